@@ -155,6 +155,55 @@ struct adaptived_schedstat_snapshot {
 	unsigned long timestamp;
 };
 
+/**
+ * Compact snapshot of the per-cpu schedstat fields, sized to the cpus in the schedstat
+ * file.  It uses a structure-of-arrays layout: each array has nr_cpus entries, and
+ * entry i of every array describes the same cpu
+ */
+struct adaptived_schedstat_cpus {
+	int nr_cpus;
+	int max_cpus;			/* the number of entries allocated in each array */
+	unsigned long timestamp;	/* in jiffies, as reported by the schedstat file */
+	long long read_ns;		/* CLOCK_MONOTONIC time when the file was read */
+
+	int *cpu;			/* the cpu number */
+	unsigned long long *ttwu;
+	unsigned long long *ttwu_local;
+	unsigned long long *run_time;
+	unsigned long long *run_delay;
+	unsigned long long *nr_timeslices;
+};
+
+/**
+ * Enumeration to map to the per-cpu tick counters in /proc/stat
+ */
+enum adaptived_cpu_stat_enum {
+	ADAPTIVED_CPU_STAT_USER = 0,
+	ADAPTIVED_CPU_STAT_NICE,
+	ADAPTIVED_CPU_STAT_SYSTEM,
+	ADAPTIVED_CPU_STAT_IDLE,
+	ADAPTIVED_CPU_STAT_IOWAIT,
+	ADAPTIVED_CPU_STAT_IRQ,
+	ADAPTIVED_CPU_STAT_SOFTIRQ,
+	ADAPTIVED_CPU_STAT_STEAL,
+
+	ADAPTIVED_CPU_STAT_CNT
+};
+
+/**
+ * An immutable, reference counted snapshot of the cpu lines in /proc/stat
+ */
+struct adaptived_cpu_stat;
+
+#define ADAPTIVED_CPUMASK_LONGS (MAX_NR_CPUS / (8 * sizeof(unsigned long)))
+
+/**
+ * A set of cpus
+ */
+struct adaptived_cpumask {
+	unsigned long bits[ADAPTIVED_CPUMASK_LONGS];
+};
+
 /**
  * Enumeration to map to the various PSI fields
  */
@@ -189,6 +238,128 @@ struct adaptived_pressure_snapshot {
 	struct adaptived_pressure_avgs full;
 };
 
+/**
+ * The resources that PSI reports pressure for
+ */
+enum adaptived_psi_resource_enum {
+	ADAPTIVED_PSI_CPU = 0,
+	ADAPTIVED_PSI_MEMORY,
+	ADAPTIVED_PSI_IO,
+
+	ADAPTIVED_PSI_RESOURCE_CNT,
+};
+
+/**
+ * The PSI data for every resource of a cgroup or of the system.  The psi_vector cause
+ * publishes one as ADAPTIVED_SDATA_PSI_VECTOR shared data when it triggers
+ */
+struct adaptived_psi_vector {
+	struct adaptived_pressure_snapshot res[ADAPTIVED_PSI_RESOURCE_CNT];
+
+	/* the combined value that the psi_vector cause compared against its threshold */
+	float value;
+};
+
+/**
+ * The cgroup v2 memory.stat fields, in the order that the kernel reports them
+ */
+enum adaptived_memorystat_enum {
+	ADAPTIVED_MEMORYSTAT_ANON = 0,
+	ADAPTIVED_MEMORYSTAT_FILE,
+	ADAPTIVED_MEMORYSTAT_KERNEL,
+	ADAPTIVED_MEMORYSTAT_KERNEL_STACK,
+	ADAPTIVED_MEMORYSTAT_PAGETABLES,
+	ADAPTIVED_MEMORYSTAT_SEC_PAGETABLES,
+	ADAPTIVED_MEMORYSTAT_PERCPU,
+	ADAPTIVED_MEMORYSTAT_SOCK,
+	ADAPTIVED_MEMORYSTAT_VMALLOC,
+	ADAPTIVED_MEMORYSTAT_SHMEM,
+	ADAPTIVED_MEMORYSTAT_ZSWAP,
+	ADAPTIVED_MEMORYSTAT_ZSWAPPED,
+	ADAPTIVED_MEMORYSTAT_FILE_MAPPED,
+	ADAPTIVED_MEMORYSTAT_FILE_DIRTY,
+	ADAPTIVED_MEMORYSTAT_FILE_WRITEBACK,
+	ADAPTIVED_MEMORYSTAT_SWAPCACHED,
+	ADAPTIVED_MEMORYSTAT_ANON_THP,
+	ADAPTIVED_MEMORYSTAT_FILE_THP,
+	ADAPTIVED_MEMORYSTAT_SHMEM_THP,
+	ADAPTIVED_MEMORYSTAT_INACTIVE_ANON,
+	ADAPTIVED_MEMORYSTAT_ACTIVE_ANON,
+	ADAPTIVED_MEMORYSTAT_INACTIVE_FILE,
+	ADAPTIVED_MEMORYSTAT_ACTIVE_FILE,
+	ADAPTIVED_MEMORYSTAT_UNEVICTABLE,
+	ADAPTIVED_MEMORYSTAT_SLAB_RECLAIMABLE,
+	ADAPTIVED_MEMORYSTAT_SLAB_UNRECLAIMABLE,
+	ADAPTIVED_MEMORYSTAT_SLAB,
+	ADAPTIVED_MEMORYSTAT_WORKINGSET_REFAULT_ANON,
+	ADAPTIVED_MEMORYSTAT_WORKINGSET_REFAULT_FILE,
+	ADAPTIVED_MEMORYSTAT_WORKINGSET_ACTIVATE_ANON,
+	ADAPTIVED_MEMORYSTAT_WORKINGSET_ACTIVATE_FILE,
+	ADAPTIVED_MEMORYSTAT_WORKINGSET_RESTORE_ANON,
+	ADAPTIVED_MEMORYSTAT_WORKINGSET_RESTORE_FILE,
+	ADAPTIVED_MEMORYSTAT_WORKINGSET_NODERECLAIM,
+	ADAPTIVED_MEMORYSTAT_PGDEMOTE_KSWAPD,
+	ADAPTIVED_MEMORYSTAT_PGDEMOTE_DIRECT,
+	ADAPTIVED_MEMORYSTAT_PGDEMOTE_KHUGEPAGED,
+	ADAPTIVED_MEMORYSTAT_PGSCAN,
+	ADAPTIVED_MEMORYSTAT_PGSTEAL,
+	ADAPTIVED_MEMORYSTAT_PGSCAN_KSWAPD,
+	ADAPTIVED_MEMORYSTAT_PGSCAN_DIRECT,
+	ADAPTIVED_MEMORYSTAT_PGSCAN_KHUGEPAGED,
+	ADAPTIVED_MEMORYSTAT_PGSTEAL_KSWAPD,
+	ADAPTIVED_MEMORYSTAT_PGSTEAL_DIRECT,
+	ADAPTIVED_MEMORYSTAT_PGSTEAL_KHUGEPAGED,
+	ADAPTIVED_MEMORYSTAT_PGFAULT,
+	ADAPTIVED_MEMORYSTAT_PGMAJFAULT,
+	ADAPTIVED_MEMORYSTAT_PGREFILL,
+	ADAPTIVED_MEMORYSTAT_PGACTIVATE,
+	ADAPTIVED_MEMORYSTAT_PGDEACTIVATE,
+	ADAPTIVED_MEMORYSTAT_PGLAZYFREE,
+	ADAPTIVED_MEMORYSTAT_PGLAZYFREED,
+	ADAPTIVED_MEMORYSTAT_ZSWPIN,
+	ADAPTIVED_MEMORYSTAT_ZSWPOUT,
+	ADAPTIVED_MEMORYSTAT_ZSWPWB,
+	ADAPTIVED_MEMORYSTAT_THP_FAULT_ALLOC,
+	ADAPTIVED_MEMORYSTAT_THP_COLLAPSE_ALLOC,
+	ADAPTIVED_MEMORYSTAT_THP_SWPOUT,
+	ADAPTIVED_MEMORYSTAT_THP_SWPOUT_FALLBACK,
+
+	ADAPTIVED_MEMORYSTAT_CNT
+};
+
+#define ADAPTIVED_MEMORYSTAT_EXTRA_MAX 32
+#define ADAPTIVED_MEMORYSTAT_KEY_MAX 48
+
+/**
+ * A memory.stat field that isn't in adaptived_memorystat_enum
+ */
+struct adaptived_memorystat_extra {
+	char key[ADAPTIVED_MEMORYSTAT_KEY_MAX];
+	long long value;
+};
+
+/**
+ * Structure to represent all of the data in a cgroup's memory.stat file
+ */
+struct adaptived_memorystat_snapshot {
+	long long values[ADAPTIVED_MEMORYSTAT_CNT];
+	bool present[ADAPTIVED_MEMORYSTAT_CNT];
+
+	/* fields that aren't in adaptived_memorystat_enum */
+	struct adaptived_memorystat_extra extra[ADAPTIVED_MEMORYSTAT_EXTRA_MAX];
+	int extra_cnt;
+	bool extra_truncated;	/* there were more than ADAPTIVED_MEMORYSTAT_EXTRA_MAX extra fields */
+};
+
+/**
+ * A single field to be read by adaptived_get_meminfo_fields()
+ */
+struct adaptived_meminfo_request {
+	const char *field;	/* input: the meminfo key, e.g. "MemAvailable" */
+	long long value;	/* output: the value, in bytes if the field has a unit */
+	int ret;		/* output: 0 on success, -ENOENT if not found, or -EINVAL */
+};
+
 /**
  * Read scheduler stats from schedstat file
  * @param schedstat_file schedstat file to read from
@@ -196,6 +367,97 @@ struct adaptived_pressure_snapshot {
  */
 int adaptived_get_schedstat(const char * const schedstat_file, struct adaptived_schedstat_snapshot * const ss);
 
+/**
+ * Read the per-cpu scheduler stats into a compact snapshot
+ * @param schedstat_file schedstat file to read from
+ * @param ss Pointer to the snapshot.  If *ss is NULL, or it is too small for the cpus in
+ * the file, it is (re)allocated.  It must be freed with adaptived_schedstat_cpus_free()
+ */
+int adaptived_get_schedstat_cpus(const char * const schedstat_file,
+				 struct adaptived_schedstat_cpus ** const ss);
+
+/**
+ * Free a snapshot allocated by adaptived_get_schedstat_cpus()
+ * @param ss Pointer to the snapshot.  It is set to NULL
+ */
+void adaptived_schedstat_cpus_free(struct adaptived_schedstat_cpus ** const ss);
+
+/**
+ * Compute the per-cpu run delay and wakeup rates between two snapshots
+ * @param prev The earlier snapshot
+ * @param cur The later snapshot
+ * @param run_delay_rate Output array (optional) of the nanoseconds per second that tasks
+ * waited to run on each cpu
+ * @param ttwu_rate Output array (optional) of the try_to_wake_up() calls per second on each
+ * cpu
+ * @param rate_cnt Number of entries in each output array.  It must be at least cur->nr_cpus
+ *
+ * @Note The output arrays are indexed like cur->cpu.  A cpu that isn't in prev (e.g. it was
+ * hotplugged) has a rate of 0
+ */
+int adaptived_schedstat_diff(const struct adaptived_schedstat_cpus * const prev,
+			     const struct adaptived_schedstat_cpus * const cur,
+			     double * const run_delay_rate, double * const ttwu_rate,
+			     int rate_cnt);
+
+/**
+ * Get a snapshot of the cpu lines in /proc/stat
+ * @param stat_file Path to the stat file to be parsed (optional).  If NULL, /proc/stat is used
+ * @param cs Output pointer for the snapshot.  It must be released with adaptived_cpu_stat_put()
+ *
+ * @Note While adaptived is running a rule, the file is parsed at most once per pass of the
+ * main loop, and every caller shares the same snapshot
+ */
+int adaptived_get_cpu_stat(const char * const stat_file, struct adaptived_cpu_stat ** const cs);
+
+/**
+ * Release a reference to a /proc/stat snapshot
+ * @param cs Pointer to the snapshot.  It is set to NULL
+ */
+void adaptived_cpu_stat_put(struct adaptived_cpu_stat ** const cs);
+
+/**
+ * Sum the per-cpu tick deltas between two /proc/stat snapshots
+ * @param prev The earlier snapshot.  If NULL, the ticks since boot are returned
+ * @param cur The later snapshot
+ * @param mask The cpus to sum (optional).  If NULL, the aggregate "cpu" line is used
+ * @param ticks Output array of the tick deltas, indexed by adaptived_cpu_stat_enum
+ *
+ * @Note Counters that went backwards contribute 0.  Cpus in mask that aren't in cur are ignored
+ */
+int adaptived_cpu_stat_delta(const struct adaptived_cpu_stat * const prev,
+			     const struct adaptived_cpu_stat * const cur,
+			     const struct adaptived_cpumask * const mask,
+			     long long ticks[ADAPTIVED_CPU_STAT_CNT]);
+
+/**
+ * Parse a cpu list, e.g. "0-3,8,10-11", into a cpumask
+ * @param cpulist The cpu list
+ * @param mask Output cpumask
+ */
+int adaptived_cpumask_parse(const char * const cpulist, struct adaptived_cpumask * const mask);
+
+/**
+ * Read a file that contains a cpu list, e.g. cpuset.cpus.effective
+ * @param file The file to read
+ * @param mask Output cpumask
+ */
+int adaptived_cpumask_read(const char * const file, struct adaptived_cpumask * const mask);
+
+/**
+ * Get the cpus in a NUMA node
+ * @param node The NUMA node
+ * @param mask Output cpumask
+ */
+int adaptived_cpumask_numa_node(int node, struct adaptived_cpumask * const mask);
+
+/**
+ * Check if a cpu is in a cpumask
+ * @param mask The cpumask
+ * @param cpu The cpu
+ */
+bool adaptived_cpumask_test(const struct adaptived_cpumask * const mask, int cpu);
+
 /**
  * Read the PSI data from the PSI file
  * @param pressure_file PSI file to read from
@@ -222,6 +484,137 @@ int adaptived_get_pressure_avg(const char * const pressure_file, enum adaptived_
 int adaptived_get_pressure_total(const char * const pressure_file,
 			      enum adaptived_pressure_meas_enum meas, long long * const total);
 
+/**
+ * Read the cpu, memory, and io PSI data in one pass
+ * @param cgroup cgroup v2 directory to read cpu.pressure, memory.pressure, and io.pressure
+ * from.  If NULL, /proc/pressure/cpu, /proc/pressure/memory, and /proc/pressure/io are read
+ * @param vec Structure to store the data into.  vec->value is set to zero
+ */
+int adaptived_get_psi_vector(const char * const cgroup, struct adaptived_psi_vector * const vec);
+
+/**
+ * The smallest and largest PSI trigger windows that the kernel accepts
+ */
+#define ADAPTIVED_PRESSURE_TRIGGER_MIN_WINDOW_US 500000LL
+#define ADAPTIVED_PRESSURE_TRIGGER_MAX_WINDOW_US 10000000LL
+
+/**
+ * Create a kernel PSI trigger on a PSI file
+ * @param pressure_file PSI file, e.g. /proc/pressure/memory or a cgroup's memory.pressure
+ * @param full If true, monitor the "full" stall time.  Otherwise monitor the "some" stall time
+ * @param stall_us Notify when the tasks have been stalled for more than this many microseconds...
+ * @param window_us ...within this many microseconds
+ * @param fd Location to store the trigger file descriptor
+ *
+ * The kernel signals the trigger by raising POLLPRI (EPOLLPRI) on the file descriptor at most
+ * once per window.  The trigger is removed when the file descriptor is closed.  Returns
+ * -EOPNOTSUPP if pressure_file is not a procfs or cgroupfs PSI file
+ */
+int adaptived_pressure_trigger_open(const char * const pressure_file, bool full,
+				    long long stall_us, long long window_us, int * const fd);
+
+/**
+ * Check, without blocking, whether a PSI trigger has fired
+ * @param fd File descriptor returned by adaptived_pressure_trigger_open()
+ *
+ * Returns 1 if the trigger has fired since it was last checked, 0 if not, and -ENODEV if the
+ * PSI file is no longer valid (e.g. its cgroup has been removed).  Checking the trigger
+ * consumes the event
+ */
+int adaptived_pressure_trigger_check(int fd);
+
+/**
+ * An immutable, reference counted table of the PSI data of every cgroup in a tree
+ */
+struct adaptived_psi_scan;
+
+/**
+ * A cgroup returned by adaptived_psi_scan_top() or adaptived_psi_scan_above()
+ */
+struct adaptived_psi_scan_entry {
+	const char *cgroup;	/* valid as long as the scan is held */
+	float value;		/* the requested measurement */
+};
+
+/**
+ * Get the PSI data of every cgroup in a tree
+ * @param cgroup Root of the tree.  It's walked like adaptived_path_walk_start() does
+ * @param res The resource whose PSI file is read in each cgroup
+ * @param max_depth How deep to walk the tree.  See adaptived_path_walk_start()
+ * @param scan Output pointer for the scan.  It must be released with adaptived_psi_scan_put()
+ *
+ * @Note While adaptived is running a rule, each tree is walked at most once per pass of the
+ * main loop, and every caller that asks for the same cgroup, res, and max_depth shares the
+ * same scan
+ */
+int adaptived_get_psi_scan(const char * const cgroup, enum adaptived_psi_resource_enum res,
+			   int max_depth, struct adaptived_psi_scan ** const scan);
+
+/**
+ * Release a reference to a PSI scan
+ * @param scan Pointer to the scan.  It is set to NULL
+ */
+void adaptived_psi_scan_put(struct adaptived_psi_scan ** const scan);
+
+/**
+ * Return the number of cgroups in a PSI scan
+ * @param scan The scan
+ */
+int adaptived_psi_scan_count(const struct adaptived_psi_scan * const scan);
+
+/**
+ * How adaptived_psi_scan_top() orders cgroups with the same PSI
+ */
+enum adaptived_psi_scan_tie_enum {
+	ADAPTIVED_PSI_SCAN_TIE_FIRST_WALKED = 0,	/* an ancestor comes before its descendants */
+	ADAPTIVED_PSI_SCAN_TIE_LAST_WALKED,		/* a descendant comes before its ancestors */
+
+	ADAPTIVED_PSI_SCAN_TIE_CNT,
+};
+
+/**
+ * Find the cgroups with the highest (or lowest) PSI in a scan
+ * @param scan The scan
+ * @param meas The measurement to compare.  Only the avg measurements are supported
+ * @param lowest If true, find the cgroups with the lowest PSI instead
+ * @param tie How cgroups with the same PSI are ordered
+ * @param top Output array, sorted from the highest (or lowest) PSI
+ * @param top_cnt Number of entries in top
+ *
+ * @return The number of cgroups stored in top (at most top_cnt), or a negative errno
+ */
+int adaptived_psi_scan_top(const struct adaptived_psi_scan * const scan,
+			   enum adaptived_pressure_meas_enum meas, bool lowest,
+			   enum adaptived_psi_scan_tie_enum tie,
+			   struct adaptived_psi_scan_entry * const top, int top_cnt);
+
+/**
+ * Find the cgroup with the highest PSI in a scan
+ * @param scan The scan
+ * @param meas The measurement to compare.  Only the avg measurements are supported
+ * @param max Output for the cgroup.  If several cgroups tie, the first one walked is returned
+ *
+ * @return 0 on success, -ENOENT if the scan is empty
+ */
+int adaptived_psi_scan_max(const struct adaptived_psi_scan * const scan,
+			   enum adaptived_pressure_meas_enum meas,
+			   struct adaptived_psi_scan_entry * const max);
+
+/**
+ * Find the cgroups whose PSI is above a threshold
+ * @param scan The scan
+ * @param meas The measurement to compare.  Only the avg measurements are supported
+ * @param threshold The cgroups whose measurement is greater than this are returned
+ * @param above Output array, in walk order
+ * @param above_cnt Number of entries in above
+ *
+ * @return The number of cgroups above the threshold, or a negative errno.  Only the first
+ * above_cnt of them are stored in above
+ */
+int adaptived_psi_scan_above(const struct adaptived_psi_scan * const scan,
+			     enum adaptived_pressure_meas_enum meas, float threshold,
+			     struct adaptived_psi_scan_entry * const above, int above_cnt);
+
 /**
  * Append a float measurement to a float array
  * @param array Float array
@@ -262,6 +655,124 @@ int adaptived_farray_append(float * const array, const float * const value, int
 int adaptived_farray_linear_regression(float * const array, int array_len, int interval,
 				    int interp_x, float * const interp_y);
 
+/**
+ * A fixed-size window of timestamped samples that maintains the sums needed for a
+ * linear regression, so that appending a sample and computing the regression are O(1)
+ */
+struct adaptived_series;
+
+/**
+ * Allocate a series
+ * @param capacity Maximum number of samples in the window.  Once the window is full, each
+ * new sample replaces the oldest one
+ */
+struct adaptived_series *adaptived_series_alloc(int capacity);
+
+/**
+ * Free a series allocated by adaptived_series_alloc()
+ * @param series Pointer to the series.  It is set to NULL
+ */
+void adaptived_series_free(struct adaptived_series ** const series);
+
+/**
+ * Append a sample to a series
+ * @param series Series
+ * @param time Time of the sample (e.g. milliseconds).  The samples need not be evenly
+ * spaced, but time must not go backwards
+ * @param value Value of the sample
+ */
+int adaptived_series_append(struct adaptived_series * const series, long long time,
+			    double value);
+
+/**
+ * Get the number of samples in a series
+ * @param series Series
+ */
+int adaptived_series_count(const struct adaptived_series * const series);
+
+/**
+ * Remove every sample from a series
+ * @param series Series
+ */
+void adaptived_series_reset(struct adaptived_series * const series);
+
+/**
+ * Use linear regression on a series to predict its value at a point in time
+ * @param series Series
+ * @param time Time to predict the value at, in the same units as the samples
+ * @param value Location to store the predicted value
+ *
+ * Returns -EINVAL if the series has fewer than two samples or all of its samples have
+ * the same time
+ */
+int adaptived_series_linear_regression(const struct adaptived_series * const series,
+				       long long time, double * const value);
+
+/**
+ * Models that an adaptived_predictor can use to forecast a series
+ */
+enum adaptived_predictor_enum {
+	ADAPTIVED_PREDICTOR_OLS = 0,	/* least-squares line over the window */
+	ADAPTIVED_PREDICTOR_EWMA,	/* exponentially weighted moving average (flat) */
+	ADAPTIVED_PREDICTOR_HOLT,	/* Holt's linear trend (double exponential smoothing) */
+	ADAPTIVED_PREDICTOR_P95,	/* streaming estimate of the 95th percentile (flat) */
+
+	ADAPTIVED_PREDICTOR_CNT,
+};
+
+/**
+ * A streaming forecaster.  Every model costs O(1) per sample
+ */
+struct adaptived_predictor;
+
+/**
+ * Look up a predictor model by name
+ * @param name Model name: "ols", "ewma", "holt", or "p95"
+ *
+ * Returns the enum adaptived_predictor_enum value, or -EINVAL if the name is unknown
+ */
+int adaptived_predictor_model_idx(const char * const name);
+
+/**
+ * Allocate a predictor
+ * @param model See enum adaptived_predictor_enum
+ * @param window Number of samples that the model considers.  The ols model keeps this many
+ * samples.  The other models keep no samples and use a smoothing factor of 2 / (window + 1),
+ * which gives them the same center of mass as a window-length moving average
+ */
+struct adaptived_predictor *adaptived_predictor_alloc(enum adaptived_predictor_enum model,
+						      int window);
+
+/**
+ * Free a predictor allocated by adaptived_predictor_alloc()
+ * @param pred Pointer to the predictor.  It is set to NULL
+ */
+void adaptived_predictor_free(struct adaptived_predictor ** const pred);
+
+/**
+ * Add a sample to a predictor
+ * @param pred Predictor
+ * @param time Time of the sample (e.g. milliseconds).  Time must not go backwards
+ * @param value Value of the sample
+ */
+int adaptived_predictor_update(struct adaptived_predictor * const pred, long long time,
+			       double value);
+
+/**
+ * Get the number of samples that a predictor has seen, up to its window
+ * @param pred Predictor
+ */
+int adaptived_predictor_count(const struct adaptived_predictor * const pred);
+
+/**
+ * Forecast the value of the series at a point in time
+ * @param pred Predictor
+ * @param time Time to forecast the value at, in the same units as the samples
+ * @param value Location to store the forecast
+ */
+int adaptived_predictor_forecast(const struct adaptived_predictor * const pred, long long time,
+				 double * const value);
+
 #define ADAPTIVED_CGROUP_FLAGS_VALIDATE 0x1
 #define ADAPTIVED_CGROUP_FLAGS_RUNTIME	0x2	/* systemctl --runtime: make changes only temporarily */
 
@@ -341,6 +852,36 @@ int adaptived_cgroup_get_memorystat_field(const char * const memorystat_file,
 				       const char * const field,
 				       long long * const ll_valuep);
 
+/**
+ * Read and parse an entire memory.stat file
+ * @param memorystat_file Path to the cgroup's memory.stat file
+ * @param snap Output structure for storing the values
+ *
+ * @Note The file is parsed at most once per pass of the main loop, so every cause that reads
+ * the same memory.stat file shares a single parse
+ */
+int adaptived_cgroup_get_memorystat(const char * const memorystat_file,
+				    struct adaptived_memorystat_snapshot * const snap);
+
+/**
+ * Map a memory.stat field name to its adaptived_memorystat_enum value
+ * @param field The field name, e.g. "workingset_refault_file"
+ *
+ * @return The enum value, or -ENOENT if the field isn't in adaptived_memorystat_enum
+ */
+int adaptived_memorystat_field_idx(const char * const field);
+
+/**
+ * Look up a field, by name, in a memory.stat snapshot
+ * @param snap The snapshot populated by adaptived_cgroup_get_memorystat()
+ * @param field The field name
+ * @param ll_valuep Output pointer for storing the value
+ *
+ * @return 0 on success, -ENOENT if the field isn't in the snapshot
+ */
+int adaptived_memorystat_get_field(const struct adaptived_memorystat_snapshot * const snap,
+				   const char * const field, long long * const ll_valuep);
+
 /**
  * Read and return the /proc/meminfo field value.
  * @param meminfo_file Path to the meminfo file to be parsed (optional).  If NULL, /proc/meminfo
@@ -354,6 +895,112 @@ int adaptived_cgroup_get_memorystat_field(const char * const memorystat_file,
 int adaptived_get_meminfo_field(const char * const meminfo_file,
 			     const char * const field, long long * const ll_valuep);
 
+/**
+ * Read several /proc/meminfo fields with a single pass over the file.
+ * @param meminfo_file Path to the meminfo file to be parsed (optional).  If NULL, /proc/meminfo
+ * is used
+ * @param reqs Array of requests.  The value and ret of each request are filled in
+ * @param req_cnt Number of requests in reqs
+ *
+ * @return 0 if every field was read, the ret of the first request that failed, or a negative
+ * errno if the file could not be read
+ *
+ * @Note Fields are matched exactly, i.e. "Cached" does not match "SwapCached".  Like
+ * adaptived_get_meminfo_field(), fields that are in kilobytes, etc. are returned in bytes.
+ */
+int adaptived_get_meminfo_fields(const char * const meminfo_file,
+			      struct adaptived_meminfo_request * const reqs, int req_cnt);
+
+/**
+ * The columns in /proc/slabinfo
+ */
+enum adaptived_slabinfo_column_enum {
+	ADAPTIVED_SLABINFO_ACTIVE_OBJS = 0,
+	ADAPTIVED_SLABINFO_NUM_OBJS,
+	ADAPTIVED_SLABINFO_OBJSIZE,
+	ADAPTIVED_SLABINFO_OBJPERSLAB,
+	ADAPTIVED_SLABINFO_PAGESPERSLAB,
+	ADAPTIVED_SLABINFO_LIMIT,
+	ADAPTIVED_SLABINFO_BATCHCOUNT,
+	ADAPTIVED_SLABINFO_SHAREDFACTOR,
+	ADAPTIVED_SLABINFO_ACTIVE_SLABS,
+	ADAPTIVED_SLABINFO_NUM_SLABS,
+	ADAPTIVED_SLABINFO_SHAREDAVAIL,
+
+	ADAPTIVED_SLABINFO_COLUMN_CNT
+};
+
+/**
+ * An immutable, reference counted snapshot of /proc/slabinfo
+ */
+struct adaptived_slabinfo_snapshot;
+
+/**
+ * A slab cache returned by adaptived_slabinfo_top_growth()
+ */
+struct adaptived_slabinfo_growth {
+	const char *name;	/* valid as long as the current snapshot is held */
+	long long value;	/* the column's value in the current snapshot */
+	long long delta;	/* the change since the previous snapshot */
+};
+
+/**
+ * Map a slabinfo column name to its adaptived_slabinfo_column_enum value
+ * @param column The column name, e.g. "<active_objs>"
+ *
+ * @return The enum value, or -EINVAL if the column is invalid
+ */
+int adaptived_slabinfo_column_idx(const char * const column);
+
+/**
+ * Get a snapshot of the slabinfo file
+ * @param slabinfo_file Path to the slabinfo file to be parsed (optional). If NULL,
+ * /proc/slabinfo is used.
+ * @param snap Output pointer for the snapshot.  It must be released with
+ * adaptived_slabinfo_put()
+ *
+ * @Note While adaptived is running a rule, the file is parsed at most once per pass of the
+ * main loop, and every caller shares the same snapshot
+ */
+int adaptived_get_slabinfo(const char * const slabinfo_file,
+			   struct adaptived_slabinfo_snapshot ** const snap);
+
+/**
+ * Release a reference to a snapshot
+ * @param snap Pointer to the snapshot.  It is set to NULL
+ */
+void adaptived_slabinfo_put(struct adaptived_slabinfo_snapshot ** const snap);
+
+/**
+ * Look up a value in a slabinfo snapshot
+ * @param snap The snapshot
+ * @param name The name of the slab cache, e.g. "dentry"
+ * @param column The column to return
+ * @param ll_valuep Output pointer for storing the value
+ *
+ * @return 0 on success, -ENOENT if the slab cache doesn't exist
+ */
+int adaptived_slabinfo_get_value(const struct adaptived_slabinfo_snapshot * const snap,
+				 const char * const name,
+				 enum adaptived_slabinfo_column_enum column,
+				 long long * const ll_valuep);
+
+/**
+ * Find the slab caches whose column grew the most between two snapshots
+ * @param cur The current snapshot
+ * @param prev The previous snapshot.  Slab caches that aren't in prev are treated as
+ * having grown from 0
+ * @param column The column to compare
+ * @param top Output array, sorted by descending delta
+ * @param top_cnt Number of entries in top
+ *
+ * @return The number of slab caches that grew (at most top_cnt), or a negative errno
+ */
+int adaptived_slabinfo_top_growth(const struct adaptived_slabinfo_snapshot * const cur,
+				  const struct adaptived_slabinfo_snapshot * const prev,
+				  enum adaptived_slabinfo_column_enum column,
+				  struct adaptived_slabinfo_growth * const top, int top_cnt);
+
 /**
  * Read and return the /proc/slabinfo field & column value
  * @param slabinfo_file Path to the slabinfo file to be parsed (optional). If NULL,
@@ -361,6 +1008,8 @@ int adaptived_get_meminfo_field(const char * const meminfo_file,
  * @param field The field in the slabinfo file to parse
  * @param column The column in the slabinfo file to parse (i.e. <active_objs>)
  * @param ll_valuep Output pointer for storing the field & column value
+ *
+ * @Note if the slab cache doesn't exist, 0 is returned and the value is 0
  */
 int adaptived_get_slabinfo_field(const char * const slabinfo_file,
 			      const char * const field, const char * const column,
@@ -425,6 +1074,142 @@ int adaptived_path_walk_next(struct adaptived_path_walk_handle **handle, char **
  */
 void adaptived_path_walk_end(struct adaptived_path_walk_handle **handle);
 
+/**
+ * A directory walk that returns entries relative to an open directory file descriptor
+ *
+ * Unlike adaptived_path_walk_next(), no path strings are built and nothing is
+ * allocated per entry.  Callers can openat() the files they need directly
+ */
+struct adaptived_dir_walk;
+
+struct adaptived_dir_walk_entry {
+	/* The directory containing the entry.  AT_FDCWD for the root of the walk */
+	int dirfd;
+	/* The entry's name within dirfd.  For the root of the walk, the root path */
+	const char *name;
+	/*
+	 * An open file descriptor for the entry if it's a directory (other than
+	 * "." or ".."), else -1.  It is owned by the walk
+	 */
+	int fd;
+	/* 0 for the root of the walk, 1 for its children, ... */
+	int depth;
+	/* DT_DIR or DT_REG */
+	unsigned char type;
+};
+
+/**
+ * Start a dirfd-relative directory walk
+ * @param path The path to be walked
+ * @param flags ADAPTIVED_PATH_WALK_* flags.  See adaptived_path_walk_start()
+ * @param max_depth How deep to recurse through the tree.  See adaptived_path_walk_start()
+ * @param walk Opaque pointer to an internal data structure
+ *
+ * @return 0 on success, negative errno on failure
+ *
+ * @Note adaptived_dir_walk_end() must be called after a successful return of this
+ *	 function so that the internal data structure can be freed
+ * @Note the path is trimmed and the root is listed exactly as adaptived_path_walk_start()
+ *	 does.  Entries whose d_type is DT_UNKNOWN are stat()ed rather than skipped
+ */
+int adaptived_dir_walk_start(const char * const path, int flags, int max_depth,
+			     struct adaptived_dir_walk ** const walk);
+
+/**
+ * Return the next entry in the walk
+ * @param walk Opaque pointer to an internal data structure
+ * @param entry The next entry
+ *
+ * @return 1 if an entry was returned, 0 at the end of the walk, negative errno on failure
+ *
+ * @Note directories are returned before their contents.  The entry's name, dirfd,
+ *	 and fd are only valid until the next call to this function
+ */
+int adaptived_dir_walk_next(struct adaptived_dir_walk * const walk,
+			    struct adaptived_dir_walk_entry * const entry);
+
+/**
+ * End the directory walk
+ * @param walk Opaque pointer to an internal data structure
+ *
+ * All file descriptors opened by the walk are closed
+ */
+void adaptived_dir_walk_end(struct adaptived_dir_walk ** const walk);
+
+/**
+ * A persistent index of the directories in a cgroup tree.  It is kept current with inotify
+ */
+struct adaptived_cgroup_tree;
+
+/**
+ * A directory in a cgroup tree
+ */
+struct adaptived_cgroup_tree_node;
+
+/**
+ * Get the index of a cgroup tree, and hold it until adaptived_cgroup_tree_put() is called
+ * @param cgroup Root of the tree.  Trailing "*" and "/" characters are ignored
+ * @param tree Output pointer for the tree
+ *
+ * The tree is built the first time it is requested and is then updated from inotify
+ * events, so it can be iterated without accessing the filesystem.  While adaptived is
+ * running a rule, the events are read at most once per pass of the main loop.  The tree
+ * can't change while it is held, and it must be released before it is requested again
+ * by the same thread
+ *
+ * @return 0 on success, negative errno otherwise.  -ENOSPC is returned if the inotify
+ * watch limit has been reached
+ */
+int adaptived_get_cgroup_tree(const char * const cgroup,
+			      struct adaptived_cgroup_tree ** const tree);
+
+/**
+ * Release a cgroup tree
+ * @param tree Pointer to the tree.  It is set to NULL
+ */
+void adaptived_cgroup_tree_put(struct adaptived_cgroup_tree ** const tree);
+
+/**
+ * Iterate over the directories in a cgroup tree
+ * @param tree The tree
+ * @param node The previous directory.  If NULL, the root of the tree is returned
+ * @param max_depth How deep to walk the tree.  See adaptived_path_walk_start()
+ *
+ * @return The next directory in the tree, or NULL at the end of the tree.  Directories
+ * are returned before their children, like adaptived_path_walk_next() does
+ */
+struct adaptived_cgroup_tree_node *adaptived_cgroup_tree_next(
+		const struct adaptived_cgroup_tree * const tree,
+		const struct adaptived_cgroup_tree_node * node, int max_depth);
+
+/**
+ * Return the full path of a directory in a cgroup tree.  It's valid as long as the tree
+ * is held
+ * @param node The directory
+ */
+const char *adaptived_cgroup_tree_node_path(const struct adaptived_cgroup_tree_node * const node);
+
+/**
+ * Return the name of a directory in a cgroup tree.  It's valid as long as the tree is held
+ * @param node The directory
+ */
+const char *adaptived_cgroup_tree_node_name(const struct adaptived_cgroup_tree_node * const node);
+
+/**
+ * Return the depth of a directory in a cgroup tree.  The root is at depth 0
+ * @param node The directory
+ */
+int adaptived_cgroup_tree_node_depth(const struct adaptived_cgroup_tree_node * const node);
+
+/**
+ * Return a file descriptor for a directory in a cgroup tree, e.g. to openat() its files
+ * @param node The directory
+ *
+ * The descriptor is opened the first time it is requested, and it is owned by the tree.
+ * It must not be closed by the caller
+ */
+int adaptived_cgroup_tree_node_dirfd(struct adaptived_cgroup_tree_node * const node);
+
 
 enum cg_setting_enum {
         CG_SETTING = 0,
@@ -30,6 +30,7 @@ extern "C" {
 
 #include <json-c/json.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 
 /*
@@ -59,6 +60,7 @@ enum adaptived_attr {
 	ADAPTIVED_ATTR_DAEMON_MODE, /* run as daemon */
 	ADAPTIVED_ATTR_DAEMON_NOCHDIR,
 	ADAPTIVED_ATTR_DAEMON_NOCLOSE,
+	ADAPTIVED_ATTR_WORKERS, /* number of threads used to run rules. see the README */
 
 	ADAPTIVED_ATTR_CNT
 };
@@ -72,6 +74,7 @@ enum adaptived_sdata_type {
 	ADAPTIVED_SDATA_STR,
 	ADAPTIVED_SDATA_CGROUP,
 	ADAPTIVED_SDATA_NAME_VALUE,
+	ADAPTIVED_SDATA_PSI_VECTOR, /* struct adaptived_psi_vector */
 
 	ADAPTIVED_SDATA_CNT
 };
@@ -80,6 +83,15 @@ enum adaptived_sdata_flags {
 	ADAPTIVED_SDATAF_PERSIST = 0x1
 };
 
+enum adaptived_cause_flags {
+	/*
+	 * The cause must be run every time its rule is run, even if an earlier cause in
+	 * the rule did not trigger.  Set this for causes that maintain state across
+	 * samples, e.g. running averages, windows, or durations
+	 */
+	ADAPTIVED_CAUSEF_EVERY_SAMPLE = 0x1
+};
+
 /**
  * Function to free a custom shared data structure.  Not needed for any other
  * shared data type, as adaptived knows how to free built-in data types.
@@ -124,13 +136,35 @@ struct adaptived_rule_stats {
 	long long loops_run_cnt;
 	long long trigger_cnt;
 	long long snooze_cnt;
+
+	/* the rule was still running (or had not started) when its next deadline passed */
+	long long overrun_cnt;
+	/* deadlines that were dropped because the rule was running late */
+	long long skipped_cnt;
+
+	/* causes that were not run because an earlier cause in the rule did not trigger */
+	long long cause_skip_cnt;
+
+	/*
+	 * The following are only used by rules whose effect_dispatch is async.  Latencies
+	 * are in milliseconds and are measured from when the effects were queued until
+	 * they completed
+	 */
+	long long effect_dispatch_cnt;	/* the effects were queued to run asynchronously */
+	long long effect_done_cnt;	/* the queued effects completed, successfully or not */
+	long long effect_fail_cnt;	/* an effect returned an error */
+	/* the rule was not run because its effects from an earlier run had not completed */
+	long long effect_busy_cnt;
+	int effect_last_ret;		/* the return value of the most recently completed effects */
+	long long effect_last_latency;
+	long long effect_max_latency;
 };
 
 /**
  * Initialization routine for a cause
  * @param cse Cause structure for this cause
  * @param args_obj JSON object representation of the args parameter for this cause
- * @param interval How often in milliseconds the adaptived main loop will run
+ * @param interval How often in milliseconds the rule containing this cause will run
  */
 typedef int (*adaptived_cause_init)(struct adaptived_cause * const cse, struct json_object *args_obj,
 				 int interval);
@@ -138,10 +172,10 @@ typedef int (*adaptived_cause_init)(struct adaptived_cause * const cse, struct j
 /**
  * Main processing logic for a cause
  * @param cse Cause structure for this cause
- * @param time_since_last_run Delta time since this cause last ran
+ * @param time_since_last_run Measured time in milliseconds since this cause last ran
  *
- * Note that currently the adaptived_loop() passes in ctx->interval in the time_since_last_run
- * field.  In the future it could track the actual delta time between runs
+ * The first time a cause is run, and when ADAPTIVED_ATTR_SKIP_SLEEP is set, the
+ * adaptived_loop() passes in the interval of the rule instead
  */
 typedef int (*adaptived_cause_main)(struct adaptived_cause * const cse, int time_since_last_run);
 
@@ -279,6 +313,52 @@ void *adaptived_cause_get_data(const struct adaptived_cause * const cse);
  */
 int adaptived_cause_set_data(struct adaptived_cause * const cse, void * const data);
 
+/**
+ * Set the flags in a cause structure
+ * @param cse Cause pointer
+ * @param flags See enum adaptived_cause_flags
+ *
+ * Once a cause in a rule does not trigger, the rule cannot trigger, and adaptived skips the
+ * remaining causes in the rule unless they have ADAPTIVED_CAUSEF_EVERY_SAMPLE set.  Built-in
+ * causes set their own flags.  Registered causes default to ADAPTIVED_CAUSEF_EVERY_SAMPLE; a
+ * stateless registered cause can call this function with flags = 0 in its init routine to allow
+ * it to be skipped.
+ */
+int adaptived_cause_set_flags(struct adaptived_cause * const cse, uint32_t flags);
+
+/**
+ * Wake the rule containing this cause whenever a file descriptor is ready
+ * @param cse Cause pointer
+ * @param fd File descriptor to be monitored, e.g. a PSI trigger or an inotify fd
+ * @param events epoll events to monitor for, e.g. EPOLLIN or EPOLLPRI
+ *
+ * The adaptived_loop() adds the fd to its epoll set.  When the fd is ready, the rule is
+ * run immediately rather than waiting for its next interval.  The fd is monitored in
+ * level-triggered mode, so the cause must consume the event (e.g. read the fd) when it
+ * is run.  The cause still owns the fd and is responsible for closing it, typically in
+ * its exit routine.  This is usually called from the cause's init routine.
+ */
+int adaptived_cause_register_fd(struct adaptived_cause * const cse, int fd, uint32_t events);
+
+/**
+ * Stop monitoring a file descriptor previously registered by adaptived_cause_register_fd()
+ * @param cse Cause pointer
+ * @param fd File descriptor
+ */
+int adaptived_cause_unregister_fd(struct adaptived_cause * const cse, int fd);
+
+/**
+ * Check whether the main loop has seen a registered file descriptor become ready
+ * @param cse Cause pointer
+ * @param fd File descriptor previously registered by adaptived_cause_register_fd()
+ *
+ * Returns 1 if the fd was reported ready since the last call and 0 if not.  Some file
+ * descriptors, e.g. PSI triggers, clear their event as soon as epoll reports it, so the
+ * cause cannot tell from the fd itself that it was ready.  Returns -ENOENT if the fd is
+ * not registered
+ */
+int adaptived_cause_fd_pending(struct adaptived_cause * const cse, int fd);
+
 /**
  * Get the private data pointer in an effect structure
  * @param eff Effect pointer
@@ -473,6 +553,14 @@ int adaptived_rule_add_cause(struct adaptived_rule * const rule, const struct ad
  */
 int adaptived_rule_add_effect(struct adaptived_rule * const rule, const struct adaptived_effect * const eff);
 
+/**
+ * Set how often an in-memory rule is evaluated
+ * @param rule Pointer to the rule object
+ * @param interval How often in milliseconds the rule will be run.  If this is never set,
+ *        the rule runs at the adaptived main loop interval (ADAPTIVED_ATTR_INTERVAL)
+ */
+int adaptived_rule_set_interval(struct adaptived_rule * const rule, int interval);
+
 /**
  * Given an in-memory rule, load it into the adaptived loop for processing
  * @param ctx adaptived context
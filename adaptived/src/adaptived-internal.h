@@ -32,9 +32,12 @@
 extern "C" {
 #endif
 
+#include <sys/epoll.h>
+#include <sys/types.h>
 #include <stdbool.h>
 #include <pthread.h>
 #include <syslog.h>
+#include <signal.h>
 #include <stdio.h>
 
 #include <adaptived.h>
@@ -53,7 +56,18 @@ extern "C" {
       __x < __y ? __x : __y; })
 #endif
 
+/*
+ * The ctx attributes may be read and written by other threads while adaptived_loop()
+ * is running.  They are accessed atomically rather than under the ctx_mutex so that
+ * adaptived_get_attr() and adaptived_set_attr() never wait on a running rule
+ */
+#define ATTR_LOAD(x) __atomic_load_n(&(x), __ATOMIC_RELAXED)
+#define ATTR_STORE(x, v) __atomic_store_n(&(x), (v), __ATOMIC_RELAXED)
+
 typedef int (*adaptived_injection_function)(struct adaptived_ctx * const ctx);
+typedef void (*worker_fn)(void * const arg);
+
+struct worker_pool;
 
 enum log_location {
 	LOG_LOC_SYSLOG = 0,
@@ -70,8 +84,102 @@ struct adaptived_rule {
 	struct adaptived_effect *effects;
 	struct json_object *json; /* only used when building a rule at runtime */
 	struct adaptived_rule_stats stats;
+	unsigned int stats_seq; /* seqlock protecting stats.  odd while an update is in progress */
+	pthread_mutex_t rule_mutex; /* held while the rule is run and its stats are updated */
+
+	/*
+	 * The order in which the causes are evaluated.  This is the order in the
+	 * configuration file unless cause_order is adaptive.  rule->causes is never
+	 * reordered, as effects may depend upon it
+	 */
+	struct adaptived_cause **eval_order;
+	int eval_cnt;
+	bool adaptive_order;
+
+	/*
+	 * If async_effects is set, the effects are run on the ctx's effect pool rather
+	 * than by the thread that ran the causes.  effects_pending is set from when the
+	 * effects are queued until they complete, and the rule is not run in the
+	 * meantime.  It is accessed atomically
+	 */
+	bool async_effects;
+	bool effects_pending;
+	long long effects_queued; /* CLOCK_MONOTONIC time in milliseconds */
+
+	/* scheduling */
+	int interval; /* in milliseconds.  0 means use the ctx->interval */
+	long long next_run; /* CLOCK_MONOTONIC time in milliseconds */
+	unsigned long seq; /* load order.  used to break ties in the scheduler */
+
+	struct adaptived_rule *next; /* only used to link rules that are waiting to be freed */
+};
+
+/*
+ * Causes with the same name, arguments, and interval are evaluated once per pass
+ * through the main loop and the result is shared by every rule that uses them.
+ * See cause_group.c
+ */
+struct cause_group {
+	char *key;
+	struct adaptived_cause *cse; /* the shared instance that is evaluated */
+	int refcnt;
+	struct adaptived_ctx *ctx;
+
+	pthread_mutex_t lock; /* held while the shared instance is evaluated */
+	unsigned long result_pass; /* the pass through the main loop that produced result */
+	long long next_due; /* the result is reused until this time.  see cause_group_run() */
+	int result;
+
+	struct cause_group *prev;
+	struct cause_group *next;
+};
+
+/*
+ * An immutable array of the loaded rules.  See rule_set.c
+ */
+struct rule_set {
+	struct adaptived_rule **rules;
+	int cnt;
+	int size;
+	unsigned long gen; /* incremented each time a rule set is published */
+
+	/* only used once the rule set has been replaced */
+	struct adaptived_rule *dead; /* rules to free along with this rule set */
+	unsigned long retire_epoch;
+	struct rule_set *retired_next;
+};
+
+struct rule_heap {
+	struct adaptived_rule **rules;
+	int cnt;
+	int size;
+};
 
-	struct adaptived_rule *next;
+#define EVENT_LOOP_MAX_EVENTS 64
+
+enum event_loop_flags {
+	EVENT_EXIT = 0x1,
+	EVENT_RELOAD = 0x2,
+	EVENT_RULE_WOKEN = 0x4,
+};
+
+struct event_loop {
+	int epoll_fd;
+	int timer_fd;
+	int wake_fd;
+	int signal_fd; /* only used in daemon mode */
+	int inotify_fd; /* only used in daemon mode */
+	char config_name[FILENAME_MAX];
+
+	sigset_t old_mask;
+	bool mask_set;
+
+	/* used to detect when the epoll set needs to be rebuilt */
+	unsigned long rules_gen;
+	unsigned long fds_gen;
+
+	struct epoll_event events[EVENT_LOOP_MAX_EVENTS];
+	int event_cnt;
 };
 
 struct adaptived_ctx {
@@ -79,13 +187,25 @@ struct adaptived_ctx {
 	char config[FILENAME_MAX];
 	int interval; /* in seconds */
 	int max_loops;
+	int workers; /* number of threads used to run rules.  1 runs them in the main loop */
+	struct worker_pool *effect_pool; /* runs asynchronous effects.  created on demand */
 
 	/* internal settings and structures */
-	struct adaptived_rule *rules;
+	struct rule_set *rule_set; /* the loaded rules.  see rule_set.c */
+	pthread_mutex_t update_mutex; /* serializes updates to the rule set */
+	struct rule_set *retired;
+	unsigned long epoch;
+	int epoch_readers[2];
+	int rule_cnt;
+	struct cause_group *cause_groups; /* protected by the update mutex */
+	struct read_cache *read_cache; /* files read during the current pass */
 	adaptived_injection_function inject_fn;
 	bool skip_sleep;
 	pthread_mutex_t ctx_mutex;
 	unsigned long loop_cnt;
+	unsigned long pass_cnt; /* every pass through the main loop.  never reset */
+	unsigned long rule_seq;
+	int wake_fd; /* eventfd used to wake the main loop.  -1 if the loop isn't running */
 	int daemon_nochdir;
 	int daemon_noclose;
 	bool daemon_mode;
@@ -99,6 +219,17 @@ struct adaptived_cause *cause_init(const char * const name);
 void cause_destroy(struct adaptived_cause ** cse);
 void causes_init(void);
 void causes_cleanup(void);
+extern unsigned long cause_fds_gen;
+
+/*
+ * cause_group.c functions
+ */
+
+int cause_group_get(struct adaptived_ctx * const ctx, struct adaptived_cause * const cse,
+		    struct json_object * const args_obj, int interval);
+void cause_group_put(struct cause_group ** grp);
+int cause_group_run(struct cause_group * const grp, unsigned long pass, long long now,
+		    int interval, bool nominal);
 
 /*
  * effect.c functions
@@ -109,6 +240,39 @@ void effect_destroy(struct adaptived_effect ** eff);
 void effects_init(void);
 void effects_cleanup(void);
 
+/*
+ * event_loop.c functions
+ */
+
+int event_loop_init(struct event_loop * const evl, struct adaptived_ctx * const ctx);
+int event_loop_update(struct event_loop * const evl, const struct rule_set * const set);
+void event_loop_wait(struct event_loop * const evl, long long deadline, bool block);
+int event_loop_process(struct event_loop * const evl, const struct rule_set * const set,
+		       long long now);
+void event_loop_wake(struct adaptived_ctx * const ctx);
+void event_loop_cleanup(struct event_loop * const evl, struct adaptived_ctx * const ctx);
+
+/*
+ * cgroup_tree.c functions
+ */
+
+void cgroup_tree_flush(void);
+
+/*
+ * cpu_utils.c functions
+ */
+
+void cpu_stat_flush(void);
+
+/*
+ * fd_cache.c functions
+ */
+
+ssize_t fd_cache_pread(const char * const path, char * const buf, size_t size);
+int fd_cache_read(const char * const path, char ** const buf, size_t * const len,
+		  size_t * const size);
+void fd_cache_flush(void);
+
 /*
  * file_utils.c functions
  */
@@ -123,30 +287,151 @@ int get_ll_field_in_file(const char * const file, const char * const field,
 extern int log_level;
 extern enum log_location log_loc;
 
+/*
+ * mem_utils.c functions
+ */
+
+void slabinfo_flush(void);
+
 /*
  * parse.c functions
  */
 
-int parse_config(struct adaptived_ctx * const ctx);
-int parse_rule(struct adaptived_ctx * const ctx, struct json_object * const rule_obj);
+int parse_config(struct adaptived_ctx * const ctx, struct rule_set * const set);
+int parse_rule(struct adaptived_ctx * const ctx, struct json_object * const rule_obj,
+	       struct rule_set * const set);
 int insert_into_json_args_obj(struct json_object * const parent, const char * const key,
 			      struct json_object * const arg);
 long long adaptived_parse_human_readable(const char * const input);
 int parse_cause_operation(struct json_object * const args_obj, const char * const name,
 			  enum cause_op_enum * const op);
 
+/*
+ * pass_cache.c functions
+ */
+
+struct pass_cache_ops {
+	/* build a new object from arg.  the caller owns the only reference */
+	int (*create)(const void * const arg, void ** const obj);
+	void (*get)(void * const obj);
+	void (*put)(void * const obj);
+};
+
+struct pass_cache_entry;
+
+struct pass_cache {
+	const struct pass_cache_ops *ops;
+	pthread_mutex_t mutex; /* protects the list.  the objects are built without it */
+	struct pass_cache_entry *list;
+};
+
+#define PASS_CACHE_INIT(_ops) { .ops = (_ops), .mutex = PTHREAD_MUTEX_INITIALIZER, .list = NULL }
+
+int pass_cache_get(struct pass_cache * const cache, const char * const key,
+		   const void * const arg, void ** const obj);
+void pass_cache_flush(struct pass_cache * const cache);
+
+/*
+ * pressure_utils.c functions
+ */
+
+/* stall percentage over a user-defined window, computed from PSI total deltas */
+struct psi_window {
+	long long window;	/* milliseconds */
+	long long *time;	/* milliseconds, ring buffer */
+	long long *total;	/* microseconds, ring buffer */
+	int size;
+	int head;		/* oldest sample */
+	int cnt;
+};
+
+int psi_window_init(struct psi_window * const win, int window, int interval);
+int psi_window_add(struct psi_window * const win, long long time, long long total,
+		   float * const pct);
+void psi_window_free(struct psi_window * const win);
+void psi_scan_flush(void);
+
 /*
  * proc_pid_stat_utils.c functions
  */
 
 int _sort_pid_list(const void *p1, const void *p2);
 
+/*
+ * read_cache.c functions
+ */
+
+/* parse the NUL-terminated contents of a file into out */
+typedef int (*read_cache_parse_fn)(const char * const buf, size_t len, void * const out);
+
+struct read_cache *read_cache_create(void);
+void read_cache_destroy(struct read_cache ** cache);
+void read_cache_begin_pass(struct read_cache * const cache);
+void read_cache_invalidate(struct read_cache * const cache);
+unsigned long read_cache_version(void);
+void read_cache_attach(struct read_cache * const cache);
+void read_cache_detach(void);
+void read_cache_drop(const char * const path);
+ssize_t read_cache_read(const char * const path, char * const buf, size_t size);
+FILE *read_cache_fopen(const char * const path);
+int read_cache_parse(const char * const path, read_cache_parse_fn parse_fn,
+		     void * const out, size_t out_size);
+
 /*
  * rule.c functions
  */
 
 struct adaptived_rule *rule_init(const char * const name);
 void rule_destroy(struct adaptived_rule ** rule);
+void rule_stats_write_begin(struct adaptived_rule * const rule);
+void rule_stats_write_end(struct adaptived_rule * const rule);
+void rule_stats_read(struct adaptived_rule * const rule, struct adaptived_rule_stats * const stats);
+
+#define RULE_STATS_ADD(rule, field, val) do { \
+	rule_stats_write_begin(rule); \
+	(rule)->stats.field += (val); \
+	rule_stats_write_end(rule); \
+} while (0)
+
+/*
+ * rule_set.c functions
+ */
+
+struct rule_set *rule_set_init(int size);
+struct rule_set *rule_set_copy(const struct rule_set * const set, int extra);
+void rule_set_free(struct rule_set ** set);
+int rule_set_append(struct rule_set * const set, struct adaptived_rule * const rule);
+void rule_set_remove(struct rule_set * const set, int idx);
+struct adaptived_rule *rule_set_find(const struct rule_set * const set, const char * const name);
+unsigned long rule_set_read_lock(struct adaptived_ctx * const ctx);
+void rule_set_read_unlock(struct adaptived_ctx * const ctx, unsigned long epoch);
+struct rule_set *rule_set_get(struct adaptived_ctx * const ctx);
+void rule_set_reclaim(struct adaptived_ctx * const ctx);
+void rule_set_publish(struct adaptived_ctx * const ctx, struct rule_set * const set,
+		      struct adaptived_rule * const dead);
+void rule_set_cleanup(struct adaptived_ctx * const ctx);
+
+/*
+ * worker_pool.c functions
+ */
+
+struct worker_pool *worker_pool_create(int thread_cnt);
+int worker_pool_thread_cnt(const struct worker_pool * const pool);
+void worker_pool_submit(struct worker_pool * const pool, worker_fn fn, void * const arg);
+void worker_pool_wait(struct worker_pool * const pool);
+void worker_pool_destroy(struct worker_pool ** pool);
+
+/*
+ * scheduler.c functions
+ */
+
+long long sched_now(void);
+int rule_heap_push(struct rule_heap * const heap, struct adaptived_rule * const rule);
+struct adaptived_rule *rule_heap_peek(const struct rule_heap * const heap);
+struct adaptived_rule *rule_heap_pop(struct rule_heap * const heap);
+int rule_heap_build(struct rule_heap * const heap, const struct rule_set * const set);
+void rule_heap_free(struct rule_heap * const heap);
+int rule_interval(const struct adaptived_ctx * const ctx, const struct adaptived_rule * const rule);
 
 /*
  * mem_utils defines
@@ -55,6 +55,7 @@ const char * const cause_names[] = {
 	"memory.stat",
 	"top",
 	"cgroup_memory_setting",
+	"psi_vector",
 };
 static_assert(ARRAY_SIZE(cause_names) == CAUSE_CNT,
 	      "cause_names[] must be same length as CAUSE_CNT");
@@ -81,10 +82,36 @@ const struct adaptived_cause_functions cause_fns[] = {
 	{memorystat_init, memorystat_main, memorystat_exit},
 	{top_init, top_main, top_exit},
 	{cgset_memory_init, cgset_memory_main, cgset_exit},
+	{psi_vector_init, psi_vector_main, psi_vector_exit},
 };
 static_assert(ARRAY_SIZE(cause_fns) == CAUSE_CNT,
 	      "cause_fns[] must be same length as CAUSE_CNT");
 
+/*
+ * Whether identical instances of a built-in cause may be shared by several rules.
+ * See cause_group.c.  A cause that publishes shared data for its rule's effects
+ * must not be shared, as the effects read the shared data from their rule's own
+ * cause rather than from the group's instance
+ */
+const bool cause_shareable[] = {
+	true,	/* time_of_day */
+	true,	/* days_of_the_week */
+	true,	/* pressure */
+	true,	/* pressure_rate */
+	true,	/* always */
+	true,	/* cgroup_setting */
+	true,	/* setting */
+	true,	/* periodic */
+	true,	/* meminfo */
+	true,	/* slabinfo */
+	true,	/* memory.stat */
+	true,	/* top */
+	true,	/* cgroup_memory_setting */
+	false,	/* psi_vector publishes ADAPTIVED_SDATA_PSI_VECTOR */
+};
+static_assert(ARRAY_SIZE(cause_shareable) == CAUSE_CNT,
+	      "cause_shareable[] must be same length as CAUSE_CNT");
+
 /*
  * Re-use the adaptived_cause structure to store a linked list of causes that have been
  * added at runtime by the user.  When processing causes, the ->next field is used to
@@ -131,7 +158,7 @@ API int adaptived_register_cause(struct adaptived_ctx * const ctx, const char *
 	cse->fns = fns;
 	cse->next = NULL;
 
-	pthread_mutex_lock(&ctx->ctx_mutex);
+	pthread_mutex_lock(&ctx->update_mutex);
 
 	/*
 	 * Verify that the name is available in both the built-in causes and the
@@ -140,7 +167,7 @@ API int adaptived_register_cause(struct adaptived_ctx * const ctx, const char *
 	for (i = 0; i < CAUSE_CNT; i++) {
 		if (strcmp(name, cause_names[i]) == 0) {
 			ret = -EEXIST;
-			pthread_mutex_unlock(&ctx->ctx_mutex);
+			pthread_mutex_unlock(&ctx->update_mutex);
 			goto err;
 		}
 	}
@@ -149,7 +176,7 @@ API int adaptived_register_cause(struct adaptived_ctx * const ctx, const char *
 	while (tmp) {
 		if (strcmp(name, tmp->name) == 0) {
 			ret = -EEXIST;
-			pthread_mutex_unlock(&ctx->ctx_mutex);
+			pthread_mutex_unlock(&ctx->update_mutex);
 			goto err;
 		}
 
@@ -169,7 +196,7 @@ API int adaptived_register_cause(struct adaptived_ctx * const ctx, const char *
 
 		tmp_cse->next = cse;
 	}
-	pthread_mutex_unlock(&ctx->ctx_mutex);
+	pthread_mutex_unlock(&ctx->update_mutex);
 
 	return ret;
 
@@ -192,6 +219,95 @@ API int adaptived_cause_set_data(struct adaptived_cause * const cse, void * cons
 	return 0;
 }
 
+API int adaptived_cause_set_flags(struct adaptived_cause * const cse, uint32_t flags)
+{
+	if (!cse)
+		return -EINVAL;
+
+	cse->flags = flags;
+	return 0;
+}
+
+/*
+ * Incremented every time a cause registers or unregisters a file descriptor.  The
+ * main loop uses this to know when it needs to rebuild its epoll set
+ */
+unsigned long cause_fds_gen;
+
+API int adaptived_cause_register_fd(struct adaptived_cause * const cse, int fd, uint32_t events)
+{
+	struct cause_fd *cfd;
+
+	if (!cse || fd < 0 || !events)
+		return -EINVAL;
+
+	cfd = cse->fds;
+	while (cfd) {
+		if (cfd->fd == fd)
+			return -EEXIST;
+		cfd = cfd->next;
+	}
+
+	cfd = malloc(sizeof(struct cause_fd));
+	if (!cfd)
+		return -ENOMEM;
+
+	memset(cfd, 0, sizeof(struct cause_fd));
+	cfd->fd = fd;
+	cfd->events = events;
+	cfd->next = cse->fds;
+	cse->fds = cfd;
+
+	__atomic_add_fetch(&cause_fds_gen, 1, __ATOMIC_RELEASE);
+
+	return 0;
+}
+
+API int adaptived_cause_unregister_fd(struct adaptived_cause * const cse, int fd)
+{
+	struct cause_fd *cfd, *prev = NULL;
+
+	if (!cse)
+		return -EINVAL;
+
+	cfd = cse->fds;
+	while (cfd) {
+		if (cfd->fd == fd) {
+			if (prev)
+				prev->next = cfd->next;
+			else
+				cse->fds = cfd->next;
+
+			free(cfd);
+			__atomic_add_fetch(&cause_fds_gen, 1, __ATOMIC_RELEASE);
+			return 0;
+		}
+
+		prev = cfd;
+		cfd = cfd->next;
+	}
+
+	return -ENOENT;
+}
+
+API int adaptived_cause_fd_pending(struct adaptived_cause * const cse, int fd)
+{
+	struct cause_fd *cfd;
+
+	if (!cse)
+		return -EINVAL;
+
+	cfd = cse->fds;
+	while (cfd) {
+		if (cfd->fd == fd)
+			return __atomic_exchange_n(&cfd->pending, false, __ATOMIC_ACQ_REL) ? 1 : 0;
+
+		cfd = cfd->next;
+	}
+
+	return -ENOENT;
+}
+
 API struct adaptived_cause *adaptived_build_cause(const char * const name)
 {
 	struct json_object *name_obj;
@@ -292,8 +408,24 @@ error:
 
 void cause_destroy(struct adaptived_cause ** cse)
 {
-	if ((*cse)->fns && (*cse)->fns->exit)
+	struct cause_fd *cfd, *cfd_next;
+
+	if ((*cse)->group)
+		/* the shared instance owns the cause's private data */
+		cause_group_put(&(*cse)->group);
+	else if ((*cse)->fns && (*cse)->fns->exit)
 		(*(*cse)->fns->exit)(*cse);
+
+	if ((*cse)->fds)
+		__atomic_add_fetch(&cause_fds_gen, 1, __ATOMIC_RELEASE);
+
+	cfd = (*cse)->fds;
+	while (cfd) {
+		cfd_next = cfd->next;
+		free(cfd);
+		cfd = cfd_next;
+	}
+
 	if ((*cse)->json)
 		json_object_put((*cse)->json);
 	if ((*cse)->name)
@@ -63,6 +63,7 @@ enum cause_enum {
 	MEMORYSTAT,
 	TOP,
 	CGROUP_MEMORY_SETTING,
+	PSI_VECTOR,
 
 	CAUSE_CNT
 };
@@ -74,6 +75,12 @@ struct adaptived_cause {
 	const struct adaptived_cause_functions *fns;
 	struct json_object *json; /* only used when building a rule at runtime */
 	struct adaptived_cause *next;
+	long long last_run; /* CLOCK_MONOTONIC time in milliseconds.  0 if never run */
+	uint32_t flags; /* enum adaptived_cause_flags */
+
+	/* used to order the causes when the rule's cause_order is adaptive */
+	float cost; /* moving average of the time spent in ->main(), in microseconds */
+	float false_rate; /* moving average of how often ->main() did not trigger */
 
 	/*
 	 * Data that can be shared between causes and effects.  It is freed/deleted
@@ -81,12 +88,36 @@ struct adaptived_cause {
 	 */
 	struct shared_data *sdata;
 
+	/* file descriptors that wake the rule containing this cause when they are ready */
+	struct cause_fd *fds;
+
+	/*
+	 * If set, this cause is identical to a cause in another rule.  The shared
+	 * instance in the group is evaluated in place of this cause.  See cause_group.c
+	 */
+	struct cause_group *group;
+
 	/* private data store for each cause plugin */
 	void *data;
 };
 
+struct cause_fd {
+	int fd;
+	uint32_t events;
+
+	/* populated by the main loop when the fd is added to its epoll set */
+	struct adaptived_rule *rule;
+	struct cause_group *group; /* set if the fd is owned by a shared cause */
+
+	/* set by the main loop when the fd is ready.  see adaptived_cause_fd_pending() */
+	bool pending;
+
+	struct cause_fd *next;
+};
+
 extern const char * const cause_names[];
 extern const struct adaptived_cause_functions cause_fns[];
+extern const bool cause_shareable[];
 extern struct adaptived_cause *registered_causes;
 
 
@@ -144,4 +175,8 @@ int top_init(struct adaptived_cause * const cse, struct json_object *args_obj, i
 int top_main(struct adaptived_cause * const cse, int time_since_last_run);
 void top_exit(struct adaptived_cause * const cse);
 
+int psi_vector_init(struct adaptived_cause * const cse, struct json_object *args_obj, int interval);
+int psi_vector_main(struct adaptived_cause * const cse, int time_since_last_run);
+void psi_vector_exit(struct adaptived_cause * const cse);
+
 #endif /* __ADAPTIVED_CAUSE_H */
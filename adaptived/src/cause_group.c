@@ -0,0 +1,386 @@
+/*
+ * Copyright (c) 2024, Oracle and/or its affiliates.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+/**
+ * Shared cause instances for adaptived
+ *
+ * Generated configurations often contain many rules that use the same cause with
+ * the same arguments, e.g. the same pressure cause on the same pressure file, and
+ * differ only in their effects.  Rather than having each rule read and parse the
+ * same file on every pass through the main loop, the built-in causes are grouped
+ * by their name, interval, and canonicalized arguments.  Each group has a single
+ * shared instance of the cause.  It is evaluated at most once per interval, and
+ * its result is used by every rule in the group.
+ *
+ * Registered causes are never shared, as adaptived cannot know whether they keep
+ * per-instance state or have side effects.  Neither are the built-in causes that
+ * publish shared data for their rule's effects.  See cause_shareable[].
+ *
+ * The groups are created and destroyed while the rules are parsed and freed, both
+ * of which happen with the ctx update mutex held.
+ */
+
+#include <json-c/json.h>
+#include <pthread.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+
+#include <adaptived.h>
+
+#include "adaptived-internal.h"
+#include "shared_data.h"
+
+struct canon_buf {
+	char *str;
+	size_t len;
+	size_t size;
+};
+
+static int canon_append(struct canon_buf * const buf, const char * const str)
+{
+	size_t len = strlen(str), new_size;
+	char *tmp;
+
+	if (buf->len + len + 1 > buf->size) {
+		new_size = max(buf->size * 2, buf->len + len + 1);
+
+		tmp = realloc(buf->str, new_size);
+		if (!tmp)
+			return -ENOMEM;
+
+		buf->str = tmp;
+		buf->size = new_size;
+	}
+
+	memcpy(&buf->str[buf->len], str, len + 1);
+	buf->len += len;
+
+	return 0;
+}
+
+static int canon_append_key(struct canon_buf * const buf, const char * const key)
+{
+	struct json_object *key_obj;
+	int ret;
+
+	/* let json-c escape the key */
+	key_obj = json_object_new_string(key);
+	if (!key_obj)
+		return -ENOMEM;
+
+	ret = canon_append(buf, json_object_to_json_string_ext(key_obj, JSON_C_TO_STRING_PLAIN));
+	json_object_put(key_obj);
+
+	return ret;
+}
+
+static int cmp_keys(const void *p1, const void *p2)
+{
+	return strcmp(*(const char * const *)p1, *(const char * const *)p2);
+}
+
+/*
+ * Serialize a JSON object with the keys of every object sorted, so that the same
+ * arguments produce the same string regardless of their order in the configuration
+ */
+static int canon_json(struct canon_buf * const buf, struct json_object * const obj)
+{
+	struct json_object_iterator it, it_end;
+	struct json_object *val_obj;
+	const char **keys = NULL;
+	int ret = 0, cnt, i;
+
+	switch (json_object_get_type(obj)) {
+	case json_type_object:
+		cnt = json_object_object_length(obj);
+		if (cnt > 0) {
+			keys = malloc(sizeof(char *) * cnt);
+			if (!keys)
+				return -ENOMEM;
+		}
+
+		i = 0;
+		it = json_object_iter_begin(obj);
+		it_end = json_object_iter_end(obj);
+		while (!json_object_iter_equal(&it, &it_end)) {
+			keys[i++] = json_object_iter_peek_name(&it);
+			json_object_iter_next(&it);
+		}
+
+		qsort(keys, cnt, sizeof(char *), cmp_keys);
+
+		ret = canon_append(buf, "{");
+		for (i = 0; !ret && i < cnt; i++) {
+			if (i > 0)
+				ret = canon_append(buf, ",");
+			if (!ret)
+				ret = canon_append_key(buf, keys[i]);
+			if (!ret)
+				ret = canon_append(buf, ":");
+			if (!ret) {
+				json_object_object_get_ex(obj, keys[i], &val_obj);
+				ret = canon_json(buf, val_obj);
+			}
+		}
+		if (!ret)
+			ret = canon_append(buf, "}");
+
+		if (keys)
+			free(keys);
+		break;
+	case json_type_array:
+		cnt = json_object_array_length(obj);
+
+		ret = canon_append(buf, "[");
+		for (i = 0; !ret && i < cnt; i++) {
+			if (i > 0)
+				ret = canon_append(buf, ",");
+			if (!ret)
+				ret = canon_json(buf, json_object_array_get_idx(obj, i));
+		}
+		if (!ret)
+			ret = canon_append(buf, "]");
+		break;
+	default:
+		ret = canon_append(buf, json_object_to_json_string_ext(obj, JSON_C_TO_STRING_PLAIN));
+		break;
+	}
+
+	return ret;
+}
+
+static int build_key(const struct adaptived_cause * const cse, struct json_object * const args_obj,
+		     int interval, char ** const key)
+{
+	struct canon_buf buf = { 0 };
+	char interval_str[32];
+	int ret;
+
+	snprintf(interval_str, sizeof(interval_str), "/%d/", interval);
+
+	ret = canon_append(&buf, cse->name);
+	if (ret)
+		goto error;
+	ret = canon_append(&buf, interval_str);
+	if (ret)
+		goto error;
+	ret = canon_json(&buf, args_obj);
+	if (ret)
+		goto error;
+
+	(*key) = buf.str;
+
+	return 0;
+
+error:
+	if (buf.str)
+		free(buf.str);
+
+	return ret;
+}
+
+/*
+ * Attach a built-in cause to the group of identical causes, creating the group and
+ * initializing its shared instance if this is the first such cause.  The caller
+ * must hold the ctx update mutex
+ */
+int cause_group_get(struct adaptived_ctx * const ctx, struct adaptived_cause * const cse,
+		    struct json_object * const args_obj, int interval)
+{
+	struct cause_group *grp = NULL;
+	char *key = NULL;
+	int ret;
+
+	ret = build_key(cse, args_obj, interval, &key);
+	if (ret)
+		return ret;
+
+	grp = ctx->cause_groups;
+	while (grp) {
+		if (strcmp(key, grp->key) == 0) {
+			free(key);
+
+			grp->refcnt++;
+			cse->group = grp;
+			cse->flags = grp->cse->flags;
+
+			adaptived_dbg("Cause %s is shared by %d rules\n", cse->name, grp->refcnt);
+			return 0;
+		}
+
+		grp = grp->next;
+	}
+
+	grp = malloc(sizeof(struct cause_group));
+	if (!grp) {
+		ret = -ENOMEM;
+		goto error;
+	}
+
+	memset(grp, 0, sizeof(struct cause_group));
+	pthread_mutex_init(&grp->lock, NULL);
+
+	grp->cse = cause_init(cse->name);
+	if (!grp->cse) {
+		ret = -ENOMEM;
+		goto error;
+	}
+
+	grp->cse->idx = cse->idx;
+	grp->cse->fns = cse->fns;
+
+	adaptived_dbg("Initializing cause %s\n", grp->cse->name);
+	ret = (*grp->cse->fns->init)(grp->cse, args_obj, interval);
+	if (ret) {
+		/* the cause failed to initialize.  don't invoke its exit function */
+		grp->cse->fns = NULL;
+		goto error;
+	}
+
+	grp->key = key;
+	grp->ctx = ctx;
+	grp->refcnt = 1;
+
+	grp->next = ctx->cause_groups;
+	if (ctx->cause_groups)
+		ctx->cause_groups->prev = grp;
+	ctx->cause_groups = grp;
+
+	cse->group = grp;
+	cse->flags = grp->cse->flags;
+
+	return 0;
+
+error:
+	if (grp && grp->cse)
+		cause_destroy(&grp->cse);
+	if (grp) {
+		pthread_mutex_destroy(&grp->lock);
+		free(grp);
+	}
+
+	free(key);
+
+	return ret;
+}
+
+/*
+ * Detach a cause from its group.  The shared instance is destroyed when the last
+ * cause in the group is detached.  The caller must hold the ctx update mutex
+ */
+void cause_group_put(struct cause_group ** grp)
+{
+	(*grp)->refcnt--;
+
+	if ((*grp)->refcnt > 0) {
+		(*grp) = NULL;
+		return;
+	}
+
+	if ((*grp)->prev)
+		(*grp)->prev->next = (*grp)->next;
+	else
+		(*grp)->ctx->cause_groups = (*grp)->next;
+	if ((*grp)->next)
+		(*grp)->next->prev = (*grp)->prev;
+
+	cause_destroy(&(*grp)->cse);
+	pthread_mutex_destroy(&(*grp)->lock);
+	free((*grp)->key);
+
+	free(*grp);
+	(*grp) = NULL;
+}
+
+static bool group_fd_pending(const struct cause_group * const grp)
+{
+	struct cause_fd *cfd;
+
+	for (cfd = grp->cse->fds; cfd; cfd = cfd->next) {
+		if (__atomic_load_n(&cfd->pending, __ATOMIC_ACQUIRE))
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Evaluate the shared instance of the cause, unless it has already been evaluated
+ * during this pass through the main loop or during the current interval.  May be
+ * called concurrently by the worker threads
+ *
+ * The rules in a group don't necessarily run on the same schedule, e.g. a rule that
+ * was loaded at runtime or a rule that was woken by another cause's fd.  The shared
+ * instance may be stateful (the pressure duration, the pressure_rate samples), so
+ * it's only evaluated once per interval and the other rules reuse its result.  The
+ * instance is always evaluated if one of its own fds is ready
+ */
+int cause_group_run(struct cause_group * const grp, unsigned long pass, long long now,
+		    int interval, bool nominal)
+{
+	struct adaptived_cause *cse = grp->cse;
+	int elapsed, ret;
+
+	pthread_mutex_lock(&grp->lock);
+
+	if (grp->result_pass == pass ||
+	    (!nominal && now < grp->next_due && !group_fd_pending(grp))) {
+		adaptived_dbg("Using the shared result of %s\n", cse->name);
+		ret = grp->result;
+		goto out;
+	}
+
+	if (nominal || cse->last_run == 0)
+		elapsed = interval;
+	else
+		elapsed = (int)(now - cse->last_run);
+	cse->last_run = now;
+
+	ret = (*cse->fns->main)(cse, elapsed);
+
+	if (cse->sdata) {
+		/* the rules' effects would never see it.  see cause_shareable[] */
+		adaptived_err("Shared cause %s published shared data\n", cse->name);
+		free_shared_data(cse, true);
+		ret = -EINVAL;
+	}
+
+	grp->result = ret;
+	grp->result_pass = pass;
+
+	if (now >= grp->next_due) {
+		/*
+		 * Like the rules' deadlines, the group's deadline is absolute so that
+		 * running slightly late doesn't skip an evaluation
+		 */
+		if (grp->next_due == 0 || now - grp->next_due >= interval)
+			grp->next_due = now + interval;
+		else
+			grp->next_due += interval;
+	}
+
+out:
+	pthread_mutex_unlock(&grp->lock);
+
+	return ret;
+}
@@ -27,7 +27,7 @@
  *
  */
 
-#define _XOPEN_SOURCE
+#define _XOPEN_SOURCE 700
 
 #include <stdbool.h>
 #include <assert.h>
@@ -150,11 +150,11 @@ error:
 int days_of_the_week_main(struct adaptived_cause * const cse, int time_since_last_run)
 {
 	struct days_of_the_week_opts *opts = (struct days_of_the_week_opts *)cse->data;
-	struct tm *cur_tm;
+	struct tm *cur_tm, tm;
 	time_t cur_time;
 
 	time(&cur_time);
-	cur_tm = localtime(&cur_time);
+	cur_tm = localtime_r(&cur_time, &tm);
 
 	switch (cur_tm->tm_wday) {
 		case 0: /* Sunday */
@@ -39,6 +39,7 @@
 struct memorystat_opts {
 	char *stat_file;
 	char *field;
+	int field_idx;	/* adaptived_memorystat_enum value, or -ENOENT if not in the enum */
 	enum cause_op_enum op;
 	struct adaptived_cgroup_value threshold;
 };
@@ -99,6 +100,7 @@ int memorystat_init(struct adaptived_cause * const cse, struct json_object *args
 
 	strcpy(opts->field, field_str);
 	opts->field[strlen(field_str)] = '\0';
+	opts->field_idx = adaptived_memorystat_field_idx(opts->field);
 
 	ret = parse_cause_operation(args_obj, NULL, &opts->op);
 	if (ret)
@@ -124,12 +126,25 @@ error:
 int memorystat_main(struct adaptived_cause * const cse, int time_since_last_run)
 {
 	struct memorystat_opts *opts = (struct memorystat_opts *)adaptived_cause_get_data(cse);
+	struct adaptived_memorystat_snapshot snap;
 	long long ll_value = 0;
 	int ret;
 
-	ret = adaptived_cgroup_get_memorystat_field(opts->stat_file, opts->field, &ll_value);
-	if (ret)
-		return ret;
+	if (opts->field_idx < 0) {
+		ret = adaptived_cgroup_get_memorystat_field(opts->stat_file, opts->field, &ll_value);
+		if (ret)
+			return ret;
+	} else {
+		/* memory.stat is parsed once per pass and shared by every cause that reads it */
+		ret = adaptived_cgroup_get_memorystat(opts->stat_file, &snap);
+		if (ret)
+			return ret;
+
+		if (!snap.present[opts->field_idx])
+			return -ENOENT;
+
+		ll_value = snap.values[opts->field_idx];
+	}
 
 	switch (opts->op) {
 	case COP_GREATER_THAN:
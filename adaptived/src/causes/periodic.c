@@ -66,6 +66,9 @@ int periodic_init(struct adaptived_cause * const cse, struct json_object *args_o
 	if (ret)
 		goto error;
 
+	/* the period is tracked by accumulating the time between runs */
+	adaptived_cause_set_flags(cse, ADAPTIVED_CAUSEF_EVERY_SAMPLE);
+
 	return ret;
 
 error:
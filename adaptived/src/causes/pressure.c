@@ -26,9 +26,11 @@
  */
 
 #include <json-c/json.h>
+#include <sys/epoll.h>
 #include <stdbool.h>
 #include <assert.h>
 #include <string.h>
+#include <unistd.h>
 #include <errno.h>
 
 #include <adaptived-utils.h>
@@ -48,6 +50,11 @@ const char * const pressure_type_names[] = {
 };
 static_assert(ARRAY_SIZE(pressure_type_names) == PRESSURE_TYPE_CNT,
 	      "pressure_type_names[] must be same length as PRESSURE_TYPE_CNT");
+/* the psi effects pass a pressure_type_enum to adaptived_get_psi_scan() */
+static_assert((int)PRESSURE_TYPE_CPU == (int)ADAPTIVED_PSI_CPU &&
+	      (int)PRESSURE_TYPE_MEMORY == (int)ADAPTIVED_PSI_MEMORY &&
+	      (int)PRESSURE_TYPE_IO == (int)ADAPTIVED_PSI_IO,
+	      "pressure_type_enum must match adaptived_psi_resource_enum");
 
 const char * const meas_names[] = {
 	"some-avg10",
@@ -70,9 +77,117 @@ static void free_opts(struct pressure_opts * const opts)
 	if (opts->common.pressure_file)
 		free(opts->common.pressure_file);
 
+	if (opts->trigger_fd >= 0)
+		close(opts->trigger_fd);
+
+	psi_window_free(&opts->common.win);
+
 	free(opts);
 }
 
+/*
+ * Parse the optional stall_window setting.  Must be called after the measurement
+ * has been parsed
+ */
+int pressure_parse_stall_window(struct json_object * const args_obj,
+				struct pressure_common_opts * const common, int interval)
+{
+	int ret;
+
+	ret = adaptived_parse_int(args_obj, "stall_window", &common->stall_window);
+	if (ret == -ENOENT) {
+		common->stall_window = 0;
+		return 0;
+	} else if (ret) {
+		return ret;
+	}
+
+	if (common->meas != PRESSURE_SOME_TOTAL && common->meas != PRESSURE_FULL_TOTAL) {
+		adaptived_err("stall_window requires the some-total or full-total measurement\n");
+		return -EINVAL;
+	}
+	if (common->stall_window <= 0) {
+		adaptived_err("stall_window must be greater than zero\n");
+		return -EINVAL;
+	}
+
+	return psi_window_init(&common->win, common->stall_window, interval);
+}
+
+/*
+ * Sample the PSI total and compute the percentage of time stalled over the
+ * stall_window.  Returns 1 if *pct is valid, 0 if the samples do not span the
+ * window yet, or a negative errno
+ */
+int pressure_get_window_pct(struct pressure_common_opts * const common,
+			    int time_since_last_run, float * const pct)
+{
+	long long total;
+	int ret;
+
+	ret = adaptived_get_pressure_total(common->pressure_file, common->meas, &total);
+	if (ret)
+		return ret;
+
+	/*
+	 * Use the measured time between runs rather than the wall clock so that the
+	 * percentage is consistent with the time the rest of the rule sees
+	 */
+	common->elapsed += time_since_last_run;
+
+	return psi_window_add(&common->win, common->elapsed, total, pct);
+}
+
+static int parse_trigger(struct json_object * const args_obj, struct pressure_opts * const opts)
+{
+	const char *trigger_str;
+	int ret;
+
+	ret = adaptived_parse_string(args_obj, "trigger", &trigger_str);
+	if (ret == -ENOENT)
+		/* no trigger was provided.  poll the PSI file */
+		return 0;
+	else if (ret)
+		return ret;
+
+	if (strcmp(trigger_str, "some") == 0) {
+		opts->trigger_full = false;
+	} else if (strcmp(trigger_str, "full") == 0) {
+		opts->trigger_full = true;
+	} else {
+		adaptived_err("Invalid trigger provided: %s\n", trigger_str);
+		return -EINVAL;
+	}
+
+	opts->trigger = true;
+
+	ret = adaptived_parse_long_long(args_obj, "stall_us", &opts->stall_us);
+	if (ret) {
+		adaptived_err("A trigger requires the stall_us setting\n");
+		return ret;
+	}
+
+	ret = adaptived_parse_long_long(args_obj, "window_us", &opts->window_us);
+	if (ret == -ENOENT)
+		opts->window_us = 1000000;
+	else if (ret)
+		return ret;
+
+	if (opts->window_us < ADAPTIVED_PRESSURE_TRIGGER_MIN_WINDOW_US ||
+	    opts->window_us > ADAPTIVED_PRESSURE_TRIGGER_MAX_WINDOW_US) {
+		adaptived_err("window_us must be between %lld and %lld\n",
+			      ADAPTIVED_PRESSURE_TRIGGER_MIN_WINDOW_US,
+			      ADAPTIVED_PRESSURE_TRIGGER_MAX_WINDOW_US);
+		return -EINVAL;
+	}
+	if (opts->stall_us <= 0 || opts->stall_us > opts->window_us) {
+		adaptived_err("stall_us must be greater than zero and no larger than window_us\n");
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
 int pressure_init(struct adaptived_cause * const cse, struct json_object *args_obj, int interval)
 {
 	const char *meas_str, *press_str;
@@ -87,6 +202,7 @@ int pressure_init(struct adaptived_cause * const cse, struct json_object *args_o
 	}
 
 	memset(opts, 0, sizeof( struct pressure_opts));
+	opts->trigger_fd = -1;
 
 	ret = adaptived_parse_string(args_obj, "pressure_file", &press_str);
 	if (ret) {
@@ -103,6 +219,41 @@ int pressure_init(struct adaptived_cause * const cse, struct json_object *args_o
 	strcpy(opts->common.pressure_file, press_str);
 	opts->common.pressure_file[strlen(press_str)] = '\0';
 
+	ret = parse_trigger(args_obj, opts);
+	if (ret)
+		goto error;
+
+	if (opts->trigger) {
+		/*
+		 * Let the kernel watch the PSI file.  The rule is woken as soon as the
+		 * trigger fires rather than at its next interval
+		 */
+		ret = adaptived_pressure_trigger_open(opts->common.pressure_file,
+						      opts->trigger_full, opts->stall_us,
+						      opts->window_us, &opts->trigger_fd);
+		if (ret) {
+			adaptived_err("Failed to create a PSI trigger on %s: %d\n",
+				      opts->common.pressure_file, ret);
+			goto error;
+		}
+
+		ret = adaptived_cause_register_fd(cse, opts->trigger_fd, EPOLLPRI);
+		if (ret)
+			goto error;
+
+		ret = adaptived_cause_set_data(cse, (void *)opts);
+		if (ret)
+			goto error;
+
+		/*
+		 * Every run must consume the trigger's event, or a stale event would fire
+		 * the cause on a later run
+		 */
+		adaptived_cause_set_flags(cse, ADAPTIVED_CAUSEF_EVERY_SAMPLE);
+
+		return ret;
+	}
+
 	ret = adaptived_parse_string(args_obj, "measurement", &meas_str);
 	if (ret)
 		goto error;
@@ -120,7 +271,12 @@ int pressure_init(struct adaptived_cause * const cse, struct json_object *args_o
 		goto error;
 	}
 
-	if (opts->common.meas == PRESSURE_FULL_TOTAL || opts->common.meas == PRESSURE_SOME_TOTAL) {
+	ret = pressure_parse_stall_window(args_obj, &opts->common, interval);
+	if (ret)
+		goto error;
+
+	if ((opts->common.meas == PRESSURE_FULL_TOTAL || opts->common.meas == PRESSURE_SOME_TOTAL) &&
+	    !opts->common.stall_window) {
 		ret = adaptived_parse_long_long(args_obj, "threshold", &opts->common.threshold.total);
 		if (ret)
 			goto error;
@@ -163,6 +319,10 @@ int pressure_init(struct adaptived_cause * const cse, struct json_object *args_o
 	if (ret)
 		goto error;
 
+	if (opts->duration > 0)
+		/* the duration is tracked by accumulating the time between runs */
+		adaptived_cause_set_flags(cse, ADAPTIVED_CAUSEF_EVERY_SAMPLE);
+
 	return ret;
 
 error:
@@ -170,6 +330,27 @@ error:
 	return ret;
 }
 
+static int trigger_main(struct adaptived_cause * const cse, struct pressure_opts * const opts)
+{
+	int pending, ret;
+
+	/*
+	 * epoll consumes the trigger's event when it wakes the main loop, so check
+	 * with the main loop first.  The trigger may also have fired since then
+	 */
+	pending = adaptived_cause_fd_pending(cse, opts->trigger_fd);
+	if (pending < 0)
+		return pending;
+
+	ret = adaptived_pressure_trigger_check(opts->trigger_fd);
+	if (ret < 0) {
+		adaptived_err("PSI trigger on %s failed: %d\n", opts->common.pressure_file, ret);
+		return ret;
+	}
+
+	return (pending || ret) ? 1 : 0;
+}
+
 int pressure_main(struct adaptived_cause * const cse, int time_since_last_run)
 {
 	struct pressure_opts *opts = (struct pressure_opts *)adaptived_cause_get_data(cse);
@@ -177,7 +358,11 @@ int pressure_main(struct adaptived_cause * const cse, int time_since_last_run)
 	float float_press;
 	int ret;
 
-	if (opts->common.meas == PRESSURE_SOME_TOTAL || opts->common.meas == PRESSURE_FULL_TOTAL) {
+	if (opts->trigger)
+		return trigger_main(cse, opts);
+
+	if ((opts->common.meas == PRESSURE_SOME_TOTAL || opts->common.meas == PRESSURE_FULL_TOTAL) &&
+	    !opts->common.stall_window) {
 		ret = adaptived_get_pressure_total(opts->common.pressure_file, opts->common.meas,
 						&int_press);
 		if (ret)
@@ -206,10 +391,20 @@ int pressure_main(struct adaptived_cause * const cse, int time_since_last_run)
 			return -EINVAL;
 		}
 	} else {
-		ret = adaptived_get_pressure_avg(opts->common.pressure_file, opts->common.meas,
-					      &float_press);
-		if (ret)
-			return -EINVAL;
+		if (opts->common.stall_window) {
+			ret = pressure_get_window_pct(&opts->common, time_since_last_run,
+						      &float_press);
+			if (ret < 0)
+				return ret;
+			if (ret == 0)
+				/* the samples do not span the stall window yet */
+				return 0;
+		} else {
+			ret = adaptived_get_pressure_avg(opts->common.pressure_file,
+							 opts->common.meas, &float_press);
+			if (ret)
+				return -EINVAL;
+		}
 
 		switch (opts->op) {
 		case COP_GREATER_THAN:
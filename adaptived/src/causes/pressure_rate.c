@@ -23,8 +23,9 @@
 /**
  * PSI pressure rate cause
  *
- * Uses linear regression to anticipate future pressures and will
- * trigger when the future PSI is expected to exceed the threshold 
+ * Uses linear regression (or another model, see enum adaptived_predictor_enum) to
+ * anticipate future pressures and will trigger when the future PSI is expected to
+ * exceed the threshold
  *
  */
 
@@ -59,8 +60,9 @@ static void free_opts(struct pressure_rate_opts * const opts)
 	if (!opts)
 		return;
 
-	if (opts->data)
-		free(opts->data);
+	adaptived_predictor_free(&opts->pred);
+
+	psi_window_free(&opts->common.win);
 
 	if (opts->common.pressure_file)
 		free(opts->common.pressure_file);
@@ -70,7 +72,7 @@ static void free_opts(struct pressure_rate_opts * const opts)
 
 int pressure_rate_init(struct adaptived_cause * const cse, struct json_object *args_obj, int interval)
 {
-	const char *meas_str, *action_str, *press_str;
+	const char *meas_str, *action_str, *press_str, *model_str;
 	struct pressure_rate_opts *opts;
 	bool found_action;
 	int ret = 0;
@@ -116,8 +118,13 @@ int pressure_rate_init(struct adaptived_cause * const cse, struct json_object *a
 		goto error;
 	}
 
-	if (opts->common.meas == PRESSURE_FULL_TOTAL || opts->common.meas == PRESSURE_SOME_TOTAL) {
-		adaptived_err("Total pressure is not supported by the pressure_rate cause\n");
+	ret = pressure_parse_stall_window(args_obj, &opts->common, interval);
+	if (ret)
+		goto error;
+
+	if ((opts->common.meas == PRESSURE_FULL_TOTAL || opts->common.meas == PRESSURE_SOME_TOTAL) &&
+	    !opts->common.stall_window) {
+		adaptived_err("Total pressure requires a stall_window in the pressure_rate cause\n");
 		ret = -EINVAL;
 		goto error;
 	} else {
@@ -176,15 +183,27 @@ int pressure_rate_init(struct adaptived_cause * const cse, struct json_object *a
 	if (opts->advanced_warning < 0)
 		goto error;
 
-	opts->data_len = (int)((float)opts->window_size / (float)interval);
+	ret = adaptived_parse_string(args_obj, "model", &model_str);
+	if (ret == -ENOENT) {
+		opts->model = ADAPTIVED_PREDICTOR_OLS;
+	} else if (ret) {
+		goto error;
+	} else {
+		ret = adaptived_predictor_model_idx(model_str);
+		if (ret < 0) {
+			adaptived_err("Invalid model provided: %s\n", model_str);
+			goto error;
+		}
+		opts->model = ret;
+	}
 
 	/*
-	 * The pressure_rate cause doesn't support Total PSI (and thus long long)
-	 * arrays.  This has already been error checked earlier in this function,
-	 * and therefore we don't need to check it here.
+	 * Total PSI is only supported via the stall_window, which produces a
+	 * percentage, so every measurement is a floating point value
 	 */
-	opts->data = malloc(sizeof(float) * opts->data_len);
-	if (!opts->data) {
+	opts->pred_len = max(opts->window_size / interval, 2);
+	opts->pred = adaptived_predictor_alloc(opts->model, opts->pred_len);
+	if (!opts->pred) {
 		ret = -ENOMEM;
 		goto error;
 	}
@@ -193,6 +212,9 @@ int pressure_rate_init(struct adaptived_cause * const cse, struct json_object *a
 	if (ret)
 		goto error;
 
+	/* the regression needs every sample in the window */
+	adaptived_cause_set_flags(cse, ADAPTIVED_CAUSEF_EVERY_SAMPLE);
+
 	return ret;
 
 error:
@@ -203,25 +225,39 @@ error:
 int pressure_rate_main(struct adaptived_cause * const cse, int time_since_last_run)
 {
 	struct pressure_rate_opts *opts = (struct pressure_rate_opts *)adaptived_cause_get_data(cse);
+	double predicted;
 	float float_press;
 	int ret;
 
-	if (opts->common.meas == PRESSURE_SOME_TOTAL || opts->common.meas == PRESSURE_FULL_TOTAL) {
+	opts->now += time_since_last_run;
+
+	if ((opts->common.meas == PRESSURE_SOME_TOTAL || opts->common.meas == PRESSURE_FULL_TOTAL) &&
+	    !opts->common.stall_window) {
 		/* Currently unsupported */
 		return -EINVAL;
 	} else {
-		ret = adaptived_get_pressure_avg(opts->common.pressure_file, opts->common.meas,
-					      &float_press);
-		if (ret)
-			return ret;
+		if (opts->common.stall_window) {
+			ret = pressure_get_window_pct(&opts->common, time_since_last_run,
+						      &float_press);
+			if (ret < 0)
+				return ret;
+			if (ret == 0)
+				/* the samples do not span the stall window yet */
+				return 0;
+		} else {
+			ret = adaptived_get_pressure_avg(opts->common.pressure_file,
+							 opts->common.meas, &float_press);
+			if (ret)
+				return ret;
+		}
 
-		ret = adaptived_farray_append(opts->data, &float_press, opts->data_len,
-					   &opts->data_sample_cnt);
+		ret = adaptived_predictor_update(opts->pred, opts->now, float_press);
 		if (ret)
 			return ret;
 
-		adaptived_dbg("smplcnt = %d data_len = %d\n", opts->data_sample_cnt, opts->data_len);
-		if (opts->data_sample_cnt < opts->data_len)
+		adaptived_dbg("smplcnt = %d pred_len = %d\n", adaptived_predictor_count(opts->pred),
+			      opts->pred_len);
+		if (adaptived_predictor_count(opts->pred) < opts->pred_len)
 			/*
 			 * Wait for the window to entirely fill before we run
 			 * linear regression.  Otherwise we could get early false
@@ -229,27 +265,22 @@ int pressure_rate_main(struct adaptived_cause * const cse, int time_since_last_r
 			 */
 			return 0;
 
-		/* 
-		 * We can re-use the float_press variable since it's already been added to the
-		 * float array
-		 */
-		ret = adaptived_farray_linear_regression(opts->data, opts->data_sample_cnt,
-						      time_since_last_run, opts->advanced_warning,
-						      &float_press);
+		ret = adaptived_predictor_forecast(opts->pred, opts->now + opts->advanced_warning,
+						   &predicted);
 		if (ret)
 			return ret;
 
 		switch(opts->action) {
 		case ACTION_RISING:
 			/*
-			 * Linear regression has predicted that the PSI value will exceed
-			 * the threshold in advanced_warning seconds.  Trigger this cause
+			 * The model has predicted that the PSI value will exceed the
+			 * threshold in advanced_warning milliseconds.  Trigger this cause
 			 */
-			if (float_press > opts->common.threshold.avg)
+			if (predicted > opts->common.threshold.avg)
 				return 1;
 			break;
 		case ACTION_FALLING:
-			if (float_press < opts->common.threshold.avg)
+			if (predicted < opts->common.threshold.avg)
 				return 1;
 			break;
 		default:
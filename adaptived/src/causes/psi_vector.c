@@ -0,0 +1,364 @@
+/*
+ * Copyright (c) 2024, Oracle and/or its affiliates.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+/**
+ * Cause that evaluates the cpu, memory, and io pressure of a cgroup together
+ *
+ * All three PSI files are read in one pass, and a combined predicate is evaluated
+ * over a list of terms, e.g. "memory full-avg10 > 10 and io some-avg10 > 20".  When
+ * the cause triggers, it publishes the whole PSI vector as shared data for the
+ * effects in its rule.
+ */
+
+#include <json-c/json.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <string.h>
+#include <errno.h>
+
+#include <adaptived-utils.h>
+#include <adaptived.h>
+
+#include "adaptived-internal.h"
+#include "defines.h"
+#include "pressure.h"
+
+enum psi_vector_predicate_enum {
+	PREDICATE_WEIGHTED_SUM = 0,
+	PREDICATE_MAX,
+	PREDICATE_ALL,
+
+	PREDICATE_CNT
+};
+
+static const char * const predicate_names[] = {
+	"weighted_sum",
+	"max",
+	"all",
+};
+static_assert(ARRAY_SIZE(predicate_names) == PREDICATE_CNT,
+	      "predicate_names[] must be same length as PREDICATE_CNT");
+static_assert((int)PRESSURE_TYPE_CNT == (int)ADAPTIVED_PSI_RESOURCE_CNT,
+	      "pressure_type_names[] must map to enum adaptived_psi_resource_enum");
+
+struct psi_vector_term {
+	enum adaptived_psi_resource_enum res;
+	enum adaptived_pressure_meas_enum meas;
+	float weight;		/* weighted_sum and max */
+	float threshold;	/* all */
+};
+
+struct psi_vector_opts {
+	char *cgroup;		/* NULL for the system-wide /proc/pressure files */
+	enum psi_vector_predicate_enum predicate;
+	enum cause_op_enum op;
+	float threshold;	/* weighted_sum and max */
+
+	struct psi_vector_term *terms;
+	int term_cnt;
+};
+
+static void free_opts(struct psi_vector_opts * const opts)
+{
+	if (!opts)
+		return;
+
+	if (opts->cgroup)
+		free(opts->cgroup);
+	if (opts->terms)
+		free(opts->terms);
+
+	free(opts);
+}
+
+static int parse_term(struct json_object * const term_obj, enum psi_vector_predicate_enum predicate,
+		      struct psi_vector_term * const term)
+{
+	const char *res_str, *meas_str;
+	int ret, i;
+
+	ret = adaptived_parse_string(term_obj, "resource", &res_str);
+	if (ret) {
+		adaptived_err("Each psi_vector term requires a resource\n");
+		return ret;
+	}
+
+	term->res = ADAPTIVED_PSI_RESOURCE_CNT;
+	for (i = 0; i < ADAPTIVED_PSI_RESOURCE_CNT; i++) {
+		if (strcmp(pressure_type_names[i], res_str) == 0) {
+			term->res = i;
+			break;
+		}
+	}
+	if (term->res == ADAPTIVED_PSI_RESOURCE_CNT) {
+		adaptived_err("Invalid resource provided: %s\n", res_str);
+		return -EINVAL;
+	}
+
+	ret = adaptived_parse_string(term_obj, "measurement", &meas_str);
+	if (ret)
+		return ret;
+
+	term->meas = PRESSURE_MEAS_CNT;
+	for (i = 0; i < PRESSURE_MEAS_CNT; i++) {
+		if (strcmp(meas_names[i], meas_str) == 0) {
+			term->meas = i;
+			break;
+		}
+	}
+	if (term->meas == PRESSURE_MEAS_CNT ||
+	    term->meas == PRESSURE_SOME_TOTAL || term->meas == PRESSURE_FULL_TOTAL) {
+		adaptived_err("Invalid measurement provided: %s.  Only the averages are supported\n",
+			      meas_str);
+		return -EINVAL;
+	}
+
+	if (predicate == PREDICATE_ALL) {
+		ret = adaptived_parse_float(term_obj, "threshold", &term->threshold);
+		if (ret) {
+			adaptived_err("Each term of the all predicate requires a threshold\n");
+			return ret;
+		}
+	} else {
+		ret = adaptived_parse_float(term_obj, "weight", &term->weight);
+		if (ret == -ENOENT)
+			term->weight = 1.0f;
+		else if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+int psi_vector_init(struct adaptived_cause * const cse, struct json_object *args_obj, int interval)
+{
+	struct json_object *terms_obj, *term_obj;
+	const char *cgroup_str, *pred_str;
+	struct psi_vector_opts *opts;
+	json_bool exists;
+	int ret = 0;
+	int i;
+
+	opts = malloc(sizeof(struct psi_vector_opts));
+	if (!opts) {
+		ret = -ENOMEM;
+		goto error;
+	}
+
+	memset(opts, 0, sizeof(struct psi_vector_opts));
+
+	ret = adaptived_parse_string(args_obj, "cgroup", &cgroup_str);
+	if (ret == -ENOENT) {
+		/* use the system-wide pressure files */
+		opts->cgroup = NULL;
+	} else if (ret) {
+		goto error;
+	} else {
+		opts->cgroup = strdup(cgroup_str);
+		if (!opts->cgroup) {
+			ret = -ENOMEM;
+			goto error;
+		}
+	}
+
+	ret = adaptived_parse_string(args_obj, "predicate", &pred_str);
+	if (ret) {
+		adaptived_err("Failed to parse the predicate: %d\n", ret);
+		goto error;
+	}
+
+	opts->predicate = PREDICATE_CNT;
+	for (i = 0; i < PREDICATE_CNT; i++) {
+		if (strcmp(predicate_names[i], pred_str) == 0) {
+			opts->predicate = i;
+			break;
+		}
+	}
+	if (opts->predicate == PREDICATE_CNT) {
+		adaptived_err("Invalid predicate provided: %s\n", pred_str);
+		ret = -EINVAL;
+		goto error;
+	}
+
+	ret = parse_cause_operation(args_obj, NULL, &opts->op);
+	if (ret)
+		goto error;
+
+	if (opts->predicate != PREDICATE_ALL) {
+		ret = adaptived_parse_float(args_obj, "threshold", &opts->threshold);
+		if (ret)
+			goto error;
+	}
+
+	exists = json_object_object_get_ex(args_obj, "terms", &terms_obj);
+	if (!exists || !terms_obj || json_object_get_type(terms_obj) != json_type_array) {
+		adaptived_err("The psi_vector cause requires an array of terms\n");
+		ret = -EINVAL;
+		goto error;
+	}
+
+	opts->term_cnt = json_object_array_length(terms_obj);
+	if (opts->term_cnt <= 0) {
+		adaptived_err("The psi_vector cause requires at least one term\n");
+		ret = -EINVAL;
+		goto error;
+	}
+
+	opts->terms = malloc(sizeof(struct psi_vector_term) * opts->term_cnt);
+	if (!opts->terms) {
+		ret = -ENOMEM;
+		goto error;
+	}
+
+	memset(opts->terms, 0, sizeof(struct psi_vector_term) * opts->term_cnt);
+
+	for (i = 0; i < opts->term_cnt; i++) {
+		term_obj = json_object_array_get_idx(terms_obj, i);
+		if (!term_obj) {
+			ret = -EINVAL;
+			goto error;
+		}
+
+		ret = parse_term(term_obj, opts->predicate, &opts->terms[i]);
+		if (ret)
+			goto error;
+	}
+
+	ret = adaptived_cause_set_data(cse, (void *)opts);
+	if (ret)
+		goto error;
+
+	return ret;
+
+error:
+	free_opts(opts);
+	return ret;
+}
+
+static float term_value(const struct adaptived_psi_vector * const vec,
+			const struct psi_vector_term * const term)
+{
+	const struct adaptived_pressure_snapshot * const ps = &vec->res[term->res];
+
+	switch (term->meas) {
+	case PRESSURE_SOME_AVG10:
+		return ps->some.avg10;
+	case PRESSURE_SOME_AVG60:
+		return ps->some.avg60;
+	case PRESSURE_SOME_AVG300:
+		return ps->some.avg300;
+	case PRESSURE_FULL_AVG10:
+		return ps->full.avg10;
+	case PRESSURE_FULL_AVG60:
+		return ps->full.avg60;
+	case PRESSURE_FULL_AVG300:
+		return ps->full.avg300;
+	default:
+		/* the totals were rejected by parse_term() */
+		return 0.0f;
+	}
+}
+
+static bool compare(enum cause_op_enum op, float value, float threshold)
+{
+	switch (op) {
+	case COP_GREATER_THAN:
+		return value > threshold;
+	case COP_LESS_THAN:
+		return value < threshold;
+	case COP_EQUAL:
+		return value == threshold;
+	default:
+		return false;
+	}
+}
+
+int psi_vector_main(struct adaptived_cause * const cse, int time_since_last_run)
+{
+	struct psi_vector_opts *opts = (struct psi_vector_opts *)adaptived_cause_get_data(cse);
+	struct adaptived_psi_vector vec, *shared;
+	bool triggered = false;
+	float value;
+	int ret, i;
+
+	ret = adaptived_get_psi_vector(opts->cgroup, &vec);
+	if (ret)
+		return ret;
+
+	switch (opts->predicate) {
+	case PREDICATE_WEIGHTED_SUM:
+		vec.value = 0.0f;
+		for (i = 0; i < opts->term_cnt; i++)
+			vec.value += opts->terms[i].weight * term_value(&vec, &opts->terms[i]);
+
+		triggered = compare(opts->op, vec.value, opts->threshold);
+		break;
+	case PREDICATE_MAX:
+		for (i = 0; i < opts->term_cnt; i++) {
+			value = opts->terms[i].weight * term_value(&vec, &opts->terms[i]);
+			if (i == 0 || value > vec.value)
+				vec.value = value;
+		}
+
+		triggered = compare(opts->op, vec.value, opts->threshold);
+		break;
+	case PREDICATE_ALL:
+		/* the value is the number of terms that met their threshold */
+		vec.value = 0.0f;
+		for (i = 0; i < opts->term_cnt; i++) {
+			if (compare(opts->op, term_value(&vec, &opts->terms[i]),
+				    opts->terms[i].threshold))
+				vec.value += 1.0f;
+		}
+
+		triggered = (int)vec.value == opts->term_cnt;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	adaptived_dbg("psi_vector: %s value = %.2f\n", predicate_names[opts->predicate], vec.value);
+
+	if (!triggered)
+		return 0;
+
+	shared = malloc(sizeof(struct adaptived_psi_vector));
+	if (!shared)
+		return -ENOMEM;
+
+	memcpy(shared, &vec, sizeof(struct adaptived_psi_vector));
+
+	ret = adaptived_write_shared_data(cse, ADAPTIVED_SDATA_PSI_VECTOR, shared, NULL, 0);
+	if (ret) {
+		free(shared);
+		return ret;
+	}
+
+	return 1;
+}
+
+void psi_vector_exit(struct adaptived_cause * const cse)
+{
+	struct psi_vector_opts *opts = (struct psi_vector_opts *)adaptived_cause_get_data(cse);
+
+	free_opts(opts);
+}
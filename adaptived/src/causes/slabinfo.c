@@ -41,6 +41,7 @@ struct slabinfo_opts {
 	char *slabinfo_file;
 	char *field;
 	char *column;
+	enum adaptived_slabinfo_column_enum column_idx;
 	struct adaptived_cgroup_value threshold;
 };
 
@@ -126,6 +127,14 @@ int slabinfo_init(struct adaptived_cause * const cse, struct json_object *args_o
 	opts->column[strlen(column_str)] = '\0';
 	adaptived_dbg("slabinfo_init: opts->column = %s\n", opts->column);
 
+	ret = adaptived_slabinfo_column_idx(opts->column);
+	if (ret < 0) {
+		adaptived_err("Invalid slabinfo column: %s\n", opts->column);
+		goto error;
+	}
+	opts->column_idx = ret;
+	ret = 0;
+
 	ret = parse_cause_operation(args_obj, NULL, &opts->op);
 	if (ret)
 		goto error;
@@ -150,13 +159,28 @@ error:
 int slabinfo_main(struct adaptived_cause * const cse, int time_since_last_run)
 {
 	struct slabinfo_opts *opts = (struct slabinfo_opts *)adaptived_cause_get_data(cse);
+	struct adaptived_slabinfo_snapshot *snap = NULL;
 	long long ll_value = 0;
 	int ret;
 
-	ret = adaptived_get_slabinfo_field(opts->slabinfo_file, opts->field, opts->column, &ll_value);
+	/* the snapshot is shared by every slabinfo cause in this pass */
+	ret = adaptived_get_slabinfo(opts->slabinfo_file, &snap);
 	if (ret)
 		return ret;
 
+	ret = adaptived_slabinfo_get_value(snap, opts->field, opts->column_idx, &ll_value);
+	adaptived_slabinfo_put(&snap);
+	if (ret == -ENOENT) {
+		/*
+		 * Slab caches come and go (and may be merged with other caches), so a
+		 * missing cache is compared as 0 rather than stopping adaptived
+		 */
+		adaptived_dbg("slabinfo: %s not found\n", opts->field);
+		ll_value = 0;
+	} else if (ret) {
+		return ret;
+	}
+
 	switch (opts->op) {
 	case COP_GREATER_THAN:
 		if (ll_value > opts->threshold.value.ll_value)
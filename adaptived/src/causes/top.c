@@ -36,31 +36,14 @@
 #include <time.h>
 #include <unistd.h>
 
+#include <sys/stat.h>
+
 #include <adaptived-utils.h>
 #include <adaptived.h>
 
 #include "adaptived-internal.h"
 #include "defines.h"
 
-/*
- * From /proc/stat:
- * u == user/us, n == nice/ni, s == system/sy, i == idle/id
- * w == IO-wait/wa (io wait time)
- * x == hi (hardware irq time), y == si (software irq time)
- * z == st (virtual steal time)
- */
-struct proc_stat {
-	long long user;
-	long long nice;
-	long long system;
-	long long idle;
-	long long iowait;
-	long long hw_irq_time;
-	long long sw_irq_time;
-	long long vm_steal_time;
-	long long total;
-};
-
 struct cpu_line {
 	float u_line;	// user
 	float n_line;	// nice
@@ -106,7 +89,12 @@ struct top_opts {
         enum top_field_enum field;
         struct adaptived_cgroup_value threshold;
 
-	struct proc_stat proc_stat;
+	/* the previous /proc/stat sample.  cpu percentages are relative to it */
+	struct adaptived_cpu_stat *prev_cs;
+	/* if set, only the cpus in cpus (or in the cpuset_file) are considered */
+	bool use_cpus;
+	struct adaptived_cpumask cpus;
+	char *cpuset_file;
 
 	struct cpu_line cpu_line;
 
@@ -124,90 +112,70 @@ static void free_opts(struct top_opts * const opts)
 		free(opts->stat_file);
 	if (opts->meminfo_file)
 		free(opts->meminfo_file);
+	if (opts->cpuset_file)
+		free(opts->cpuset_file);
+
+	adaptived_cpu_stat_put(&opts->prev_cs);
 
 	free(opts);
 }
 
-static long long get_diff(long long curr, long long prev)
+static int get_proc_stat_total(struct top_opts *opts, long long * const totalp)
 {
-	long long x = curr - prev;
+	long long ticks[ADAPTIVED_CPU_STAT_CNT], total = 0;
+	const struct adaptived_cpumask *mask = NULL;
+	struct adaptived_cpumask cpuset_mask;
+	struct adaptived_cpu_stat *cs = NULL;
+	int ret, i;
+
+	/* /proc/stat is parsed once per pass and shared by every top cause */
+	ret = adaptived_get_cpu_stat(opts->stat_file, &cs);
+	if (ret) {
+		adaptived_err("get_proc_stat_total: can't read %s: %d\n", opts->stat_file, ret);
+		return ret;
+	}
 
-	return ((x < 0) ? 0 : x);
-}
+	if (opts->cpuset_file) {
+		/* the cpuset may change at any time, so it's read on every sample */
+		ret = adaptived_cpumask_read(opts->cpuset_file, &cpuset_mask);
+		if (ret)
+			goto out;
+		mask = &cpuset_mask;
+	} else if (opts->use_cpus) {
+		mask = &opts->cpus;
+	}
 
-static int get_proc_stat_total(struct top_opts *opts)
-{
-	int items = 0;
-	char *bp;
-	FILE *fp;
-	char *line = NULL;
-	size_t len = 0;
-	ssize_t read;
-	struct proc_stat prev_proc_stat;
-	long long user_tics, nice_tics, system_tics, idle_tics;
-	long long iowait_tics, hw_irq_time_tics, sw_irq_time_tics, vm_steal_time_tics;
-	long long total;
+	/* the first sample is relative to boot */
+	ret = adaptived_cpu_stat_delta(opts->prev_cs, cs, mask, ticks);
+	if (ret)
+		goto out;
 
-	fp = fopen(opts->stat_file, "r");
-	if (fp == NULL) {
-		adaptived_err("get_proc_stat_total: can't open top file %s\n", opts->stat_file);
-		return -errno;
-	}
-	read = getline(&line, &len, fp);
-	fclose(fp);
-	if (read < 0 || !line) {
-		adaptived_err("get_proc_stat_total: read of %s failed.\n", opts->stat_file);
-		return -errno;
-	}
-	line[strcspn(line, "\n")] = '\0';
-	bp = line;
-	
-	memcpy(&prev_proc_stat, &opts->proc_stat, sizeof(struct proc_stat));
-
-	items = sscanf(bp, "cpu %llu %llu %llu %llu %llu %llu %llu %llu",
-	    &opts->proc_stat.user, &opts->proc_stat.nice, &opts->proc_stat.system,
-	    &opts->proc_stat.idle, &opts->proc_stat.iowait, &opts->proc_stat.hw_irq_time,
-	    &opts->proc_stat.sw_irq_time, &opts->proc_stat.vm_steal_time);
-	free(line);
-	if (items != 8) {
-		adaptived_err("get_proc_stat_total: sscanf error. Items should be 8, but got %d\n", items);
-		return -EINVAL;
-	}
-	opts->proc_stat.total =
-	    opts->proc_stat.user + opts->proc_stat.nice + opts->proc_stat.system +
-	    opts->proc_stat.idle + opts->proc_stat.iowait + opts->proc_stat.hw_irq_time +
-	    opts->proc_stat.sw_irq_time + opts->proc_stat.vm_steal_time;
-	
-	if (!opts->proc_stat.total)
-		return 0;
-
-	user_tics = get_diff(opts->proc_stat.user, prev_proc_stat.user);
-	nice_tics = get_diff(opts->proc_stat.nice, prev_proc_stat.nice);
-	system_tics = get_diff(opts->proc_stat.system, prev_proc_stat.system);
-	idle_tics = get_diff(opts->proc_stat.idle, prev_proc_stat.idle);
-	iowait_tics = get_diff(opts->proc_stat.iowait, prev_proc_stat.iowait);
-	hw_irq_time_tics = get_diff(opts->proc_stat.hw_irq_time, prev_proc_stat.hw_irq_time);
-	sw_irq_time_tics = get_diff(opts->proc_stat.sw_irq_time, prev_proc_stat.sw_irq_time);
-	vm_steal_time_tics = get_diff(opts->proc_stat.vm_steal_time, prev_proc_stat.vm_steal_time);
-
-	total = user_tics + nice_tics + system_tics + idle_tics + iowait_tics +
-	    hw_irq_time_tics + sw_irq_time_tics + vm_steal_time_tics;
+	adaptived_cpu_stat_put(&opts->prev_cs);
+	opts->prev_cs = cs;
+	cs = NULL;
+
+	for (i = 0; i < ADAPTIVED_CPU_STAT_CNT; i++)
+		total += ticks[i];
 
 	adaptived_dbg("user_tics=%lld, nice_tics=%lld, system_tics=%lld, idle_tics=%lld, "
 		"iowait_tics=%lld, hw_irq_time_tics=%lld, sw_irq_time_tics=%lld, "
 		"vm_steal_time_tics=%lld, total=%lld\n",
-	    user_tics, nice_tics, system_tics, idle_tics, iowait_tics, hw_irq_time_tics,
-		sw_irq_time_tics, vm_steal_time_tics, total);
+	    ticks[ADAPTIVED_CPU_STAT_USER], ticks[ADAPTIVED_CPU_STAT_NICE],
+	    ticks[ADAPTIVED_CPU_STAT_SYSTEM], ticks[ADAPTIVED_CPU_STAT_IDLE],
+	    ticks[ADAPTIVED_CPU_STAT_IOWAIT], ticks[ADAPTIVED_CPU_STAT_IRQ],
+	    ticks[ADAPTIVED_CPU_STAT_SOFTIRQ], ticks[ADAPTIVED_CPU_STAT_STEAL], total);
+
+	*totalp = total;
 
 	if (total > 0) {
-		opts->cpu_line.u_line = 100.0 * (float)user_tics / (float)total;
-		opts->cpu_line.n_line = 100.0 * (float)nice_tics / (float)total;
-		opts->cpu_line.s_line = 100.0 * (float)system_tics / (float)total;
-		opts->cpu_line.i_line = 100.0 * (float)idle_tics / (float)total;
-		opts->cpu_line.w_line = 100.0 * (float)iowait_tics / (float)total;
-		opts->cpu_line.h_line = 100.0 * (float)hw_irq_time_tics / (float)total;
-		opts->cpu_line.x_line = 100.0 * (float)sw_irq_time_tics / (float)total;
-		opts->cpu_line.v_line = 100.0 * (float)vm_steal_time_tics / (float)total;
+		opts->cpu_line.u_line = 100.0 * (float)ticks[ADAPTIVED_CPU_STAT_USER] / (float)total;
+		opts->cpu_line.n_line = 100.0 * (float)ticks[ADAPTIVED_CPU_STAT_NICE] / (float)total;
+		opts->cpu_line.s_line = 100.0 * (float)ticks[ADAPTIVED_CPU_STAT_SYSTEM] / (float)total;
+		opts->cpu_line.i_line = 100.0 * (float)ticks[ADAPTIVED_CPU_STAT_IDLE] / (float)total;
+		opts->cpu_line.w_line = 100.0 * (float)ticks[ADAPTIVED_CPU_STAT_IOWAIT] / (float)total;
+		opts->cpu_line.h_line = 100.0 * (float)ticks[ADAPTIVED_CPU_STAT_IRQ] / (float)total;
+		opts->cpu_line.x_line = 100.0 * (float)ticks[ADAPTIVED_CPU_STAT_SOFTIRQ] / (float)total;
+		opts->cpu_line.v_line = 100.0 * (float)ticks[ADAPTIVED_CPU_STAT_STEAL] / (float)total;
 	} else {
 		opts->cpu_line.u_line = 0.0;
 		opts->cpu_line.n_line = 0.0;
@@ -227,32 +195,36 @@ static int get_proc_stat_total(struct top_opts *opts)
 		    opts->cpu_line.h_line, opts->cpu_line.x_line, opts->cpu_line.v_line);
 	}
 
-	return 0;
+out:
+	adaptived_cpu_stat_put(&cs);
+
+	return ret;
 }
 
 static int calc_meminfo(struct top_opts *opts, struct proc_meminfo *meminfo)
 {
+	struct adaptived_meminfo_request reqs[] = {
+		{ .field = "MemTotal" },
+		{ .field = "MemFree" },
+		{ .field = "MemAvailable" },
+		{ .field = "Cached" },
+		{ .field = "SReclaimable" },
+		{ .field = "Buffers" },
+	};
 	long long ll_main_cached;
 	int ret;
 
-	ret = adaptived_get_meminfo_field(opts->meminfo_file, "MemTotal", &meminfo->total);
-	if (ret)
-		return ret;
-	ret = adaptived_get_meminfo_field(opts->meminfo_file, "MemFree", &meminfo->free);
-	if (ret)
-		return ret;
-	ret = adaptived_get_meminfo_field(opts->meminfo_file, "MemAvailable", &meminfo->available);
-	if (ret)
-		return ret;
-	ret = adaptived_get_meminfo_field(opts->meminfo_file, "Cached", &meminfo->page_cache);
-	if (ret)
-		return ret;
-	ret = adaptived_get_meminfo_field(opts->meminfo_file, "SReclaimable", &meminfo->slab_reclaimable);
-	if (ret)
-		return ret;
-	ret = adaptived_get_meminfo_field(opts->meminfo_file, "Buffers", &meminfo->buffers);
+	ret = adaptived_get_meminfo_fields(opts->meminfo_file, reqs, ARRAY_SIZE(reqs));
 	if (ret)
 		return ret;
+
+	meminfo->total = reqs[0].value;
+	meminfo->free = reqs[1].value;
+	meminfo->available = reqs[2].value;
+	meminfo->page_cache = reqs[3].value;
+	meminfo->slab_reclaimable = reqs[4].value;
+	meminfo->buffers = reqs[5].value;
+
 	ll_main_cached = meminfo->page_cache + meminfo->slab_reclaimable;
 
 	if (meminfo->available > meminfo->total)
@@ -271,6 +243,73 @@ static int calc_meminfo(struct top_opts *opts, struct proc_meminfo *meminfo)
 	return 0;
 }
 
+/*
+ * By default, the top cause uses the aggregate of every cpu.  It can instead be limited
+ * to a list of cpus, the cpus in a NUMA node, or the cpus in a cgroup's cpuset
+ */
+static int parse_cpus(struct json_object * const args_obj, struct top_opts * const opts)
+{
+	const char *cpus_str, *cpuset_str;
+	char cpuset_file[FILENAME_MAX];
+	int ret, node, cnt = 0;
+	struct stat st;
+
+	ret = adaptived_parse_string(args_obj, "cpus", &cpus_str);
+	if (ret == 0) {
+		ret = adaptived_cpumask_parse(cpus_str, &opts->cpus);
+		if (ret) {
+			adaptived_err("top_init: invalid cpus: %s\n", cpus_str);
+			return ret;
+		}
+		opts->use_cpus = true;
+		cnt++;
+	} else if (ret != -ENOENT) {
+		adaptived_err("Failed to parse the cpus\n");
+		return ret;
+	}
+
+	ret = adaptived_parse_int(args_obj, "numa_node", &node);
+	if (ret == 0) {
+		ret = adaptived_cpumask_numa_node(node, &opts->cpus);
+		if (ret) {
+			adaptived_err("top_init: failed to get the cpus in NUMA node %d: %d\n",
+				      node, ret);
+			return ret;
+		}
+		opts->use_cpus = true;
+		cnt++;
+	} else if (ret != -ENOENT) {
+		adaptived_err("Failed to parse the numa_node\n");
+		return ret;
+	}
+
+	ret = adaptived_parse_string(args_obj, "cpuset", &cpuset_str);
+	if (ret == 0) {
+		/* a cgroup directory, or a file that contains a cpu list */
+		if (stat(cpuset_str, &st) == 0 && S_ISDIR(st.st_mode))
+			snprintf(cpuset_file, FILENAME_MAX - 1, "%s/cpuset.cpus.effective",
+				 cpuset_str);
+		else
+			snprintf(cpuset_file, FILENAME_MAX - 1, "%s", cpuset_str);
+		cpuset_file[FILENAME_MAX - 1] = '\0';
+
+		opts->cpuset_file = strdup(cpuset_file);
+		if (!opts->cpuset_file)
+			return -ENOMEM;
+		cnt++;
+	} else if (ret != -ENOENT) {
+		adaptived_err("Failed to parse the cpuset\n");
+		return ret;
+	}
+
+	if (cnt > 1) {
+		adaptived_err("top_init: only one of cpus, numa_node, and cpuset may be specified\n");
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
 int top_init(struct adaptived_cause * const cse, struct json_object *args_obj, int interval)
 {
 	const char *stat_file_str, *meminfo_file_str,  *field_str, *component_str;
@@ -345,6 +384,10 @@ int top_init(struct adaptived_cause * const cse, struct json_object *args_obj, i
 			ret = -EINVAL;
 			goto error;
 		}
+
+		ret = parse_cpus(args_obj, opts);
+		if (ret)
+			goto error;
 	} else if (strcmp(component_str, "mem") == 0) {
 		if (opts->threshold.type != ADAPTIVED_CGVAL_LONG_LONG) {
 			adaptived_err("Only long long supported for top mem.\n");
@@ -407,6 +450,11 @@ int top_init(struct adaptived_cause * const cse, struct json_object *args_obj, i
         ret = adaptived_cause_set_data(cse, (void *)opts);
         if (ret)
                 goto error;
+
+	if (opts->field <= TOP_CPU_ST)
+		/* cpu percentages are computed from the delta since the previous sample */
+		adaptived_cause_set_flags(cse, ADAPTIVED_CAUSEF_EVERY_SAMPLE);
+
 	return ret;
 
 error:
@@ -418,17 +466,17 @@ int top_main(struct adaptived_cause * const cse, int time_since_last_run)
 {
 	struct top_opts *opts = (struct top_opts *)adaptived_cause_get_data(cse);
 	float float_value = 0;
-	long long ll_value = 0;
+	long long ll_value = 0, total;
 	struct proc_meminfo meminfo;
 	int ret;
 
 	if (opts->field <= TOP_CPU_ST) {
-		ret = get_proc_stat_total(opts);
+		ret = get_proc_stat_total(opts, &total);
 		if (ret) {
 			adaptived_err("top_main: get_proc_stat_total() failed. ret=%d\n", ret);
 			return ret;
 		}
-		if (!opts->proc_stat.total) {
+		if (!total) {
 			adaptived_dbg("top_main: cause percentages not yet ready...\n");
 			return 0;
 		}
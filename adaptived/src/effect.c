@@ -133,7 +133,7 @@ API int adaptived_register_effect(struct adaptived_ctx * const ctx, const char *
 	eff->fns = fns;
 	eff->next = NULL;
 
-	pthread_mutex_lock(&ctx->ctx_mutex);
+	pthread_mutex_lock(&ctx->update_mutex);
 
 	/*
 	 * Verify that the name is available in both the built-in effects and the
@@ -142,7 +142,7 @@ API int adaptived_register_effect(struct adaptived_ctx * const ctx, const char *
 	for (i = 0; i < EFFECT_CNT; i++) {
 		if (strcmp(name, effect_names[i]) == 0) {
 			ret = -EEXIST;
-			pthread_mutex_unlock(&ctx->ctx_mutex);
+			pthread_mutex_unlock(&ctx->update_mutex);
 			goto err;
 		}
 	}
@@ -151,7 +151,7 @@ API int adaptived_register_effect(struct adaptived_ctx * const ctx, const char *
 	while (tmp) {
 		if (strcmp(name, tmp->name) == 0) {
 			ret = -EEXIST;
-			pthread_mutex_unlock(&ctx->ctx_mutex);
+			pthread_mutex_unlock(&ctx->update_mutex);
 			goto err;
 		}
 
@@ -171,7 +171,7 @@ API int adaptived_register_effect(struct adaptived_ctx * const ctx, const char *
 
 		tmp_eff->next = eff;
 	}
-	pthread_mutex_unlock(&ctx->ctx_mutex);
+	pthread_mutex_unlock(&ctx->update_mutex);
 
 	return ret;
 
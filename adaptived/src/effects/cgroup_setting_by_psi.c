@@ -217,33 +217,6 @@ error:
 	return ret;
 }
 
-static int get_psi_avg(const struct cgroup_setting_psi_opts * const opts,
-		       const char * const cgroup_path, float * const avg)
-{
-	char pressure_path[FILENAME_MAX] = { '\0' };
-	int ret;
-
-	switch(opts->pressure_type) {
-	case PRESSURE_TYPE_CPU:
-		sprintf(pressure_path, "%s/cpu.pressure", cgroup_path);
-		break;
-	case PRESSURE_TYPE_MEMORY:
-		sprintf(pressure_path, "%s/memory.pressure", cgroup_path);
-		break;
-	case PRESSURE_TYPE_IO:
-		sprintf(pressure_path, "%s/io.pressure", cgroup_path);
-		break;
-	default:
-		return -EINVAL;
-	}
-
-	ret = adaptived_get_pressure_avg(pressure_path, opts->meas, avg);
-	if (ret)
-		return ret;
-
-	return 0;
-}
-
 static int add(const struct cgroup_setting_psi_opts * const opts,
 	       struct adaptived_cgroup_value * const value)
 {
@@ -337,123 +310,83 @@ error:
 	return ret;
 }
 
-static int compare_psi(struct cgroup_setting_psi_opts * const opts, const char * const cg_path,
-		       float psi, float * const max_psi)
-{
-	char full_setting_path[FILENAME_MAX];
-	struct adaptived_cgroup_value value;
-	int ret;
-
-	value.type = opts->value.type;
-
-	switch (opts->pressure_op) {
-	case COP_GREATER_THAN:
-		if (psi < *max_psi)
-			/* We have already found a better candidate */
-			return -EALREADY;
-		break;
-	case COP_LESS_THAN:
-		if (psi > *max_psi)
-			/* We have already found a better candidate */
-			return -EALREADY;
-		break;
-	default:
-		return -EINVAL;
-	}
-
-	sprintf(full_setting_path, "%s/%s", cg_path, opts->cgroup_setting);
-	full_setting_path[strlen(cg_path) + strlen(opts->cgroup_setting) + 1] = '\0';
-
-	ret = calculate_value(opts, full_setting_path, &value);
-	if (ret)
-		return ret;
-
-	/*
-	 * This cgroup is the currently best candidate to be modified
-	 */
-	*max_psi = psi;
-
-	return 0;
-}
-
 int cgroup_setting_psi_main(struct adaptived_effect * const eff)
 {
 	struct cgroup_setting_psi_opts *opts = (struct cgroup_setting_psi_opts *)eff->data;
-	char *cgroup_path = NULL, *max_cgroup_path = NULL;
-	struct adaptived_path_walk_handle *handle = NULL;
+	struct adaptived_psi_scan_entry *candidates = NULL;
+	struct adaptived_psi_scan *scan = NULL;
 	char full_setting_path[FILENAME_MAX];
 	struct adaptived_cgroup_value value;
 	uint32_t cgflags = 0;
-	float psi, max_psi;
-	int ret;
+	int ret, cnt, i;
+	bool lowest;
 
 	switch (opts->pressure_op) {
 	case COP_GREATER_THAN:
-		max_psi = -1.0f;
+		lowest = false;
 		break;
 	case COP_LESS_THAN:
-		max_psi = 101.0f;
+		lowest = true;
 		break;
 	default:
 		return -EINVAL;
 	}
 
-	value.type = opts->value.type;
-
-	ret = adaptived_path_walk_start(opts->cgroup_path, &handle, ADAPTIVED_PATH_WALK_LIST_DIRS,
-				     opts->max_depth);
+	/* the cgroup tree is walked at most once per pass, however many effects use it */
+	ret = adaptived_get_psi_scan(opts->cgroup_path,
+				     (enum adaptived_psi_resource_enum)opts->pressure_type,
+				     opts->max_depth, &scan);
 	if (ret)
 		goto error;
 
-	do {
-		ret = adaptived_path_walk_next(&handle, &cgroup_path);
-		if (ret)
-			goto error;
-		if (!cgroup_path)
-			/* We've reached the end of the tree */
-			break;
+	cnt = adaptived_psi_scan_count(scan);
+	if (cnt <= 0)
+		goto error;
 
-		ret = get_psi_avg(opts, cgroup_path, &psi);
-		if (ret)
-			goto error;
+	candidates = malloc(sizeof(struct adaptived_psi_scan_entry) * cnt);
+	if (!candidates) {
+		ret = -ENOMEM;
+		goto error;
+	}
 
-		ret = compare_psi(opts, cgroup_path, psi, &max_psi);
-		if (ret == -EALREADY) {
-			/* A previous cgroup is a better candidate */
-			free(cgroup_path);
-			continue;
-		} else if (ret) {
-			goto error;
-		}
+	/* like the original walk, the last cgroup walked wins a tie */
+	cnt = adaptived_psi_scan_top(scan, opts->meas, lowest, ADAPTIVED_PSI_SCAN_TIE_LAST_WALKED,
+				     candidates, cnt);
+	if (cnt < 0) {
+		ret = cnt;
+		goto error;
+	}
 
-		if (max_cgroup_path)
-			free(max_cgroup_path);
-		max_cgroup_path = cgroup_path;
-	} while (true);
+	for (i = 0; i < cnt; i++) {
+		value.type = opts->value.type;
 
-	if (max_cgroup_path) {
-		sprintf(full_setting_path, "%s/%s", max_cgroup_path, opts->cgroup_setting);
-		full_setting_path[strlen(max_cgroup_path) +
+		sprintf(full_setting_path, "%s/%s", candidates[i].cgroup, opts->cgroup_setting);
+		full_setting_path[strlen(candidates[i].cgroup) +
 				  strlen(opts->cgroup_setting) + 1] = '\0';
 
 		ret = calculate_value(opts, full_setting_path, &value);
-		if (ret)
+		if (ret == -EALREADY) {
+			/*
+			 * This cgroup's setting is already at its limit.  Move on to the
+			 * next best candidate
+			 */
+			ret = 0;
+			continue;
+		} else if (ret) {
 			goto error;
+		}
 
 		if (opts->validate)
 			cgflags |= ADAPTIVED_CGROUP_FLAGS_VALIDATE;
 
 		ret = adaptived_cgroup_set_value(full_setting_path, &value, cgflags);
-		if (ret)
-			goto error;
+		break;
 	}
 
 error:
-	adaptived_path_walk_end(&handle);
-	if (cgroup_path)
-		free(cgroup_path);
-	if (max_cgroup_path)
-		free(max_cgroup_path);
+	if (candidates)
+		free(candidates);
+	adaptived_psi_scan_put(&scan);
 
 	return ret;
 }
@@ -21,7 +21,7 @@
  * questions.
  */
 /**
- * An effect to kill the processes in a cgroup that has the largest PSI value
+ * An effect to kill the processes in the cgroup(s) that have the largest PSI values
  *
  */
 
@@ -37,6 +37,7 @@
 #include "defines.h"
 
 #define DEFAULT_SIGNAL SIGKILL
+#define DEFAULT_COUNT 1
 
 struct kill_cg_opts {
 	char *cgroup_path;
@@ -46,6 +47,11 @@ struct kill_cg_opts {
 
 	int signal; /* optional */
 	int max_depth; /* optional */
+	int count; /* optional */
+	float threshold; /* optional */
+
+	/* internal variables that aren't passed in via JSON args */
+	bool threshold_provided;
 };
 
 int kill_cgroup_psi_init(struct adaptived_effect * const eff, struct json_object *args_obj,
@@ -126,6 +132,30 @@ int kill_cgroup_psi_init(struct adaptived_effect * const eff, struct json_object
 		goto error;
 	}
 
+	ret = adaptived_parse_int(args_obj, "count", &opts->count);
+	if (ret == -ENOENT) {
+		opts->count = DEFAULT_COUNT;
+		ret = 0;
+	} else if (ret) {
+		goto error;
+	}
+
+	if (opts->count <= 0) {
+		adaptived_err("Invalid count provided: %d\n", opts->count);
+		ret = -EINVAL;
+		goto error;
+	}
+
+	ret = adaptived_parse_float(args_obj, "threshold", &opts->threshold);
+	if (ret == -ENOENT) {
+		opts->threshold_provided = false;
+		ret = 0;
+	} else if (ret) {
+		goto error;
+	} else {
+		opts->threshold_provided = true;
+	}
+
 	eff->data = (void *)opts;
 
 	return ret;
@@ -172,81 +202,48 @@ error:
 	return ret;
 }
 
-static int get_psi(const struct kill_cg_opts * const opts, const char * const cgroup_path,
-		   float * const avg)
-{
-	char pressure_path[FILENAME_MAX] = { '\0' };
-	int ret;
-
-	switch(opts->pressure_type) {
-	case PRESSURE_TYPE_CPU:
-		sprintf(pressure_path, "%s/cpu.pressure", cgroup_path);
-		break;
-	case PRESSURE_TYPE_MEMORY:
-		sprintf(pressure_path, "%s/memory.pressure", cgroup_path);
-		break;
-	case PRESSURE_TYPE_IO:
-		sprintf(pressure_path, "%s/io.pressure", cgroup_path);
-		break;
-	default:
-		return -EINVAL;
-	}
-
-	ret = adaptived_get_pressure_avg(pressure_path, opts->meas, avg);
-	if (ret)
-		return ret;
-
-	return 0;
-}
-
 int kill_cgroup_psi_main(struct adaptived_effect * const eff)
 {
 	struct kill_cg_opts *opts = (struct kill_cg_opts *)eff->data;
-	char *cgroup_path = NULL, *kill_cgroup_path = NULL;
-	struct adaptived_path_walk_handle *handle = NULL;
-	float psi, max_psi = -1.0f;
-	int ret;
-
-	ret = adaptived_path_walk_start(opts->cgroup_path, &handle, ADAPTIVED_PATH_WALK_LIST_DIRS,
-				     opts->max_depth);
+	struct adaptived_psi_scan_entry *top = NULL;
+	struct adaptived_psi_scan *scan = NULL;
+	int ret, cnt, i;
+
+	/* the cgroup tree is walked at most once per pass, however many effects use it */
+	ret = adaptived_get_psi_scan(opts->cgroup_path,
+				     (enum adaptived_psi_resource_enum)opts->pressure_type,
+				     opts->max_depth, &scan);
 	if (ret)
 		goto error;
 
-	do {
-		ret = adaptived_path_walk_next(&handle, &cgroup_path);
-		if (ret)
-			goto error;
-		if (!cgroup_path)
+	top = malloc(sizeof(struct adaptived_psi_scan_entry) * opts->count);
+	if (!top) {
+		ret = -ENOMEM;
+		goto error;
+	}
+
+	/* like the original walk, the first cgroup walked wins a tie */
+	cnt = adaptived_psi_scan_top(scan, opts->meas, false, ADAPTIVED_PSI_SCAN_TIE_FIRST_WALKED,
+				     top, opts->count);
+	if (cnt < 0) {
+		ret = cnt;
+		goto error;
+	}
+
+	for (i = 0; i < cnt; i++) {
+		if (opts->threshold_provided && top[i].value <= opts->threshold)
+			/* the remaining cgroups have even less pressure */
 			break;
 
-		ret = get_psi(opts, cgroup_path, &psi);
+		ret = kill_cgroup(opts, top[i].cgroup);
 		if (ret)
 			goto error;
-
-		if (psi > max_psi) {
-			/*
-			 * This cgroup is our current candidate for being killed.
-			 * Save it off.
-			 */
-			if (kill_cgroup_path)
-				free(kill_cgroup_path);
-
-			kill_cgroup_path = cgroup_path;
-			max_psi = psi;
-		} else {
-			free(cgroup_path);
-		}
-	} while (true);
-
-	ret = kill_cgroup(opts, kill_cgroup_path);
-	if (ret)
-		goto error;
+	}
 
 error:
-	adaptived_path_walk_end(&handle);
-
-	if (kill_cgroup_path)
-		free(kill_cgroup_path);
+	if (top)
+		free(top);
+	adaptived_psi_scan_put(&scan);
 
 	return ret;
 }
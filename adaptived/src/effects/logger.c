@@ -275,6 +275,7 @@ int logger_main(struct adaptived_effect * const eff)
 	size_t read, write;
 	int ret = 0;
 	time_t now = time(NULL);
+	struct tm tm;
 	char *buf = NULL;
 
 	log = fopen(opts->logfile, "a");
@@ -294,9 +295,9 @@ int logger_main(struct adaptived_effect * const eff)
 	}
 	if (opts->date_format) {
 		if (opts->utc)
-			strftime(dateline, FILENAME_MAX, opts->date_format, gmtime(&now));
+			strftime(dateline, FILENAME_MAX, opts->date_format, gmtime_r(&now, &tm));
 		else
-			strftime(dateline, FILENAME_MAX, opts->date_format, localtime(&now));
+			strftime(dateline, FILENAME_MAX, opts->date_format, localtime_r(&now, &tm));
 		strcpy(&separator[strlen(separator)], dateline);
 		}
 
@@ -0,0 +1,444 @@
+/*
+ * Copyright (c) 2024, Oracle and/or its affiliates.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+/**
+ * epoll-based event handling for the adaptived main loop
+ *
+ * The main loop blocks in epoll_wait() on the following file descriptors:
+ * 	timerfd - armed with the absolute deadline of the next rule that is due
+ * 	eventfd - written to when a rule is loaded or unloaded at runtime
+ * 	signalfd - SIGTERM/SIGINT (exit) and SIGHUP (reload).  daemon mode only
+ * 	inotify - changes to the configuration file (reload).  daemon mode only
+ * 	cause fds - registered via adaptived_cause_register_fd().  When one is
+ * 		    ready, the rule that contains the cause is run immediately
+ */
+
+#include <sys/signalfd.h>
+#include <sys/inotify.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+#include <sys/epoll.h>
+#include <string.h>
+#include <libgen.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+
+#include <adaptived.h>
+
+#include "adaptived-internal.h"
+
+#define INOTIFY_BUF_SIZE (sizeof(struct inotify_event) + FILENAME_MAX + 1)
+
+static int epoll_add(int epoll_fd, int fd, uint32_t events, void * const ptr)
+{
+	struct epoll_event ev;
+	int ret;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = events;
+	ev.data.ptr = ptr;
+
+	ret = epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+	if (ret)
+		return -errno;
+
+	return 0;
+}
+
+static int watch_config(struct event_loop * const evl, const char * const config)
+{
+	char dir[FILENAME_MAX];
+	char base[FILENAME_MAX];
+
+	strncpy(dir, config, FILENAME_MAX - 1);
+	dir[FILENAME_MAX - 1] = '\0';
+	strncpy(base, config, FILENAME_MAX - 1);
+	base[FILENAME_MAX - 1] = '\0';
+
+	strncpy(evl->config_name, basename(base), FILENAME_MAX - 1);
+	evl->config_name[FILENAME_MAX - 1] = '\0';
+
+	evl->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (evl->inotify_fd < 0)
+		return -errno;
+
+	/*
+	 * Watch the directory rather than the file itself.  Many editors write a new
+	 * file and rename it over the original
+	 */
+	if (inotify_add_watch(evl->inotify_fd, dirname(dir), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+		return -errno;
+
+	return 0;
+}
+
+int event_loop_init(struct event_loop * const evl, struct adaptived_ctx * const ctx)
+{
+	sigset_t mask;
+	int ret;
+
+	memset(evl, 0, sizeof(struct event_loop));
+	evl->epoll_fd = -1;
+	evl->timer_fd = -1;
+	evl->wake_fd = -1;
+	evl->signal_fd = -1;
+	evl->inotify_fd = -1;
+
+	evl->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (evl->timer_fd < 0) {
+		ret = -errno;
+		goto error;
+	}
+
+	evl->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (evl->wake_fd < 0) {
+		ret = -errno;
+		goto error;
+	}
+
+	if (ctx->daemon_mode) {
+		/*
+		 * The signals must be blocked before the worker threads are created so
+		 * that they are only delivered via the signalfd
+		 */
+		sigemptyset(&mask);
+		sigaddset(&mask, SIGTERM);
+		sigaddset(&mask, SIGINT);
+		sigaddset(&mask, SIGHUP);
+
+		ret = pthread_sigmask(SIG_BLOCK, &mask, &evl->old_mask);
+		if (ret) {
+			ret = -ret;
+			goto error;
+		}
+		evl->mask_set = true;
+
+		evl->signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+		if (evl->signal_fd < 0) {
+			ret = -errno;
+			goto error;
+		}
+
+		if (strlen(ctx->config) > 0) {
+			ret = watch_config(evl, ctx->config);
+			if (ret) {
+				adaptived_wrn("Failed to watch %s: %d\n", ctx->config, ret);
+				if (evl->inotify_fd >= 0)
+					close(evl->inotify_fd);
+				evl->inotify_fd = -1;
+			}
+		}
+	}
+
+	ctx->wake_fd = evl->wake_fd;
+
+	return 0;
+
+error:
+	adaptived_err("Failed to initialize the event loop: %d\n", ret);
+	event_loop_cleanup(evl, ctx);
+	return ret;
+}
+
+/*
+ * (Re)build the epoll set.  This is done whenever a rule is loaded or unloaded or
+ * a cause registers or unregisters a file descriptor.  Recreating the epoll instance
+ * guarantees that it no longer references file descriptors owned by causes that
+ * have been destroyed
+ */
+int event_loop_update(struct event_loop * const evl, const struct rule_set * const set)
+{
+	unsigned long fds_gen = __atomic_load_n(&cause_fds_gen, __ATOMIC_ACQUIRE);
+	struct adaptived_rule *rule;
+	struct adaptived_cause *cse;
+	struct cause_fd *cfd;
+	int ret, i;
+
+	if (evl->epoll_fd >= 0 && evl->rules_gen == set->gen && evl->fds_gen == fds_gen)
+		return 0;
+
+	if (evl->epoll_fd >= 0)
+		close(evl->epoll_fd);
+
+	evl->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (evl->epoll_fd < 0)
+		return -errno;
+
+	ret = epoll_add(evl->epoll_fd, evl->timer_fd, EPOLLIN, &evl->timer_fd);
+	if (ret)
+		return ret;
+	ret = epoll_add(evl->epoll_fd, evl->wake_fd, EPOLLIN, &evl->wake_fd);
+	if (ret)
+		return ret;
+	if (evl->signal_fd >= 0) {
+		ret = epoll_add(evl->epoll_fd, evl->signal_fd, EPOLLIN, &evl->signal_fd);
+		if (ret)
+			return ret;
+	}
+	if (evl->inotify_fd >= 0) {
+		ret = epoll_add(evl->epoll_fd, evl->inotify_fd, EPOLLIN, &evl->inotify_fd);
+		if (ret)
+			return ret;
+	}
+
+	for (i = 0; i < set->cnt; i++) {
+		rule = set->rules[i];
+		cse = rule->causes;
+		while (cse) {
+			/* a shared cause's fds are owned by the group's instance */
+			cfd = cse->group ? cse->group->cse->fds : cse->fds;
+			while (cfd) {
+				cfd->rule = rule;
+				cfd->group = cse->group;
+
+				ret = epoll_add(evl->epoll_fd, cfd->fd, cfd->events, cfd);
+				if (ret == -EEXIST && cse->group)
+					/* already added by another rule in the group */
+					ret = 0;
+				if (ret) {
+					adaptived_err("Rule %s: failed to monitor fd %d: %d\n",
+						      rule->name, cfd->fd, ret);
+					return ret;
+				}
+
+				cfd = cfd->next;
+			}
+			cse = cse->next;
+		}
+	}
+
+	evl->rules_gen = set->gen;
+	evl->fds_gen = fds_gen;
+
+	return 0;
+}
+
+/*
+ * Wait for the deadline to pass or for another event to occur.  This is called
+ * without the ctx mutex or the rule set read lock held, so the events are only
+ * recorded here.  They are processed by event_loop_process() once the locks have
+ * been reacquired
+ */
+void event_loop_wait(struct event_loop * const evl, long long deadline, bool block)
+{
+	struct itimerspec its;
+	int ret;
+
+	evl->event_cnt = 0;
+
+	if (block) {
+		memset(&its, 0, sizeof(its));
+		its.it_value.tv_sec = deadline / 1000;
+		its.it_value.tv_nsec = (deadline % 1000) * 1000000LL;
+
+		/*
+		 * An it_value of zero disarms the timer.  A deadline of zero is always
+		 * in the past, so bump it to the smallest possible expiration
+		 */
+		if (its.it_value.tv_sec == 0 && its.it_value.tv_nsec == 0)
+			its.it_value.tv_nsec = 1;
+
+		ret = timerfd_settime(evl->timer_fd, TFD_TIMER_ABSTIME, &its, NULL);
+		if (ret)
+			adaptived_wrn("timerfd_settime returned %d\n", errno);
+	}
+
+	do {
+		ret = epoll_wait(evl->epoll_fd, evl->events, EVENT_LOOP_MAX_EVENTS, block ? -1 : 0);
+	} while (ret < 0 && errno == EINTR);
+
+	if (ret < 0) {
+		adaptived_wrn("epoll_wait returned %d\n", errno);
+		return;
+	}
+
+	evl->event_cnt = ret;
+}
+
+static void drain(int fd)
+{
+	uint64_t buf;
+
+	while (read(fd, &buf, sizeof(buf)) > 0)
+		;
+}
+
+static int process_signals(struct event_loop * const evl)
+{
+	struct signalfd_siginfo info;
+	int flags = 0;
+
+	while (read(evl->signal_fd, &info, sizeof(info)) == sizeof(info)) {
+		switch (info.ssi_signo) {
+		case SIGHUP:
+			adaptived_info("Received SIGHUP.  Reloading the configuration\n");
+			flags |= EVENT_RELOAD;
+			break;
+		case SIGTERM:
+		case SIGINT:
+			adaptived_info("Received signal %u.  Exiting\n", info.ssi_signo);
+			flags |= EVENT_EXIT;
+			break;
+		default:
+			break;
+		}
+	}
+
+	return flags;
+}
+
+static int process_inotify(struct event_loop * const evl)
+{
+	char buf[INOTIFY_BUF_SIZE * 8]
+		__attribute__ ((aligned(__alignof__(struct inotify_event))));
+	const struct inotify_event *event;
+	ssize_t len;
+	char *ptr;
+	int flags = 0;
+
+	while ((len = read(evl->inotify_fd, buf, sizeof(buf))) > 0) {
+		for (ptr = buf; ptr < buf + len; ptr += sizeof(struct inotify_event) + event->len) {
+			event = (const struct inotify_event *)ptr;
+
+			if (event->len && strcmp(event->name, evl->config_name) == 0) {
+				adaptived_info("%s changed.  Reloading the configuration\n",
+					       evl->config_name);
+				flags |= EVENT_RELOAD;
+			}
+		}
+	}
+
+	return flags;
+}
+
+/*
+ * Wake every rule that contains a cause in the group
+ */
+static void wake_group(const struct rule_set * const set, const struct cause_group * const grp,
+		       long long now)
+{
+	struct adaptived_cause *cse;
+	int i;
+
+	for (i = 0; i < set->cnt; i++) {
+		cse = set->rules[i]->causes;
+		while (cse) {
+			if (cse->group == grp) {
+				adaptived_dbg("Shared cause %s is ready.  Waking rule %s\n",
+					      cse->name, set->rules[i]->name);
+				set->rules[i]->next_run = now;
+				break;
+			}
+			cse = cse->next;
+		}
+	}
+}
+
+/*
+ * Process the events recorded by the last event_loop_wait().  Must be called with
+ * the ctx mutex and the rule set read lock held.  set is the current rule set.
+ * Returns a bitmask of enum event_loop_flags
+ */
+int event_loop_process(struct event_loop * const evl, const struct rule_set * const set,
+		       long long now)
+{
+	bool fds_valid;
+	struct cause_fd *cfd;
+	void *ptr;
+	int i, flags = 0;
+
+	/*
+	 * If a rule was unloaded while we were waiting, the cause fd pointers may
+	 * be stale.  Ignore them; the epoll set will be rebuilt and level-triggered
+	 * fds will be reported again
+	 */
+	fds_valid = evl->rules_gen == set->gen &&
+		    evl->fds_gen == __atomic_load_n(&cause_fds_gen, __ATOMIC_ACQUIRE);
+
+	for (i = 0; i < evl->event_cnt; i++) {
+		ptr = evl->events[i].data.ptr;
+
+		if (ptr == &evl->timer_fd) {
+			drain(evl->timer_fd);
+		} else if (ptr == &evl->wake_fd) {
+			drain(evl->wake_fd);
+		} else if (ptr == &evl->signal_fd) {
+			flags |= process_signals(evl);
+		} else if (ptr == &evl->inotify_fd) {
+			flags |= process_inotify(evl);
+		} else if (fds_valid) {
+			cfd = ptr;
+			__atomic_store_n(&cfd->pending, true, __ATOMIC_RELEASE);
+
+			if (cfd->group) {
+				wake_group(set, cfd->group, now);
+			} else {
+				adaptived_dbg("fd %d is ready.  Waking rule %s\n", cfd->fd,
+					      cfd->rule->name);
+				cfd->rule->next_run = now;
+			}
+			flags |= EVENT_RULE_WOKEN;
+		}
+	}
+
+	evl->event_cnt = 0;
+
+	return flags;
+}
+
+void event_loop_wake(struct adaptived_ctx * const ctx)
+{
+	uint64_t one = 1;
+
+	if (ctx->wake_fd < 0)
+		return;
+
+	if (write(ctx->wake_fd, &one, sizeof(one)) < 0)
+		adaptived_dbg("Failed to wake the main loop: %d\n", errno);
+}
+
+void event_loop_cleanup(struct event_loop * const evl, struct adaptived_ctx * const ctx)
+{
+	ctx->wake_fd = -1;
+
+	if (evl->epoll_fd >= 0)
+		close(evl->epoll_fd);
+	if (evl->timer_fd >= 0)
+		close(evl->timer_fd);
+	if (evl->wake_fd >= 0)
+		close(evl->wake_fd);
+	if (evl->signal_fd >= 0)
+		close(evl->signal_fd);
+	if (evl->inotify_fd >= 0)
+		close(evl->inotify_fd);
+
+	if (evl->mask_set)
+		pthread_sigmask(SIG_SETMASK, &evl->old_mask, NULL);
+
+	memset(evl, 0, sizeof(struct event_loop));
+	evl->epoll_fd = -1;
+	evl->timer_fd = -1;
+	evl->wake_fd = -1;
+	evl->signal_fd = -1;
+	evl->inotify_fd = -1;
+}
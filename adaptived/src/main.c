@@ -55,6 +55,8 @@ static_assert(ARRAY_SIZE(log_files) == LOG_LOC_CNT,
 
 static const char * const default_config_file = "/etc/adaptived.json";
 static const int default_interval = 5000; /* milliseconds */
+static const int default_workers = 1;
+static const int max_workers = 256;
 
 static void usage(FILE *fd)
 {
@@ -70,6 +72,8 @@ static void usage(FILE *fd)
 	fprintf(fd, "  -l --loglevel=LEVEL       Log level. See <syslog.h>\n");
 	fprintf(fd, "  -m --maxloops=COUNT       Maximum number of loops to run."
 						 "Useful for testing\n");
+	fprintf(fd, "  -w --workers=COUNT        Number of threads used to run rules (default: %d)\n",
+		default_workers);
 	fprintf(fd, "  -d --daemon_mode          Run as a daemon\n");
 }
 
@@ -84,12 +88,13 @@ static int _adaptived_init(struct adaptived_ctx * const ctx)
 
 	ctx->interval = default_interval;
 	ctx->max_loops = 0;
-	ctx->rules = NULL;
+	ctx->workers = default_workers;
 	ctx->inject_fn = NULL;
 	ctx->skip_sleep = false;
 	ctx->daemon_mode = false;
 	ctx->daemon_nochdir = 1;
 	ctx->daemon_noclose = 1;
+	ctx->wake_fd = -1;
 
 	ret = pthread_mutex_init(&ctx->ctx_mutex, NULL);
 	if (ret) {
@@ -97,6 +102,28 @@ static int _adaptived_init(struct adaptived_ctx * const ctx)
 		return ret;
 	}
 
+	ret = pthread_mutex_init(&ctx->update_mutex, NULL);
+	if (ret) {
+		adaptived_err("mutex init failed: %d\n", ret);
+		pthread_mutex_destroy(&ctx->ctx_mutex);
+		return ret;
+	}
+
+	ctx->rule_set = rule_set_init(0);
+	if (!ctx->rule_set) {
+		pthread_mutex_destroy(&ctx->update_mutex);
+		pthread_mutex_destroy(&ctx->ctx_mutex);
+		return -ENOMEM;
+	}
+
+	ctx->read_cache = read_cache_create();
+	if (!ctx->read_cache) {
+		rule_set_free(&ctx->rule_set);
+		pthread_mutex_destroy(&ctx->update_mutex);
+		pthread_mutex_destroy(&ctx->ctx_mutex);
+		return -ENOMEM;
+	}
+
 	causes_init();
 	effects_init();
 
@@ -140,49 +167,46 @@ API void adaptived_release(struct adaptived_ctx **ctx)
 	(*ctx) = NULL;
 }
 
+/*
+ * The attributes are stored atomically so that they can be read and written without
+ * taking the ctx mutex, which is held by adaptived_loop() while rules are running
+ */
 API int adaptived_set_attr(struct adaptived_ctx * const ctx, enum adaptived_attr attr, uint32_t value)
 {
 	int ret = 0;
 
-	pthread_mutex_lock(&ctx->ctx_mutex);
-
 	switch (attr) {
 	case ADAPTIVED_ATTR_INTERVAL:
-		ctx->interval = (int)value;
+		ATTR_STORE(ctx->interval, (int)value);
 		break;
 	case ADAPTIVED_ATTR_MAX_LOOPS:
-		ctx->max_loops = (int)value;
+		ATTR_STORE(ctx->max_loops, (int)value);
 		break;
 	case ADAPTIVED_ATTR_LOG_LEVEL:
 		if ((int)value > LOG_DEBUG) {
 			ret = -EINVAL;
 			break;
 		}
-		log_level = (int)value;
+		ATTR_STORE(log_level, (int)value);
 		break;
 	case ADAPTIVED_ATTR_SKIP_SLEEP:
-		if ((int)value > 0)
-			ctx->skip_sleep = true;
-		else
-			ctx->skip_sleep = false;
+		ATTR_STORE(ctx->skip_sleep, (int)value > 0);
 		break;
 	case ADAPTIVED_ATTR_DAEMON_MODE:
-		if ((int)value > 0)
-			ctx->daemon_mode = true;
-		else
-			ctx->daemon_mode = false;
+		ATTR_STORE(ctx->daemon_mode, (int)value > 0);
 		break;
 	case ADAPTIVED_ATTR_DAEMON_NOCHDIR:
-		if ((int)value == 0)
-			ctx->daemon_nochdir = 0;
-		else
-			ctx->daemon_nochdir = 1;
+		ATTR_STORE(ctx->daemon_nochdir, (int)value == 0 ? 0 : 1);
 		break;
 	case ADAPTIVED_ATTR_DAEMON_NOCLOSE:
-		if ((int)value == 0)
-			ctx->daemon_noclose = 0;
-		else
-			ctx->daemon_noclose = 1;
+		ATTR_STORE(ctx->daemon_noclose, (int)value == 0 ? 0 : 1);
+		break;
+	case ADAPTIVED_ATTR_WORKERS:
+		if ((int)value < 1 || (int)value > max_workers) {
+			ret = -EINVAL;
+			break;
+		}
+		ATTR_STORE(ctx->workers, (int)value);
 		break;
 	case ADAPTIVED_ATTR_RULE_CNT:
 	default:
@@ -190,97 +214,78 @@ API int adaptived_set_attr(struct adaptived_ctx * const ctx, enum adaptived_attr
 		break;
 	}
 
-	pthread_mutex_unlock(&ctx->ctx_mutex);
-
 	return ret;
 }
 
 API int adaptived_get_attr(struct adaptived_ctx * const ctx, enum adaptived_attr attr,
 		    uint32_t * const value)
 {
-	struct adaptived_rule *rule;
 	int ret = 0;
-	int i = 0;
 
 	if (!value)
 		return -EINVAL;
 
-	pthread_mutex_lock(&ctx->ctx_mutex);
-
 	switch (attr) {
 	case ADAPTIVED_ATTR_INTERVAL:
-		*value = (uint32_t)ctx->interval;
+		*value = (uint32_t)ATTR_LOAD(ctx->interval);
 		break;
 	case ADAPTIVED_ATTR_MAX_LOOPS:
-		*value = (uint32_t)ctx->max_loops;
+		*value = (uint32_t)ATTR_LOAD(ctx->max_loops);
 		break;
 	case ADAPTIVED_ATTR_LOG_LEVEL:
-		*value = (uint32_t)log_level;
+		*value = (uint32_t)ATTR_LOAD(log_level);
 		break;
 	case ADAPTIVED_ATTR_SKIP_SLEEP:
-		if (ctx->skip_sleep)
-			*value = (uint32_t)1;
-		else
-			*value = (uint32_t)0;
+		*value = ATTR_LOAD(ctx->skip_sleep) ? 1 : 0;
 		break;
 	case ADAPTIVED_ATTR_DAEMON_MODE:
-		*value = ctx->daemon_mode;
+		*value = ATTR_LOAD(ctx->daemon_mode) ? 1 : 0;
 		break;
 	case ADAPTIVED_ATTR_DAEMON_NOCHDIR:
-		*value = ctx->daemon_nochdir;
+		*value = (uint32_t)ATTR_LOAD(ctx->daemon_nochdir);
 		break;
 	case ADAPTIVED_ATTR_DAEMON_NOCLOSE:
-		*value = ctx->daemon_noclose;
+		*value = (uint32_t)ATTR_LOAD(ctx->daemon_noclose);
+		break;
+	case ADAPTIVED_ATTR_WORKERS:
+		*value = (uint32_t)ATTR_LOAD(ctx->workers);
 		break;
 	case ADAPTIVED_ATTR_RULE_CNT:
-		i = 0;
-		rule = ctx->rules;
-		while (rule) {
-			i++;
-			rule = rule->next;
-		}
-
-		*value = (uint32_t)i;
+		*value = (uint32_t)ATTR_LOAD(ctx->rule_cnt);
 		break;
 	default:
 		ret = -EINVAL;
 		break;
 	}
 
-	pthread_mutex_unlock(&ctx->ctx_mutex);
-
 	return ret;
 }
 
+/*
+ * The rule is looked up in the current rule set and its stats are read via the
+ * rule's seqlock.  Thus this function never waits on adaptived_loop() and
+ * adaptived_loop() never waits on this function
+ */
 API int adaptived_get_rule_stats(struct adaptived_ctx * const ctx,
 			      const char * const name, struct adaptived_rule_stats * const stats)
 {
 	struct adaptived_rule *tmp_rule;
-	bool found_rule = false;
+	unsigned long epoch;
 
 	if (!name || !stats)
 		return -EINVAL;
 
-	pthread_mutex_lock(&ctx->ctx_mutex);
-
-	tmp_rule = ctx->rules;
-	while (tmp_rule) {
-		if (strcmp(name, tmp_rule->name) == 0) {
-			found_rule = true;
-			break;
-		}
-
-		tmp_rule = tmp_rule->next;
-	}
+	epoch = rule_set_read_lock(ctx);
 
-	if (!found_rule) {
-		pthread_mutex_unlock(&ctx->ctx_mutex);
+	tmp_rule = rule_set_find(rule_set_get(ctx), name);
+	if (!tmp_rule) {
+		rule_set_read_unlock(ctx, epoch);
 		return -EEXIST;
 	}
 
-	memcpy(stats, &tmp_rule->stats, sizeof(struct adaptived_rule_stats));
+	rule_stats_read(tmp_rule, stats);
 
-	pthread_mutex_unlock(&ctx->ctx_mutex);
+	rule_set_read_unlock(ctx, epoch);
 
 	return 0;
 }
@@ -294,10 +299,11 @@ int parse_opts(int argc, char *argv[], struct adaptived_ctx * const ctx)
 		{"loglocation",	  required_argument, NULL, 'L'},
 		{"loglevel",	  required_argument, NULL, 'l'},
 		{"maxloops",	  required_argument, NULL, 'm'},
+		{"workers",	  required_argument, NULL, 'w'},
 		{"daemon_mode",		no_argument, NULL, 'd'},
 		{NULL, 0, NULL, 0}
 	};
-	const char *short_options = "c:hi:L:l:m:d";
+	const char *short_options = "c:hi:L:l:m:w:d";
 
 	int ret = 0, i;
 	int tmp_level;
@@ -369,6 +375,14 @@ int parse_opts(int argc, char *argv[], struct adaptived_ctx * const ctx)
 				goto err;
 			}
 			break;
+		case 'w':
+			ctx->workers = atoi(optarg);
+			if (ctx->workers < 1 || ctx->workers > max_workers) {
+				adaptived_err("Invalid workers: %s\n", optarg);
+				ret = 1;
+				goto err;
+			}
+			break;
 		case 'd':
 			ctx->daemon_mode = true;
 			break;
@@ -390,18 +404,16 @@ err:
 
 void cleanup(struct adaptived_ctx *ctx)
 {
-	struct adaptived_rule *rule, *rule_next;
-
 	pthread_mutex_lock(&ctx->ctx_mutex);
+	pthread_mutex_lock(&ctx->update_mutex);
 
-	rule = ctx->rules;
-
-	while (rule) {
-		adaptived_dbg("Cleaning up rule %s\n", rule->name);
-		rule_next = rule->next;
-		rule_destroy(&rule);
-		rule = rule_next;
-	}
+	rule_set_cleanup(ctx);
+	read_cache_destroy(&ctx->read_cache);
+	fd_cache_flush();
+	slabinfo_flush();
+	cpu_stat_flush();
+	psi_scan_flush();
+	cgroup_tree_flush();
 
 	/*
 	 * Now that the rules have been cleaned up, we can clean up the
@@ -410,7 +422,9 @@ void cleanup(struct adaptived_ctx *ctx)
 	causes_cleanup();
 	effects_cleanup();
 
+	pthread_mutex_unlock(&ctx->update_mutex);
 	pthread_mutex_unlock(&ctx->ctx_mutex);
+	pthread_mutex_destroy(&ctx->update_mutex);
 	pthread_mutex_destroy(&ctx->ctx_mutex);
 }
 
@@ -439,28 +453,507 @@ static void free_rule_shared_data(struct adaptived_rule * const rule, bool force
 	}
 }
 
-API int adaptived_loop(struct adaptived_ctx * const ctx, bool parse)
+#define COST_EWMA_WEIGHT 0.125f
+#define MIN_FALSE_RATE 0.01f
+
+/* CLOCK_MONOTONIC time in microseconds.  Only used to measure how long causes take */
+static long long cost_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (long long)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+/*
+ * The expected cost of evaluating a cause before a rule is known not to trigger is
+ * minimized by running the causes in ascending order of cost / P(cause is false)
+ */
+static float cause_score(const struct adaptived_cause * const cse)
+{
+	return cse->cost / max(cse->false_rate, MIN_FALSE_RATE);
+}
+
+static void order_causes(struct adaptived_rule * const rule)
+{
+	struct adaptived_cause *cse;
+	int i, j;
+
+	/* rules have a handful of causes and are nearly sorted.  insertion sort is ideal */
+	for (i = 1; i < rule->eval_cnt; i++) {
+		cse = rule->eval_order[i];
+
+		for (j = i - 1; j >= 0 && cause_score(rule->eval_order[j]) > cause_score(cse); j--)
+			rule->eval_order[j + 1] = rule->eval_order[j];
+
+		rule->eval_order[j + 1] = cse;
+	}
+}
+
+#define EFFECT_POOL_THREADS 4
+
+/*
+ * Run the effects of a rule in order.  If an effect returns -EALREADY, the
+ * remaining effects are skipped and *snoozed is set
+ */
+static int run_effects(struct adaptived_rule * const rule, bool * const snoozed)
 {
 	struct adaptived_effect *eff;
+	int ret;
+
+	*snoozed = false;
+	eff = rule->effects;
+
+	while (eff) {
+		adaptived_dbg("Running effect %s\n", eff->name);
+		ret = (*eff->fns->main)(eff);
+		if (ret == -EALREADY) {
+			/*
+			 * This effect has requested to skip the
+			 * remaining effects in this rule
+			 */
+			adaptived_dbg("Skipping effects in rule: %s\n",
+				   rule->name);
+			*snoozed = true;
+			break;
+		} else if (ret) {
+			adaptived_dbg("Effect %s returned %d\n", eff->name,
+				   ret);
+			return ret;
+		}
+
+		eff = eff->next;
+	}
+
+	return 0;
+}
+
+/*
+ * Run the effects of a rule on the effect pool.  The rule is not run again until
+ * this has completed, so the effects have exclusive use of the causes' data
+ */
+static void run_effects_job(void * const arg)
+{
+	struct adaptived_rule *rule = arg;
+	long long latency;
+	bool snoozed;
+	int ret;
+
+	ret = run_effects(rule, &snoozed);
+	if (ret)
+		adaptived_wrn("Rule %s: effects returned %d\n", rule->name, ret);
+	else
+		free_rule_shared_data(rule, false);
+
+	latency = sched_now() - rule->effects_queued;
+
+	pthread_mutex_lock(&rule->rule_mutex);
+
+	rule_stats_write_begin(rule);
+	rule->stats.effect_done_cnt++;
+	if (snoozed)
+		rule->stats.snooze_cnt++;
+	if (ret)
+		rule->stats.effect_fail_cnt++;
+	rule->stats.effect_last_ret = ret;
+	rule->stats.effect_last_latency = latency;
+	rule->stats.effect_max_latency = max(rule->stats.effect_max_latency, latency);
+	rule_stats_write_end(rule);
+
+	__atomic_store_n(&rule->effects_pending, false, __ATOMIC_RELEASE);
+
+	pthread_mutex_unlock(&rule->rule_mutex);
+}
+
+struct rule_job {
+	struct adaptived_ctx *ctx;
 	struct adaptived_rule *rule;
+	long long now;
+	bool nominal; /* pass the rule interval rather than the measured time to the causes */
+	int ret;
+};
+
+/*
+ * Run the causes and, if they all triggered, the effects of a rule.  This may
+ * be called from a worker thread, so it must not modify the ctx
+ */
+static int run_rule(struct adaptived_ctx * const ctx, struct adaptived_rule * const rule,
+		    long long now, bool nominal)
+{
+	bool triggered = true, snoozed;
 	struct adaptived_cause *cse;
-	bool triggered = true;
-	int interval, ret = 0;
-	struct timespec sleep;
+	int ret = 0, elapsed, i;
+	long long start = 0;
+
+	pthread_mutex_lock(&rule->rule_mutex);
+	read_cache_attach(ctx->read_cache);
+
+	if (__atomic_load_n(&rule->effects_pending, __ATOMIC_ACQUIRE)) {
+		/*
+		 * The effects from an earlier run have not completed.  Running the
+		 * causes now could modify data that the effects are using
+		 */
+		adaptived_dbg("Rule %s: effects are still running\n", rule->name);
+		RULE_STATS_ADD(rule, effect_busy_cnt, 1);
+		goto out;
+	}
+
+	adaptived_dbg("Running rule %s\n", rule->name);
+	RULE_STATS_ADD(rule, loops_run_cnt, 1);
+
+	triggered = true;
+	for (i = 0; i < rule->eval_cnt; i++) {
+		cse = rule->eval_order[i];
+
+		if (!triggered && !(cse->flags & ADAPTIVED_CAUSEF_EVERY_SAMPLE)) {
+			/*
+			 * An earlier cause did not trigger, so this rule cannot
+			 * trigger.  Don't bother running this cause
+			 */
+			adaptived_dbg("Skipping cause %s\n", cse->name);
+			RULE_STATS_ADD(rule, cause_skip_cnt, 1);
+			continue;
+		}
+
+		if (rule->adaptive_order)
+			start = cost_now();
+
+		if (cse->group) {
+			ret = cause_group_run(cse->group, ctx->pass_cnt, now,
+					      rule_interval(ctx, rule), nominal);
+		} else {
+			if (nominal || cse->last_run == 0)
+				elapsed = rule_interval(ctx, rule);
+			else
+				elapsed = (int)(now - cse->last_run);
+			cse->last_run = now;
+
+			ret = (*cse->fns->main)(cse, elapsed);
+		}
+		if (ret < 0) {
+			adaptived_dbg("%s raised error %d\n", cse->name, ret);
+			goto out;
+		} else if (ret == 0) {
+			adaptived_dbg("%s did not trigger\n", cse->name);
+			triggered = false;
+		} else if (ret > 0) {
+			adaptived_dbg("%s triggered\n", cse->name);
+		}
+
+		if (rule->adaptive_order) {
+			cse->cost += ((float)(cost_now() - start) - cse->cost) * COST_EWMA_WEIGHT;
+			cse->false_rate += ((ret == 0 ? 1.0f : 0.0f) - cse->false_rate) *
+					   COST_EWMA_WEIGHT;
+		}
+	}
+
+	if (rule->adaptive_order)
+		order_causes(rule);
+
+	ret = 0;
+
+	if (triggered) {
+		RULE_STATS_ADD(rule, trigger_cnt, 1);
+
+		if (rule->async_effects) {
+			/*
+			 * Queue the effect(s).  The shared data is freed once they
+			 * have completed
+			 */
+			rule->effects_queued = sched_now();
+			__atomic_store_n(&rule->effects_pending, true, __ATOMIC_RELEASE);
+			RULE_STATS_ADD(rule, effect_dispatch_cnt, 1);
+
+			worker_pool_submit(ctx->effect_pool, &run_effects_job, rule);
+			goto out;
+		}
+
+		/*
+		 * The cause(s) for this rule were all triggered, invoke the
+		 * effect(s)
+		 */
+		ret = run_effects(rule, &snoozed);
+		if (snoozed)
+			RULE_STATS_ADD(rule, snooze_cnt, 1);
+		if (ret)
+			goto out;
+	}
+
+	free_rule_shared_data(rule, false);
+
+out:
+	read_cache_detach();
+	pthread_mutex_unlock(&rule->rule_mutex);
+
+	return ret;
+}
+
+static void run_rule_job(void * const arg)
+{
+	struct rule_job *job = arg;
+
+	job->ret = run_rule(job->ctx, job->rule, job->now, job->nominal);
+}
+
+/* Invoke the test injection function, if any, and drop any cached file contents */
+static int run_inject_fn(struct adaptived_ctx * const ctx)
+{
+	int ret;
+
+	if (!ctx->inject_fn)
+		return 0;
+
+	ret = (*ctx->inject_fn)(ctx);
+	if (ret)
+		return ret;
+
+	/* the injection function may have modified any file */
+	read_cache_invalidate(ctx->read_cache);
+
+	return 0;
+}
+
+/*
+ * Run every rule in the jobs array.  If a worker pool is available, the rules are
+ * run concurrently and the first error (in rule order) is returned.  Otherwise the
+ * rules are run in order and processing stops at the first error
+ */
+static int run_rules(struct adaptived_ctx * const ctx, struct worker_pool * const pool,
+		     struct rule_job * const jobs, int job_cnt, long long now)
+{
+	bool concurrent = pool && job_cnt > 1;
+	int i, submitted = 0, ret = 0;
+
+	/*
+	 * Intentionally undocumented API that allows a user to modify
+	 * values/settings during each loop.  This feature is targeted at
+	 * automated testing where it's difficult to force certain
+	 * behaviors, e.g. PSI thresholds.  It's always invoked from the
+	 * main loop thread.  When the rules are run in order, it's invoked
+	 * before each rule.  When they are run concurrently, it's invoked
+	 * once before the pass, so that it never modifies a file that a
+	 * running rule is reading
+	 */
+	if (concurrent) {
+		ret = run_inject_fn(ctx);
+		if (ret)
+			return ret;
+	}
+
+	for (i = 0; i < job_cnt; i++) {
+		if (!concurrent) {
+			ret = run_inject_fn(ctx);
+			if (ret)
+				break;
+		}
+
+		jobs[i].ctx = ctx;
+		jobs[i].now = now;
+		jobs[i].nominal = ATTR_LOAD(ctx->skip_sleep);
+		jobs[i].ret = 0;
+
+		if (concurrent) {
+			worker_pool_submit(pool, &run_rule_job, &jobs[i]);
+			submitted++;
+		} else {
+			ret = run_rule(ctx, jobs[i].rule, jobs[i].now, jobs[i].nominal);
+			if (ret)
+				break;
+		}
+	}
+
+	if (submitted) {
+		worker_pool_wait(pool);
+
+		for (i = 0; i < submitted; i++) {
+			if (jobs[i].ret) {
+				ret = jobs[i].ret;
+				break;
+			}
+		}
+	}
+
+	return ret;
+}
+
+/*
+ * Advance the rule to its next deadline.  Deadlines are absolute, so the time
+ * spent running the rules does not cause the schedule to drift.  If the rule
+ * finished after its next deadline, that deadline (and any others that have
+ * passed) are skipped rather than run back-to-back
+ */
+static void schedule_rule(const struct adaptived_ctx * const ctx,
+			  struct adaptived_rule * const rule, long long now, long long end)
+{
+	int interval = rule_interval(ctx, rule);
+	long long missed;
+
+	if (ATTR_LOAD(ctx->skip_sleep)) {
+		rule->next_run = now + interval;
+		return;
+	}
+
+	if (rule->next_run == 0)
+		/* this is the first time the rule has run.  anchor its schedule */
+		rule->next_run = now;
+
+	rule->next_run += interval;
+
+	if (end >= rule->next_run) {
+		missed = (end - rule->next_run) / interval + 1;
+
+		adaptived_dbg("Rule %s overran its interval; skipping %lld deadline(s)\n",
+			      rule->name, missed);
+
+		/* the rule's asynchronous effects may be updating its stats */
+		pthread_mutex_lock(&rule->rule_mutex);
+		rule_stats_write_begin(rule);
+		rule->stats.overrun_cnt++;
+		rule->stats.skipped_cnt += missed;
+		rule_stats_write_end(rule);
+		pthread_mutex_unlock(&rule->rule_mutex);
+
+		rule->next_run += missed * interval;
+	}
+}
+
+/*
+ * The effect pool is created the first time a rule with asynchronous effects is
+ * about to run, so that adaptived doesn't start threads it will never use
+ */
+static int effect_pool_prepare(struct adaptived_ctx * const ctx,
+			       const struct rule_job * const jobs, int job_cnt)
+{
+	int i;
+
+	if (ctx->effect_pool)
+		return 0;
+
+	for (i = 0; i < job_cnt; i++) {
+		if (!jobs[i].rule->async_effects)
+			continue;
+
+		ctx->effect_pool = worker_pool_create(EFFECT_POOL_THREADS);
+		if (!ctx->effect_pool)
+			return -ENOMEM;
+
+		break;
+	}
+
+	return 0;
+}
+
+static int jobs_reserve(struct rule_job ** const jobs, int * const jobs_size, int cnt)
+{
+	struct rule_job *tmp;
+
+	if (cnt <= *jobs_size)
+		return 0;
+
+	tmp = realloc(*jobs, sizeof(struct rule_job) * cnt);
+	if (!tmp)
+		return -ENOMEM;
+
+	(*jobs) = tmp;
+	(*jobs_size) = cnt;
+
+	return 0;
+}
+
+/*
+ * Parse the configuration file into a new rule set and publish it.  If replace is
+ * true, the new rules replace the current rules.  Otherwise they are added to the
+ * current rules.  If the configuration file cannot be parsed, the current rules
+ * are kept
+ */
+static int load_config(struct adaptived_ctx * const ctx, bool replace)
+{
+	struct adaptived_rule *dead = NULL;
+	struct rule_set *old, *set;
+	int ret, first, i;
+
+	pthread_mutex_lock(&ctx->update_mutex);
+
+	old = ctx->rule_set;
+	if (replace)
+		set = rule_set_init(0);
+	else
+		set = rule_set_copy(old, 0);
+	if (!set) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	first = set->cnt;
+
+	ret = parse_config(ctx, set);
+	if (ret) {
+		/* these rules were never published, so they can be freed now */
+		for (i = first; i < set->cnt; i++)
+			rule_destroy(&set->rules[i]);
+
+		rule_set_free(&set);
+		goto out;
+	}
+
+	if (replace) {
+		/*
+		 * the old rules, and their shared data, are freed once no reader is
+		 * using the old rule set
+		 */
+		for (i = old->cnt - 1; i >= 0; i--) {
+			old->rules[i]->next = dead;
+			dead = old->rules[i];
+		}
+	}
+
+	rule_set_publish(ctx, set, dead);
+
+out:
+	pthread_mutex_unlock(&ctx->update_mutex);
+
+	return ret;
+}
+
+static void reload_config(struct adaptived_ctx * const ctx)
+{
+	int ret;
+
+	ret = load_config(ctx, true);
+	if (ret)
+		adaptived_err("Failed to reload %s: %d.  Keeping the current rules\n",
+			      ctx->config, ret);
+}
+
+API int adaptived_loop(struct adaptived_ctx * const ctx, bool parse)
+{
+	struct worker_pool *pool = NULL;
+	struct rule_heap heap = { 0 };
+	struct event_loop evl;
+	struct rule_job *jobs = NULL;
+	unsigned long heap_gen = 0, epoch;
+	bool heap_valid = false;
+	struct adaptived_rule *rule;
+	struct rule_set *set;
+	int jobs_size = 0, job_cnt;
+	int interval, max_loops, workers, ret = 0;
+	long long now, end, deadline;
 	bool skip_sleep;
+	int i, flags;
 
 	if (parse) {
-		ret = parse_config(ctx);
+		ret = load_config(ctx, false);
 		if (ret)
 			return ret;
 	}
 
 	pthread_mutex_lock(&ctx->ctx_mutex);
-	rule = ctx->rules;
-	while(rule) {
-		adaptived_dbg("Rule \"%s\" loaded\n", rule->name);
-		rule = rule->next;
-	}
+	epoch = rule_set_read_lock(ctx);
+	set = rule_set_get(ctx);
+	for (i = 0; i < set->cnt; i++)
+		adaptived_dbg("Rule \"%s\" loaded\n", set->rules[i]->name);
+	rule_set_read_unlock(ctx, epoch);
 
         if (ctx->daemon_mode) {
 		adaptived_dbg("adaptived_loop: Try to run as daemon, nochdir = %d, noclose = %d\n",
@@ -476,118 +969,192 @@ API int adaptived_loop(struct adaptived_ctx * const ctx, bool parse)
 		adaptived_dbg("adaptived_loop: Debug mode. Skip running as daemon.\n");
 	}
 
+	ret = event_loop_init(&evl, ctx);
+	if (ret) {
+		pthread_mutex_unlock(&ctx->ctx_mutex);
+		return ret;
+	}
+
 	ctx->loop_cnt = 0;
 	pthread_mutex_unlock(&ctx->ctx_mutex);
 
 	while (1) {
 		pthread_mutex_lock(&ctx->ctx_mutex);
-		rule = ctx->rules;
+		now = sched_now();
 
-		while (rule) {
-			/*
-			 * Intentionally undocumented API that allows a user to modify
-			 * values/settings during each loop.  This feature is targeted at
-			 * automated testing where it's difficult to force certain
-			 * behaviors, e.g. PSI thresholds
-			 */
-			if (ctx->inject_fn) {
-				ret = (*ctx->inject_fn)(ctx);
-				if (ret)
-					goto out;
-			}
+		/*
+		 * Hold a reference to the current rule set for this pass.  Rules may be
+		 * loaded and unloaded concurrently, but the rules in this set will not
+		 * be freed until the pass has completed
+		 */
+		epoch = rule_set_read_lock(ctx);
+		set = rule_set_get(ctx);
+		ctx->pass_cnt++;
+
+		/* files read in the previous pass may have changed */
+		read_cache_begin_pass(ctx->read_cache);
 
-			adaptived_dbg("Running rule %s\n", rule->name);
-			rule->stats.loops_run_cnt++;
-			cse = rule->causes;
+		/*
+		 * The attributes can be changed by another thread at any time.  Use a
+		 * consistent snapshot of them for this pass through the loop
+		 */
+		interval = ATTR_LOAD(ctx->interval);
+		max_loops = ATTR_LOAD(ctx->max_loops);
+		workers = ATTR_LOAD(ctx->workers);
+		skip_sleep = ATTR_LOAD(ctx->skip_sleep);
+
+		flags = event_loop_process(&evl, set, now);
+		if (flags & EVENT_EXIT) {
+			ret = 0;
+			goto out;
+		}
+		if (flags & EVENT_RELOAD) {
+			reload_config(ctx);
+			set = rule_set_get(ctx);
+		}
+		if (flags & EVENT_RULE_WOKEN)
+			/* a rule's next_run was changed.  rebuild the heap */
+			heap_valid = false;
+
+		ret = event_loop_update(&evl, set);
+		if (ret)
+			goto out;
 
-			triggered = true;
-			while (cse) {
-				ret = (*cse->fns->main)(cse, ctx->interval);
-				if (ret < 0) {
-					adaptived_dbg("%s raised error %d\n", cse->name, ret);
+		/*
+		 * The worker pool is (re)created in the main loop thread, so that the
+		 * number of workers can be changed while adaptived is running
+		 */
+		if ((workers > 1 && (!pool || worker_pool_thread_cnt(pool) != workers)) ||
+		    (workers <= 1 && pool)) {
+			worker_pool_destroy(&pool);
+
+			if (workers > 1) {
+				pool = worker_pool_create(workers);
+				if (!pool) {
+					ret = -ENOMEM;
 					goto out;
-				} else if (ret == 0) {
-					adaptived_dbg("%s did not trigger\n", cse->name);
-					triggered = false;
-				} else if (ret > 0) {
-					adaptived_dbg("%s triggered\n", cse->name);
 				}
-
-				cse = cse->next;
 			}
+		}
+
+		job_cnt = 0;
 
-			if (triggered) {
-				rule->stats.trigger_cnt++;
+		if (skip_sleep) {
+			/*
+			 * Tests that skip sleeping expect every rule to run on every
+			 * pass of the loop, regardless of the rule's interval
+			 */
+			ret = jobs_reserve(&jobs, &jobs_size, set->cnt);
+			if (ret)
+				goto out;
 
+			for (i = 0; i < set->cnt; i++)
+				jobs[job_cnt++].rule = set->rules[i];
+
+			heap_valid = false;
+		} else {
+			if (!heap_valid || heap_gen != set->gen) {
 				/*
-				 * The cause(s) for this rule were all triggered, invoke the
-				 * effect(s)
+				 * A rule has been loaded or unloaded since the last pass.  The
+				 * heap may reference a freed rule, so rebuild it
 				 */
-				eff = rule->effects;
-
-				while (eff) {
-					adaptived_dbg("Running effect %s\n", eff->name);
-					ret = (*eff->fns->main)(eff);
-					if (ret == -EALREADY) {
-						/*
-						 * This effect has requested to skip the
-						 * remaining effects in this rule
-						 */
-						adaptived_dbg("Skipping effects in rule: %s\n",
-							   rule->name);
-						rule->stats.snooze_cnt++;
-						break;
-					} else if (ret) {
-						adaptived_dbg("Effect %s returned %d\n", eff->name,
-							   ret);
-						goto out;
-					}
-
-					eff = eff->next;
-				}
+				ret = rule_heap_build(&heap, set);
+				if (ret)
+					goto out;
+
+				heap_gen = set->gen;
+				heap_valid = true;
 			}
 
-			free_rule_shared_data(rule, false);
-			rule = rule->next;
+			ret = jobs_reserve(&jobs, &jobs_size, heap.cnt);
+			if (ret)
+				goto out;
+
+			/* collect every rule that is due */
+			rule = rule_heap_peek(&heap);
+			while (rule && rule->next_run <= now) {
+				jobs[job_cnt++].rule = rule_heap_pop(&heap);
+				rule = rule_heap_peek(&heap);
+			}
 		}
 
-		ctx->loop_cnt++;
-		if (ctx->max_loops > 0 && ctx->loop_cnt >= ctx->max_loops) {
-			adaptived_dbg("adaptived main loop exceeded max loops\n");
-			ret = -ETIME;
-			break;
+		ret = effect_pool_prepare(ctx, jobs, job_cnt);
+		if (ret)
+			goto out;
+
+		ret = run_rules(ctx, pool, jobs, job_cnt, now);
+		end = sched_now();
+
+		for (i = 0; i < job_cnt; i++) {
+			schedule_rule(ctx, jobs[i].rule, now, end);
+
+			/* the heap cannot grow here; these rules were just popped */
+			if (heap_valid)
+				rule_heap_push(&heap, jobs[i].rule);
+		}
+
+		if (ret)
+			goto out;
+
+		/*
+		 * Only count the passes that did some work.  A pass may have been
+		 * started by an event (e.g. a rule being loaded) before any rule was due
+		 */
+		if (job_cnt > 0 || set->cnt == 0) {
+			ctx->loop_cnt++;
+			if (max_loops > 0 && ctx->loop_cnt >= max_loops) {
+				adaptived_dbg("adaptived main loop exceeded max loops\n");
+				ret = -ETIME;
+				break;
+			}
 		}
 
 		/*
-		 * Once we've unlocked the ctx mutex, we can't safely access any variables
-		 * within ctx.  Make a stack copy before unlocking
+		 * Sleep until the next rule is due.  If there are no rules, wake up once
+		 * per main loop interval
 		 */
-		interval = ctx->interval;
-		skip_sleep = ctx->skip_sleep;
+		now = sched_now();
+		deadline = now + interval;
+		rule = rule_heap_peek(&heap);
+		if (heap_valid && rule)
+			deadline = rule->next_run;
 
+		rule_set_read_unlock(ctx, epoch);
 		pthread_mutex_unlock(&ctx->ctx_mutex);
 
-		if (!skip_sleep) {
-			sleep.tv_sec = interval / 1000;
-			sleep.tv_nsec = (interval % 1000) * 1000000LL;
-			adaptived_dbg("sleeping for %ld seconds and %ld nanoseconds\n",
-				      sleep.tv_sec, sleep.tv_nsec);
-
-			ret = nanosleep(&sleep, NULL);
-			if (ret)
-				adaptived_wrn("nanosleep returned %d\n", ret);
+		/*
+		 * Free the rule sets that were replaced during this pass.  Don't wait
+		 * if a rule is being loaded or unloaded; it will free them instead
+		 */
+		if (pthread_mutex_trylock(&ctx->update_mutex) == 0) {
+			rule_set_reclaim(ctx);
+			pthread_mutex_unlock(&ctx->update_mutex);
 		}
+
+		if (!skip_sleep && deadline > now)
+			adaptived_dbg("sleeping for %lld milliseconds\n", deadline - now);
+
+		event_loop_wait(&evl, deadline, !skip_sleep && deadline > now);
 	}
 
 out:
-	rule = ctx->rules;
-	while (rule) {
-		free_rule_shared_data(rule, true);
-		rule = rule->next;
-	}
+	/* wait for the asynchronous effects to complete */
+	worker_pool_destroy(&ctx->effect_pool);
+
+	for (i = 0; i < set->cnt; i++)
+		free_rule_shared_data(set->rules[i], true);
+
+	rule_set_read_unlock(ctx, epoch);
+
+	event_loop_cleanup(&evl, ctx);
 
 	pthread_mutex_unlock(&ctx->ctx_mutex);
 
+	worker_pool_destroy(&pool);
+	rule_heap_free(&heap);
+	if (jobs)
+		free(jobs);
+
 	return ret;
 }
 
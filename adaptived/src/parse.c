@@ -320,8 +320,13 @@ static int parse_cause(struct adaptived_ctx * const ctx, struct adaptived_rule *
 			cse->idx = i;
 			cse->fns = &cause_fns[i];
 
-			adaptived_dbg("Initializing cause %s\n", cse->name);
-			ret = (*cse->fns->init)(cse, args_obj, ctx->interval);
+			if (!cause_shareable[i]) {
+				adaptived_dbg("Initializing cause %s\n", cse->name);
+				ret = (*cse->fns->init)(cse, args_obj, rule_interval(ctx, rule));
+			} else {
+				/* identical built-in causes share a single instance */
+				ret = cause_group_get(ctx, cse, args_obj, rule_interval(ctx, rule));
+			}
 			if (ret)
 				goto error;
 
@@ -354,8 +359,14 @@ static int parse_cause(struct adaptived_ctx * const ctx, struct adaptived_rule *
 				 */
 				cse->next = NULL;
 
+				/*
+				 * adaptived doesn't know if a registered cause needs to see
+				 * every sample.  Be conservative
+				 */
+				cse->flags = ADAPTIVED_CAUSEF_EVERY_SAMPLE;
+
 				adaptived_dbg("Initializing cause %s\n", cse->name);
-				ret = (*cse->fns->init)(cse, args_obj, ctx->interval);
+				ret = (*cse->fns->init)(cse, args_obj, rule_interval(ctx, rule));
 				if (ret)
 					goto error;
 
@@ -511,13 +522,19 @@ error:
 	return ret;
 }
 
-int parse_rule(struct adaptived_ctx * const ctx, struct json_object * const rule_obj)
+/*
+ * Parse a rule and add it to set.  set is a private copy of the rule set that is
+ * published by the caller
+ */
+int parse_rule(struct adaptived_ctx * const ctx, struct json_object * const rule_obj,
+	       struct rule_set * const set)
 {
 	struct json_object *causes_obj, *cause_obj, *effects_obj, *effect_obj;
-	struct adaptived_rule *rule = NULL, *tmp_rule = NULL;
+	struct adaptived_rule *rule = NULL;
 	int i, cause_cnt, effect_cnt;
+	const char *name, *order, *dispatch;
+	struct adaptived_cause *cse;
 	json_bool exists;
-	const char *name;
 	int ret = 0;
 
 	ret = adaptived_parse_string(rule_obj, "name", &name);
@@ -533,15 +550,57 @@ int parse_rule(struct adaptived_ctx * const ctx, struct json_object * const rule
 	/*
 	 * Verify that this rule has a unique name
 	 */
-	tmp_rule = ctx->rules;
-	while (tmp_rule) {
-		if (strcmp(name, tmp_rule->name) == 0) {
-			adaptived_err("A rule with name %s already exists\n", name);
-			ret = -EEXIST;
+	if (rule_set_find(set, name)) {
+		adaptived_err("A rule with name %s already exists\n", name);
+		ret = -EEXIST;
+		goto error;
+	}
+
+	ret = adaptived_parse_int(rule_obj, "interval", &rule->interval);
+	if (ret == -ENOENT) {
+		/* the user didn't provide an interval.  use the main loop's interval */
+		rule->interval = 0;
+		ret = 0;
+	} else if (ret) {
+		goto error;
+	} else {
+		if (rule->interval <= 0) {
+			adaptived_err("Rule %s: interval must be greater than zero\n", name);
+			ret = -EINVAL;
 			goto error;
 		}
+	}
+
+	ret = adaptived_parse_string(rule_obj, "cause_order", &order);
+	if (ret == -ENOENT) {
+		rule->adaptive_order = false;
+		ret = 0;
+	} else if (ret) {
+		goto error;
+	} else if (strcmp(order, "config") == 0) {
+		rule->adaptive_order = false;
+	} else if (strcmp(order, "adaptive") == 0) {
+		rule->adaptive_order = true;
+	} else {
+		adaptived_err("Rule %s: invalid cause_order: %s\n", name, order);
+		ret = -EINVAL;
+		goto error;
+	}
 
-		tmp_rule = tmp_rule->next;
+	ret = adaptived_parse_string(rule_obj, "effect_dispatch", &dispatch);
+	if (ret == -ENOENT) {
+		rule->async_effects = false;
+		ret = 0;
+	} else if (ret) {
+		goto error;
+	} else if (strcmp(dispatch, "inline") == 0) {
+		rule->async_effects = false;
+	} else if (strcmp(dispatch, "async") == 0) {
+		rule->async_effects = true;
+	} else {
+		adaptived_err("Rule %s: invalid effect_dispatch: %s\n", name, dispatch);
+		ret = -EINVAL;
+		goto error;
 	}
 
 	/*
@@ -570,6 +629,21 @@ int parse_rule(struct adaptived_ctx * const ctx, struct json_object * const rule
 			goto error;
 	}
 
+	if (cause_cnt > 0) {
+		rule->eval_order = malloc(sizeof(struct adaptived_cause *) * cause_cnt);
+		if (!rule->eval_order) {
+			ret = -ENOMEM;
+			goto error;
+		}
+
+		for (i = 0, cse = rule->causes; cse; i++, cse = cse->next) {
+			/* start with no assumptions about the cost or selectivity of each cause */
+			cse->false_rate = 0.5f;
+			rule->eval_order[i] = cse;
+		}
+		rule->eval_cnt = i;
+	}
+
 	/*
 	 * Parse the effects
 	 */
@@ -596,19 +670,15 @@ int parse_rule(struct adaptived_ctx * const ctx, struct json_object * const rule
 			goto error;
 	}
 
+	ret = rule_set_append(set, rule);
+	if (ret)
+		goto error;
+
 	/*
 	 * do not goto error after this point.  we have added the rule
-	 * to the rules linked list
+	 * to the rule set
 	 */
-	if (!ctx->rules) {
-		ctx->rules = rule;
-	} else {
-		tmp_rule = ctx->rules;
-
-		while (tmp_rule->next)
-			tmp_rule = tmp_rule->next;
-		tmp_rule->next = rule;
-	}
+	rule->seq = ctx->rule_seq++;
 
 	return ret;
 
@@ -619,7 +689,8 @@ error:
 	return ret;
 }
 
-static int parse_json(struct adaptived_ctx * const ctx, const char * const buf)
+static int parse_json(struct adaptived_ctx * const ctx, const char * const buf,
+		      struct rule_set * const set)
 {
 	struct json_object *obj, *rules_obj, *rule_obj;
 	enum json_tokener_error err;
@@ -652,7 +723,7 @@ static int parse_json(struct adaptived_ctx * const ctx, const char * const buf)
 			goto out;
 		}
 
-		ret = parse_rule(ctx, rule_obj);
+		ret = parse_rule(ctx, rule_obj, set);
 		if (ret)
 			goto out;
 	}
@@ -661,7 +732,11 @@ out:
 	return ret;
 }
 
-int parse_config(struct adaptived_ctx * const ctx)
+/*
+ * Parse the configuration file and add its rules to set.  On failure, the rules
+ * that were added to set are left in it
+ */
+int parse_config(struct adaptived_ctx * const ctx, struct rule_set * const set)
 {
 	FILE *config_fd = NULL;
 	long config_size = 0;
@@ -695,7 +770,7 @@ int parse_config(struct adaptived_ctx * const ctx)
 	}
 	buf[config_size] = '\0';
 
-	ret = parse_json(ctx, buf);
+	ret = parse_json(ctx, buf, set);
 	if (ret)
 		goto out;
 
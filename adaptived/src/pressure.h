@@ -76,8 +76,27 @@ struct pressure_common_opts {
 		float avg;
 		long long total;
 	} threshold;
+
+	/*
+	 * JSON tag: stall_window
+	 * Description: Compute the percentage of time stalled over this many
+	 *		milliseconds from the change in the PSI total
+	 * Required: No
+	 * Note: Only valid for the some-total and full-total measurements.  When
+	 *	 provided, the threshold is a percentage and the float version is used
+	 */
+	int stall_window;
+
+	/* internal variables */
+	struct psi_window win;
+	long long elapsed; /* sum of the time between runs, in milliseconds */
 };
 
+int pressure_parse_stall_window(struct json_object * const args_obj,
+				struct pressure_common_opts * const common, int interval);
+int pressure_get_window_pct(struct pressure_common_opts * const common,
+			    int time_since_last_run, float * const pct);
+
 struct pressure_opts {
 	struct pressure_common_opts common;
 
@@ -98,8 +117,36 @@ struct pressure_opts {
 	 */
 	enum cause_op_enum op;
 
+	/*
+	 * JSON tag: trigger
+	 * Description: Use a kernel PSI trigger rather than polling the PSI file
+	 * Required: No
+	 * Valid Options: some, full
+	 * Note: When a trigger is used, measurement, threshold, operator, and duration
+	 *	 are not used.  The cause triggers when the kernel reports that more than
+	 *	 stall_us of stall time occurred within window_us
+	 */
+	bool trigger;
+	bool trigger_full;
+
+	/*
+	 * JSON tag: stall_us
+	 * Description: Stall time within the window that fires the kernel PSI trigger
+	 * Required: Yes, if trigger is provided
+	 */
+	long long stall_us;
+
+	/*
+	 * JSON tag: window_us
+	 * Description: Length of the kernel PSI trigger window
+	 * Required: No.  Defaults to 1 second
+	 * Valid Options: 500000 - 10000000
+	 */
+	long long window_us;
+
 	/* internal variables */
 	int current_duration; /* how long PSI has currently exceeded the threshold */
+	int trigger_fd; /* -1 if the PSI file is polled */
 };
 
 enum action_enum {
@@ -114,11 +161,12 @@ struct pressure_rate_opts {
 	enum action_enum action;
 	int window_size;
 	int advanced_warning;
+	enum adaptived_predictor_enum model;
 
-	/* internal data for calculating the linear regression */
-	int data_len;
-	int data_sample_cnt;
-	float *data;
+	/* internal data for forecasting the PSI value */
+	struct adaptived_predictor *pred;
+	int pred_len; /* number of samples in the window */
+	long long now; /* sum of the time between runs, in milliseconds */
 };
 
 #endif /* __PRESSURE_H */
@@ -39,6 +39,7 @@
 #include <adaptived.h>
 
 #include "adaptived-internal.h"
+#include "shared_data.h"
 
 struct adaptived_rule *rule_init(const char * const name)
 {
@@ -49,6 +50,7 @@ struct adaptived_rule *rule_init(const char * const name)
 		return NULL;
 
 	memset(rule, 0, sizeof(struct adaptived_rule));
+	pthread_mutex_init(&rule->rule_mutex, NULL);
 
 	rule->name = malloc(strlen(name) + 1);
 	if (!rule->name)
@@ -71,6 +73,7 @@ void rule_destroy(struct adaptived_rule ** rule)
 	while (cse) {
 		cse_next = cse->next;
 		adaptived_dbg("Cleaning up cause %s\n", cse->name);
+		free_shared_data(cse, true);
 		cause_destroy(&cse);
 		cse = cse_next;
 	}
@@ -86,13 +89,48 @@ void rule_destroy(struct adaptived_rule ** rule)
 	if ((*rule)->json)
 		json_object_put((*rule)->json);
 
+	if ((*rule)->eval_order)
+		free((*rule)->eval_order);
+
 	if ((*rule)->name)
 		free((*rule)->name);
 
+	pthread_mutex_destroy(&(*rule)->rule_mutex);
 	free(*rule);
 	(*rule) = NULL;
 }
 
+/*
+ * The rule stats are protected by a seqlock.  Writers are serialized by the rule
+ * mutex, which the thread running the rule already holds.  Readers retry until
+ * they get a copy of the stats that wasn't modified while they were reading it,
+ * and thus never block the writer.
+ */
+void rule_stats_write_begin(struct adaptived_rule * const rule)
+{
+	__atomic_store_n(&rule->stats_seq, rule->stats_seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+void rule_stats_write_end(struct adaptived_rule * const rule)
+{
+	__atomic_store_n(&rule->stats_seq, rule->stats_seq + 1, __ATOMIC_RELEASE);
+}
+
+void rule_stats_read(struct adaptived_rule * const rule, struct adaptived_rule_stats * const stats)
+{
+	unsigned int seq;
+
+	do {
+		seq = __atomic_load_n(&rule->stats_seq, __ATOMIC_ACQUIRE);
+		if (seq & 1)
+			continue;
+
+		memcpy(stats, &rule->stats, sizeof(struct adaptived_rule_stats));
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	} while ((seq & 1) || seq != __atomic_load_n(&rule->stats_seq, __ATOMIC_RELAXED));
+}
+
 API struct adaptived_rule *adaptived_build_rule(const char * const name)
 {
 	struct json_object *name_obj, *cse_obj, *eff_obj;
@@ -185,58 +223,105 @@ API int adaptived_rule_add_effect(struct adaptived_rule * const rule,
 	return ret;
 }
 
+API int adaptived_rule_set_interval(struct adaptived_rule * const rule, int interval)
+{
+	struct json_object *interval_obj;
+	int ret;
+
+	if (!rule || !rule->json || interval <= 0)
+		return -EINVAL;
+
+	interval_obj = json_object_new_int(interval);
+	if (!interval_obj)
+		return -ENOMEM;
+
+	ret = json_object_object_add(rule->json, "interval", interval_obj);
+	if (ret) {
+		json_object_put(interval_obj);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/*
+ * Rules are loaded and unloaded by publishing a new copy of the rule set.  This
+ * does not wait for adaptived_loop() to finish running the current rules
+ */
 API int adaptived_load_rule(struct adaptived_ctx * const ctx, struct adaptived_rule * const rule)
 {
+	struct rule_set *set;
 	int ret;
 
-	pthread_mutex_lock(&ctx->ctx_mutex);
-	ret = parse_rule(ctx, rule->json);
-	if (!ret) {
-		/*
-		 * The rule was successfully inserted and now the json-c library
-		 * owns the json struct.  Forget our pointer to it.
-		 */
-		free(rule->json);
-		rule->json = NULL;
+	pthread_mutex_lock(&ctx->update_mutex);
+
+	set = rule_set_copy(ctx->rule_set, 1);
+	if (!set) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	ret = parse_rule(ctx, rule->json, set);
+	if (ret) {
+		rule_set_free(&set);
+		goto out;
 	}
-	pthread_mutex_unlock(&ctx->ctx_mutex);
+
+	/*
+	 * The rule was successfully inserted and now the json-c library
+	 * owns the json struct.  Forget our pointer to it.
+	 */
+	free(rule->json);
+	rule->json = NULL;
+
+	rule_set_publish(ctx, set, NULL);
+	event_loop_wake(ctx);
+
+out:
+	pthread_mutex_unlock(&ctx->update_mutex);
 
 	return ret;
 }
 
 API int adaptived_unload_rule(struct adaptived_ctx * const ctx, const char * const name)
 {
-	struct adaptived_rule *rule, *prev, *next;
+	struct adaptived_rule *rule;
+	struct rule_set *set;
 	bool found = false;
+	int i;
 
-	pthread_mutex_lock(&ctx->ctx_mutex);
+	pthread_mutex_lock(&ctx->update_mutex);
+
+	for (i = 0; i < ctx->rule_set->cnt; i++) {
+		rule = ctx->rule_set->rules[i];
 
-	rule = ctx->rules;
-	prev = NULL;
-	while (rule) {
 		if (strncmp(name, rule->name, strlen(rule->name)) == 0) {
-			next = rule->next;
 			found = true;
-
-			rule_destroy(&rule);
 			break;
 		}
-
-		prev = rule;
-		rule = rule->next;
 	}
 
 	if (!found) {
-		pthread_mutex_unlock(&ctx->ctx_mutex);
+		pthread_mutex_unlock(&ctx->update_mutex);
 		return -ENOENT;
 	}
 
-	if (prev) {
-		prev->next = next;
-	} else {
-		ctx->rules = next;
+	set = rule_set_copy(ctx->rule_set, 0);
+	if (!set) {
+		pthread_mutex_unlock(&ctx->update_mutex);
+		return -ENOMEM;
 	}
 
-	pthread_mutex_unlock(&ctx->ctx_mutex);
+	rule_set_remove(set, i);
+
+	/*
+	 * The rule may still be running.  It will be freed once adaptived_loop()
+	 * is done with it
+	 */
+	rule->next = NULL;
+	rule_set_publish(ctx, set, rule);
+	event_loop_wake(ctx);
+
+	pthread_mutex_unlock(&ctx->update_mutex);
 	return 0;
 }
@@ -0,0 +1,313 @@
+/*
+ * Copyright (c) 2024, Oracle and/or its affiliates.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+/**
+ * Copy-on-write rule set for adaptived
+ *
+ * The loaded rules are published as an immutable array.  Loading or unloading a
+ * rule builds a new array and atomically replaces the current one, so readers -
+ * most importantly adaptived_loop() - never wait on an update and updates never
+ * wait on a running rule.
+ *
+ * Replaced rule sets (and any rules that were unloaded with them) are retired
+ * rather than freed.  Readers register in the current epoch while they hold a
+ * reference to the rule set.  The epoch is only advanced once every reader in the
+ * previous epoch has finished, and a retired rule set is freed once the epoch has
+ * advanced twice past the epoch in which it was retired.  At that point no reader
+ * can still hold a reference to it.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+
+#include <adaptived.h>
+
+#include "adaptived-internal.h"
+
+#define RULE_SET_MIN_SIZE 8
+
+struct rule_set *rule_set_init(int size)
+{
+	struct rule_set *set;
+
+	set = malloc(sizeof(struct rule_set));
+	if (!set)
+		return NULL;
+
+	memset(set, 0, sizeof(struct rule_set));
+
+	if (size < RULE_SET_MIN_SIZE)
+		size = RULE_SET_MIN_SIZE;
+
+	set->rules = malloc(sizeof(struct adaptived_rule *) * size);
+	if (!set->rules) {
+		free(set);
+		return NULL;
+	}
+
+	set->size = size;
+
+	return set;
+}
+
+/*
+ * Make an unpublished copy of a rule set with room for extra rules.  The rules
+ * themselves are shared with the original set
+ */
+struct rule_set *rule_set_copy(const struct rule_set * const set, int extra)
+{
+	struct rule_set *copy;
+
+	copy = rule_set_init(set->cnt + extra);
+	if (!copy)
+		return NULL;
+
+	memcpy(copy->rules, set->rules, sizeof(struct adaptived_rule *) * set->cnt);
+	copy->cnt = set->cnt;
+
+	return copy;
+}
+
+/*
+ * Frees the rule set.  The rules are not freed, as they may be shared with
+ * another rule set
+ */
+void rule_set_free(struct rule_set ** set)
+{
+	if (!set || !(*set))
+		return;
+
+	if ((*set)->rules)
+		free((*set)->rules);
+
+	free(*set);
+	(*set) = NULL;
+}
+
+/*
+ * Add a rule to an unpublished rule set
+ */
+int rule_set_append(struct rule_set * const set, struct adaptived_rule * const rule)
+{
+	struct adaptived_rule **tmp;
+	int new_size;
+
+	if (set->cnt == set->size) {
+		new_size = set->size * 2;
+
+		tmp = realloc(set->rules, sizeof(struct adaptived_rule *) * new_size);
+		if (!tmp)
+			return -ENOMEM;
+
+		set->rules = tmp;
+		set->size = new_size;
+	}
+
+	set->rules[set->cnt] = rule;
+	set->cnt++;
+
+	return 0;
+}
+
+/*
+ * Remove a rule from an unpublished rule set
+ */
+void rule_set_remove(struct rule_set * const set, int idx)
+{
+	memmove(&set->rules[idx], &set->rules[idx + 1],
+		sizeof(struct adaptived_rule *) * (set->cnt - idx - 1));
+	set->cnt--;
+}
+
+struct adaptived_rule *rule_set_find(const struct rule_set * const set, const char * const name)
+{
+	int i;
+
+	for (i = 0; i < set->cnt; i++) {
+		if (strcmp(name, set->rules[i]->name) == 0)
+			return set->rules[i];
+	}
+
+	return NULL;
+}
+
+static void rule_set_destroy(struct rule_set ** set)
+{
+	struct adaptived_rule *rule, *rule_next;
+
+	rule = (*set)->dead;
+	while (rule) {
+		adaptived_dbg("Cleaning up rule %s\n", rule->name);
+		rule_next = rule->next;
+		rule_destroy(&rule);
+		rule = rule_next;
+	}
+
+	rule_set_free(set);
+}
+
+/*
+ * Register as a reader of the rule set.  Returns the epoch that must be passed to
+ * rule_set_read_unlock().  This never blocks
+ */
+unsigned long rule_set_read_lock(struct adaptived_ctx * const ctx)
+{
+	unsigned long epoch;
+
+	while (1) {
+		epoch = __atomic_load_n(&ctx->epoch, __ATOMIC_SEQ_CST);
+		__atomic_add_fetch(&ctx->epoch_readers[epoch & 1], 1, __ATOMIC_SEQ_CST);
+
+		/*
+		 * If the epoch advanced before we were counted, our count may not
+		 * have been seen.  Retry in the new epoch
+		 */
+		if (__atomic_load_n(&ctx->epoch, __ATOMIC_SEQ_CST) == epoch)
+			return epoch;
+
+		__atomic_sub_fetch(&ctx->epoch_readers[epoch & 1], 1, __ATOMIC_SEQ_CST);
+	}
+}
+
+void rule_set_read_unlock(struct adaptived_ctx * const ctx, unsigned long epoch)
+{
+	__atomic_sub_fetch(&ctx->epoch_readers[epoch & 1], 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * Get the current rule set.  The caller must hold the rule set read lock or the
+ * update mutex, and the rule set must not be modified
+ */
+struct rule_set *rule_set_get(struct adaptived_ctx * const ctx)
+{
+	return __atomic_load_n(&ctx->rule_set, __ATOMIC_SEQ_CST);
+}
+
+/*
+ * A dead rule whose effects are still running asynchronously cannot be freed yet
+ */
+static bool rule_set_effects_pending(const struct rule_set * const set)
+{
+	struct adaptived_rule *rule;
+
+	for (rule = set->dead; rule; rule = rule->next) {
+		if (__atomic_load_n(&rule->effects_pending, __ATOMIC_ACQUIRE))
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Free the retired rule sets that can no longer be referenced by a reader.  The
+ * caller must hold the update mutex
+ */
+void rule_set_reclaim(struct adaptived_ctx * const ctx)
+{
+	struct rule_set *set, **prev;
+	unsigned long epoch;
+	int i;
+
+	if (!ctx->retired)
+		return;
+
+	/*
+	 * The epoch can be advanced if there are no readers left in the previous
+	 * epoch.  Those readers share a counter with the next epoch
+	 */
+	for (i = 0; i < 2; i++) {
+		epoch = __atomic_load_n(&ctx->epoch, __ATOMIC_SEQ_CST);
+		if (__atomic_load_n(&ctx->epoch_readers[(epoch + 1) & 1], __ATOMIC_SEQ_CST) > 0)
+			break;
+
+		__atomic_store_n(&ctx->epoch, epoch + 1, __ATOMIC_SEQ_CST);
+	}
+
+	epoch = ctx->epoch;
+
+	prev = &ctx->retired;
+	set = ctx->retired;
+	while (set) {
+		if (set->retire_epoch + 2 <= epoch && !rule_set_effects_pending(set)) {
+			(*prev) = set->retired_next;
+			rule_set_destroy(&set);
+			set = (*prev);
+		} else {
+			prev = &set->retired_next;
+			set = set->retired_next;
+		}
+	}
+}
+
+/*
+ * Replace the current rule set with set.  dead is a linked list of rules that are
+ * no longer in the rule set.  They are freed along with the old rule set once no
+ * reader can still be using them.  The caller must hold the update mutex
+ */
+void rule_set_publish(struct adaptived_ctx * const ctx, struct rule_set * const set,
+		      struct adaptived_rule * const dead)
+{
+	struct rule_set *old = ctx->rule_set;
+
+	set->gen = old->gen + 1;
+	__atomic_store_n(&ctx->rule_set, set, __ATOMIC_SEQ_CST);
+	ATTR_STORE(ctx->rule_cnt, set->cnt);
+
+	old->dead = dead;
+	old->retire_epoch = ctx->epoch;
+	old->retired_next = ctx->retired;
+	ctx->retired = old;
+
+	rule_set_reclaim(ctx);
+}
+
+/*
+ * Free the current rule set, its rules, and every retired rule set.  There must
+ * not be any readers
+ */
+void rule_set_cleanup(struct adaptived_ctx * const ctx)
+{
+	struct rule_set *set, *set_next;
+	int i;
+
+	set = ctx->retired;
+	while (set) {
+		set_next = set->retired_next;
+		rule_set_destroy(&set);
+		set = set_next;
+	}
+	ctx->retired = NULL;
+
+	set = ctx->rule_set;
+	if (set) {
+		for (i = set->cnt - 1; i >= 0; i--) {
+			set->rules[i]->next = set->dead;
+			set->dead = set->rules[i];
+		}
+
+		rule_set_destroy(&set);
+	}
+
+	ctx->rule_set = NULL;
+	ATTR_STORE(ctx->rule_cnt, 0);
+}
@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2024, Oracle and/or its affiliates.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+/**
+ * Rule scheduler for adaptived
+ *
+ * Each rule may run at its own interval.  The rules are kept in a binary
+ * min-heap ordered by the time they are next due, so that the main loop
+ * can cheaply find the rules that need to run and how long it can sleep
+ * before the next one is due.  Ties are broken by the order in which the
+ * rules were loaded so that rules that are due at the same time run in
+ * the order they appear in the configuration file.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+
+#include <adaptived.h>
+
+#include "adaptived-internal.h"
+
+#define RULE_HEAP_MIN_SIZE 16
+
+long long sched_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (long long)ts.tv_sec * 1000LL + ts.tv_nsec / 1000000LL;
+}
+
+static bool rule_before(const struct adaptived_rule * const a,
+			const struct adaptived_rule * const b)
+{
+	if (a->next_run != b->next_run)
+		return a->next_run < b->next_run;
+
+	return a->seq < b->seq;
+}
+
+static void swap(struct rule_heap * const heap, int i, int j)
+{
+	struct adaptived_rule *tmp;
+
+	tmp = heap->rules[i];
+	heap->rules[i] = heap->rules[j];
+	heap->rules[j] = tmp;
+}
+
+static void sift_up(struct rule_heap * const heap, int i)
+{
+	int parent;
+
+	while (i > 0) {
+		parent = (i - 1) / 2;
+
+		if (!rule_before(heap->rules[i], heap->rules[parent]))
+			break;
+
+		swap(heap, i, parent);
+		i = parent;
+	}
+}
+
+static void sift_down(struct rule_heap * const heap, int i)
+{
+	int left, right, smallest;
+
+	while (1) {
+		left = 2 * i + 1;
+		right = left + 1;
+		smallest = i;
+
+		if (left < heap->cnt && rule_before(heap->rules[left], heap->rules[smallest]))
+			smallest = left;
+		if (right < heap->cnt && rule_before(heap->rules[right], heap->rules[smallest]))
+			smallest = right;
+
+		if (smallest == i)
+			break;
+
+		swap(heap, i, smallest);
+		i = smallest;
+	}
+}
+
+int rule_heap_push(struct rule_heap * const heap, struct adaptived_rule * const rule)
+{
+	struct adaptived_rule **tmp;
+	int new_size;
+
+	if (heap->cnt == heap->size) {
+		new_size = heap->size ? heap->size * 2 : RULE_HEAP_MIN_SIZE;
+
+		tmp = realloc(heap->rules, sizeof(struct adaptived_rule *) * new_size);
+		if (!tmp)
+			return -ENOMEM;
+
+		heap->rules = tmp;
+		heap->size = new_size;
+	}
+
+	heap->rules[heap->cnt] = rule;
+	heap->cnt++;
+	sift_up(heap, heap->cnt - 1);
+
+	return 0;
+}
+
+struct adaptived_rule *rule_heap_peek(const struct rule_heap * const heap)
+{
+	if (heap->cnt == 0)
+		return NULL;
+
+	return heap->rules[0];
+}
+
+struct adaptived_rule *rule_heap_pop(struct rule_heap * const heap)
+{
+	struct adaptived_rule *rule;
+
+	if (heap->cnt == 0)
+		return NULL;
+
+	rule = heap->rules[0];
+	heap->cnt--;
+
+	if (heap->cnt > 0) {
+		heap->rules[0] = heap->rules[heap->cnt];
+		sift_down(heap, 0);
+	}
+
+	return rule;
+}
+
+/*
+ * Rebuild the heap from the rule set.  Rules keep their next_run value, so
+ * rebuilding the heap after a rule has been loaded or unloaded does not disturb
+ * the schedule of the other rules.  Newly loaded rules have a next_run of 0 and
+ * will run on the next pass through the loop.
+ */
+int rule_heap_build(struct rule_heap * const heap, const struct rule_set * const set)
+{
+	int ret, i;
+
+	heap->cnt = 0;
+
+	for (i = 0; i < set->cnt; i++) {
+		ret = rule_heap_push(heap, set->rules[i]);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+void rule_heap_free(struct rule_heap * const heap)
+{
+	if (heap->rules)
+		free(heap->rules);
+
+	memset(heap, 0, sizeof(struct rule_heap));
+}
+
+int rule_interval(const struct adaptived_ctx * const ctx, const struct adaptived_rule * const rule)
+{
+	if (rule->interval > 0)
+		return rule->interval;
+
+	return ATTR_LOAD(ctx->interval);
+}
@@ -0,0 +1,651 @@
+/*
+ * Copyright (c) 2024, Oracle and/or its affiliates.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+/**
+ * Persistent index of the directories in a cgroup tree
+ *
+ * Walking a cgroup tree with adaptived_path_walk_start() opens every directory
+ * and allocates every path on each walk, and that dominates the cost of the
+ * effects that operate on large hierarchies.  This index builds the tree once
+ * and keeps it current with inotify.  Every directory in the tree is watched for
+ * subdirectories that are created or removed, and the pending events are applied
+ * the next time the tree is requested.  While adaptived is running a rule, the
+ * events are read at most once per pass of the main loop, so iterating a tree
+ * that hasn't changed only costs a non-blocking read() per pass.
+ *
+ * If the event queue overflows, or the root of the tree is removed, the tree is
+ * rebuilt from scratch the next time it is requested.
+ */
+
+#include <sys/inotify.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+
+#include <adaptived-utils.h>
+#include <adaptived.h>
+
+#include "adaptived-internal.h"
+
+#define CGROUP_TREE_WD_BUCKETS 256
+#define CGROUP_TREE_EVENT_BUF 4096
+
+#define CGROUP_TREE_WATCH_MASK (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | \
+				IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR)
+
+struct adaptived_cgroup_tree_node {
+	char *path;
+	const char *name;	/* points into path */
+	int depth;		/* the root is 0 */
+	int wd;			/* inotify watch descriptor */
+	int dirfd;		/* opened on demand.  accessed atomically */
+
+	struct adaptived_cgroup_tree_node *parent;
+	/* the children are kept in the order they were found */
+	struct adaptived_cgroup_tree_node *first_child;
+	struct adaptived_cgroup_tree_node *last_child;
+	struct adaptived_cgroup_tree_node *prev;
+	struct adaptived_cgroup_tree_node *next;
+
+	struct adaptived_cgroup_tree_node *wd_next;
+};
+
+struct adaptived_cgroup_tree {
+	char *path;
+	/*
+	 * Held for reading between adaptived_get_cgroup_tree() and
+	 * adaptived_cgroup_tree_put(), and for writing while the tree is updated
+	 */
+	pthread_rwlock_t lock;
+
+	/* the following fields are protected by the lock */
+	int ifd;		/* inotify instance.  -1 if the tree hasn't been built */
+	unsigned long version;	/* the read cache version the events were last read in */
+	bool stale;		/* the tree must be rebuilt */
+	struct adaptived_cgroup_tree_node *root;
+	struct adaptived_cgroup_tree_node *wd_buckets[CGROUP_TREE_WD_BUCKETS];
+
+	/* protected by cgroup_tree_mutex */
+	struct adaptived_cgroup_tree *next;
+};
+
+static pthread_mutex_t cgroup_tree_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct adaptived_cgroup_tree *cgroup_tree_list;
+
+static struct adaptived_cgroup_tree_node *wd_find(const struct adaptived_cgroup_tree * const tree,
+						  int wd)
+{
+	struct adaptived_cgroup_tree_node *node;
+
+	for (node = tree->wd_buckets[wd % CGROUP_TREE_WD_BUCKETS]; node; node = node->wd_next) {
+		if (node->wd == wd)
+			return node;
+	}
+
+	return NULL;
+}
+
+static void wd_unlink(struct adaptived_cgroup_tree * const tree,
+		      const struct adaptived_cgroup_tree_node * const node)
+{
+	struct adaptived_cgroup_tree_node **nodep;
+
+	if (node->wd < 0)
+		return;
+
+	for (nodep = &tree->wd_buckets[node->wd % CGROUP_TREE_WD_BUCKETS]; *nodep;
+	     nodep = &(*nodep)->wd_next) {
+		if (*nodep == node) {
+			*nodep = node->wd_next;
+			break;
+		}
+	}
+}
+
+static struct adaptived_cgroup_tree_node *child_find(
+		const struct adaptived_cgroup_tree_node * const parent, const char * const name)
+{
+	struct adaptived_cgroup_tree_node *child;
+
+	for (child = parent->first_child; child; child = child->next) {
+		if (strcmp(child->name, name) == 0)
+			return child;
+	}
+
+	return NULL;
+}
+
+/*
+ * Remove a node and all of its descendants from the tree
+ */
+static void node_remove(struct adaptived_cgroup_tree * const tree,
+			struct adaptived_cgroup_tree_node * node)
+{
+	while (node->first_child)
+		node_remove(tree, node->first_child);
+
+	if (node->parent) {
+		if (node->prev)
+			node->prev->next = node->next;
+		else
+			node->parent->first_child = node->next;
+
+		if (node->next)
+			node->next->prev = node->prev;
+		else
+			node->parent->last_child = node->prev;
+	}
+
+	if (node->wd >= 0) {
+		wd_unlink(tree, node);
+		/* the watch is already gone if the directory was removed */
+		(void)inotify_rm_watch(tree->ifd, node->wd);
+	}
+
+	if (node->dirfd >= 0)
+		close(node->dirfd);
+
+	free(node->path);
+	free(node);
+}
+
+static struct adaptived_cgroup_tree_node *node_alloc(struct adaptived_cgroup_tree_node * const parent,
+						     const char * const name)
+{
+	struct adaptived_cgroup_tree_node *node;
+	size_t parent_len;
+
+	node = malloc(sizeof(struct adaptived_cgroup_tree_node));
+	if (!node)
+		return NULL;
+
+	memset(node, 0, sizeof(struct adaptived_cgroup_tree_node));
+	node->wd = -1;
+	node->dirfd = -1;
+
+	if (!parent) {
+		/* the root's name is the whole path */
+		node->path = strdup(name);
+		if (!node->path) {
+			free(node);
+			return NULL;
+		}
+
+		node->name = node->path;
+		return node;
+	}
+
+	parent_len = strlen(parent->path);
+
+	node->path = malloc(parent_len + strlen(name) + 2);
+	if (!node->path) {
+		free(node);
+		return NULL;
+	}
+
+	sprintf(node->path, "%s/%s", parent->path, name);
+	node->name = &node->path[parent_len + 1];
+	node->depth = parent->depth + 1;
+	node->parent = parent;
+
+	node->prev = parent->last_child;
+	if (parent->last_child)
+		parent->last_child->next = node;
+	else
+		parent->first_child = node;
+	parent->last_child = node;
+
+	return node;
+}
+
+static int node_watch(struct adaptived_cgroup_tree * const tree,
+		      struct adaptived_cgroup_tree_node * const node)
+{
+	node->wd = inotify_add_watch(tree->ifd, node->path, CGROUP_TREE_WATCH_MASK);
+	if (node->wd < 0)
+		return -errno;
+
+	node->wd_next = tree->wd_buckets[node->wd % CGROUP_TREE_WD_BUCKETS];
+	tree->wd_buckets[node->wd % CGROUP_TREE_WD_BUCKETS] = node;
+
+	return 0;
+}
+
+/*
+ * Watch a directory and add its subdirectories to the tree.  Each directory is
+ * watched when the walk returns it, which is before its contents are read, so a
+ * subdirectory that is created in the meantime is either read or reported by
+ * inotify (or both)
+ */
+static int node_populate(struct adaptived_cgroup_tree * const tree,
+			 struct adaptived_cgroup_tree_node * const node)
+{
+	struct adaptived_cgroup_tree_node *parent = node, *child;
+	struct adaptived_dir_walk_entry entry;
+	struct adaptived_dir_walk *walk = NULL;
+	int ret, skip_depth = -1;
+
+	ret = node_watch(tree, node);
+	if (ret)
+		return ret;
+
+	ret = adaptived_dir_walk_start(node->path, ADAPTIVED_PATH_WALK_LIST_DIRS,
+				       ADAPTIVED_PATH_WALK_UNLIMITED_DEPTH, &walk);
+	if (ret)
+		return ret;
+
+	while ((ret = adaptived_dir_walk_next(walk, &entry)) > 0) {
+		if (entry.depth == 0)
+			/* the root of the walk is this node */
+			continue;
+
+		if (skip_depth >= 0) {
+			if (entry.depth > skip_depth)
+				/* the contents of a directory that was removed */
+				continue;
+			skip_depth = -1;
+		}
+
+		/* the walk is pre-order, so the parent is the last directory one level up */
+		while (parent->depth - node->depth >= entry.depth)
+			parent = parent->parent;
+
+		child = node_alloc(parent, entry.name);
+		if (!child) {
+			ret = -ENOMEM;
+			break;
+		}
+
+		ret = node_watch(tree, child);
+		if (ret == -ENOENT || ret == -ENOTDIR) {
+			/* the directory was removed while we were reading it */
+			node_remove(tree, child);
+			skip_depth = entry.depth;
+			continue;
+		} else if (ret) {
+			break;
+		}
+
+		parent = child;
+	}
+
+	adaptived_dir_walk_end(&walk);
+
+	return ret;
+}
+
+static void tree_clear(struct adaptived_cgroup_tree * const tree)
+{
+	if (tree->root)
+		node_remove(tree, tree->root);
+	tree->root = NULL;
+
+	if (tree->ifd >= 0)
+		close(tree->ifd);
+	tree->ifd = -1;
+}
+
+static int tree_build(struct adaptived_cgroup_tree * const tree)
+{
+	int ret;
+
+	tree_clear(tree);
+	tree->stale = false;
+
+	tree->ifd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (tree->ifd < 0) {
+		ret = -errno;
+		goto error;
+	}
+
+	tree->root = node_alloc(NULL, tree->path);
+	if (!tree->root) {
+		ret = -ENOMEM;
+		goto error;
+	}
+
+	ret = node_populate(tree, tree->root);
+	if (ret)
+		goto error;
+
+	return 0;
+
+error:
+	tree_clear(tree);
+	tree->stale = true;
+
+	return ret;
+}
+
+static int tree_apply_event(struct adaptived_cgroup_tree * const tree,
+			    const struct inotify_event * const ev)
+{
+	struct adaptived_cgroup_tree_node *node, *child;
+	int ret;
+
+	if (ev->mask & IN_Q_OVERFLOW) {
+		/* events were lost */
+		tree->stale = true;
+		return 0;
+	}
+
+	node = wd_find(tree, ev->wd);
+	if (!node)
+		/* an event for a directory that has already been removed */
+		return 0;
+
+	if (ev->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) {
+		/* other directories are removed when their parent reports it */
+		if (node == tree->root)
+			tree->stale = true;
+		return 0;
+	}
+
+	if (!(ev->mask & IN_ISDIR) || ev->len == 0)
+		return 0;
+
+	if (ev->mask & (IN_CREATE | IN_MOVED_TO)) {
+		if (child_find(node, ev->name))
+			/* it was found when its parent was read */
+			return 0;
+
+		child = node_alloc(node, ev->name);
+		if (!child)
+			return -ENOMEM;
+
+		ret = node_populate(tree, child);
+		if (ret == -ENOENT || ret == -ENOTDIR) {
+			/* it has already been removed again */
+			node_remove(tree, child);
+			ret = 0;
+		}
+
+		return ret;
+	}
+
+	if (ev->mask & (IN_DELETE | IN_MOVED_FROM)) {
+		child = child_find(node, ev->name);
+		if (child)
+			node_remove(tree, child);
+	}
+
+	return 0;
+}
+
+static int tree_read_events(struct adaptived_cgroup_tree * const tree)
+{
+	char buf[CGROUP_TREE_EVENT_BUF]
+		__attribute__ ((aligned(__alignof__(struct inotify_event))));
+	const struct inotify_event *ev;
+	ssize_t len;
+	char *c;
+	int ret;
+
+	do {
+		len = read(tree->ifd, buf, sizeof(buf));
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN)
+				/* there are no more events */
+				return 0;
+
+			return -errno;
+		}
+
+		for (c = buf; c < buf + len; ) {
+			ev = (const struct inotify_event *)c;
+			c += sizeof(struct inotify_event) + ev->len;
+
+			ret = tree_apply_event(tree, ev);
+			if (ret)
+				return ret;
+		}
+	} while (true);
+}
+
+/*
+ * Bring the tree up to date.  The write lock must be held
+ */
+static int tree_refresh(struct adaptived_cgroup_tree * const tree, unsigned long version)
+{
+	int ret;
+
+	if (version && tree->version == version && !tree->stale)
+		/* another thread has already refreshed the tree in this pass */
+		return 0;
+
+	if (tree->root && !tree->stale) {
+		ret = tree_read_events(tree);
+		if (ret)
+			tree->stale = true;
+	}
+
+	if (!tree->root || tree->stale) {
+		ret = tree_build(tree);
+		if (ret)
+			return ret;
+	}
+
+	tree->version = version;
+
+	return 0;
+}
+
+static struct adaptived_cgroup_tree *tree_find(const char * const path)
+{
+	struct adaptived_cgroup_tree *tree;
+
+	pthread_mutex_lock(&cgroup_tree_mutex);
+
+	for (tree = cgroup_tree_list; tree; tree = tree->next) {
+		if (strcmp(tree->path, path) == 0)
+			goto out;
+	}
+
+	tree = malloc(sizeof(struct adaptived_cgroup_tree));
+	if (!tree)
+		goto out;
+
+	memset(tree, 0, sizeof(struct adaptived_cgroup_tree));
+	tree->ifd = -1;
+
+	tree->path = strdup(path);
+	if (!tree->path) {
+		free(tree);
+		tree = NULL;
+		goto out;
+	}
+
+	pthread_rwlock_init(&tree->lock, NULL);
+
+	tree->next = cgroup_tree_list;
+	cgroup_tree_list = tree;
+
+out:
+	pthread_mutex_unlock(&cgroup_tree_mutex);
+
+	return tree;
+}
+
+API int adaptived_get_cgroup_tree(const char * const cgroup,
+				  struct adaptived_cgroup_tree ** const tree)
+{
+	struct adaptived_cgroup_tree *t;
+	unsigned long version;
+	char *path;
+	size_t len;
+	int ret;
+
+	if (!cgroup || !tree || strlen(cgroup) == 0)
+		return -EINVAL;
+
+	/* remove the trailing "*" and "/" like adaptived_path_walk_start() does */
+	path = strdup(cgroup);
+	if (!path)
+		return -ENOMEM;
+
+	len = strlen(path);
+	if (len > 1 && path[len - 1] == '*')
+		path[--len] = '\0';
+	if (len > 1 && path[len - 1] == '/')
+		path[--len] = '\0';
+
+	t = tree_find(path);
+	free(path);
+	if (!t)
+		return -ENOMEM;
+
+	version = read_cache_version();
+
+	pthread_rwlock_rdlock(&t->lock);
+	if (version && t->version == version && t->root && !t->stale) {
+		*tree = t;
+		return 0;
+	}
+	pthread_rwlock_unlock(&t->lock);
+
+	pthread_rwlock_wrlock(&t->lock);
+	ret = tree_refresh(t, version);
+	pthread_rwlock_unlock(&t->lock);
+	if (ret)
+		return ret;
+
+	pthread_rwlock_rdlock(&t->lock);
+	if (!t->root) {
+		/* another thread failed to rebuild the tree in the meantime */
+		pthread_rwlock_unlock(&t->lock);
+		return -ENOENT;
+	}
+
+	*tree = t;
+
+	return 0;
+}
+
+API void adaptived_cgroup_tree_put(struct adaptived_cgroup_tree ** const tree)
+{
+	if (!tree || !(*tree))
+		return;
+
+	pthread_rwlock_unlock(&(*tree)->lock);
+	(*tree) = NULL;
+}
+
+API struct adaptived_cgroup_tree_node *adaptived_cgroup_tree_next(
+		const struct adaptived_cgroup_tree * const tree,
+		const struct adaptived_cgroup_tree_node * node, int max_depth)
+{
+	if (!tree)
+		return NULL;
+	if (!node)
+		return tree->root;
+
+	/* preorder, like adaptived_path_walk_next() */
+	if (node->first_child && (max_depth < 0 || node->depth <= max_depth))
+		return node->first_child;
+
+	for (; node; node = node->parent) {
+		if (node->next)
+			return node->next;
+	}
+
+	return NULL;
+}
+
+API const char *adaptived_cgroup_tree_node_path(
+		const struct adaptived_cgroup_tree_node * const node)
+{
+	if (!node)
+		return NULL;
+
+	return node->path;
+}
+
+API const char *adaptived_cgroup_tree_node_name(
+		const struct adaptived_cgroup_tree_node * const node)
+{
+	if (!node)
+		return NULL;
+
+	return node->name;
+}
+
+API int adaptived_cgroup_tree_node_depth(const struct adaptived_cgroup_tree_node * const node)
+{
+	if (!node)
+		return -EINVAL;
+
+	return node->depth;
+}
+
+API int adaptived_cgroup_tree_node_dirfd(struct adaptived_cgroup_tree_node * const node)
+{
+	int fd, expected = -1;
+
+	if (!node)
+		return -EINVAL;
+
+	fd = __atomic_load_n(&node->dirfd, __ATOMIC_ACQUIRE);
+	if (fd >= 0)
+		return fd;
+
+	fd = open(node->path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd < 0)
+		return -errno;
+
+	/* several threads may be reading the tree */
+	if (!__atomic_compare_exchange_n(&node->dirfd, &expected, fd, false, __ATOMIC_ACQ_REL,
+					 __ATOMIC_ACQUIRE)) {
+		close(fd);
+		fd = expected;
+	}
+
+	return fd;
+}
+
+/*
+ * Free every tree.  This must not be called while a tree is held
+ */
+void cgroup_tree_flush(void)
+{
+	struct adaptived_cgroup_tree *tree, *next;
+
+	pthread_mutex_lock(&cgroup_tree_mutex);
+
+	for (tree = cgroup_tree_list; tree; tree = next) {
+		next = tree->next;
+
+		tree_clear(tree);
+		pthread_rwlock_destroy(&tree->lock);
+		free(tree->path);
+		free(tree);
+	}
+	cgroup_tree_list = NULL;
+
+	pthread_mutex_unlock(&cgroup_tree_mutex);
+}
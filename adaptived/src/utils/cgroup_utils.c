@@ -26,6 +26,8 @@
  */
 
 #include <stdbool.h>
+#include <stdlib.h>
+#include <assert.h>
 #include <string.h>
 #include <limits.h>
 #include <unistd.h>
@@ -38,6 +40,7 @@
 #include <adaptived.h>
 
 #include "adaptived-internal.h"
+#include "defines.h"
 
 #define LL_MAX 8192
 
@@ -75,6 +78,7 @@ API int adaptived_cgroup_set_ll(const char * const setting, long long value, uin
 	ret = 0;
 out:
 	close(fd);
+	read_cache_drop(setting);
 
 	if (ret == 0 && (flags & ADAPTIVED_CGROUP_FLAGS_VALIDATE)) {
 		ret = adaptived_cgroup_get_ll(setting, &validate_value);
@@ -93,21 +97,18 @@ out:
 
 API int adaptived_cgroup_get_ll(const char * const setting, long long * const value)
 {
-	size_t bytes_read;
+	ssize_t bytes_read;
 	char buf[LL_MAX];
 	char *endptr;
 	int ret = 0;
-	FILE *f;
 
 	if (!setting || !value)
 		return -EINVAL;
 
-	f = fopen(setting, "r");
-	if (!f)
-		return -errno;
-
-	bytes_read = fread(buf, 1, sizeof(buf), f);
-	if (bytes_read >= sizeof(buf)) {
+	bytes_read = read_cache_read(setting, buf, sizeof(buf));
+	if (bytes_read < 0)
+		return bytes_read;
+	if (bytes_read >= (ssize_t)sizeof(buf)) {
 		ret = -EOVERFLOW;
 		goto out;
 	}
@@ -142,28 +143,23 @@ API int adaptived_cgroup_get_ll(const char * const setting, long long * const va
 	ret = 0;
 
 out:
-	(void)fclose(f);
-
 	return ret;
 }
 
 API int adaptived_cgroup_get_float(const char * const setting, float * const value)
 {
-	size_t bytes_read;
+	ssize_t bytes_read;
 	char buf[LL_MAX];
 	char *endptr;
 	int ret = 0;
-	FILE *f;
 
 	if (!setting || !value)
 		return -EINVAL;
 
-	f = fopen(setting, "r");
-	if (!f)
-		return -errno;
-
-	bytes_read = fread(buf, 1, sizeof(buf), f);
-	if (bytes_read >= sizeof(buf)) {
+	bytes_read = read_cache_read(setting, buf, sizeof(buf));
+	if (bytes_read < 0)
+		return bytes_read;
+	if (bytes_read >= (ssize_t)sizeof(buf)) {
 		ret = -EOVERFLOW;
 		goto out;
 	}
@@ -194,8 +190,6 @@ API int adaptived_cgroup_get_float(const char * const setting, float * const val
 	ret = 0;
 
 out:
-	(void)fclose(f);
-
 	return ret;
 }
 
@@ -228,6 +222,7 @@ API int adaptived_cgroup_set_str(const char * const setting, const char * const
 	ret = 0;
 out:
 	close(fd);
+	read_cache_drop(setting);
 
 	if (ret == 0 && (flags & ADAPTIVED_CGROUP_FLAGS_VALIDATE)) {
 		ret = adaptived_cgroup_get_str(setting, &validate_value);
@@ -250,22 +245,19 @@ out:
 
 API int adaptived_cgroup_get_str(const char * const setting, char ** value)
 {
-	size_t bytes_read;
+	ssize_t bytes_read;
 	char buf[LL_MAX];
 	int ret = 0;
-	FILE *f;
 
 	if (!setting || !value)
 		return -EINVAL;
 
 	*value = NULL;
 
-	f = fopen(setting, "r");
-	if (!f)
-		return -errno;
-
-	bytes_read = fread(buf, 1, sizeof(buf), f);
-	if (bytes_read >= sizeof(buf)) {
+	bytes_read = read_cache_read(setting, buf, sizeof(buf));
+	if (bytes_read < 0)
+		return bytes_read;
+	if (bytes_read >= (ssize_t)sizeof(buf)) {
 		ret = -EOVERFLOW;
 		goto out;
 	}
@@ -283,8 +275,6 @@ API int adaptived_cgroup_get_str(const char * const setting, char ** value)
 	}
 
 out:
-	(void)fclose(f);
-
 	return ret;
 }
 
@@ -308,7 +298,7 @@ API int adaptived_cgroup_get_procs(const char * const cgroup_path, pid_t ** pids
 
 	sprintf(cgroup_procs_path, "%s/cgroup.procs", cgroup_path);
 
-	procs_f = fopen(cgroup_procs_path, "r");
+	procs_f = read_cache_fopen(cgroup_procs_path);
 	if (!procs_f) {
 		ret = -errno;
 		goto error;
@@ -488,9 +478,154 @@ API bool adaptived_cgroup_setting_is_max(const char * const setting)
 
 }
 
+static const char * const memorystat_names[] = {
+	"anon", "file", "kernel", "kernel_stack", "pagetables", "sec_pagetables",
+	"percpu", "sock", "vmalloc", "shmem", "zswap", "zswapped", "file_mapped",
+	"file_dirty", "file_writeback", "swapcached", "anon_thp", "file_thp",
+	"shmem_thp", "inactive_anon", "active_anon", "inactive_file", "active_file",
+	"unevictable", "slab_reclaimable", "slab_unreclaimable", "slab",
+	"workingset_refault_anon", "workingset_refault_file",
+	"workingset_activate_anon", "workingset_activate_file",
+	"workingset_restore_anon", "workingset_restore_file", "workingset_nodereclaim",
+	"pgdemote_kswapd", "pgdemote_direct", "pgdemote_khugepaged", "pgscan",
+	"pgsteal", "pgscan_kswapd", "pgscan_direct", "pgscan_khugepaged",
+	"pgsteal_kswapd", "pgsteal_direct", "pgsteal_khugepaged", "pgfault",
+	"pgmajfault", "pgrefill", "pgactivate", "pgdeactivate", "pglazyfree",
+	"pglazyfreed", "zswpin", "zswpout", "zswpwb", "thp_fault_alloc",
+	"thp_collapse_alloc", "thp_swpout", "thp_swpout_fallback",
+};
+static_assert(ARRAY_SIZE(memorystat_names) == ADAPTIVED_MEMORYSTAT_CNT,
+	      "memorystat_names[] must be the same length as ADAPTIVED_MEMORYSTAT_CNT");
+
+/*
+ * The kernel reports the fields in the same order as memorystat_names[], so start
+ * the search at the field after the previous one
+ */
+static int memorystat_key_idx(const char * const key, size_t len, int hint)
+{
+	int i, idx;
+
+	for (i = 0; i < ADAPTIVED_MEMORYSTAT_CNT; i++) {
+		idx = (hint + i) % ADAPTIVED_MEMORYSTAT_CNT;
+
+		if (strncmp(memorystat_names[idx], key, len) == 0 &&
+		    memorystat_names[idx][len] == '\0')
+			return idx;
+	}
+
+	return -ENOENT;
+}
+
+static int parse_memorystat(const char * const buf, size_t len, void * const out)
+{
+	struct adaptived_memorystat_snapshot * const snap = out;
+	const char *line, *eol, *space;
+	long long value;
+	int idx, hint = 0;
+	char *endptr;
+
+	memset(snap, 0, sizeof(*snap));
+
+	for (line = buf; line < buf + len; line = eol + 1) {
+		eol = memchr(line, '\n', buf + len - line);
+		if (!eol)
+			eol = buf + len;
+
+		space = memchr(line, ' ', eol - line);
+		if (!space || space == line)
+			continue;
+
+		errno = 0;
+		value = strtoll(space + 1, &endptr, 10);
+		if (endptr == space + 1 || endptr != eol || errno)
+			/* There was unparsable data in the string */
+			continue;
+
+		idx = memorystat_key_idx(line, space - line, hint);
+		if (idx >= 0) {
+			snap->values[idx] = value;
+			snap->present[idx] = true;
+			hint = idx + 1;
+			continue;
+		}
+
+		if (snap->extra_cnt >= ADAPTIVED_MEMORYSTAT_EXTRA_MAX ||
+		    space - line >= ADAPTIVED_MEMORYSTAT_KEY_MAX) {
+			snap->extra_truncated = true;
+			continue;
+		}
+
+		memcpy(snap->extra[snap->extra_cnt].key, line, space - line);
+		snap->extra[snap->extra_cnt].key[space - line] = '\0';
+		snap->extra[snap->extra_cnt].value = value;
+		snap->extra_cnt++;
+	}
+
+	return 0;
+}
+
+API int adaptived_cgroup_get_memorystat(const char * const memorystat_file,
+				     struct adaptived_memorystat_snapshot * const snap)
+{
+	if (!memorystat_file || !snap)
+		return -EINVAL;
+
+	return read_cache_parse(memorystat_file, &parse_memorystat, snap, sizeof(*snap));
+}
+
+API int adaptived_memorystat_field_idx(const char * const field)
+{
+	if (!field)
+		return -EINVAL;
+
+	return memorystat_key_idx(field, strlen(field), 0);
+}
+
+API int adaptived_memorystat_get_field(const struct adaptived_memorystat_snapshot * const snap,
+				    const char * const field, long long * const ll_valuep)
+{
+	int i, idx;
+
+	if (!snap || !field || !ll_valuep)
+		return -EINVAL;
+
+	idx = adaptived_memorystat_field_idx(field);
+	if (idx >= 0) {
+		if (!snap->present[idx])
+			return -ENOENT;
+
+		*ll_valuep = snap->values[idx];
+		return 0;
+	}
+
+	for (i = 0; i < snap->extra_cnt; i++) {
+		if (strcmp(snap->extra[i].key, field) == 0) {
+			*ll_valuep = snap->extra[i].value;
+			return 0;
+		}
+	}
+
+	return -ENOENT;
+}
+
 API int adaptived_cgroup_get_memorystat_field(const char * const memorystat_file,
 					   const char * const field,
 					   long long * const ll_valuep)
 {
-	return get_ll_field_in_file(memorystat_file, field, " ", ll_valuep);
+	struct adaptived_memorystat_snapshot snap;
+	int ret;
+
+	if (!memorystat_file || !field || !ll_valuep)
+		return -EINVAL;
+
+	ret = adaptived_cgroup_get_memorystat(memorystat_file, &snap);
+	if (ret)
+		return ret;
+
+	ret = adaptived_memorystat_get_field(&snap, field, ll_valuep);
+	if (ret == -ENOENT && snap.extra_truncated)
+		/* the field may be one of the extra fields that didn't fit in the snapshot */
+		ret = get_ll_field_in_file(memorystat_file, field, " ", ll_valuep);
+
+	return ret;
 }
@@ -0,0 +1,390 @@
+/*
+ * Copyright (c) 2024, Oracle and/or its affiliates.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+/**
+ * Utilities for working with the per-cpu statistics in /proc/stat
+ *
+ */
+
+#include <stdbool.h>
+#include <string.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <stdio.h>
+#include <errno.h>
+
+#include <adaptived-utils.h>
+#include <adaptived.h>
+
+#include "adaptived-internal.h"
+
+#define BITS_PER_LONG (8 * sizeof(unsigned long))
+#define CPULIST_MAX 4096
+
+struct adaptived_cpu_stat {
+	int refcnt;		/* accessed atomically */
+	int nr_cpus;
+	int *cpu;		/* the cpu number of each entry, in ascending order */
+	/* structure of arrays.  ticks[field][i] is the field's value for cpu[i] */
+	long long *ticks[ADAPTIVED_CPU_STAT_CNT];
+	long long all[ADAPTIVED_CPU_STAT_CNT];	/* the aggregate "cpu" line */
+};
+
+static void cpu_stat_free(struct adaptived_cpu_stat ** cs)
+{
+	if (!cs || !(*cs))
+		return;
+
+	free(*cs);
+	(*cs) = NULL;
+}
+
+/*
+ * Parse the tick counters that follow "cpu" or "cpuN".  Older kernels report fewer
+ * counters; the missing ones are 0
+ */
+static int parse_ticks(const char *c, long long * const ticks, int stride)
+{
+	char *endptr;
+	int i;
+
+	for (i = 0; i < ADAPTIVED_CPU_STAT_CNT; i++) {
+		ticks[i * stride] = strtoll(c, &endptr, 10);
+		if (endptr == c) {
+			if (i < ADAPTIVED_CPU_STAT_IDLE + 1)
+				return -EINVAL;
+
+			ticks[i * stride] = 0;
+			continue;
+		}
+		c = endptr;
+	}
+
+	return 0;
+}
+
+static int cpu_stat_create(const char * const stat_file, struct adaptived_cpu_stat ** const csp)
+{
+	struct adaptived_cpu_stat *cs = NULL;
+	int ret, i, cpu_cnt = 0, idx = 0;
+	size_t len, size = 0;
+	char *buf = NULL, *line;
+	long long *ticks;
+	char *endptr;
+	long cpu;
+
+	ret = fd_cache_read(stat_file, &buf, &len, &size);
+	if (ret) {
+		adaptived_err("Failed to read %s: %d\n", stat_file, ret);
+		goto error;
+	}
+
+	/* the cpu lines are at the start of the file */
+	for (line = buf; strncmp(line, "cpu", 3) == 0; line = strchr(line, '\n') + 1) {
+		if (line[3] != ' ')
+			cpu_cnt++;
+		if (!strchr(line, '\n'))
+			break;
+	}
+
+	cs = malloc(sizeof(struct adaptived_cpu_stat) +
+		    (sizeof(long long) * ADAPTIVED_CPU_STAT_CNT + sizeof(int)) * cpu_cnt);
+	if (!cs) {
+		ret = -ENOMEM;
+		goto error;
+	}
+
+	memset(cs, 0, sizeof(struct adaptived_cpu_stat));
+	cs->refcnt = 1;
+
+	ticks = (long long *)&cs[1];
+	for (i = 0; i < ADAPTIVED_CPU_STAT_CNT; i++)
+		cs->ticks[i] = &ticks[i * cpu_cnt];
+	cs->cpu = (int *)&ticks[ADAPTIVED_CPU_STAT_CNT * cpu_cnt];
+
+	for (line = buf; strncmp(line, "cpu", 3) == 0; line = strchr(line, '\n') + 1) {
+		if (line[3] == ' ') {
+			ret = parse_ticks(&line[3], cs->all, 1);
+		} else {
+			cpu = strtol(&line[3], &endptr, 10);
+			if (endptr == &line[3] || cpu < 0 || cpu >= MAX_NR_CPUS ||
+			    (idx > 0 && cpu <= cs->cpu[idx - 1])) {
+				ret = -EINVAL;
+			} else {
+				cs->cpu[idx] = cpu;
+				ret = parse_ticks(endptr, &cs->ticks[0][idx], cpu_cnt);
+				idx++;
+			}
+		}
+
+		if (ret) {
+			adaptived_err("Failed to parse the cpu lines in %s\n", stat_file);
+			goto error;
+		}
+
+		if (!strchr(line, '\n'))
+			break;
+	}
+
+	cs->nr_cpus = idx;
+	*csp = cs;
+	free(buf);
+
+	return 0;
+
+error:
+	cpu_stat_free(&cs);
+	if (buf)
+		free(buf);
+
+	return ret;
+}
+
+static int cpu_stat_cache_create(const void * const arg, void ** const obj)
+{
+	struct adaptived_cpu_stat *cs;
+	int ret;
+
+	ret = cpu_stat_create(arg, &cs);
+	if (ret)
+		return ret;
+
+	*obj = cs;
+
+	return 0;
+}
+
+static void cpu_stat_cache_get(void * const obj)
+{
+	struct adaptived_cpu_stat *cs = obj;
+
+	__atomic_add_fetch(&cs->refcnt, 1, __ATOMIC_RELAXED);
+}
+
+static void cpu_stat_cache_put(void * const obj)
+{
+	struct adaptived_cpu_stat *cs = obj;
+
+	adaptived_cpu_stat_put(&cs);
+}
+
+static const struct pass_cache_ops cpu_stat_cache_ops = {
+	.create = cpu_stat_cache_create,
+	.get = cpu_stat_cache_get,
+	.put = cpu_stat_cache_put,
+};
+
+/* the most recent snapshot of each stat file */
+static struct pass_cache cpu_stat_cache = PASS_CACHE_INIT(&cpu_stat_cache_ops);
+
+API int adaptived_get_cpu_stat(const char * const stat_file, struct adaptived_cpu_stat ** const cs)
+{
+	const char *file;
+	void *obj;
+	int ret;
+
+	if (!cs)
+		return -EINVAL;
+
+	file = stat_file ? stat_file : PROC_STAT;
+
+	ret = pass_cache_get(&cpu_stat_cache, file, file, &obj);
+	if (ret)
+		return ret;
+
+	*cs = obj;
+
+	return 0;
+}
+
+API void adaptived_cpu_stat_put(struct adaptived_cpu_stat ** const cs)
+{
+	if (!cs || !(*cs))
+		return;
+
+	if (__atomic_sub_fetch(&(*cs)->refcnt, 1, __ATOMIC_ACQ_REL) == 0)
+		cpu_stat_free(cs);
+
+	(*cs) = NULL;
+}
+
+/*
+ * Release the shared snapshots.  Snapshots that are still referenced are freed when
+ * their last reference is put
+ */
+void cpu_stat_flush(void)
+{
+	pass_cache_flush(&cpu_stat_cache);
+}
+
+static long long tick_delta(long long cur, long long prev)
+{
+	long long x = cur - prev;
+
+	return ((x < 0) ? 0 : x);
+}
+
+API int adaptived_cpu_stat_delta(const struct adaptived_cpu_stat * const prev,
+			      const struct adaptived_cpu_stat * const cur,
+			      const struct adaptived_cpumask * const mask,
+			      long long ticks[ADAPTIVED_CPU_STAT_CNT])
+{
+	long long sel[cur ? cur->nr_cpus + 1 : 1];
+	const long long *p, *c;
+	int f, i, j;
+
+	if (!cur || !ticks)
+		return -EINVAL;
+
+	if (!mask) {
+		for (f = 0; f < ADAPTIVED_CPU_STAT_CNT; f++)
+			ticks[f] = tick_delta(cur->all[f], prev ? prev->all[f] : 0);
+
+		return 0;
+	}
+
+	for (i = 0; i < cur->nr_cpus; i++)
+		sel[i] = adaptived_cpumask_test(mask, cur->cpu[i]) ? 1 : 0;
+
+	if (!prev || (prev->nr_cpus == cur->nr_cpus &&
+		      memcmp(prev->cpu, cur->cpu, sizeof(int) * cur->nr_cpus) == 0)) {
+		/*
+		 * The common case.  The cpus are selected by multiplying rather than
+		 * branching so that the compiler can vectorize these loops
+		 */
+		for (f = 0; f < ADAPTIVED_CPU_STAT_CNT; f++) {
+			c = cur->ticks[f];
+			p = prev ? prev->ticks[f] : NULL;
+			ticks[f] = 0;
+
+			if (p) {
+				for (i = 0; i < cur->nr_cpus; i++)
+					ticks[f] += tick_delta(c[i], p[i]) * sel[i];
+			} else {
+				for (i = 0; i < cur->nr_cpus; i++)
+					ticks[f] += c[i] * sel[i];
+			}
+		}
+
+		return 0;
+	}
+
+	/* the cpus have changed.  both snapshots list the cpus in ascending order */
+	for (f = 0; f < ADAPTIVED_CPU_STAT_CNT; f++)
+		ticks[f] = 0;
+
+	for (i = 0, j = 0; i < cur->nr_cpus; i++) {
+		while (j < prev->nr_cpus && prev->cpu[j] < cur->cpu[i])
+			j++;
+
+		if (!sel[i] || j == prev->nr_cpus || prev->cpu[j] != cur->cpu[i])
+			/* a cpu that just came online has no previous sample */
+			continue;
+
+		for (f = 0; f < ADAPTIVED_CPU_STAT_CNT; f++)
+			ticks[f] += tick_delta(cur->ticks[f][i], prev->ticks[f][j]);
+	}
+
+	return 0;
+}
+
+API int adaptived_cpumask_parse(const char * const cpulist, struct adaptived_cpumask * const mask)
+{
+	long first, last, cpu;
+	const char *c;
+	char *endptr;
+
+	if (!cpulist || !mask)
+		return -EINVAL;
+
+	memset(mask, 0, sizeof(struct adaptived_cpumask));
+
+	for (c = cpulist; *c && *c != '\n'; ) {
+		first = strtol(c, &endptr, 10);
+		if (endptr == c || first < 0)
+			return -EINVAL;
+		c = endptr;
+
+		last = first;
+		if (*c == '-') {
+			c++;
+			last = strtol(c, &endptr, 10);
+			if (endptr == c || last < first)
+				return -EINVAL;
+			c = endptr;
+		}
+
+		if (last >= MAX_NR_CPUS) {
+			adaptived_err("cpu %ld exceeds the maximum of %d\n", last, MAX_NR_CPUS - 1);
+			return -EINVAL;
+		}
+
+		for (cpu = first; cpu <= last; cpu++)
+			mask->bits[cpu / BITS_PER_LONG] |= 1UL << (cpu % BITS_PER_LONG);
+
+		if (*c == ',')
+			c++;
+		else if (*c && *c != '\n')
+			return -EINVAL;
+	}
+
+	return 0;
+}
+
+API int adaptived_cpumask_read(const char * const file, struct adaptived_cpumask * const mask)
+{
+	char buf[CPULIST_MAX];
+	ssize_t bytes;
+
+	if (!file || !mask)
+		return -EINVAL;
+
+	bytes = read_cache_read(file, buf, sizeof(buf) - 1);
+	if (bytes < 0) {
+		adaptived_err("Failed to read %s: %zd\n", file, bytes);
+		return bytes;
+	}
+	buf[bytes] = '\0';
+
+	return adaptived_cpumask_parse(buf, mask);
+}
+
+API int adaptived_cpumask_numa_node(int node, struct adaptived_cpumask * const mask)
+{
+	char path[FILENAME_MAX];
+
+	if (node < 0 || !mask)
+		return -EINVAL;
+
+	snprintf(path, FILENAME_MAX - 1, "/sys/devices/system/node/node%d/cpulist", node);
+	path[FILENAME_MAX - 1] = '\0';
+
+	return adaptived_cpumask_read(path, mask);
+}
+
+API bool adaptived_cpumask_test(const struct adaptived_cpumask * const mask, int cpu)
+{
+	if (!mask || cpu < 0 || cpu >= MAX_NR_CPUS)
+		return false;
+
+	return (mask->bits[cpu / BITS_PER_LONG] >> (cpu % BITS_PER_LONG)) & 1;
+}
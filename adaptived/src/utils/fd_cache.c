@@ -0,0 +1,411 @@
+/*
+ * Copyright (c) 2024, Oracle and/or its affiliates.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+/**
+ * File descriptor cache for hot procfs, sysfs, and cgroupfs files
+ *
+ * adaptived reads the same pseudo files over and over, and opening and closing
+ * them on every read is a significant part of the cost of sampling them.  This
+ * cache keeps those files open and re-reads them with pread() from offset 0,
+ * which causes the kernel to regenerate their contents.
+ *
+ * Only files on procfs, sysfs, and cgroupfs are kept open.  A regular file may
+ * be replaced by a new file with the same name, and a cached descriptor would
+ * keep reading the old one, so other files are opened on every read.
+ *
+ * The number of open descriptors is capped, and the least recently used file is
+ * closed when the cap is reached.  If a cgroup is removed, reads of its files
+ * fail with ENODEV; the descriptor is then closed and the file is reopened once,
+ * in case the cgroup has been recreated.
+ */
+
+#include <sys/statfs.h>
+#include <linux/magic.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+
+#include <adaptived.h>
+
+#include "adaptived-internal.h"
+
+#define FD_CACHE_BUCKETS 256
+#define FD_CACHE_MAX_FDS 256
+#define FD_CACHE_MIN_SIZE 4096
+
+struct fd_cache_entry {
+	char *path;
+	int fd;		/* -1 if the file is not on a pseudo filesystem */
+	int refcnt;	/* readers currently using fd */
+	bool evicted;	/* close fd once the last reader is done with it */
+
+	struct fd_cache_entry *hash_next;
+	/* LRU list.  the head is the most recently used entry */
+	struct fd_cache_entry *lru_prev;
+	struct fd_cache_entry *lru_next;
+};
+
+static pthread_mutex_t fd_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct fd_cache_entry *buckets[FD_CACHE_BUCKETS];
+static struct fd_cache_entry *lru_head;
+static struct fd_cache_entry *lru_tail;
+static int entry_cnt;
+
+static unsigned int hash_path(const char * const path)
+{
+	unsigned int hash = 2166136261u;
+	const char *c;
+
+	/* FNV-1a */
+	for (c = path; *c; c++) {
+		hash ^= (unsigned char)*c;
+		hash *= 16777619u;
+	}
+
+	return hash % FD_CACHE_BUCKETS;
+}
+
+static bool is_pseudo_fs(int fd)
+{
+	struct statfs sfs;
+
+	if (fstatfs(fd, &sfs) < 0)
+		return false;
+
+	switch (sfs.f_type) {
+	case PROC_SUPER_MAGIC:
+	case SYSFS_MAGIC:
+	case CGROUP_SUPER_MAGIC:
+	case CGROUP2_SUPER_MAGIC:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static void lru_unlink(struct fd_cache_entry * const entry)
+{
+	if (entry->lru_prev)
+		entry->lru_prev->lru_next = entry->lru_next;
+	else
+		lru_head = entry->lru_next;
+
+	if (entry->lru_next)
+		entry->lru_next->lru_prev = entry->lru_prev;
+	else
+		lru_tail = entry->lru_prev;
+
+	entry->lru_prev = NULL;
+	entry->lru_next = NULL;
+}
+
+static void lru_push(struct fd_cache_entry * const entry)
+{
+	entry->lru_prev = NULL;
+	entry->lru_next = lru_head;
+
+	if (lru_head)
+		lru_head->lru_prev = entry;
+	lru_head = entry;
+
+	if (!lru_tail)
+		lru_tail = entry;
+}
+
+static void entry_free(struct fd_cache_entry ** entry)
+{
+	if ((*entry)->fd >= 0)
+		close((*entry)->fd);
+
+	free((*entry)->path);
+	free(*entry);
+	(*entry) = NULL;
+}
+
+/*
+ * Remove the entry from the cache.  It is freed now if no reader is using it,
+ * otherwise by the last reader.  The caller must hold fd_cache_mutex
+ */
+static void entry_evict(struct fd_cache_entry * entry)
+{
+	struct fd_cache_entry **entryp;
+
+	entryp = &buckets[hash_path(entry->path)];
+	while (*entryp != entry)
+		entryp = &(*entryp)->hash_next;
+	(*entryp) = entry->hash_next;
+
+	lru_unlink(entry);
+	entry_cnt--;
+
+	if (entry->refcnt > 0)
+		entry->evicted = true;
+	else
+		entry_free(&entry);
+}
+
+/*
+ * Find or open the file and return its entry with a reference held.  Returns NULL
+ * and sets errno on failure
+ */
+static struct fd_cache_entry *entry_get(const char * const path)
+{
+	struct fd_cache_entry *entry;
+	unsigned int bucket;
+	int fd, err;
+
+	bucket = hash_path(path);
+
+	pthread_mutex_lock(&fd_cache_mutex);
+
+	for (entry = buckets[bucket]; entry; entry = entry->hash_next) {
+		if (strcmp(entry->path, path) == 0) {
+			lru_unlink(entry);
+			lru_push(entry);
+			entry->refcnt++;
+
+			pthread_mutex_unlock(&fd_cache_mutex);
+			return entry;
+		}
+	}
+
+	pthread_mutex_unlock(&fd_cache_mutex);
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return NULL;
+
+	entry = malloc(sizeof(struct fd_cache_entry));
+	if (!entry) {
+		err = ENOMEM;
+		goto error;
+	}
+
+	memset(entry, 0, sizeof(struct fd_cache_entry));
+
+	entry->path = strdup(path);
+	if (!entry->path) {
+		err = ENOMEM;
+		goto error;
+	}
+
+	if (is_pseudo_fs(fd)) {
+		entry->fd = fd;
+	} else {
+		close(fd);
+		entry->fd = -1;
+	}
+	entry->refcnt = 1;
+
+	pthread_mutex_lock(&fd_cache_mutex);
+
+	/* make room for this entry */
+	while (entry_cnt >= FD_CACHE_MAX_FDS && lru_tail)
+		entry_evict(lru_tail);
+
+	/*
+	 * Another thread may have added this file while we were opening it.  That's
+	 * harmless; this entry will be found first, and the other one will age out
+	 */
+	entry->hash_next = buckets[bucket];
+	buckets[bucket] = entry;
+	lru_push(entry);
+	entry_cnt++;
+
+	pthread_mutex_unlock(&fd_cache_mutex);
+
+	return entry;
+
+error:
+	if (entry)
+		free(entry);
+	close(fd);
+	errno = err;
+
+	return NULL;
+}
+
+static void entry_put(struct fd_cache_entry * entry, bool stale)
+{
+	pthread_mutex_lock(&fd_cache_mutex);
+
+	entry->refcnt--;
+
+	if (entry->evicted) {
+		if (entry->refcnt == 0)
+			entry_free(&entry);
+	} else if (stale) {
+		entry_evict(entry);
+	}
+
+	pthread_mutex_unlock(&fd_cache_mutex);
+}
+
+/*
+ * Read the file from offset 0 into *buf.  If grow is true, *buf is grown (and
+ * *size updated) until the whole file has been read, and the contents are NUL
+ * terminated.  Otherwise at most *size bytes are read
+ */
+static int read_entry(const struct fd_cache_entry * const entry, char ** const buf,
+		      size_t * const len, size_t * const size, bool grow)
+{
+	size_t new_size, room;
+	ssize_t bytes;
+	int ret = 0;
+	char *tmp;
+	int fd;
+
+	*len = 0;
+
+	if (entry->fd >= 0) {
+		fd = entry->fd;
+	} else {
+		fd = open(entry->path, O_RDONLY | O_CLOEXEC);
+		if (fd < 0)
+			return -errno;
+	}
+
+	while (1) {
+		if (grow && *size - *len < 2) {
+			new_size = *size ? *size * 2 : FD_CACHE_MIN_SIZE;
+
+			tmp = realloc(*buf, new_size);
+			if (!tmp) {
+				ret = -ENOMEM;
+				goto out;
+			}
+
+			*buf = tmp;
+			*size = new_size;
+		}
+
+		/* leave room for the NUL terminator when growing the buffer */
+		room = *size - *len - (grow ? 1 : 0);
+		if (room == 0)
+			break;
+
+		bytes = pread(fd, &(*buf)[*len], room, *len);
+		if (bytes < 0) {
+			if (errno == EINTR)
+				continue;
+
+			ret = -errno;
+			goto out;
+		}
+		if (bytes == 0)
+			break;
+
+		*len += bytes;
+	}
+
+	if (grow)
+		(*buf)[*len] = '\0';
+
+out:
+	if (entry->fd < 0)
+		close(fd);
+
+	return ret;
+}
+
+static int fd_cache_read_common(const char * const path, char ** const buf,
+				size_t * const len, size_t * const size, bool grow)
+{
+	struct fd_cache_entry *entry;
+	bool retried = false;
+	int ret;
+
+	if (!path || !buf || !len || !size)
+		return -EINVAL;
+
+	while (1) {
+		entry = entry_get(path);
+		if (!entry)
+			return -errno;
+
+		ret = read_entry(entry, buf, len, size, grow);
+
+		if ((ret == -ENODEV || ret == -ENOENT || ret == -ESTALE) && entry->fd >= 0) {
+			/*
+			 * The cgroup (or process) that this file belonged to has been
+			 * removed.  Drop the stale descriptor and try the path once more
+			 */
+			entry_put(entry, true);
+
+			if (retried)
+				return ret;
+
+			retried = true;
+			continue;
+		}
+
+		entry_put(entry, false);
+		return ret;
+	}
+}
+
+/*
+ * Read up to size bytes of the file into buf.  Returns the number of bytes read or
+ * a negative errno
+ */
+ssize_t fd_cache_pread(const char * const path, char * const buf, size_t size)
+{
+	size_t len = 0;
+	char *bufp = buf;
+	int ret;
+
+	ret = fd_cache_read_common(path, &bufp, &len, &size, false);
+	if (ret)
+		return ret;
+
+	return len;
+}
+
+/*
+ * Read the entire file into *buf, growing it (and updating *size) as needed.  *buf
+ * may be NULL and *size 0.  The contents are NUL terminated
+ */
+int fd_cache_read(const char * const path, char ** const buf, size_t * const len,
+		  size_t * const size)
+{
+	return fd_cache_read_common(path, buf, len, size, true);
+}
+
+/*
+ * Close every file that is not currently being read
+ */
+void fd_cache_flush(void)
+{
+	int i;
+
+	pthread_mutex_lock(&fd_cache_mutex);
+
+	for (i = 0; i < FD_CACHE_BUCKETS; i++) {
+		while (buckets[i])
+			entry_evict(buckets[i]);
+	}
+
+	pthread_mutex_unlock(&fd_cache_mutex);
+}
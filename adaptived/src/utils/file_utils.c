@@ -69,18 +69,22 @@ static int parse_suffix(char * const line, long long * const multiplier)
 int get_ll_field_in_file(const char * const file, const char * const field,
 			 const char * const separator, long long * const ll_valuep)
 {
-	char *subp, *subp2, *str;
+	size_t field_len, separator_len;
 	long long multiplier = 0;
 	char * line = NULL;
 	int ret = -ENOENT;
 	size_t len = 0;
 	ssize_t read;
+	char *str, *endptr;
 	FILE * fp;
 
 	if (!file || !field || !separator || !ll_valuep)
 		return -EINVAL;
 
-	fp = fopen(file, "r");
+	field_len = strlen(field);
+	separator_len = strlen(separator);
+
+	fp = read_cache_fopen(file);
 	if (fp == NULL) {
 		adaptived_err("Failed to open %s: errno = %d\n", file, errno);
 		return -errno;
@@ -88,38 +92,38 @@ int get_ll_field_in_file(const char * const file, const char * const field,
 
 	while ((read = getline(&line, &len, fp)) != -1) {
 		line[strcspn(line, "\n")] = '\0';
-		subp = strstr(line, field);
-		if (subp) {
-			subp2 = strstr(subp, separator);
-			if (subp2) {
-				char *endptr;
-
-				str = &subp2[1];
-
-				ret = parse_suffix(str, &multiplier);
-				if (ret)
-					goto out;
-
-				*ll_valuep = strtoll(str, &endptr, 10);
-				if (endptr[0] != '\0' && endptr[0] != '\n' && endptr[0] != ' ') {
-					/* There was unparsable data in the string */
-					ret = -EINVAL;
-					goto out;
-				}
-				if (endptr == str) {
-					/* There was unparsable data in the string */
-					ret = -EINVAL;
-					goto out;
-				}
-				if (*ll_valuep == LLONG_MIN || *ll_valuep == LLONG_MAX) {
-					ret = -ERANGE;
-					goto out;
-				}
-
-				ret = 0;
-			}
-			break;
+		/*
+		 * The field must match the whole key, e.g. "Cached" must not
+		 * match "SwapCached: ..."
+		 */
+		if (strncmp(line, field, field_len) != 0 ||
+		    strncmp(&line[field_len], separator, separator_len) != 0)
+			continue;
+
+		str = &line[field_len + separator_len];
+
+		ret = parse_suffix(str, &multiplier);
+		if (ret)
+			goto out;
+
+		*ll_valuep = strtoll(str, &endptr, 10);
+		if (endptr[0] != '\0' && endptr[0] != '\n' && endptr[0] != ' ') {
+			/* There was unparsable data in the string */
+			ret = -EINVAL;
+			goto out;
+		}
+		if (endptr == str) {
+			/* There was unparsable data in the string */
+			ret = -EINVAL;
+			goto out;
 		}
+		if (*ll_valuep == LLONG_MIN || *ll_valuep == LLONG_MAX) {
+			ret = -ERANGE;
+			goto out;
+		}
+
+		ret = 0;
+		break;
 	}
 out:
 	fclose(fp);
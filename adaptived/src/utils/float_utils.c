@@ -21,11 +21,20 @@
  * questions.
  */
 /**
- * Utilities for managing arrays of floats
+ * Utilities for managing arrays of floats and time series
  *
+ * adaptived_farray_*() operate on a plain array, and every append and regression is
+ * O(n) in the length of the array.  struct adaptived_series is a ring buffer of
+ * timestamped samples that maintains the regression's running sums in double
+ * precision, so that appending a sample and computing the regression are O(1)
+ *
+ * struct adaptived_predictor wraps the series and a few streaming models behind
+ * one interface, so that a cause can trade reaction speed against stability
  */
 
+#include <stdlib.h>
 #include <string.h>
+#include <assert.h>
 #include <stdio.h>
 #include <errno.h>
 
@@ -33,6 +42,7 @@
 #include <adaptived.h>
 
 #include "adaptived-internal.h"
+#include "defines.h"
 
 API int adaptived_farray_append(float * const array, const float * const value, int array_len,
 			     int * const samples_in_array)
@@ -91,3 +101,396 @@ API int adaptived_farray_linear_regression(float * const array, int array_len, i
 
 	return 0;
 }
+
+struct adaptived_series {
+	long long *time;
+	double *value;
+	int size;
+	int head;	/* oldest sample */
+	int cnt;
+
+	/*
+	 * The sums are over x = time - base and y = value.  Keeping x relative to a
+	 * recent base keeps x * x small enough that the sums do not lose precision
+	 */
+	long long base;
+	double sum_x;
+	double sum_y;
+	double sum_xx;
+	double sum_xy;
+
+	/* samples appended since the sums were last recomputed from scratch */
+	int appends;
+};
+
+API struct adaptived_series *adaptived_series_alloc(int capacity)
+{
+	struct adaptived_series *series;
+
+	if (capacity <= 0)
+		return NULL;
+
+	series = malloc(sizeof(struct adaptived_series));
+	if (!series)
+		return NULL;
+
+	memset(series, 0, sizeof(struct adaptived_series));
+	series->size = capacity;
+
+	series->time = malloc(sizeof(long long) * capacity);
+	series->value = malloc(sizeof(double) * capacity);
+	if (!series->time || !series->value) {
+		adaptived_series_free(&series);
+		return NULL;
+	}
+
+	return series;
+}
+
+API void adaptived_series_free(struct adaptived_series ** const series)
+{
+	if (!series || !(*series))
+		return;
+
+	free((*series)->time);
+	free((*series)->value);
+	free(*series);
+	(*series) = NULL;
+}
+
+API void adaptived_series_reset(struct adaptived_series * const series)
+{
+	if (!series)
+		return;
+
+	series->head = 0;
+	series->cnt = 0;
+	series->base = 0;
+	series->sum_x = 0.0;
+	series->sum_y = 0.0;
+	series->sum_xx = 0.0;
+	series->sum_xy = 0.0;
+	series->appends = 0;
+}
+
+API int adaptived_series_count(const struct adaptived_series * const series)
+{
+	if (!series)
+		return -EINVAL;
+
+	return series->cnt;
+}
+
+/*
+ * Move the base to the oldest sample and recompute the sums.  Adding and removing
+ * samples slowly accumulates rounding error in the sums, and x grows as time moves
+ * away from the base, so this is done once every size appends.  That keeps the
+ * amortized cost of an append O(1)
+ */
+static void series_rebase(struct adaptived_series * const series)
+{
+	double x, y;
+	int i, idx;
+
+	series->base = series->time[series->head];
+	series->sum_x = 0.0;
+	series->sum_y = 0.0;
+	series->sum_xx = 0.0;
+	series->sum_xy = 0.0;
+
+	for (i = 0; i < series->cnt; i++) {
+		idx = (series->head + i) % series->size;
+		x = (double)(series->time[idx] - series->base);
+		y = series->value[idx];
+
+		series->sum_x += x;
+		series->sum_y += y;
+		series->sum_xx += x * x;
+		series->sum_xy += x * y;
+	}
+
+	series->appends = 0;
+}
+
+API int adaptived_series_append(struct adaptived_series * const series, long long time,
+				double value)
+{
+	int tail;
+	double x;
+
+	if (!series)
+		return -EINVAL;
+
+	if (series->cnt > 0) {
+		tail = (series->head + series->cnt - 1) % series->size;
+		if (time < series->time[tail])
+			return -EINVAL;
+	} else {
+		series->base = time;
+	}
+
+	if (series->cnt == series->size) {
+		/* drop the oldest sample */
+		x = (double)(series->time[series->head] - series->base);
+
+		series->sum_x -= x;
+		series->sum_y -= series->value[series->head];
+		series->sum_xx -= x * x;
+		series->sum_xy -= x * series->value[series->head];
+
+		series->head = (series->head + 1) % series->size;
+		series->cnt--;
+	}
+
+	tail = (series->head + series->cnt) % series->size;
+	series->time[tail] = time;
+	series->value[tail] = value;
+	series->cnt++;
+
+	x = (double)(time - series->base);
+	series->sum_x += x;
+	series->sum_y += value;
+	series->sum_xx += x * x;
+	series->sum_xy += x * value;
+
+	series->appends++;
+	if (series->appends >= series->size)
+		series_rebase(series);
+
+	return 0;
+}
+
+API int adaptived_series_linear_regression(const struct adaptived_series * const series,
+					   long long time, double * const value)
+{
+	double n, sxx, sxy, slope, intercept;
+
+	if (!series || !value)
+		return -EINVAL;
+	if (series->cnt < 2)
+		return -EINVAL;
+
+	n = (double)series->cnt;
+
+	/* the centered sums, i.e. n * variance(x) and n * covariance(x, y) */
+	sxx = series->sum_xx - series->sum_x * series->sum_x / n;
+	sxy = series->sum_xy - series->sum_x * series->sum_y / n;
+	if (sxx <= 0.0)
+		return -EINVAL;
+
+	slope = sxy / sxx;
+	intercept = (series->sum_y - slope * series->sum_x) / n;
+	adaptived_dbg("Series: slope = %.4f yintcpt = %.4f\n", slope, intercept);
+
+	*value = intercept + slope * (double)(time - series->base);
+
+	return 0;
+}
+
+static const char * const predictor_names[] = {
+	"ols",
+	"ewma",
+	"holt",
+	"p95",
+};
+static_assert(ARRAY_SIZE(predictor_names) == ADAPTIVED_PREDICTOR_CNT,
+	      "predictor_names[] must be same length as ADAPTIVED_PREDICTOR_CNT");
+
+/* the quantile estimated by the p95 model */
+static const double predictor_quantile = 0.95;
+
+struct adaptived_predictor {
+	enum adaptived_predictor_enum model;
+	int window;
+	int cnt;		/* samples seen, up to window */
+	double alpha;		/* smoothing factor */
+	long long last_time;
+
+	/* ols */
+	struct adaptived_series *series;
+
+	/* ewma and holt */
+	double level;
+	double trend;		/* per unit of time */
+
+	/* p95 */
+	double quantile;
+	double deviation;	/* smoothed absolute deviation from the level */
+};
+
+API int adaptived_predictor_model_idx(const char * const name)
+{
+	int i;
+
+	if (!name)
+		return -EINVAL;
+
+	for (i = 0; i < ADAPTIVED_PREDICTOR_CNT; i++) {
+		if (strcmp(predictor_names[i], name) == 0)
+			return i;
+	}
+
+	return -EINVAL;
+}
+
+API struct adaptived_predictor *adaptived_predictor_alloc(enum adaptived_predictor_enum model,
+							  int window)
+{
+	struct adaptived_predictor *pred;
+
+	if (model < 0 || model >= ADAPTIVED_PREDICTOR_CNT || window <= 0)
+		return NULL;
+
+	pred = malloc(sizeof(struct adaptived_predictor));
+	if (!pred)
+		return NULL;
+
+	memset(pred, 0, sizeof(struct adaptived_predictor));
+	pred->model = model;
+	pred->window = window;
+	pred->alpha = 2.0 / (window + 1.0);
+
+	if (model == ADAPTIVED_PREDICTOR_OLS) {
+		pred->series = adaptived_series_alloc(window);
+		if (!pred->series) {
+			free(pred);
+			return NULL;
+		}
+	}
+
+	return pred;
+}
+
+API void adaptived_predictor_free(struct adaptived_predictor ** const pred)
+{
+	if (!pred || !(*pred))
+		return;
+
+	adaptived_series_free(&(*pred)->series);
+	free(*pred);
+	(*pred) = NULL;
+}
+
+/*
+ * Holt's linear trend method, with the trend expressed per unit of time so that
+ * the samples need not be evenly spaced
+ */
+static void holt_update(struct adaptived_predictor * const pred, long long time, double value)
+{
+	double prev_level, dt;
+
+	dt = (double)(time - pred->last_time);
+	prev_level = pred->level;
+
+	pred->level = pred->alpha * value +
+		      (1.0 - pred->alpha) * (pred->level + pred->trend * dt);
+	if (dt > 0.0)
+		pred->trend = pred->alpha * (pred->level - prev_level) / dt +
+			      (1.0 - pred->alpha) * pred->trend;
+}
+
+/*
+ * Track the quantile by stochastic approximation: step up by q * step when the
+ * sample is above the estimate and down by (1 - q) * step otherwise.  The
+ * estimate settles where a fraction (1 - q) of the samples are above it.  The
+ * step scales with the spread of the samples, so that the estimate adapts at the
+ * same rate regardless of their magnitude
+ */
+static void quantile_update(struct adaptived_predictor * const pred, double value)
+{
+	double step, deviation;
+
+	pred->level += pred->alpha * (value - pred->level);
+
+	deviation = value > pred->level ? value - pred->level : pred->level - value;
+	pred->deviation += pred->alpha * (deviation - pred->deviation);
+
+	step = pred->alpha * pred->deviation * 2.0;
+
+	if (value > pred->quantile)
+		pred->quantile += step * predictor_quantile;
+	else
+		pred->quantile -= step * (1.0 - predictor_quantile);
+}
+
+API int adaptived_predictor_update(struct adaptived_predictor * const pred, long long time,
+				   double value)
+{
+	int ret;
+
+	if (!pred)
+		return -EINVAL;
+
+	if (pred->cnt > 0 && time < pred->last_time)
+		return -EINVAL;
+
+	if (pred->cnt == 0) {
+		pred->level = value;
+		pred->trend = 0.0;
+		pred->quantile = value;
+		pred->deviation = 0.0;
+	} else {
+		switch (pred->model) {
+		case ADAPTIVED_PREDICTOR_OLS:
+			break;
+		case ADAPTIVED_PREDICTOR_EWMA:
+			pred->level += pred->alpha * (value - pred->level);
+			break;
+		case ADAPTIVED_PREDICTOR_HOLT:
+			holt_update(pred, time, value);
+			break;
+		case ADAPTIVED_PREDICTOR_P95:
+			quantile_update(pred, value);
+			break;
+		default:
+			return -EINVAL;
+		}
+	}
+
+	if (pred->model == ADAPTIVED_PREDICTOR_OLS) {
+		ret = adaptived_series_append(pred->series, time, value);
+		if (ret)
+			return ret;
+	}
+
+	pred->last_time = time;
+	if (pred->cnt < pred->window)
+		pred->cnt++;
+
+	return 0;
+}
+
+API int adaptived_predictor_count(const struct adaptived_predictor * const pred)
+{
+	if (!pred)
+		return -EINVAL;
+
+	return pred->cnt;
+}
+
+API int adaptived_predictor_forecast(const struct adaptived_predictor * const pred, long long time,
+				     double * const value)
+{
+	if (!pred || !value)
+		return -EINVAL;
+	if (pred->cnt == 0)
+		return -EINVAL;
+
+	switch (pred->model) {
+	case ADAPTIVED_PREDICTOR_OLS:
+		return adaptived_series_linear_regression(pred->series, time, value);
+	case ADAPTIVED_PREDICTOR_EWMA:
+		*value = pred->level;
+		break;
+	case ADAPTIVED_PREDICTOR_HOLT:
+		*value = pred->level + pred->trend * (double)(time - pred->last_time);
+		break;
+	case ADAPTIVED_PREDICTOR_P95:
+		*value = pred->quantile;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	return 0;
+}
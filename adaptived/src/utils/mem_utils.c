@@ -26,6 +26,8 @@
  */
 
 #include <stdbool.h>
+#include <stdlib.h>
+#include <assert.h>
 #include <string.h>
 #include <limits.h>
 #include <unistd.h>
@@ -38,114 +40,611 @@
 #include <adaptived.h>
 
 #include "adaptived-internal.h"
+#include "defines.h"
 
-struct slabinfo_columns {
-        char name[FILENAME_MAX];
-        long long active_objs;
-        long long num_objs;
-        long long objsize;
-        long long objperslab;
-        long long pagesperslab;
-        long long limit;
-        long long batchcount;
-        long long sharedfactor;
-        long long active_slabs;
-        long long num_slabs;
-        long long sharedavail;
+struct slab_cache {
+	const char *name;
+	long long values[ADAPTIVED_SLABINFO_COLUMN_CNT];
 };
 
+struct adaptived_slabinfo_snapshot {
+	int refcnt;			/* accessed atomically */
+	char *buf;			/* the file's contents.  the cache names point into it */
+	struct slab_cache *caches;	/* in the order they appear in the file */
+	int cache_cnt;
+	int *slots;			/* index + 1 into caches, hashed by name.  0 if unused */
+	unsigned int slot_mask;
+};
+
+static const char * const slabinfo_columns[] = {
+	ACTIVE_OBJS, NUM_OBJS, OBJSIZE, OBJPERSLAB, PAGESPERSLAB, LIMIT, BATCHCOUNT,
+	SHAREDFACTOR, ACTIVE_SLABS, NUM_SLABS, SHAREDAVAIL,
+};
+static_assert(ARRAY_SIZE(slabinfo_columns) == ADAPTIVED_SLABINFO_COLUMN_CNT,
+	      "slabinfo_columns[] must be the same length as ADAPTIVED_SLABINFO_COLUMN_CNT");
+
+/*
+ * The keys in /proc/meminfo.  They are found with a perfect hash, so that the
+ * file can be parsed in a single pass.  If this list is changed, meminfo_slots
+ * must be regenerated by searching for a MEMINFO_HASH_SEED for which
+ * meminfo_hash() does not collide for any of the keys
+ */
+static const char * const meminfo_keys[] = {
+	"MemTotal", "MemFree", "MemAvailable", "Buffers", "Cached", "SwapCached",
+	"Active", "Inactive", "Active(anon)", "Inactive(anon)", "Active(file)",
+	"Inactive(file)", "Unevictable", "Mlocked", "HighTotal", "HighFree",
+	"LowTotal", "LowFree", "MmapCopy", "SwapTotal", "SwapFree", "Zswap",
+	"Zswapped", "Dirty", "Writeback", "AnonPages", "Mapped", "Shmem",
+	"KReclaimable", "Slab", "SReclaimable", "SUnreclaim", "KernelStack",
+	"ShadowCallStack", "PageTables", "SecPageTables", "NFS_Unstable", "Bounce",
+	"WritebackTmp", "CommitLimit", "Committed_AS", "VmallocTotal", "VmallocUsed",
+	"VmallocChunk", "Percpu", "HardwareCorrupted", "AnonHugePages",
+	"ShmemHugePages", "ShmemPmdMapped", "FileHugePages", "FilePmdMapped",
+	"CmaTotal", "CmaFree", "Unaccepted", "Balloon", "HugePages_Total",
+	"HugePages_Free", "HugePages_Rsvd", "HugePages_Surp", "Hugepagesize",
+	"Hugetlb", "DirectMap4k", "DirectMap2M", "DirectMap4M", "DirectMap1G",
+};
+
+#define MEMINFO_KEY_CNT ARRAY_SIZE(meminfo_keys)
+#define MEMINFO_HASH_SIZE 256
+#define MEMINFO_HASH_SEED 275
+
+/* index + 1 into meminfo_keys for each hash slot.  0 if the slot is unused */
+static const unsigned char meminfo_slots[MEMINFO_HASH_SIZE] = {
+	 0, 39,  0,  0,  0,  0, 58, 55,  0,  0,  0,  0,  0,  0,  0,  0,
+	 0,  0,  0,  0, 33, 43,  0,  0, 41,  0, 54, 61,  0,  0,  0,  0,
+	 0, 26,  0,  0, 45,  0,  0,  0, 27,  0,  0,  0,  0,  0,  0,  0,
+	44,  0,  0,  0,  0,  0,  0, 59,  7,  0,  0,  0,  0,  0,  0,  0,
+	 0,  0,  5,  0,  4,  0, 16,  0, 14, 25,  0,  0, 46, 47,  0, 32,
+	 0,  0,  0,  0,  0, 34,  0,  0,  0,  0, 53, 35,  0,  0,  0,  0,
+	37,  0, 12, 28,  9,  0,  0,  0,  0,  0,  1,  0,  0,  0,  0,  8,
+	 0, 29,  0, 23,  0,  0,  0,  0,  0,  0,  0, 10,  0,  0, 56,  0,
+	 0, 57,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 11,
+	 0,  0,  0,  0,  6, 65,  0,  0, 60,  0, 36,  0, 13,  0,  0,  0,
+	 0, 30, 21,  0,  0,  0,  0,  0,  0, 31,  0,  0,  0,  0,  0,  0,
+	51,  3, 48,  0,  0,  0,  0,  0,  0,  0, 62,  0,  0,  0,  0, 18,
+	 0,  0,  0,  0, 52,  0,  0,  0,  0,  0,  0,  0,  0,  2, 64,  0,
+	 0, 20,  0,  0,  0,  0,  0,  0,  0,  0, 22,  0, 24, 17, 49,  0,
+	40,  0, 63,  0,  0, 42,  0,  0,  0,  0,  0, 19,  0,  0,  0,  0,
+	15,  0,  0, 38,  0,  0,  0, 50,  0,  0,  0,  0,  0,  0,  0,  0,
+};
+
+struct meminfo_snapshot {
+	long long values[MEMINFO_KEY_CNT];
+	int rets[MEMINFO_KEY_CNT]; /* 0 if the value is valid, else a negative errno */
+};
+
+static unsigned int meminfo_hash(const char * const key, size_t len)
+{
+	unsigned int hash = 2166136261u ^ MEMINFO_HASH_SEED;
+	size_t i;
+
+	/* FNV-1a followed by a final mix so that every bit affects the slot */
+	for (i = 0; i < len; i++) {
+		hash ^= (unsigned char)key[i];
+		hash *= 16777619u;
+	}
+
+	hash ^= hash >> 16;
+	hash *= 0x45d9f3bu;
+	hash ^= hash >> 16;
+
+	return hash % MEMINFO_HASH_SIZE;
+}
+
+/*
+ * Returns the index of the key in meminfo_keys, or -1 if it's not a known key
+ */
+static int meminfo_key_idx(const char * const key, size_t len)
+{
+	int idx;
+
+	idx = meminfo_slots[meminfo_hash(key, len)] - 1;
+	if (idx < 0)
+		return -1;
+
+	if (strlen(meminfo_keys[idx]) != len || strncmp(meminfo_keys[idx], key, len) != 0)
+		return -1;
+
+	return idx;
+}
+
+/*
+ * Parse a value such as "   1234 kB".  Values with a unit are returned in bytes
+ */
+static int parse_meminfo_value(const char * const str, const char * const eol,
+			       long long * const value)
+{
+	long long multiplier = 1;
+	const char *c;
+	char *endptr;
+
+	errno = 0;
+	*value = strtoll(str, &endptr, 10);
+	if (endptr == str)
+		return -EINVAL;
+	if (errno || *value == LLONG_MIN || *value == LLONG_MAX)
+		return -ERANGE;
+
+	c = endptr;
+	while (c < eol && *c == ' ')
+		c++;
+
+	if (eol - c >= 2 && (c[1] == 'b' || c[1] == 'B')) {
+		if (c[0] == 'k')
+			multiplier = 1024;
+		else if (c[0] == 'm')
+			multiplier = 1024 * 1024;
+		else if (c[0] == 'g')
+			multiplier = 1024 * 1024 * 1024;
+		else
+			return -EINVAL;
+
+		c += 2;
+	}
+
+	while (c < eol && *c == ' ')
+		c++;
+
+	if (c != eol)
+		/* There was unparsable data in the string */
+		return -EINVAL;
+
+	*value *= multiplier;
+
+	return 0;
+}
+
+static int parse_meminfo(const char * const buf, size_t len, void * const out)
+{
+	struct meminfo_snapshot * const snap = out;
+	const char *line, *eol, *colon;
+	size_t i;
+	int idx;
+
+	for (i = 0; i < MEMINFO_KEY_CNT; i++)
+		snap->rets[i] = -ENOENT;
+
+	for (line = buf; line < buf + len; line = eol + 1) {
+		eol = memchr(line, '\n', buf + len - line);
+		if (!eol)
+			eol = buf + len;
+
+		colon = memchr(line, ':', eol - line);
+		if (!colon)
+			continue;
+
+		idx = meminfo_key_idx(line, colon - line);
+		if (idx < 0 || snap->rets[idx] != -ENOENT)
+			/* unknown keys are looked up when they are requested */
+			continue;
+
+		snap->rets[idx] = parse_meminfo_value(colon + 1, eol, &snap->values[idx]);
+	}
+
+	return 0;
+}
+
+API int adaptived_get_meminfo_fields(const char * const meminfo_file,
+				  struct adaptived_meminfo_request * const reqs, int req_cnt)
+{
+	struct meminfo_snapshot snap;
+	const char *file;
+	int ret, i, idx;
+
+	if (!reqs || req_cnt <= 0)
+		return -EINVAL;
+
+	file = meminfo_file ? meminfo_file : PROC_MEMINFO;
+
+	/* the snapshot is cached, so the file is parsed at most once per pass */
+	ret = read_cache_parse(file, &parse_meminfo, &snap, sizeof(snap));
+	if (ret) {
+		adaptived_err("Failed to read %s: %d\n", file, ret);
+		return ret;
+	}
+
+	for (i = 0; i < req_cnt; i++) {
+		if (!reqs[i].field) {
+			reqs[i].ret = -EINVAL;
+		} else {
+			idx = meminfo_key_idx(reqs[i].field, strlen(reqs[i].field));
+			if (idx >= 0) {
+				reqs[i].ret = snap.rets[idx];
+				reqs[i].value = snap.values[idx];
+			} else {
+				/* a key that this version of adaptived doesn't know about */
+				reqs[i].ret = get_ll_field_in_file(file, reqs[i].field, ": ",
+								   &reqs[i].value);
+			}
+		}
+
+		if (reqs[i].ret && !ret)
+			ret = reqs[i].ret;
+	}
+
+	return ret;
+}
+
 API int adaptived_get_meminfo_field(const char * const meminfo_file,
 				 const char * const field, long long * const ll_valuep)
 {
-	return get_ll_field_in_file(meminfo_file, field, ": ", ll_valuep);
+	struct adaptived_meminfo_request req = { 0 };
+	int ret;
+
+	if (!field || !ll_valuep)
+		return -EINVAL;
+
+	req.field = field;
+
+	ret = adaptived_get_meminfo_fields(meminfo_file, &req, 1);
+	if (ret)
+		return ret;
+
+	*ll_valuep = req.value;
+
+	return 0;
+}
+
+static unsigned int hash_name(const char * const name)
+{
+	unsigned int hash = 2166136261u;
+	const char *c;
+
+	/* FNV-1a */
+	for (c = name; *c; c++) {
+		hash ^= (unsigned char)*c;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static void slabinfo_snapshot_free(struct adaptived_slabinfo_snapshot ** snap)
+{
+	if (!snap || !(*snap))
+		return;
+
+	if ((*snap)->buf)
+		free((*snap)->buf);
+	if ((*snap)->caches)
+		free((*snap)->caches);
+	if ((*snap)->slots)
+		free((*snap)->slots);
+
+	free(*snap);
+	(*snap) = NULL;
+}
+
+static const struct slab_cache *slabinfo_find(const struct adaptived_slabinfo_snapshot * const snap,
+					      const char * const name)
+{
+	unsigned int slot;
+	int idx;
+
+	if (!snap->slots)
+		return NULL;
+
+	for (slot = hash_name(name) & snap->slot_mask; snap->slots[slot];
+	     slot = (slot + 1) & snap->slot_mask) {
+		idx = snap->slots[slot] - 1;
+
+		if (strcmp(snap->caches[idx].name, name) == 0)
+			return &snap->caches[idx];
+	}
+
+	return NULL;
+}
+
+/*
+ * Parse one line of slabinfo in place, e.g.
+ * "dentry 1000 1050 192 21 1 : tunables 0 0 0 : slabdata 50 50 0"
+ */
+static int parse_slabinfo_line(char * const line, struct slab_cache * const cache)
+{
+	int column = 0;
+	char *c, *endptr;
+
+	c = line;
+	while (*c && *c != ' ')
+		c++;
+	if (c == line || !*c)
+		return -EINVAL;
+
+	*c++ = '\0';
+	cache->name = line;
+
+	while (*c) {
+		while (*c == ' ')
+			c++;
+		if (!*c)
+			break;
+
+		if (*c < '0' || *c > '9') {
+			/* skip the ":", "tunables", and "slabdata" labels */
+			while (*c && *c != ' ')
+				c++;
+			continue;
+		}
+
+		if (column >= ADAPTIVED_SLABINFO_COLUMN_CNT)
+			return -EINVAL;
+
+		cache->values[column++] = strtoll(c, &endptr, 10);
+		if (*endptr && *endptr != ' ')
+			/* There was unparsable data in the string */
+			return -EINVAL;
+		c = endptr;
+	}
+
+	if (column != ADAPTIVED_SLABINFO_COLUMN_CNT)
+		return -EINVAL;
+
+	return 0;
+}
+
+static int slabinfo_snapshot_create(const char * const slabinfo_file,
+				    struct adaptived_slabinfo_snapshot ** const snapp)
+{
+	struct adaptived_slabinfo_snapshot *snap;
+	size_t len, size = 0, line_cnt = 0;
+	unsigned int slot_cnt, slot;
+	char *line, *eol;
+	int ret, i;
+
+	snap = malloc(sizeof(struct adaptived_slabinfo_snapshot));
+	if (!snap)
+		return -ENOMEM;
+
+	memset(snap, 0, sizeof(struct adaptived_slabinfo_snapshot));
+	snap->refcnt = 1;
+
+	ret = fd_cache_read(slabinfo_file, &snap->buf, &len, &size);
+	if (ret) {
+		adaptived_err("Failed to read %s: %d\n", slabinfo_file, ret);
+		goto error;
+	}
+
+	for (i = 0; i < (int)len; i++) {
+		if (snap->buf[i] == '\n')
+			line_cnt++;
+	}
+
+	snap->caches = malloc(sizeof(struct slab_cache) * (line_cnt + 1));
+	if (!snap->caches) {
+		ret = -ENOMEM;
+		goto error;
+	}
+
+	for (line = snap->buf; *line; line = eol + 1) {
+		eol = strchr(line, '\n');
+		if (eol)
+			*eol = '\0';
+
+		/* skip the "slabinfo - version: 2.1" and "# name ..." headers */
+		if (*line && *line != '#' && strncmp(line, "slabinfo -", strlen("slabinfo -")) != 0) {
+			ret = parse_slabinfo_line(line, &snap->caches[snap->cache_cnt]);
+			if (ret) {
+				adaptived_err("Failed to parse slabinfo line: %s\n", line);
+				goto error;
+			}
+			snap->cache_cnt++;
+		}
+
+		if (!eol)
+			break;
+	}
+
+	/* keep the table at most half full */
+	for (slot_cnt = 16; slot_cnt < (unsigned int)snap->cache_cnt * 2; slot_cnt <<= 1)
+		;
+
+	snap->slots = malloc(sizeof(int) * slot_cnt);
+	if (!snap->slots) {
+		ret = -ENOMEM;
+		goto error;
+	}
+
+	memset(snap->slots, 0, sizeof(int) * slot_cnt);
+	snap->slot_mask = slot_cnt - 1;
+
+	for (i = 0; i < snap->cache_cnt; i++) {
+		if (slabinfo_find(snap, snap->caches[i].name))
+			/* keep the first entry if a name is duplicated */
+			continue;
+
+		for (slot = hash_name(snap->caches[i].name) & snap->slot_mask; snap->slots[slot];
+		     slot = (slot + 1) & snap->slot_mask)
+			;
+		snap->slots[slot] = i + 1;
+	}
+
+	*snapp = snap;
+
+	return 0;
+
+error:
+	slabinfo_snapshot_free(&snap);
+	return ret;
+}
+
+API int adaptived_slabinfo_column_idx(const char * const column)
+{
+	int i;
+
+	if (!column)
+		return -EINVAL;
+
+	for (i = 0; i < ADAPTIVED_SLABINFO_COLUMN_CNT; i++) {
+		if (strcmp(column, slabinfo_columns[i]) == 0)
+			return i;
+	}
+
+	return -EINVAL;
+}
+
+static int slabinfo_cache_create(const void * const arg, void ** const obj)
+{
+	struct adaptived_slabinfo_snapshot *snap;
+	int ret;
+
+	ret = slabinfo_snapshot_create(arg, &snap);
+	if (ret)
+		return ret;
+
+	*obj = snap;
+
+	return 0;
+}
+
+static void slabinfo_cache_get(void * const obj)
+{
+	struct adaptived_slabinfo_snapshot *snap = obj;
+
+	__atomic_add_fetch(&snap->refcnt, 1, __ATOMIC_RELAXED);
+}
+
+static void slabinfo_cache_put(void * const obj)
+{
+	struct adaptived_slabinfo_snapshot *snap = obj;
+
+	adaptived_slabinfo_put(&snap);
+}
+
+static const struct pass_cache_ops slabinfo_cache_ops = {
+	.create = slabinfo_cache_create,
+	.get = slabinfo_cache_get,
+	.put = slabinfo_cache_put,
+};
+
+/* the most recent snapshot of each slabinfo file */
+static struct pass_cache slabinfo_cache = PASS_CACHE_INIT(&slabinfo_cache_ops);
+
+API int adaptived_get_slabinfo(const char * const slabinfo_file,
+			    struct adaptived_slabinfo_snapshot ** const snap)
+{
+	const char *file;
+	void *obj;
+	int ret;
+
+	if (!snap)
+		return -EINVAL;
+
+	file = slabinfo_file ? slabinfo_file : PROC_SLABINFO;
+
+	ret = pass_cache_get(&slabinfo_cache, file, file, &obj);
+	if (ret)
+		return ret;
+
+	*snap = obj;
+
+	return 0;
+}
+
+API void adaptived_slabinfo_put(struct adaptived_slabinfo_snapshot ** const snap)
+{
+	if (!snap || !(*snap))
+		return;
+
+	if (__atomic_sub_fetch(&(*snap)->refcnt, 1, __ATOMIC_ACQ_REL) == 0)
+		slabinfo_snapshot_free(snap);
+
+	(*snap) = NULL;
+}
+
+/*
+ * Release the shared snapshots.  Snapshots that are still referenced are freed when
+ * their last reference is put
+ */
+void slabinfo_flush(void)
+{
+	pass_cache_flush(&slabinfo_cache);
+}
+
+API int adaptived_slabinfo_get_value(const struct adaptived_slabinfo_snapshot * const snap,
+				  const char * const name,
+				  enum adaptived_slabinfo_column_enum column,
+				  long long * const ll_valuep)
+{
+	const struct slab_cache *cache;
+
+	if (!snap || !name || !ll_valuep || column < 0 || column >= ADAPTIVED_SLABINFO_COLUMN_CNT)
+		return -EINVAL;
+
+	cache = slabinfo_find(snap, name);
+	if (!cache)
+		return -ENOENT;
+
+	*ll_valuep = cache->values[column];
+
+	return 0;
+}
+
+API int adaptived_slabinfo_top_growth(const struct adaptived_slabinfo_snapshot * const cur,
+				   const struct adaptived_slabinfo_snapshot * const prev,
+				   enum adaptived_slabinfo_column_enum column,
+				   struct adaptived_slabinfo_growth * const top, int top_cnt)
+{
+	const struct slab_cache *prev_cache;
+	long long delta;
+	int i, j, cnt = 0;
+
+	if (!cur || !prev || !top || top_cnt <= 0 || column < 0 ||
+	    column >= ADAPTIVED_SLABINFO_COLUMN_CNT)
+		return -EINVAL;
+
+	for (i = 0; i < cur->cache_cnt; i++) {
+		prev_cache = slabinfo_find(prev, cur->caches[i].name);
+
+		delta = cur->caches[i].values[column];
+		if (prev_cache)
+			delta -= prev_cache->values[column];
+
+		if (delta <= 0)
+			continue;
+		if (cnt == top_cnt && delta <= top[cnt - 1].delta)
+			continue;
+
+		/* insertion sort into the (short) top list */
+		j = cnt < top_cnt ? cnt++ : cnt - 1;
+		for (; j > 0 && top[j - 1].delta < delta; j--)
+			top[j] = top[j - 1];
+
+		top[j].name = cur->caches[i].name;
+		top[j].value = cur->caches[i].values[column];
+		top[j].delta = delta;
+	}
+
+	return cnt;
 }
 
 API int adaptived_get_slabinfo_field(const char * const slabinfo_file,
 				 const char * const field, const char * const column,
 				 long long * const ll_valuep)
 {
-	FILE * fp;
-	char * line = NULL;
-	size_t len = 0;
-	ssize_t read;
-	char *bp;
-	int ret = 0;
-	int items = 0;
-	struct slabinfo_columns columns;
-	bool slabinfo_found = false;
-	bool column_found = false;
+	struct adaptived_slabinfo_snapshot *snap = NULL;
+	int ret, column_idx;
 
 	if ((!field) || (!column) || (!ll_valuep))
 		return -EINVAL;
 
-	if (slabinfo_file)
-		fp = fopen(slabinfo_file, "r");
-	else
-		fp = fopen(PROC_SLABINFO, "r");
-	if (fp == NULL) {
-		adaptived_err("adaptived_get_slabinfo_field: can't open slabinfo file.\n");
-		return -errno;
-	}
-        while ((read = getline(&line, &len, fp)) != -1) {
-		if (!slabinfo_found) {
-			if (strncmp(line, "# name", strlen("# name")) == 0)
-				slabinfo_found = true;
-			continue;
-		}
-                line[strcspn(line, "\n")] = '\0';
-
-                bp = line;
-                items = sscanf(bp, "%s %lld %lld %lld %lld %lld : tunables %lld %lld %lld : slabdata %lld %lld %lld",
-                    columns.name, &columns.active_objs, &columns.num_objs, &columns.objsize, &columns.objperslab,
-                    &columns.pagesperslab, &columns.limit, &columns.batchcount,
-                    &columns.sharedfactor, &columns.active_slabs, &columns.num_slabs, &columns.sharedavail);
-                if (items != 12) {
-                        adaptived_err("adaptived_get_slabinfo_field: sscanf error. Items should be 12, but got %d\n", items);
-                        return -EINVAL;
-                }
-                if (strcmp(field, columns.name) == 0) {
-			column_found = true;
-                        break;
-		}
-        }
-	if (!column_found)
-		goto out;
-        adaptived_dbg("adaptived_get_slabinfo_field: %s %lld %lld %lld %lld %lld : tunables %lld %lld %lld : slabdata %lld %lld %lld\n",
-                columns.name, columns.active_objs, columns.num_objs, columns.objsize, columns.objperslab,
-                columns.pagesperslab, columns.limit, columns.batchcount,
-                columns.sharedfactor, columns.active_slabs, columns.num_slabs, columns.sharedavail);
-
-        if (strncmp(column, ACTIVE_OBJS, strlen(ACTIVE_OBJS)) == 0)
-                *ll_valuep = columns.active_objs;
-        else if (strncmp(column, NUM_OBJS, strlen(NUM_OBJS)) == 0)
-                *ll_valuep = columns.num_objs;
-        else if (strncmp(column, OBJSIZE, strlen(OBJSIZE)) == 0)
-                *ll_valuep = columns.objsize;
-        else if (strncmp(column, OBJPERSLAB, strlen(OBJPERSLAB)) == 0)
-                *ll_valuep = columns.objperslab;
-        else if (strncmp(column, PAGESPERSLAB, strlen(PAGESPERSLAB)) == 0)
-                *ll_valuep = columns.pagesperslab;
-        else if (strncmp(column, LIMIT, strlen(LIMIT)) == 0)
-                *ll_valuep = columns.limit;
-        else if (strncmp(column, BATCHCOUNT, strlen(BATCHCOUNT)) == 0)
-                *ll_valuep = columns.batchcount;
-        else if (strncmp(column, SHAREDFACTOR, strlen(SHAREDFACTOR)) == 0)
-                *ll_valuep = columns.sharedfactor;
-        else if (strncmp(column, ACTIVE_SLABS, strlen(ACTIVE_SLABS)) == 0)
-                *ll_valuep = columns.active_slabs;
-        else if (strncmp(column, NUM_SLABS, strlen(NUM_SLABS)) == 0)
-                *ll_valuep = columns.num_slabs;
-        else if (strncmp(column, SHAREDAVAIL, strlen(SHAREDAVAIL)) == 0)
-                *ll_valuep = columns.sharedavail;
-	else {
-		adaptived_err("adaptived_get_slabinfo_field: unknow column: %s\n", column);
-		ret = -EINVAL;
-	}
-
-out:
-	fclose(fp);
-	if (line)
-		free(line);
+	column_idx = adaptived_slabinfo_column_idx(column);
+	if (column_idx < 0) {
+		adaptived_err("adaptived_get_slabinfo_field: unknown column: %s\n", column);
+		return column_idx;
+	}
+
+	ret = adaptived_get_slabinfo(slabinfo_file, &snap);
+	if (ret)
+		return ret;
+
+	ret = adaptived_slabinfo_get_value(snap, field, column_idx, ll_valuep);
+	adaptived_slabinfo_put(&snap);
+	if (ret == -ENOENT) {
+		/* the slab cache doesn't exist (or was merged into another cache) */
+		*ll_valuep = 0;
+		ret = 0;
+	}
 
 	return ret;
 }
@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2024, Oracle and/or its affiliates.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+/**
+ * Objects that are built at most once per pass through the main loop
+ *
+ * Some helpers build an object from many reads or an expensive parse, e.g. a
+ * snapshot of /proc/stat or /proc/slabinfo, or the PSI of every cgroup in a tree.
+ * While a rule is being run, the most recent object for each key is shared by
+ * every caller until the read cache is invalidated.  The objects are reference
+ * counted by their owners, so a caller can keep using an object after it has
+ * been replaced.
+ *
+ * Callers outside of the main loop always get a new object.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <adaptived.h>
+
+#include "adaptived-internal.h"
+
+struct pass_cache_entry {
+	char *key;
+
+	/*
+	 * Held while the object is built, so that callers that want the same object
+	 * wait for it without blocking callers that want other objects
+	 */
+	pthread_mutex_t lock;
+	/* the following fields are protected by the entry's lock */
+	unsigned long version; /* the read cache version the object was built in */
+	void *obj;
+
+	/* protected by the cache's mutex.  entries are only removed by pass_cache_flush() */
+	struct pass_cache_entry *next;
+};
+
+/*
+ * Get the object for key, building it if it hasn't been built during this pass.
+ * The caller owns a reference to the object
+ */
+int pass_cache_get(struct pass_cache * const cache, const char * const key,
+		   const void * const arg, void ** const obj)
+{
+	struct pass_cache_entry *entry;
+	unsigned long version;
+	int ret = 0;
+
+	version = read_cache_version();
+	if (!version)
+		/* not in a pass of the main loop, so there is nothing to share */
+		return (*cache->ops->create)(arg, obj);
+
+	/* the cache's mutex only protects the list.  never build an object while holding it */
+	pthread_mutex_lock(&cache->mutex);
+
+	for (entry = cache->list; entry; entry = entry->next) {
+		if (strcmp(entry->key, key) == 0)
+			break;
+	}
+
+	if (!entry) {
+		entry = malloc(sizeof(struct pass_cache_entry));
+		if (!entry) {
+			pthread_mutex_unlock(&cache->mutex);
+			return -ENOMEM;
+		}
+
+		memset(entry, 0, sizeof(struct pass_cache_entry));
+		pthread_mutex_init(&entry->lock, NULL);
+
+		entry->key = strdup(key);
+		if (!entry->key) {
+			pthread_mutex_destroy(&entry->lock);
+			free(entry);
+			pthread_mutex_unlock(&cache->mutex);
+			return -ENOMEM;
+		}
+
+		entry->next = cache->list;
+		cache->list = entry;
+	}
+
+	pthread_mutex_lock(&entry->lock);
+	pthread_mutex_unlock(&cache->mutex);
+
+	if (!entry->obj || entry->version != version) {
+		if (entry->obj)
+			(*cache->ops->put)(entry->obj);
+		entry->obj = NULL;
+
+		ret = (*cache->ops->create)(arg, &entry->obj);
+		if (ret)
+			goto out;
+
+		entry->version = version;
+	}
+
+	(*cache->ops->get)(entry->obj);
+	*obj = entry->obj;
+
+out:
+	pthread_mutex_unlock(&entry->lock);
+
+	return ret;
+}
+
+/*
+ * Release the shared objects.  Objects that are still referenced are freed when
+ * their last reference is put.  This must not be called while a rule is running
+ */
+void pass_cache_flush(struct pass_cache * const cache)
+{
+	struct pass_cache_entry *entry, *next;
+
+	pthread_mutex_lock(&cache->mutex);
+
+	for (entry = cache->list; entry; entry = next) {
+		next = entry->next;
+
+		if (entry->obj)
+			(*cache->ops->put)(entry->obj);
+		pthread_mutex_destroy(&entry->lock);
+		free(entry->key);
+		free(entry);
+	}
+	cache->list = NULL;
+
+	pthread_mutex_unlock(&cache->mutex);
+}
@@ -25,10 +25,16 @@
  *
  */
 
+#include <sys/syscall.h>
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <dirent.h>
 #include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
 #include <errno.h>
 
 #include <adaptived-utils.h>
@@ -36,6 +42,41 @@
 
 #include "adaptived-internal.h"
 
+/* large enough to read most cgroup directories in a single getdents64() call */
+#define DIR_WALK_BUF_SIZE 32768
+
+/* the record returned by the getdents64 system call */
+struct linux_dirent64 {
+	uint64_t d_ino;
+	int64_t d_off;
+	unsigned short d_reclen;
+	unsigned char d_type;
+	char d_name[];
+};
+
+struct dir_walk_level {
+	int fd;
+	char *buf;	/* reused by every directory that is read at this level */
+	int pos;
+	int len;
+};
+
+struct adaptived_dir_walk {
+	char *path;
+	int flags;
+	int max_depth;
+	bool list_top_dir;
+
+	/* levels[0] is the root.  depth is the level being read, or -1 at the end */
+	struct dir_walk_level *levels;
+	int level_cnt;
+	int depth;
+
+	/* the directory returned by the last call.  it's descended into or closed next */
+	int pending_fd;
+	bool pending_descend;
+};
+
 struct adaptived_path_walk_handle {
 	char *path;
 	DIR *dirp;
@@ -269,3 +310,273 @@ API void adaptived_path_walk_end(struct adaptived_path_walk_handle **handle)
 
 	*handle = NULL;
 }
+
+static int dir_walk_push(struct adaptived_dir_walk * const walk, int fd)
+{
+	struct dir_walk_level *levels;
+	int depth = walk->depth + 1;
+
+	if (depth == walk->level_cnt) {
+		levels = realloc(walk->levels, sizeof(struct dir_walk_level) * (depth + 1));
+		if (!levels)
+			return -ENOMEM;
+
+		memset(&levels[depth], 0, sizeof(struct dir_walk_level));
+		levels[depth].fd = -1;
+
+		walk->levels = levels;
+		walk->level_cnt++;
+	}
+
+	if (!walk->levels[depth].buf) {
+		walk->levels[depth].buf = malloc(DIR_WALK_BUF_SIZE);
+		if (!walk->levels[depth].buf)
+			return -ENOMEM;
+	}
+
+	walk->levels[depth].fd = fd;
+	walk->levels[depth].pos = 0;
+	walk->levels[depth].len = 0;
+	walk->depth = depth;
+
+	return 0;
+}
+
+static void dir_walk_pop(struct adaptived_dir_walk * const walk)
+{
+	close(walk->levels[walk->depth].fd);
+	walk->levels[walk->depth].fd = -1;
+	walk->depth--;
+}
+
+API int adaptived_dir_walk_start(const char * const path, int flags, int max_depth,
+				 struct adaptived_dir_walk ** const walk)
+{
+	struct adaptived_dir_walk *w;
+	size_t len;
+	int ret, fd;
+
+	if (!path || !walk || strlen(path) == 0)
+		return -EINVAL;
+
+	if (flags == 0)
+		flags = ADAPTIVED_PATH_WALK_DEFAULT_FLAGS;
+
+	w = malloc(sizeof(struct adaptived_dir_walk));
+	if (!w)
+		return -ENOMEM;
+
+	memset(w, 0, sizeof(struct adaptived_dir_walk));
+	w->flags = flags;
+	w->max_depth = max_depth < 0 ? ADAPTIVED_PATH_WALK_UNLIMITED_DEPTH : max_depth;
+	w->depth = -1;
+	w->pending_fd = -1;
+
+	w->path = strdup(path);
+	if (!w->path) {
+		ret = -ENOMEM;
+		goto error;
+	}
+
+	/* the root is listed and the path is trimmed like adaptived_path_walk_start() does */
+	len = strlen(w->path);
+	w->list_top_dir = (flags & ADAPTIVED_PATH_WALK_LIST_DIRS) &&
+			  !(len >= 2 && w->path[len - 1] == '*' && w->path[len - 2] == '/');
+
+	if (len > 1 && w->path[len - 1] == '*')
+		w->path[--len] = '\0';
+	if (len > 1 && w->path[len - 1] == '/')
+		w->path[--len] = '\0';
+
+	fd = open(w->path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd < 0) {
+		ret = -errno;
+		goto error;
+	}
+
+	ret = dir_walk_push(w, fd);
+	if (ret) {
+		close(fd);
+		goto error;
+	}
+
+	*walk = w;
+
+	return 0;
+
+error:
+	adaptived_dir_walk_end(&w);
+
+	return ret;
+}
+
+/*
+ * Return the type of an entry.  Some filesystems don't fill in d_type, so those
+ * entries are stat()ed
+ */
+static unsigned char dir_walk_type(int dirfd, const struct linux_dirent64 * const de)
+{
+	struct stat st;
+
+	if (de->d_type != DT_UNKNOWN)
+		return de->d_type;
+
+	if (fstatat(dirfd, de->d_name, &st, AT_SYMLINK_NOFOLLOW) < 0)
+		/* the entry has been removed */
+		return DT_UNKNOWN;
+
+	if (S_ISDIR(st.st_mode))
+		return DT_DIR;
+	if (S_ISREG(st.st_mode))
+		return DT_REG;
+
+	return DT_UNKNOWN;
+}
+
+API int adaptived_dir_walk_next(struct adaptived_dir_walk * const walk,
+				struct adaptived_dir_walk_entry * const entry)
+{
+	const struct linux_dirent64 *de;
+	struct dir_walk_level *level;
+	unsigned char type;
+	bool descend;
+	long len;
+	int ret, fd;
+
+	if (!walk || !entry)
+		return -EINVAL;
+
+	if (walk->pending_fd >= 0) {
+		fd = walk->pending_fd;
+		walk->pending_fd = -1;
+
+		if (walk->pending_descend) {
+			ret = dir_walk_push(walk, fd);
+			if (ret) {
+				close(fd);
+				return ret;
+			}
+		} else {
+			close(fd);
+		}
+	}
+
+	if (walk->list_top_dir) {
+		walk->list_top_dir = false;
+
+		entry->dirfd = AT_FDCWD;
+		entry->name = walk->path;
+		entry->fd = walk->levels[0].fd;
+		entry->depth = 0;
+		entry->type = DT_DIR;
+		return 1;
+	}
+
+	while (walk->depth >= 0) {
+		level = &walk->levels[walk->depth];
+
+		if (level->pos >= level->len) {
+			len = syscall(SYS_getdents64, level->fd, level->buf, DIR_WALK_BUF_SIZE);
+			if (len < 0)
+				return -errno;
+			if (len == 0) {
+				/* We've reached the end of this directory */
+				dir_walk_pop(walk);
+				continue;
+			}
+
+			level->pos = 0;
+			level->len = len;
+		}
+
+		de = (const struct linux_dirent64 *)&level->buf[level->pos];
+		level->pos += de->d_reclen;
+
+		if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0) {
+			if ((walk->flags & ADAPTIVED_PATH_WALK_LIST_DIRS) &&
+			    (walk->flags & ADAPTIVED_PATH_WALK_LIST_DOT_DIRS)) {
+				entry->dirfd = level->fd;
+				entry->name = de->d_name;
+				entry->fd = -1;
+				entry->depth = walk->depth + 1;
+				entry->type = DT_DIR;
+				return 1;
+			}
+			continue;
+		}
+
+		type = dir_walk_type(level->fd, de);
+
+		if (type == DT_REG && (walk->flags & ADAPTIVED_PATH_WALK_LIST_FILES)) {
+			entry->dirfd = level->fd;
+			entry->name = de->d_name;
+			entry->fd = -1;
+			entry->depth = walk->depth + 1;
+			entry->type = DT_REG;
+			return 1;
+		}
+
+		if (type != DT_DIR)
+			continue;
+
+		descend = walk->max_depth < 0 || walk->depth < walk->max_depth;
+		if (!descend && !(walk->flags & ADAPTIVED_PATH_WALK_LIST_DIRS))
+			continue;
+
+		fd = openat(level->fd, de->d_name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if (fd < 0) {
+			if (errno == ENOENT || errno == ENOTDIR)
+				/* the directory has been removed or replaced */
+				continue;
+			return -errno;
+		}
+
+		if (!(walk->flags & ADAPTIVED_PATH_WALK_LIST_DIRS)) {
+			ret = dir_walk_push(walk, fd);
+			if (ret) {
+				close(fd);
+				return ret;
+			}
+			continue;
+		}
+
+		/* The directory is returned before its contents, like adaptived_path_walk_next() */
+		walk->pending_fd = fd;
+		walk->pending_descend = descend;
+
+		entry->dirfd = level->fd;
+		entry->name = de->d_name;
+		entry->fd = fd;
+		entry->depth = walk->depth + 1;
+		entry->type = DT_DIR;
+		return 1;
+	}
+
+	return 0;
+}
+
+API void adaptived_dir_walk_end(struct adaptived_dir_walk ** const walk)
+{
+	int i;
+
+	if (!walk || !(*walk))
+		return;
+
+	if ((*walk)->pending_fd >= 0)
+		close((*walk)->pending_fd);
+
+	for (i = 0; i < (*walk)->level_cnt; i++) {
+		if ((*walk)->levels[i].fd >= 0)
+			close((*walk)->levels[i].fd);
+		if ((*walk)->levels[i].buf)
+			free((*walk)->levels[i].buf);
+	}
+
+	if ((*walk)->levels)
+		free((*walk)->levels);
+	if ((*walk)->path)
+		free((*walk)->path);
+
+	free(*walk);
+	(*walk) = NULL;
+}
@@ -27,97 +27,217 @@
  *
  */
 
+#include <sys/statfs.h>
+#include <linux/magic.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <assert.h>
+#include <stdlib.h>
 #include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <errno.h>
+#include <poll.h>
 
 #include <adaptived-utils.h>
 #include <adaptived.h>
 
 #include "adaptived-internal.h"
+#include "defines.h"
 
-static void get_avgs(const char * const line, struct adaptived_pressure_avgs * const pa)
+#define PSI_AVG10	0x1
+#define PSI_AVG60	0x2
+#define PSI_AVG300	0x4
+#define PSI_TOTAL	0x8
+#define PSI_ALL		(PSI_AVG10 | PSI_AVG60 | PSI_AVG300 | PSI_TOTAL)
+
+/*
+ * Parse an unsigned decimal number such as "12.34".  Returns a pointer to the first
+ * character after the number, or NULL if there isn't a number at c
+ */
+static const char *parse_float(const char *c, const char * const end, float * const value)
 {
-	char *subp;
+	unsigned long long whole = 0, frac = 0, scale = 1;
+	const char * const start = c;
 
-	subp = strstr(line, "avg10");
-	subp = strstr(subp, "=");
-	pa->avg10 = strtof(&subp[1], NULL);
+	while (c < end && *c >= '0' && *c <= '9')
+		whole = whole * 10 + (*c++ - '0');
+
+	if (c < end && *c == '.') {
+		c++;
+		while (c < end && *c >= '0' && *c <= '9') {
+			if (scale < 1000000000ULL) {
+				frac = frac * 10 + (*c - '0');
+				scale *= 10;
+			}
+			c++;
+		}
+	}
 
-	subp = strstr(subp, "avg60");
-	subp = strstr(subp, "=");
-	pa->avg60 = strtof(&subp[1], NULL);
+	if (c == start)
+		return NULL;
 
-	subp = strstr(subp, "avg300");
-	subp = strstr(subp, "=");
-	pa->avg300 = strtof(&subp[1], NULL);
+	*value = (float)((double)whole + (double)frac / (double)scale);
 
-	subp = strstr(subp, "total");
-	subp = strstr(subp, "=");
-	pa->total = strtoll(&subp[1], 0, 0);
+	return c;
 }
 
-API int adaptived_get_pressure(const char * const pressure_file,
-			    struct adaptived_pressure_snapshot * const ps)
+static const char *parse_total(const char *c, const char * const end, long long * const value)
 {
-        FILE *fp;
-        char *line = NULL;
-        size_t len = 0;
-        ssize_t nread;
+	const char * const start = c;
+	long long total = 0;
 
-	if (!pressure_file || !ps)
-		return -EINVAL;
+	while (c < end && *c >= '0' && *c <= '9') {
+		if (total > (LLONG_MAX - 9) / 10)
+			return NULL;
+
+		total = total * 10 + (*c++ - '0');
+	}
+
+	if (c == start)
+		return NULL;
+
+	*value = total;
+
+	return c;
+}
+
+static bool key_is(const char * const key, size_t len, const char * const name)
+{
+	return strlen(name) == len && memcmp(key, name, len) == 0;
+}
+
+/*
+ * Parse the "avg10=0.00 avg60=0.00 avg300=0.00 total=0" portion of a PSI line.
+ * Unknown keys are skipped, but all four of the known keys must be present
+ */
+static int parse_avgs(const char *c, const char * const end,
+		      struct adaptived_pressure_avgs * const pa)
+{
+	const char *key, *eq;
+	int found = 0;
+
+	while (c < end) {
+		while (c < end && *c == ' ')
+			c++;
+		if (c == end)
+			break;
+
+		key = c;
+		eq = memchr(key, '=', end - key);
+		if (!eq)
+			return -EINVAL;
+		c = eq + 1;
 
-        fp = fopen(pressure_file, "r");
-        if (fp == NULL) {
-		adaptived_err("Failed to open pressure file: %s\n", pressure_file);
+		if (key_is(key, eq - key, "avg10")) {
+			c = parse_float(c, end, &pa->avg10);
+			found |= PSI_AVG10;
+		} else if (key_is(key, eq - key, "avg60")) {
+			c = parse_float(c, end, &pa->avg60);
+			found |= PSI_AVG60;
+		} else if (key_is(key, eq - key, "avg300")) {
+			c = parse_float(c, end, &pa->avg300);
+			found |= PSI_AVG300;
+		} else if (key_is(key, eq - key, "total")) {
+			c = parse_total(c, end, &pa->total);
+			found |= PSI_TOTAL;
+		} else {
+			while (c < end && *c != ' ')
+				c++;
+		}
+
+		if (!c || (c < end && *c != ' '))
+			/* There was unparsable data in the string */
+			return -EINVAL;
+	}
+
+	if (found != PSI_ALL)
 		return -EINVAL;
-        }
 
-        while ((nread = getline(&line, &len, fp)) != -1) {
-		if (strncmp(line, "some", 4) == 0)
-			get_avgs(line, &ps->some);
-		if (strncmp(line, "full", 4) == 0)
-			get_avgs(line, &ps->full);
-        }
-        fclose(fp);
+	return 0;
+}
 
-	free(line);
+/*
+ * Parse a PSI file without allocating memory.  The "some" line is required, and the
+ * "full" line is optional since older kernels don't provide it for cpu.pressure
+ */
+static int parse_pressure(const char * const buf, size_t len, void * const out)
+{
+	struct adaptived_pressure_snapshot * const ps = out;
+	const char *line, *eol, *end = buf + len;
+	bool found_some = false;
+	int ret;
+
+	memset(ps, 0, sizeof(struct adaptived_pressure_snapshot));
+
+	for (line = buf; line < end; line = eol + 1) {
+		eol = memchr(line, '\n', end - line);
+		if (!eol)
+			eol = end;
+
+		if (eol - line > 5 && memcmp(line, "some ", 5) == 0) {
+			ret = parse_avgs(&line[5], eol, &ps->some);
+			if (ret)
+				return ret;
+			found_some = true;
+		} else if (eol - line > 5 && memcmp(line, "full ", 5) == 0) {
+			ret = parse_avgs(&line[5], eol, &ps->full);
+			if (ret)
+				return ret;
+		}
+	}
+
+	if (!found_some)
+		return -EINVAL;
 
 	return 0;
 }
 
-API int adaptived_get_pressure_avg(const char * const pressure_file,
-				enum adaptived_pressure_meas_enum meas, float * const avg)
+API int adaptived_get_pressure(const char * const pressure_file,
+			    struct adaptived_pressure_snapshot * const ps)
 {
-	struct adaptived_pressure_snapshot ps;
 	int ret;
 
-	if (!pressure_file || !avg)
+	if (!pressure_file || !ps)
 		return -EINVAL;
 
-	ret = adaptived_get_pressure(pressure_file, &ps);
-	if (ret)
-		return ret;
+	/*
+	 * The pressure files are read by many causes and effects, so the parsed
+	 * snapshot is cached for the duration of a pass through the main loop
+	 */
+	ret = read_cache_parse(pressure_file, &parse_pressure, ps,
+			       sizeof(struct adaptived_pressure_snapshot));
+	if (ret) {
+		adaptived_err("Failed to read pressure file %s: %d\n", pressure_file, ret);
+		return -EINVAL;
+	}
 
+	return 0;
+}
+
+static int snapshot_avg(const struct adaptived_pressure_snapshot * const ps,
+			enum adaptived_pressure_meas_enum meas, float * const avg)
+{
 	switch (meas) {
 	case PRESSURE_SOME_AVG10:
-		*avg = ps.some.avg10;
+		*avg = ps->some.avg10;
 		break;
 	case PRESSURE_SOME_AVG60:
-		*avg = ps.some.avg60;
+		*avg = ps->some.avg60;
 		break;
 	case PRESSURE_SOME_AVG300:
-		*avg = ps.some.avg300;
+		*avg = ps->some.avg300;
 		break;
 	case PRESSURE_FULL_AVG10:
-		*avg = ps.full.avg10;
+		*avg = ps->full.avg10;
 		break;
 	case PRESSURE_FULL_AVG60:
-		*avg = ps.full.avg60;
+		*avg = ps->full.avg60;
 		break;
 	case PRESSURE_FULL_AVG300:
-		*avg = ps.full.avg300;
+		*avg = ps->full.avg300;
 		break;
 	default:
 		return -EINVAL;
@@ -126,6 +246,22 @@ API int adaptived_get_pressure_avg(const char * const pressure_file,
 	return 0;
 }
 
+API int adaptived_get_pressure_avg(const char * const pressure_file,
+				enum adaptived_pressure_meas_enum meas, float * const avg)
+{
+	struct adaptived_pressure_snapshot ps;
+	int ret;
+
+	if (!pressure_file || !avg)
+		return -EINVAL;
+
+	ret = adaptived_get_pressure(pressure_file, &ps);
+	if (ret)
+		return ret;
+
+	return snapshot_avg(&ps, meas, avg);
+}
+
 API int adaptived_get_pressure_total(const char * const pressure_file,
 				  enum adaptived_pressure_meas_enum meas, long long * const total)
 {
@@ -152,3 +288,626 @@ API int adaptived_get_pressure_total(const char * const pressure_file,
 
 	return 0;
 }
+
+static const char * const psi_resource_files[] = {
+	"cpu.pressure",
+	"memory.pressure",
+	"io.pressure",
+};
+static_assert(ARRAY_SIZE(psi_resource_files) == ADAPTIVED_PSI_RESOURCE_CNT,
+	      "psi_resource_files[] must be same length as ADAPTIVED_PSI_RESOURCE_CNT");
+
+static const char * const psi_proc_files[] = {
+	"/proc/pressure/cpu",
+	"/proc/pressure/memory",
+	"/proc/pressure/io",
+};
+static_assert(ARRAY_SIZE(psi_proc_files) == ADAPTIVED_PSI_RESOURCE_CNT,
+	      "psi_proc_files[] must be same length as ADAPTIVED_PSI_RESOURCE_CNT");
+
+API int adaptived_get_psi_vector(const char * const cgroup, struct adaptived_psi_vector * const vec)
+{
+	char path[FILENAME_MAX];
+	const char *file;
+	int ret, i;
+
+	if (!vec)
+		return -EINVAL;
+
+	memset(vec, 0, sizeof(struct adaptived_psi_vector));
+
+	for (i = 0; i < ADAPTIVED_PSI_RESOURCE_CNT; i++) {
+		if (cgroup) {
+			ret = snprintf(path, sizeof(path), "%s/%s", cgroup, psi_resource_files[i]);
+			if (ret < 0 || ret >= (int)sizeof(path))
+				return -ENAMETOOLONG;
+
+			file = path;
+		} else {
+			file = psi_proc_files[i];
+		}
+
+		ret = adaptived_get_pressure(file, &vec->res[i]);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+/*
+ * Prepare a window that is window milliseconds long.  The samples are expected
+ * roughly every interval milliseconds, but the window grows as needed
+ */
+int psi_window_init(struct psi_window * const win, int window, int interval)
+{
+	if (!win || window <= 0)
+		return -EINVAL;
+
+	memset(win, 0, sizeof(struct psi_window));
+	win->window = window;
+
+	/* one sample at each end of the window, plus one for jitter */
+	win->size = window / max(interval, 1) + 2;
+
+	win->time = malloc(sizeof(long long) * win->size);
+	win->total = malloc(sizeof(long long) * win->size);
+	if (!win->time || !win->total) {
+		psi_window_free(win);
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static int psi_window_grow(struct psi_window * const win)
+{
+	long long *time, *total;
+	int i, size;
+
+	size = win->size * 2;
+	time = malloc(sizeof(long long) * size);
+	total = malloc(sizeof(long long) * size);
+	if (!time || !total) {
+		free(time);
+		free(total);
+		return -ENOMEM;
+	}
+
+	/* unroll the ring so that the oldest sample is at index 0 */
+	for (i = 0; i < win->cnt; i++) {
+		time[i] = win->time[(win->head + i) % win->size];
+		total[i] = win->total[(win->head + i) % win->size];
+	}
+
+	free(win->time);
+	free(win->total);
+	win->time = time;
+	win->total = total;
+	win->size = size;
+	win->head = 0;
+
+	return 0;
+}
+
+/*
+ * Add a sample of a PSI total (in microseconds) taken at time (in milliseconds on
+ * any monotonic clock).  Returns 1 and sets *pct to the percentage of time spent
+ * stalled over the last window, or 0 if the samples do not yet span the window.
+ *
+ * The oldest sample kept is the newest one that is at least window milliseconds
+ * old, so the percentage covers at least the window and at most the window plus
+ * one sampling interval
+ */
+int psi_window_add(struct psi_window * const win, long long time, long long total,
+		   float * const pct)
+{
+	long long elapsed, stalled;
+	int ret, second, tail;
+
+	if (!win || !pct)
+		return -EINVAL;
+
+	if (win->cnt > 0) {
+		tail = (win->head + win->cnt - 1) % win->size;
+
+		if (total < win->total[tail] || time < win->time[tail])
+			/* the counter or the clock went backwards.  start over */
+			win->cnt = 0;
+	}
+
+	if (win->cnt == win->size) {
+		ret = psi_window_grow(win);
+		if (ret)
+			return ret;
+	}
+
+	tail = (win->head + win->cnt) % win->size;
+	win->time[tail] = time;
+	win->total[tail] = total;
+	win->cnt++;
+
+	/* drop the samples that are no longer needed to span the window */
+	while (win->cnt > 2) {
+		second = (win->head + 1) % win->size;
+		if (time - win->time[second] < win->window)
+			break;
+
+		win->head = second;
+		win->cnt--;
+	}
+
+	elapsed = time - win->time[win->head];
+	if (win->cnt < 2 || elapsed < win->window)
+		return 0;
+
+	stalled = total - win->total[win->head];
+
+	/* the totals are in microseconds, and the times are in milliseconds */
+	*pct = (float)stalled / (float)(elapsed * 1000) * 100.0f;
+
+	return 1;
+}
+
+void psi_window_free(struct psi_window * const win)
+{
+	if (!win)
+		return;
+
+	free(win->time);
+	free(win->total);
+	win->time = NULL;
+	win->total = NULL;
+	win->size = 0;
+	win->cnt = 0;
+}
+
+API int adaptived_pressure_trigger_open(const char * const pressure_file, bool full,
+				     long long stall_us, long long window_us, int * const fd)
+{
+	char trigger[64];
+	struct statfs sfs;
+	int ret, len;
+	int tfd = -1;
+
+	if (!pressure_file || !fd)
+		return -EINVAL;
+	if (window_us < ADAPTIVED_PRESSURE_TRIGGER_MIN_WINDOW_US ||
+	    window_us > ADAPTIVED_PRESSURE_TRIGGER_MAX_WINDOW_US)
+		return -EINVAL;
+	if (stall_us <= 0 || stall_us > window_us)
+		return -EINVAL;
+
+	tfd = open(pressure_file, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+	if (tfd < 0) {
+		ret = -errno;
+		goto error;
+	}
+
+	/*
+	 * Writing a trigger to a regular file would succeed, but the file would never
+	 * raise POLLPRI
+	 */
+	if (fstatfs(tfd, &sfs) < 0) {
+		ret = -errno;
+		goto error;
+	}
+	if (sfs.f_type != PROC_SUPER_MAGIC && sfs.f_type != CGROUP2_SUPER_MAGIC) {
+		ret = -EOPNOTSUPP;
+		goto error;
+	}
+
+	len = snprintf(trigger, sizeof(trigger), "%s %lld %lld", full ? "full" : "some",
+		       stall_us, window_us);
+
+	/* the kernel expects the trigger to be NUL terminated */
+	if (write(tfd, trigger, len + 1) < 0) {
+		ret = -errno;
+		adaptived_err("Failed to write PSI trigger \"%s\" to %s: %d\n", trigger,
+			      pressure_file, ret);
+		goto error;
+	}
+
+	*fd = tfd;
+	return 0;
+
+error:
+	if (tfd >= 0)
+		close(tfd);
+
+	return ret;
+}
+
+API int adaptived_pressure_trigger_check(int fd)
+{
+	struct pollfd pfd;
+	int ret;
+
+	if (fd < 0)
+		return -EINVAL;
+
+	memset(&pfd, 0, sizeof(pfd));
+	pfd.fd = fd;
+	pfd.events = POLLPRI;
+
+	do {
+		ret = poll(&pfd, 1, 0);
+	} while (ret < 0 && errno == EINTR);
+
+	if (ret < 0)
+		return -errno;
+	if (ret == 0)
+		return 0;
+
+	if (pfd.revents & (POLLERR | POLLNVAL))
+		return -ENODEV;
+	if (pfd.revents & POLLPRI)
+		return 1;
+
+	return 0;
+}
+
+struct psi_scan_cgroup {
+	char *path;
+	struct adaptived_pressure_snapshot ps;
+};
+
+struct adaptived_psi_scan {
+	int refcnt;		/* accessed atomically */
+	int cnt;		/* in walk order */
+	int size;
+	struct psi_scan_cgroup *cgroups;
+};
+
+/* the arguments of a scan, which are also the key of the shared scan */
+struct psi_scan_args {
+	const char *root;
+	enum adaptived_psi_resource_enum res;
+	int max_depth;
+};
+
+static void psi_scan_free(struct adaptived_psi_scan ** scan)
+{
+	int i;
+
+	if (!scan || !(*scan))
+		return;
+
+	for (i = 0; i < (*scan)->cnt; i++)
+		free((*scan)->cgroups[i].path);
+	if ((*scan)->cgroups)
+		free((*scan)->cgroups);
+
+	free(*scan);
+	(*scan) = NULL;
+}
+
+static int psi_scan_append(struct adaptived_psi_scan * const scan, char * const path,
+			   enum adaptived_psi_resource_enum res)
+{
+	char pressure_path[FILENAME_MAX];
+	struct psi_scan_cgroup *cgroups;
+	int ret, size;
+
+	if (scan->cnt == scan->size) {
+		size = scan->size ? scan->size * 2 : 16;
+
+		cgroups = realloc(scan->cgroups, sizeof(struct psi_scan_cgroup) * size);
+		if (!cgroups)
+			return -ENOMEM;
+
+		scan->cgroups = cgroups;
+		scan->size = size;
+	}
+
+	ret = snprintf(pressure_path, sizeof(pressure_path), "%s/%s", path,
+		       psi_resource_files[res]);
+	if (ret < 0 || ret >= (int)sizeof(pressure_path))
+		return -ENAMETOOLONG;
+
+	ret = adaptived_get_pressure(pressure_path, &scan->cgroups[scan->cnt].ps);
+	if (ret)
+		return ret;
+
+	scan->cgroups[scan->cnt].path = path;
+	scan->cnt++;
+
+	return 0;
+}
+
+/*
+ * Scan the cgroups in the persistent tree index, so the directories don't have to be
+ * read again
+ */
+static int psi_scan_tree(struct adaptived_psi_scan * const scan,
+			 const struct adaptived_cgroup_tree * const tree, const char * const root,
+			 enum adaptived_psi_resource_enum res, int max_depth)
+{
+	struct adaptived_cgroup_tree_node *node = NULL;
+	bool list_root = true;
+	int ret = 0;
+	char *path;
+	size_t len;
+
+	/* like adaptived_path_walk_start(), "/foo/\*" doesn't list /foo itself */
+	len = strlen(root);
+	if (len >= 2 && root[len - 1] == '*' && root[len - 2] == '/')
+		list_root = false;
+
+	while ((node = adaptived_cgroup_tree_next(tree, node, max_depth))) {
+		if (!list_root && adaptived_cgroup_tree_node_depth(node) == 0)
+			continue;
+
+		path = strdup(adaptived_cgroup_tree_node_path(node));
+		if (!path) {
+			ret = -ENOMEM;
+			break;
+		}
+
+		ret = psi_scan_append(scan, path, res);
+		if (ret) {
+			free(path);
+			break;
+		}
+	}
+
+	return ret;
+}
+
+static int psi_scan_create(const char * const root, enum adaptived_psi_resource_enum res,
+			   int max_depth, bool use_tree, struct adaptived_psi_scan ** const scanp)
+{
+	struct adaptived_path_walk_handle *handle = NULL;
+	struct adaptived_cgroup_tree *tree = NULL;
+	struct adaptived_psi_scan *scan;
+	char *path = NULL;
+	int ret;
+
+	scan = malloc(sizeof(struct adaptived_psi_scan));
+	if (!scan)
+		return -ENOMEM;
+
+	memset(scan, 0, sizeof(struct adaptived_psi_scan));
+	scan->refcnt = 1;
+
+	if (use_tree) {
+		ret = adaptived_get_cgroup_tree(root, &tree);
+		if (ret == 0) {
+			ret = psi_scan_tree(scan, tree, root, res, max_depth);
+			adaptived_cgroup_tree_put(&tree);
+			if (ret)
+				goto error;
+
+			*scanp = scan;
+			return 0;
+		}
+
+		/* e.g. the inotify watch limit was reached.  Walk the tree instead */
+		adaptived_dbg("Failed to index cgroup tree %s: %d\n", root, ret);
+	}
+
+	ret = adaptived_path_walk_start(root, &handle, ADAPTIVED_PATH_WALK_LIST_DIRS, max_depth);
+	if (ret)
+		goto error;
+
+	do {
+		ret = adaptived_path_walk_next(&handle, &path);
+		if (ret)
+			goto error;
+		if (!path)
+			/* We've reached the end of the tree */
+			break;
+
+		ret = psi_scan_append(scan, path, res);
+		if (ret)
+			goto error;
+
+		/* the scan owns the path now */
+		path = NULL;
+	} while (true);
+
+	adaptived_path_walk_end(&handle);
+	*scanp = scan;
+
+	return 0;
+
+error:
+	adaptived_path_walk_end(&handle);
+	if (path)
+		free(path);
+	psi_scan_free(&scan);
+
+	return ret;
+}
+
+static int psi_scan_cache_create(const void * const arg, void ** const obj)
+{
+	const struct psi_scan_args *args = arg;
+	struct adaptived_psi_scan *scan;
+	int ret;
+
+	ret = psi_scan_create(args->root, args->res, args->max_depth, read_cache_version() != 0,
+			      &scan);
+	if (ret)
+		return ret;
+
+	*obj = scan;
+
+	return 0;
+}
+
+static void psi_scan_cache_get(void * const obj)
+{
+	struct adaptived_psi_scan *scan = obj;
+
+	__atomic_add_fetch(&scan->refcnt, 1, __ATOMIC_RELAXED);
+}
+
+static void psi_scan_cache_put(void * const obj)
+{
+	struct adaptived_psi_scan *scan = obj;
+
+	adaptived_psi_scan_put(&scan);
+}
+
+static const struct pass_cache_ops psi_scan_cache_ops = {
+	.create = psi_scan_cache_create,
+	.get = psi_scan_cache_get,
+	.put = psi_scan_cache_put,
+};
+
+/* the most recent scan of each tree */
+static struct pass_cache psi_scan_cache = PASS_CACHE_INIT(&psi_scan_cache_ops);
+
+API int adaptived_get_psi_scan(const char * const cgroup, enum adaptived_psi_resource_enum res,
+			       int max_depth, struct adaptived_psi_scan ** const scan)
+{
+	struct psi_scan_args args = {
+		.root = cgroup,
+		.res = res,
+		.max_depth = max_depth,
+	};
+	char key[FILENAME_MAX];
+	void *obj;
+	int ret;
+
+	if (!cgroup || !scan || res < 0 || res >= ADAPTIVED_PSI_RESOURCE_CNT)
+		return -EINVAL;
+
+	ret = snprintf(key, sizeof(key), "%d/%d/%s", res, max_depth, cgroup);
+	if (ret < 0 || ret >= (int)sizeof(key))
+		return -ENAMETOOLONG;
+
+	ret = pass_cache_get(&psi_scan_cache, key, &args, &obj);
+	if (ret)
+		return ret;
+
+	*scan = obj;
+
+	return 0;
+}
+
+API void adaptived_psi_scan_put(struct adaptived_psi_scan ** const scan)
+{
+	if (!scan || !(*scan))
+		return;
+
+	if (__atomic_sub_fetch(&(*scan)->refcnt, 1, __ATOMIC_ACQ_REL) == 0)
+		psi_scan_free(scan);
+
+	(*scan) = NULL;
+}
+
+/*
+ * Release the shared scans.  Scans that are still referenced are freed when their
+ * last reference is put
+ */
+void psi_scan_flush(void)
+{
+	pass_cache_flush(&psi_scan_cache);
+}
+
+API int adaptived_psi_scan_count(const struct adaptived_psi_scan * const scan)
+{
+	if (!scan)
+		return -EINVAL;
+
+	return scan->cnt;
+}
+
+/* the scan can only rank cgroups by the avg measurements */
+static bool psi_scan_meas_valid(enum adaptived_pressure_meas_enum meas)
+{
+	return meas >= 0 && meas < PRESSURE_MEAS_CNT && meas != PRESSURE_SOME_TOTAL &&
+	       meas != PRESSURE_FULL_TOTAL;
+}
+
+API int adaptived_psi_scan_top(const struct adaptived_psi_scan * const scan,
+			       enum adaptived_pressure_meas_enum meas, bool lowest,
+			       enum adaptived_psi_scan_tie_enum tie,
+			       struct adaptived_psi_scan_entry * const top, int top_cnt)
+{
+	bool last_walked = (tie == ADAPTIVED_PSI_SCAN_TIE_LAST_WALKED);
+	int ret, i, j, cnt = 0;
+	float value, key, prev;
+
+	if (!scan || !top || top_cnt <= 0 || !psi_scan_meas_valid(meas))
+		return -EINVAL;
+	if (tie < 0 || tie >= ADAPTIVED_PSI_SCAN_TIE_CNT)
+		return -EINVAL;
+
+	for (i = 0; i < scan->cnt; i++) {
+		ret = snapshot_avg(&scan->cgroups[i].ps, meas, &value);
+		if (ret)
+			return ret;
+
+		/* rank by key, highest first */
+		key = lowest ? -value : value;
+
+		if (cnt == top_cnt) {
+			prev = lowest ? -top[cnt - 1].value : top[cnt - 1].value;
+			if (key < prev || (key == prev && !last_walked))
+				continue;
+		}
+
+		/*
+		 * insertion sort into the top list.  Unless the last walked cgroup wins ties,
+		 * a cgroup stops behind the ones it ties with, so walk order is kept
+		 */
+		j = cnt < top_cnt ? cnt++ : cnt - 1;
+		for (; j > 0; j--) {
+			prev = lowest ? -top[j - 1].value : top[j - 1].value;
+			if (prev > key || (prev == key && !last_walked))
+				break;
+			top[j] = top[j - 1];
+		}
+
+		top[j].cgroup = scan->cgroups[i].path;
+		top[j].value = value;
+	}
+
+	return cnt;
+}
+
+API int adaptived_psi_scan_max(const struct adaptived_psi_scan * const scan,
+			       enum adaptived_pressure_meas_enum meas,
+			       struct adaptived_psi_scan_entry * const max)
+{
+	int ret;
+
+	ret = adaptived_psi_scan_top(scan, meas, false, ADAPTIVED_PSI_SCAN_TIE_FIRST_WALKED, max, 1);
+	if (ret < 0)
+		return ret;
+	if (ret == 0)
+		return -ENOENT;
+
+	return 0;
+}
+
+API int adaptived_psi_scan_above(const struct adaptived_psi_scan * const scan,
+				 enum adaptived_pressure_meas_enum meas, float threshold,
+				 struct adaptived_psi_scan_entry * const above, int above_cnt)
+{
+	int ret, i, cnt = 0;
+	float value;
+
+	if (!scan || (!above && above_cnt > 0) || above_cnt < 0 || !psi_scan_meas_valid(meas))
+		return -EINVAL;
+
+	for (i = 0; i < scan->cnt; i++) {
+		ret = snapshot_avg(&scan->cgroups[i].ps, meas, &value);
+		if (ret)
+			return ret;
+
+		if (value <= threshold)
+			continue;
+
+		if (cnt < above_cnt) {
+			above[cnt].cgroup = scan->cgroups[i].path;
+			above[cnt].value = value;
+		}
+		cnt++;
+	}
+
+	return cnt;
+}
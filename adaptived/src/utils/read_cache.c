@@ -0,0 +1,503 @@
+/*
+ * Copyright (c) 2024, Oracle and/or its affiliates.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+/**
+ * Per-pass snapshot of the files read by the causes and effects
+ *
+ * Within a single pass through the main loop, many causes and effects read
+ * the same procfs and cgroupfs files, e.g. /proc/meminfo or a cgroup's
+ * memory.pressure.  While a rule is being run, the file helpers in src/utils
+ * read through this cache, so a file is opened and read at most once per
+ * pass and later reads are served from memory.  Helpers that understand a
+ * file's format can also cache the parsed form of the file, so that it is
+ * only parsed once per pass.
+ *
+ * The cache is only used by threads that are running a rule.  Callers outside
+ * of the main loop (e.g. users of the library's utility functions) always read
+ * the file.  The cache is invalidated at the start of every pass, when the
+ * injection function is invoked, and a file's entry is dropped when it is
+ * written via a helper, so a rule always sees its own writes.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+
+#include <adaptived.h>
+
+#include "adaptived-internal.h"
+
+#define READ_CACHE_BUCKETS 64
+/* entries that have not been used for this many passes are freed */
+#define READ_CACHE_MAX_IDLE 16
+/* files that fit in this many bytes are parsed from the stack when no cache is attached */
+#define READ_CACHE_STACK_BUF 4096
+
+struct read_cache_entry {
+	char *path;
+	pthread_mutex_t lock;
+
+	/* the following fields are protected by the entry's lock */
+	unsigned long gen; /* the generation the contents were read in.  0 if stale */
+	int err;
+	char *buf;
+	size_t len;
+	size_t size;
+
+	read_cache_parse_fn parse_fn; /* the parser that produced parsed, if any */
+	void *parsed;
+	size_t parsed_size;
+	int parse_ret;
+
+	/* the following fields are protected by the cache's lock */
+	unsigned long last_pass;
+	struct read_cache_entry *next;
+};
+
+struct read_cache {
+	pthread_mutex_t lock;
+	unsigned long gen;
+	unsigned long pass;
+	unsigned long version; /* unique across every cache.  changes when gen does */
+	struct read_cache_entry *buckets[READ_CACHE_BUCKETS];
+};
+
+static unsigned long next_version;
+
+/* the cache used by this thread.  only set while a rule is being run */
+static __thread struct read_cache *thread_cache;
+
+static unsigned int hash_path(const char * const path)
+{
+	unsigned int hash = 2166136261u;
+	const char *c;
+
+	/* FNV-1a */
+	for (c = path; *c; c++) {
+		hash ^= (unsigned char)*c;
+		hash *= 16777619u;
+	}
+
+	return hash % READ_CACHE_BUCKETS;
+}
+
+static void entry_free(struct read_cache_entry ** entry)
+{
+	if (!entry || !(*entry))
+		return;
+
+	pthread_mutex_destroy(&(*entry)->lock);
+
+	if ((*entry)->path)
+		free((*entry)->path);
+	if ((*entry)->buf)
+		free((*entry)->buf);
+	if ((*entry)->parsed)
+		free((*entry)->parsed);
+
+	free(*entry);
+	(*entry) = NULL;
+}
+
+/*
+ * Find the entry for path, or create it if it doesn't exist, and return it with
+ * its lock held.  The entry's contents are read in if they are stale
+ */
+static struct read_cache_entry *entry_get(struct read_cache * const cache,
+					  const char * const path)
+{
+	struct read_cache_entry *entry;
+	unsigned int bucket;
+	unsigned long gen;
+
+	bucket = hash_path(path);
+
+	pthread_mutex_lock(&cache->lock);
+
+	for (entry = cache->buckets[bucket]; entry; entry = entry->next) {
+		if (strcmp(entry->path, path) == 0)
+			break;
+	}
+
+	if (!entry) {
+		entry = malloc(sizeof(struct read_cache_entry));
+		if (!entry) {
+			pthread_mutex_unlock(&cache->lock);
+			return NULL;
+		}
+
+		memset(entry, 0, sizeof(struct read_cache_entry));
+
+		entry->path = strdup(path);
+		if (!entry->path) {
+			pthread_mutex_unlock(&cache->lock);
+			free(entry);
+			return NULL;
+		}
+
+		pthread_mutex_init(&entry->lock, NULL);
+
+		entry->next = cache->buckets[bucket];
+		cache->buckets[bucket] = entry;
+	}
+
+	entry->last_pass = cache->pass;
+	gen = cache->gen;
+
+	pthread_mutex_lock(&entry->lock);
+	pthread_mutex_unlock(&cache->lock);
+
+	if (entry->gen != gen) {
+		entry->err = fd_cache_read(path, &entry->buf, &entry->len, &entry->size);
+		entry->parse_fn = NULL;
+		entry->gen = gen;
+	}
+
+	return entry;
+}
+
+struct read_cache *read_cache_create(void)
+{
+	struct read_cache *cache;
+
+	cache = malloc(sizeof(struct read_cache));
+	if (!cache)
+		return NULL;
+
+	memset(cache, 0, sizeof(struct read_cache));
+
+	pthread_mutex_init(&cache->lock, NULL);
+	cache->gen = 1;
+	cache->version = __atomic_add_fetch(&next_version, 1, __ATOMIC_RELAXED);
+
+	return cache;
+}
+
+void read_cache_destroy(struct read_cache ** cache)
+{
+	struct read_cache_entry *entry, *next;
+	int i;
+
+	if (!cache || !(*cache))
+		return;
+
+	for (i = 0; i < READ_CACHE_BUCKETS; i++) {
+		entry = (*cache)->buckets[i];
+
+		while (entry) {
+			next = entry->next;
+			entry_free(&entry);
+			entry = next;
+		}
+	}
+
+	pthread_mutex_destroy(&(*cache)->lock);
+
+	free(*cache);
+	(*cache) = NULL;
+}
+
+/*
+ * Start a new pass.  Every entry becomes stale, and entries that haven't been
+ * used recently are freed.  This must not be called while a rule is running
+ */
+void read_cache_begin_pass(struct read_cache * const cache)
+{
+	struct read_cache_entry **entryp, *entry;
+	int i;
+
+	pthread_mutex_lock(&cache->lock);
+
+	cache->gen++;
+	cache->pass++;
+	cache->version = __atomic_add_fetch(&next_version, 1, __ATOMIC_RELAXED);
+
+	for (i = 0; i < READ_CACHE_BUCKETS; i++) {
+		entryp = &cache->buckets[i];
+
+		while (*entryp) {
+			entry = *entryp;
+
+			if (entry->last_pass + READ_CACHE_MAX_IDLE < cache->pass) {
+				*entryp = entry->next;
+				entry_free(&entry);
+			} else {
+				entryp = &entry->next;
+			}
+		}
+	}
+
+	pthread_mutex_unlock(&cache->lock);
+}
+
+/*
+ * Mark every entry as stale.  Unlike read_cache_begin_pass(), this may be called
+ * while rules are running
+ */
+void read_cache_invalidate(struct read_cache * const cache)
+{
+	pthread_mutex_lock(&cache->lock);
+	cache->gen++;
+	cache->version = __atomic_add_fetch(&next_version, 1, __ATOMIC_RELAXED);
+	pthread_mutex_unlock(&cache->lock);
+}
+
+/*
+ * Return an identifier for the current contents of the attached cache, or 0 if no
+ * cache is attached.  It changes whenever the cache is invalidated, so it can be
+ * used to share data that is too large for read_cache_parse() within a pass
+ */
+unsigned long read_cache_version(void)
+{
+	unsigned long version;
+
+	if (!thread_cache)
+		return 0;
+
+	pthread_mutex_lock(&thread_cache->lock);
+	version = thread_cache->version;
+	pthread_mutex_unlock(&thread_cache->lock);
+
+	return version;
+}
+
+void read_cache_attach(struct read_cache * const cache)
+{
+	thread_cache = cache;
+}
+
+void read_cache_detach(void)
+{
+	thread_cache = NULL;
+}
+
+/*
+ * Drop the cached contents of a file.  This must be called after a file is
+ * written, so that later reads in the same pass see the new contents
+ */
+void read_cache_drop(const char * const path)
+{
+	struct read_cache_entry *entry;
+	unsigned int bucket;
+
+	if (!thread_cache || !path)
+		return;
+
+	bucket = hash_path(path);
+
+	pthread_mutex_lock(&thread_cache->lock);
+
+	for (entry = thread_cache->buckets[bucket]; entry; entry = entry->next) {
+		if (strcmp(entry->path, path) == 0) {
+			pthread_mutex_lock(&entry->lock);
+			entry->gen = 0;
+			pthread_mutex_unlock(&entry->lock);
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&thread_cache->lock);
+}
+
+/*
+ * Copy up to size bytes of the file into buf.  Returns the number of bytes copied
+ * or a negative errno
+ */
+ssize_t read_cache_read(const char * const path, char * const buf, size_t size)
+{
+	struct read_cache_entry *entry;
+	ssize_t ret;
+
+	if (!path || !buf)
+		return -EINVAL;
+
+	if (!thread_cache)
+		return fd_cache_pread(path, buf, size);
+
+	entry = entry_get(thread_cache, path);
+	if (!entry)
+		return -ENOMEM;
+
+	if (entry->err) {
+		ret = entry->err;
+		goto out;
+	}
+
+	ret = entry->len < size ? entry->len : size;
+	memcpy(buf, entry->buf, ret);
+
+out:
+	pthread_mutex_unlock(&entry->lock);
+
+	return ret;
+}
+
+/*
+ * fmemopen() with a NULL buffer allocates a buffer that is freed by fclose(), so
+ * the caller can treat this stream like any other
+ */
+static FILE *open_stream(const char * const buf, size_t len)
+{
+	FILE *fp;
+
+	fp = fmemopen(NULL, len + 1, "w+");
+	if (!fp)
+		return NULL;
+
+	if (fwrite(buf, 1, len, fp) != len) {
+		fclose(fp);
+		errno = EIO;
+		return NULL;
+	}
+
+	rewind(fp);
+
+	return fp;
+}
+
+/*
+ * Open the file for reading.  The returned stream reads from a private copy of
+ * the file's contents.  On failure, NULL is returned and errno is set
+ */
+FILE *read_cache_fopen(const char * const path)
+{
+	struct read_cache_entry *entry;
+	size_t len, size = 0;
+	char *buf = NULL;
+	FILE *fp = NULL;
+	int ret;
+
+	if (!thread_cache) {
+		ret = fd_cache_read(path, &buf, &len, &size);
+		if (ret == 0)
+			fp = open_stream(buf, len);
+
+		if (buf)
+			free(buf);
+		if (ret)
+			errno = -ret;
+
+		return fp;
+	}
+
+	entry = entry_get(thread_cache, path);
+	if (!entry) {
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	if (entry->err) {
+		ret = entry->err;
+		goto out;
+	}
+
+	fp = open_stream(entry->buf, entry->len);
+	ret = fp ? 0 : -errno;
+
+out:
+	pthread_mutex_unlock(&entry->lock);
+
+	if (ret)
+		errno = -ret;
+
+	return fp;
+}
+
+/*
+ * Parse the file with parse_fn and copy the parsed result into out.  If a cache
+ * is in use, the parsed result is cached as well, so each file is parsed at
+ * most once per pass.  Returns a negative errno if the file couldn't be read,
+ * otherwise the return value of parse_fn
+ */
+int read_cache_parse(const char * const path, read_cache_parse_fn parse_fn,
+		     void * const out, size_t out_size)
+{
+	char stack_buf[READ_CACHE_STACK_BUF];
+	struct read_cache_entry *entry;
+	size_t len, size = 0;
+	char *buf = NULL;
+	ssize_t bytes;
+	int ret;
+
+	if (!path || !parse_fn || !out)
+		return -EINVAL;
+
+	if (!thread_cache) {
+		/* most of the parsed files (e.g. PSI) are small, so try to avoid a malloc() */
+		bytes = fd_cache_pread(path, stack_buf, sizeof(stack_buf) - 1);
+		if (bytes < 0)
+			return bytes;
+
+		if ((size_t)bytes < sizeof(stack_buf) - 1) {
+			stack_buf[bytes] = '\0';
+			return (*parse_fn)(stack_buf, bytes, out);
+		}
+
+		ret = fd_cache_read(path, &buf, &len, &size);
+		if (ret == 0)
+			ret = (*parse_fn)(buf, len, out);
+
+		if (buf)
+			free(buf);
+
+		return ret;
+	}
+
+	entry = entry_get(thread_cache, path);
+	if (!entry)
+		return -ENOMEM;
+
+	if (entry->err) {
+		ret = entry->err;
+		goto out;
+	}
+
+	if (entry->parse_fn != parse_fn || entry->parsed_size != out_size) {
+		if (entry->parsed_size != out_size) {
+			if (entry->parsed)
+				free(entry->parsed);
+
+			entry->parsed_size = 0;
+			entry->parsed = malloc(out_size);
+			if (!entry->parsed) {
+				entry->parse_fn = NULL;
+				ret = -ENOMEM;
+				goto out;
+			}
+
+			entry->parsed_size = out_size;
+		}
+
+		entry->parse_ret = (*parse_fn)(entry->buf, entry->len, entry->parsed);
+		entry->parse_fn = parse_fn;
+	}
+
+	ret = entry->parse_ret;
+	memcpy(out, entry->parsed, out_size);
+
+out:
+	pthread_mutex_unlock(&entry->lock);
+
+	return ret;
+}
@@ -25,9 +25,12 @@
  *
  */
 #include <string.h>
+#include <stdlib.h>
+#include <limits.h>
 #include <stdio.h>
 #include <errno.h>
 #include <ctype.h>
+#include <time.h>
 
 #include <adaptived-utils.h>
 #include <adaptived.h>
@@ -52,10 +55,11 @@ static unsigned long cpumask_to_hex(char * p) {
 	return strtoul(dst, NULL, 16);
 }
 
-static int adaptived_get_schedstat_cpu(char * token, struct adaptived_schedstat_cpu * const ss_cpu)
+static int adaptived_get_schedstat_cpu(char * token, char ** const saveptr,
+				       struct adaptived_schedstat_cpu * const ss_cpu)
 {
 	enum adaptived_schedstat_cpu_enum i;
-	for (i = 1; token != NULL; i++, token = strtok(NULL, " ")) {
+	for (i = 1; token != NULL; i++, token = strtok_r(NULL, " ", saveptr)) {
 		switch (i) {
 		case SCHEDSTAT_YLD_DEFUNCT ... SCHEDSTAT_GOIDLE_DEFUNCT:
 			/*
@@ -85,15 +89,16 @@ static int adaptived_get_schedstat_cpu(char * token, struct adaptived_schedstat_
 	return 0;
 }
 
-static int adaptived_get_schedstat_domain(char * token, struct adaptived_schedstat_domain *ss_domain)
+static int adaptived_get_schedstat_domain(char * token, char ** const saveptr,
+					  struct adaptived_schedstat_domain *ss_domain)
 {
 	enum adaptived_schedstat_domain_enum i;
 	enum cpu_idle_type_enum cpu_type;
 
 	ss_domain->cpumask = cpumask_to_hex(token);
 
-	token = strtok(NULL, " ");
-	for (i = 0; token != NULL; i++, token = strtok(NULL, " ")) {
+	token = strtok_r(NULL, " ", saveptr);
+	for (i = 0; token != NULL; i++, token = strtok_r(NULL, " ", saveptr)) {
 		if (i < CPU_MAX_IDLE_TYPES * 8) {
 			cpu_type = i / 8;
 			switch (i % 8) {
@@ -160,7 +165,7 @@ static int adaptived_get_schedstat_domain(char * token, struct adaptived_schedst
 API int adaptived_get_schedstat(const char * const schedstat_file, struct adaptived_schedstat_snapshot * const ss)
 {
 	FILE *fp;
-        char *line = NULL, *token = NULL;
+        char *line = NULL, *token = NULL, *saveptr = NULL;
         size_t len = 0;
         ssize_t nread;
 	int ret = 0, cpu = -1, domain = -1, max_domain = 0;
@@ -168,7 +173,7 @@ API int adaptived_get_schedstat(const char * const schedstat_file, struct adapti
 	if (!schedstat_file || !ss)
 		return -EINVAL;
 
-        fp = fopen(schedstat_file, "r");
+        fp = read_cache_fopen(schedstat_file);
         if (fp == NULL) {
 		adaptived_err("Failed to open schedstat file: %s\n", schedstat_file);
 		return -EINVAL;
@@ -181,7 +186,7 @@ API int adaptived_get_schedstat(const char * const schedstat_file, struct adapti
 			if (-1 != cpu)
 				ss->schedstat_cpus[cpu].nr_domains = max_domain + 1;
 
-			token = strtok(line, " ");
+			token = strtok_r(line, " ", &saveptr);
 			cpu = atoi(token + 3);
 			if (cpu < 0 || cpu >= MAX_NR_CPUS) {
 				adaptived_err("CPU# must be a nonzero integer less than %d\n", MAX_NR_CPUS);
@@ -189,7 +194,8 @@ API int adaptived_get_schedstat(const char * const schedstat_file, struct adapti
 				goto error;
 			}
 
-			ret = adaptived_get_schedstat_cpu(strtok(NULL, " "), &ss->schedstat_cpus[cpu]);
+			ret = adaptived_get_schedstat_cpu(strtok_r(NULL, " ", &saveptr), &saveptr,
+							  &ss->schedstat_cpus[cpu]);
 			if (ret) {
 				adaptived_err("adaptived_get_schedstat_cpu() failed\n");
 				goto error;
@@ -198,7 +204,7 @@ API int adaptived_get_schedstat(const char * const schedstat_file, struct adapti
 			if (cpu < 0)
 				continue;
 
-			token = strtok(line, " ");
+			token = strtok_r(line, " ", &saveptr);
 			domain = atoi(token + 6);
 			if (domain < 0 || domain >= MAX_DOMAIN_LEVELS) {
 				adaptived_err("Domain# must be a nonzero integer less than %d\n", MAX_DOMAIN_LEVELS);
@@ -206,14 +212,15 @@ API int adaptived_get_schedstat(const char * const schedstat_file, struct adapti
 				goto error;
 			}
 			max_domain = max(domain, max_domain);
-			ret = adaptived_get_schedstat_domain(strtok(NULL, " "), &ss->schedstat_cpus[cpu].schedstat_domains[domain]);
+			ret = adaptived_get_schedstat_domain(strtok_r(NULL, " ", &saveptr), &saveptr,
+					&ss->schedstat_cpus[cpu].schedstat_domains[domain]);
 			if (ret) {
 				adaptived_err("adaptived_get_schedstat_domain() failed\n");
 				goto error;
 			}
 		} else if (0 == strncmp(line, "timestamp", 9)) {
-			token = strtok(line, " ");
-			token = strtok(NULL, " ");
+			token = strtok_r(line, " ", &saveptr);
+			token = strtok_r(NULL, " ", &saveptr);
 			ss->timestamp = strtoll(token, NULL, 10);
 		}
         }
@@ -228,3 +235,216 @@ error:
 
 	return ret;
 }
+
+static void schedstat_cpus_set_arrays(struct adaptived_schedstat_cpus * const ss)
+{
+	unsigned long long *ull = (unsigned long long *)&ss[1];
+
+	ss->ttwu = ull;
+	ss->ttwu_local = &ull[ss->max_cpus];
+	ss->run_time = &ull[ss->max_cpus * 2];
+	ss->run_delay = &ull[ss->max_cpus * 3];
+	ss->nr_timeslices = &ull[ss->max_cpus * 4];
+	ss->cpu = (int *)&ull[ss->max_cpus * 5];
+}
+
+/*
+ * Parse the fields that follow "cpuN" on a schedstat line
+ */
+static int parse_schedstat_cpu_line(const char *c, struct adaptived_schedstat_cpus * const ss,
+				    int idx)
+{
+	enum adaptived_schedstat_cpu_enum i;
+	unsigned long long value;
+	char *endptr;
+
+	for (i = 1; ; i++) {
+		while (*c == ' ')
+			c++;
+		if (*c == '\0' || *c == '\n')
+			break;
+
+		value = strtoull(c, &endptr, 10);
+		if (endptr == c)
+			return -EINVAL;
+		c = endptr;
+
+		switch (i) {
+		case SCHEDSTAT_YLD_DEFUNCT ... SCHEDSTAT_GOIDLE_DEFUNCT:
+			break;
+		case SCHEDSTAT_TTWU:
+			ss->ttwu[idx] = value;
+			break;
+		case SCHEDSTAT_TTWU_LOCAL:
+			ss->ttwu_local[idx] = value;
+			break;
+		case SCHEDSTAT_RUN_TIME:
+			ss->run_time[idx] = value;
+			break;
+		case SCHEDSTAT_RUN_DELAY:
+			ss->run_delay[idx] = value;
+			break;
+		case SCHEDSTAT_NR_TIMESLICES:
+			ss->nr_timeslices[idx] = value;
+			break;
+		default:
+			adaptived_err("Invalid entry#: %d\n", i);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+API int adaptived_get_schedstat_cpus(const char * const schedstat_file,
+				  struct adaptived_schedstat_cpus ** const ssp)
+{
+	struct adaptived_schedstat_cpus *ss;
+	size_t len, size = 0;
+	char *buf = NULL, *line, *eol;
+	int ret, cpu_cnt = 0, idx = 0;
+	struct timespec now;
+	char *endptr;
+	long cpu;
+
+	if (!schedstat_file || !ssp)
+		return -EINVAL;
+
+	ret = fd_cache_read(schedstat_file, &buf, &len, &size);
+	if (ret) {
+		adaptived_err("Failed to read schedstat file %s: %d\n", schedstat_file, ret);
+		goto out;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	for (line = buf; line; line = strchr(line, '\n')) {
+		if (*line == '\n')
+			line++;
+		if (strncmp(line, "cpu", 3) == 0)
+			cpu_cnt++;
+	}
+
+	ss = *ssp;
+	if (!ss || ss->max_cpus < cpu_cnt) {
+		adaptived_schedstat_cpus_free(ssp);
+
+		ss = malloc(sizeof(struct adaptived_schedstat_cpus) +
+			    (sizeof(unsigned long long) * 5 + sizeof(int)) * cpu_cnt);
+		if (!ss) {
+			ret = -ENOMEM;
+			goto out;
+		}
+
+		memset(ss, 0, sizeof(struct adaptived_schedstat_cpus));
+		ss->max_cpus = cpu_cnt;
+		schedstat_cpus_set_arrays(ss);
+		*ssp = ss;
+	}
+
+	ss->nr_cpus = 0;
+	ss->timestamp = 0;
+	ss->read_ns = now.tv_sec * 1000000000LL + now.tv_nsec;
+
+	for (line = buf; *line; line = eol + 1) {
+		eol = strchr(line, '\n');
+
+		if (strncmp(line, "cpu", 3) == 0 && idx < cpu_cnt) {
+			cpu = strtol(&line[3], &endptr, 10);
+			if (endptr == &line[3] || cpu < 0 || cpu > INT_MAX) {
+				adaptived_err("Invalid schedstat cpu line\n");
+				ret = -EINVAL;
+				goto out;
+			}
+
+			ss->cpu[idx] = cpu;
+			ss->ttwu[idx] = 0;
+			ss->ttwu_local[idx] = 0;
+			ss->run_time[idx] = 0;
+			ss->run_delay[idx] = 0;
+			ss->nr_timeslices[idx] = 0;
+
+			ret = parse_schedstat_cpu_line(endptr, ss, idx);
+			if (ret) {
+				adaptived_err("Invalid schedstat line for cpu%ld\n", cpu);
+				goto out;
+			}
+			idx++;
+		} else if (strncmp(line, "timestamp ", 10) == 0) {
+			ss->timestamp = strtoul(&line[10], NULL, 10);
+		}
+
+		if (!eol)
+			break;
+	}
+
+	ss->nr_cpus = idx;
+
+out:
+	if (buf)
+		free(buf);
+
+	return ret;
+}
+
+API void adaptived_schedstat_cpus_free(struct adaptived_schedstat_cpus ** const ss)
+{
+	if (!ss || !(*ss))
+		return;
+
+	free(*ss);
+	(*ss) = NULL;
+}
+
+API int adaptived_schedstat_diff(const struct adaptived_schedstat_cpus * const prev,
+			      const struct adaptived_schedstat_cpus * const cur,
+			      double * const run_delay_rate, double * const ttwu_rate,
+			      int rate_cnt)
+{
+	double per_sec;
+	int i, j;
+
+	if (!prev || !cur || rate_cnt < cur->nr_cpus)
+		return -EINVAL;
+	if (cur->read_ns <= prev->read_ns)
+		return -EINVAL;
+
+	per_sec = 1000000000.0 / (double)(cur->read_ns - prev->read_ns);
+
+	if (prev->nr_cpus == cur->nr_cpus &&
+	    memcmp(prev->cpu, cur->cpu, sizeof(int) * cur->nr_cpus) == 0) {
+		/* the common case.  these loops are simple enough for the compiler to vectorize */
+		if (run_delay_rate) {
+			for (i = 0; i < cur->nr_cpus; i++)
+				run_delay_rate[i] = (double)(cur->run_delay[i] - prev->run_delay[i]) *
+						    per_sec;
+		}
+		if (ttwu_rate) {
+			for (i = 0; i < cur->nr_cpus; i++)
+				ttwu_rate[i] = (double)(cur->ttwu[i] - prev->ttwu[i]) * per_sec;
+		}
+
+		return 0;
+	}
+
+	/* the cpus have changed.  both snapshots list the cpus in ascending order */
+	for (i = 0, j = 0; i < cur->nr_cpus; i++) {
+		while (j < prev->nr_cpus && prev->cpu[j] < cur->cpu[i])
+			j++;
+
+		if (j < prev->nr_cpus && prev->cpu[j] == cur->cpu[i]) {
+			if (run_delay_rate)
+				run_delay_rate[i] = (double)(cur->run_delay[i] - prev->run_delay[j]) *
+						    per_sec;
+			if (ttwu_rate)
+				ttwu_rate[i] = (double)(cur->ttwu[i] - prev->ttwu[j]) * per_sec;
+		} else {
+			if (run_delay_rate)
+				run_delay_rate[i] = 0.0;
+			if (ttwu_rate)
+				ttwu_rate[i] = 0.0;
+		}
+	}
+
+	return 0;
+}
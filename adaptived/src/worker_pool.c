@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2024, Oracle and/or its affiliates.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+/**
+ * Worker thread pool for adaptived
+ *
+ * A fixed number of worker threads pull jobs from a single bounded FIFO
+ * queue.  The submitter can then wait for every queued job to complete.
+ * adaptived_loop() uses this to evaluate independent rules concurrently.
+ */
+
+#include <pthread.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+
+#include <adaptived.h>
+
+#include "adaptived-internal.h"
+
+#define WORKER_QUEUE_SIZE 256
+
+struct worker_job {
+	worker_fn fn;
+	void *arg;
+};
+
+struct worker_pool {
+	pthread_t *threads;
+	int thread_cnt;
+
+	pthread_mutex_t lock;
+	pthread_cond_t work_cond;	/* a job was queued or the pool is stopping */
+	pthread_cond_t space_cond;	/* a slot in the queue was freed */
+	pthread_cond_t done_cond;	/* all submitted jobs have completed */
+
+	struct worker_job queue[WORKER_QUEUE_SIZE];
+	int head;
+	int queued;
+	int busy;	/* jobs that are queued or running */
+	bool stop;
+};
+
+static void *worker_thread(void *arg)
+{
+	struct worker_pool *pool = arg;
+	struct worker_job job;
+
+	pthread_mutex_lock(&pool->lock);
+
+	while (1) {
+		while (pool->queued == 0 && !pool->stop)
+			pthread_cond_wait(&pool->work_cond, &pool->lock);
+
+		if (pool->queued == 0 && pool->stop)
+			break;
+
+		job = pool->queue[pool->head];
+		pool->head = (pool->head + 1) % WORKER_QUEUE_SIZE;
+		pool->queued--;
+		pthread_cond_signal(&pool->space_cond);
+
+		pthread_mutex_unlock(&pool->lock);
+		(*job.fn)(job.arg);
+		pthread_mutex_lock(&pool->lock);
+
+		pool->busy--;
+		if (pool->busy == 0)
+			pthread_cond_broadcast(&pool->done_cond);
+	}
+
+	pthread_mutex_unlock(&pool->lock);
+
+	return NULL;
+}
+
+struct worker_pool *worker_pool_create(int thread_cnt)
+{
+	struct worker_pool *pool;
+	int ret, i;
+
+	if (thread_cnt < 1)
+		return NULL;
+
+	pool = malloc(sizeof(struct worker_pool));
+	if (!pool)
+		return NULL;
+
+	memset(pool, 0, sizeof(struct worker_pool));
+
+	pool->threads = malloc(sizeof(pthread_t) * thread_cnt);
+	if (!pool->threads)
+		goto error;
+
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->work_cond, NULL);
+	pthread_cond_init(&pool->space_cond, NULL);
+	pthread_cond_init(&pool->done_cond, NULL);
+
+	for (i = 0; i < thread_cnt; i++) {
+		ret = pthread_create(&pool->threads[i], NULL, &worker_thread, pool);
+		if (ret) {
+			adaptived_err("Failed to create worker thread %d: %d\n", i, ret);
+			goto error;
+		}
+
+		pool->thread_cnt++;
+	}
+
+	adaptived_dbg("Created a pool of %d worker threads\n", pool->thread_cnt);
+
+	return pool;
+
+error:
+	worker_pool_destroy(&pool);
+	return NULL;
+}
+
+int worker_pool_thread_cnt(const struct worker_pool * const pool)
+{
+	return pool->thread_cnt;
+}
+
+void worker_pool_submit(struct worker_pool * const pool, worker_fn fn, void * const arg)
+{
+	int tail;
+
+	pthread_mutex_lock(&pool->lock);
+
+	while (pool->queued == WORKER_QUEUE_SIZE)
+		pthread_cond_wait(&pool->space_cond, &pool->lock);
+
+	tail = (pool->head + pool->queued) % WORKER_QUEUE_SIZE;
+	pool->queue[tail].fn = fn;
+	pool->queue[tail].arg = arg;
+	pool->queued++;
+	pool->busy++;
+
+	pthread_cond_signal(&pool->work_cond);
+	pthread_mutex_unlock(&pool->lock);
+}
+
+void worker_pool_wait(struct worker_pool * const pool)
+{
+	pthread_mutex_lock(&pool->lock);
+
+	while (pool->busy > 0)
+		pthread_cond_wait(&pool->done_cond, &pool->lock);
+
+	pthread_mutex_unlock(&pool->lock);
+}
+
+void worker_pool_destroy(struct worker_pool ** pool)
+{
+	int i;
+
+	if (!pool || !(*pool))
+		return;
+
+	if ((*pool)->threads) {
+		pthread_mutex_lock(&(*pool)->lock);
+		(*pool)->stop = true;
+		pthread_cond_broadcast(&(*pool)->work_cond);
+		pthread_mutex_unlock(&(*pool)->lock);
+
+		for (i = 0; i < (*pool)->thread_cnt; i++)
+			pthread_join((*pool)->threads[i], NULL);
+
+		pthread_cond_destroy(&(*pool)->done_cond);
+		pthread_cond_destroy(&(*pool)->space_cond);
+		pthread_cond_destroy(&(*pool)->work_cond);
+		pthread_mutex_destroy(&(*pool)->lock);
+
+		free((*pool)->threads);
+	}
+
+	free(*pool);
+	(*pool) = NULL;
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2025, Oracle and/or its affiliates.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+/**
+ * Test to verify that rules with their own interval are run at that interval
+ *
+ */
+
+#include <pthread.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <adaptived.h>
+
+#include "ftests.h"
+
+static const int max_loops = 20;
+
+int main(int argc, char *argv[])
+{
+	struct adaptived_rule_stats stats;
+	char config_path[FILENAME_MAX];
+	struct adaptived_ctx *ctx;
+	int ret;
+
+	snprintf(config_path, FILENAME_MAX - 1, "%s/071-rule-interval.json", argv[1]);
+	config_path[FILENAME_MAX - 1] = '\0';
+
+	ctx = adaptived_init(config_path);
+	if (!ctx)
+		return AUTOMAKE_HARD_ERROR;
+
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_LOG_LEVEL, LOG_DEBUG);
+	if (ret)
+		goto err;
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_INTERVAL, 1000);
+	if (ret)
+		goto err;
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_MAX_LOOPS, max_loops);
+	if (ret)
+		goto err;
+
+	ret = adaptived_loop(ctx, true);
+	if (ret != -ETIME)
+		goto err;
+
+	/*
+	 * The fast rule runs every 100ms and thus drives nearly every pass of the
+	 * loop.  (The slow rule may be due slightly before the fast rule and get a
+	 * pass to itself.)  The slow rule uses the main loop interval and should
+	 * only have run at startup and one second later
+	 */
+	ret = adaptived_get_rule_stats(ctx, "fast", &stats);
+	if (ret)
+		goto err;
+	if (stats.loops_run_cnt < max_loops - 1 || stats.loops_run_cnt > max_loops) {
+		adaptived_err("Expected the fast rule to run %d times, but it ran %lld times\n",
+			      max_loops, stats.loops_run_cnt);
+		goto err;
+	}
+
+	ret = adaptived_get_rule_stats(ctx, "slow", &stats);
+	if (ret)
+		goto err;
+	if (stats.loops_run_cnt != 2) {
+		adaptived_err("Expected the slow rule to run 2 times, but it ran %lld times\n",
+			      stats.loops_run_cnt);
+		goto err;
+	}
+
+	adaptived_release(&ctx);
+
+	return AUTOMAKE_PASSED;
+
+err:
+	adaptived_release(&ctx);
+
+	return AUTOMAKE_HARD_ERROR;
+}
@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2025, Oracle and/or its affiliates.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+/**
+ * Test to verify rules are properly run by a pool of worker threads
+ *
+ * The injection function must be invoked once per pass rather than once per
+ * rule, as the rules run concurrently
+ */
+
+#include <syslog.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <adaptived.h>
+
+#include "ftests.h"
+
+static const int max_loops = 10;
+static const int rule_cnt = 6;
+
+static int inject_cnt = 0;
+
+typedef int (*adaptived_injection_function)(struct adaptived_ctx * const ctx);
+extern int adaptived_register_injection_function(struct adaptived_ctx * const ctx,
+					      adaptived_injection_function fn);
+
+static int inject(struct adaptived_ctx * const ctx)
+{
+	inject_cnt++;
+
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	struct adaptived_rule_stats stats;
+	char config_path[FILENAME_MAX];
+	char rule_name[FILENAME_MAX];
+	struct adaptived_ctx *ctx;
+	uint32_t workers;
+	int ret, i;
+
+	snprintf(config_path, FILENAME_MAX - 1, "%s/072-rule-workers.json", argv[1]);
+	config_path[FILENAME_MAX - 1] = '\0';
+
+	ctx = adaptived_init(config_path);
+	if (!ctx)
+		return AUTOMAKE_HARD_ERROR;
+
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_LOG_LEVEL, LOG_DEBUG);
+	if (ret)
+		goto err;
+	ret = adaptived_register_injection_function(ctx, inject);
+	if (ret)
+		goto err;
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_MAX_LOOPS, max_loops);
+	if (ret)
+		goto err;
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_SKIP_SLEEP, 1);
+	if (ret)
+		goto err;
+
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_WORKERS, 0);
+	if (ret != -EINVAL)
+		goto err;
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_WORKERS, 4);
+	if (ret)
+		goto err;
+	ret = adaptived_get_attr(ctx, ADAPTIVED_ATTR_WORKERS, &workers);
+	if (ret)
+		goto err;
+	if (workers != 4)
+		goto err;
+
+	ret = adaptived_loop(ctx, true);
+	if (ret != -ETIME)
+		goto err;
+
+	if (inject_cnt != max_loops) {
+		adaptived_err("Expected %d injections, but got %d\n", max_loops, inject_cnt);
+		goto err;
+	}
+
+	for (i = 1; i <= rule_cnt; i++) {
+		snprintf(rule_name, FILENAME_MAX - 1, "%d", i);
+
+		ret = adaptived_get_rule_stats(ctx, rule_name, &stats);
+		if (ret)
+			goto err;
+		if (stats.loops_run_cnt != max_loops || stats.trigger_cnt != max_loops) {
+			adaptived_err("Rule %s: expected %d loops and triggers, but got %lld and %lld\n",
+				      rule_name, max_loops, stats.loops_run_cnt, stats.trigger_cnt);
+			goto err;
+		}
+	}
+
+	adaptived_release(&ctx);
+
+	return AUTOMAKE_PASSED;
+
+err:
+	adaptived_release(&ctx);
+
+	return AUTOMAKE_HARD_ERROR;
+}
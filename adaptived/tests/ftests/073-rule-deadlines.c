@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2025, Oracle and/or its affiliates.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+/**
+ * Test to verify that the main loop runs rules on absolute deadlines and
+ * passes the measured elapsed time to the causes
+ *
+ */
+
+#include <json-c/json.h>
+#include <syslog.h>
+#include <errno.h>
+#include <time.h>
+
+#include <adaptived.h>
+
+#include "ftests.h"
+
+#define MAX_LOOPS 6
+
+static int elapsed[MAX_LOOPS];
+static int run_cnt;
+
+struct busy_cause_opts {
+	int busy; /* milliseconds to spend in each run */
+};
+
+int busy_cause_init(struct adaptived_cause * const cse, struct json_object *args_obj, int interval)
+{
+	struct busy_cause_opts *opts;
+	int ret = 0;
+
+	opts = malloc(sizeof(struct busy_cause_opts));
+	if (!opts) {
+		ret = -ENOMEM;
+		goto error;
+	}
+
+	ret = adaptived_parse_int(args_obj, "busy", &opts->busy);
+	if (ret)
+		goto error;
+
+	ret = adaptived_cause_set_data(cse, (void *)opts);
+	if (ret)
+		goto error;
+
+	return ret;
+
+error:
+	if (opts)
+		free(opts);
+
+	return ret;
+}
+
+int busy_cause_main(struct adaptived_cause * const cse, int time_since_last_run)
+{
+	struct busy_cause_opts *opts;
+	struct timespec busy;
+
+	opts = (struct busy_cause_opts *)adaptived_cause_get_data(cse);
+
+	if (run_cnt < MAX_LOOPS)
+		elapsed[run_cnt] = time_since_last_run;
+	run_cnt++;
+
+	busy.tv_sec = opts->busy / 1000;
+	busy.tv_nsec = (opts->busy % 1000) * 1000000LL;
+	nanosleep(&busy, NULL);
+
+	return 0;
+}
+
+void busy_cause_exit(struct adaptived_cause * const cse)
+{
+	struct busy_cause_opts *opts;
+
+	opts = (struct busy_cause_opts *)adaptived_cause_get_data(cse);
+
+	free(opts);
+}
+
+const struct adaptived_cause_functions busy_cause_fns = {
+	busy_cause_init,
+	busy_cause_main,
+	busy_cause_exit,
+};
+
+int main(int argc, char *argv[])
+{
+	struct adaptived_rule_stats stats;
+	char config_path[FILENAME_MAX];
+	struct timespec start, end;
+	struct adaptived_ctx *ctx;
+	double time_diff;
+	int ret, i;
+
+	snprintf(config_path, FILENAME_MAX - 1, "%s/073-rule-deadlines.json", argv[1]);
+	config_path[FILENAME_MAX - 1] = '\0';
+
+	ctx = adaptived_init(config_path);
+	if (!ctx)
+		return AUTOMAKE_HARD_ERROR;
+
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_MAX_LOOPS, MAX_LOOPS);
+	if (ret)
+		goto err;
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_INTERVAL, 1000);
+	if (ret)
+		goto err;
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_LOG_LEVEL, LOG_DEBUG);
+	if (ret)
+		goto err;
+
+	ret = adaptived_register_cause(ctx, "busy_cause", &busy_cause_fns);
+	if (ret)
+		goto err;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	ret = adaptived_loop(ctx, true);
+	if (ret != -ETIME)
+		goto err;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	/*
+	 * The rule runs every 200ms and is busy for 50ms each time it runs.  Since
+	 * the deadlines are absolute, the busy time doesn't accumulate:
+	 * 	5 intervals * 200ms + 50ms for the last run = 1.05 seconds
+	 * A loop that sleeps for the interval after doing its work would take
+	 * 	6 runs * 50ms + 5 intervals * 200ms = 1.3 seconds
+	 */
+	time_diff = time_elapsed(&start, &end);
+	if (time_diff > 1.2 || time_diff < 1.0) {
+		adaptived_err("Expected test to take 1.05 seconds to run, but it took %f\n",
+			      time_diff);
+		goto err;
+	}
+
+	/* the first run is given the rule interval.  the others are measured */
+	for (i = 0; i < MAX_LOOPS; i++) {
+		if (elapsed[i] < 190 || elapsed[i] > 220) {
+			adaptived_err("Run %d: expected 200ms since the last run, but got %d\n",
+				      i, elapsed[i]);
+			goto err;
+		}
+	}
+
+	ret = adaptived_get_rule_stats(ctx, "deadlines", &stats);
+	if (ret)
+		goto err;
+	if (stats.loops_run_cnt != MAX_LOOPS || stats.overrun_cnt != 0 || stats.skipped_cnt != 0)
+		goto err;
+
+	adaptived_release(&ctx);
+	return AUTOMAKE_PASSED;
+
+err:
+	adaptived_release(&ctx);
+	return AUTOMAKE_HARD_ERROR;
+}
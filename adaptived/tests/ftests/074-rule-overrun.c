@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2025, Oracle and/or its affiliates.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+/**
+ * Test to verify that a rule that takes longer than its interval skips the
+ * deadlines it missed and that the overrun and skipped counters are updated
+ *
+ */
+
+#include <json-c/json.h>
+#include <syslog.h>
+#include <errno.h>
+#include <time.h>
+
+#include <adaptived.h>
+
+#include "ftests.h"
+
+#define MAX_LOOPS 4
+
+static int elapsed[MAX_LOOPS];
+static int run_cnt;
+
+struct busy_cause_opts {
+	int busy; /* milliseconds to spend in each run */
+};
+
+int busy_cause_init(struct adaptived_cause * const cse, struct json_object *args_obj, int interval)
+{
+	struct busy_cause_opts *opts;
+	int ret = 0;
+
+	opts = malloc(sizeof(struct busy_cause_opts));
+	if (!opts) {
+		ret = -ENOMEM;
+		goto error;
+	}
+
+	ret = adaptived_parse_int(args_obj, "busy", &opts->busy);
+	if (ret)
+		goto error;
+
+	ret = adaptived_cause_set_data(cse, (void *)opts);
+	if (ret)
+		goto error;
+
+	return ret;
+
+error:
+	if (opts)
+		free(opts);
+
+	return ret;
+}
+
+int busy_cause_main(struct adaptived_cause * const cse, int time_since_last_run)
+{
+	struct busy_cause_opts *opts;
+	struct timespec busy;
+
+	opts = (struct busy_cause_opts *)adaptived_cause_get_data(cse);
+
+	if (run_cnt < MAX_LOOPS)
+		elapsed[run_cnt] = time_since_last_run;
+	run_cnt++;
+
+	busy.tv_sec = opts->busy / 1000;
+	busy.tv_nsec = (opts->busy % 1000) * 1000000LL;
+	nanosleep(&busy, NULL);
+
+	return 0;
+}
+
+void busy_cause_exit(struct adaptived_cause * const cse)
+{
+	struct busy_cause_opts *opts;
+
+	opts = (struct busy_cause_opts *)adaptived_cause_get_data(cse);
+
+	free(opts);
+}
+
+const struct adaptived_cause_functions busy_cause_fns = {
+	busy_cause_init,
+	busy_cause_main,
+	busy_cause_exit,
+};
+
+int main(int argc, char *argv[])
+{
+	struct adaptived_rule_stats stats;
+	char config_path[FILENAME_MAX];
+	struct timespec start, end;
+	struct adaptived_ctx *ctx;
+	double time_diff;
+	int ret, i;
+
+	snprintf(config_path, FILENAME_MAX - 1, "%s/074-rule-overrun.json", argv[1]);
+	config_path[FILENAME_MAX - 1] = '\0';
+
+	ctx = adaptived_init(config_path);
+	if (!ctx)
+		return AUTOMAKE_HARD_ERROR;
+
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_MAX_LOOPS, MAX_LOOPS);
+	if (ret)
+		goto err;
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_INTERVAL, 1000);
+	if (ret)
+		goto err;
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_LOG_LEVEL, LOG_DEBUG);
+	if (ret)
+		goto err;
+
+	ret = adaptived_register_cause(ctx, "busy_cause", &busy_cause_fns);
+	if (ret)
+		goto err;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	ret = adaptived_loop(ctx, true);
+	if (ret != -ETIME)
+		goto err;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	/*
+	 * The rule runs every 100ms but is busy for 250ms each time it runs.  Each
+	 * run overruns the next two deadlines, so the rule runs every 300ms:
+	 * 	3 * 300ms + 250ms for the last run = 1.15 seconds
+	 */
+	time_diff = time_elapsed(&start, &end);
+	if (time_diff > 1.3 || time_diff < 1.1) {
+		adaptived_err("Expected test to take 1.15 seconds to run, but it took %f\n",
+			      time_diff);
+		goto err;
+	}
+
+	for (i = 1; i < MAX_LOOPS; i++) {
+		if (elapsed[i] < 290 || elapsed[i] > 320) {
+			adaptived_err("Run %d: expected 300ms since the last run, but got %d\n",
+				      i, elapsed[i]);
+			goto err;
+		}
+	}
+
+	ret = adaptived_get_rule_stats(ctx, "overrun", &stats);
+	if (ret)
+		goto err;
+	if (stats.loops_run_cnt != MAX_LOOPS || stats.overrun_cnt != MAX_LOOPS ||
+	    stats.skipped_cnt != 2 * MAX_LOOPS) {
+		adaptived_err("Expected %d overruns and %d skipped deadlines, but got %lld and %lld\n",
+			      MAX_LOOPS, 2 * MAX_LOOPS, stats.overrun_cnt, stats.skipped_cnt);
+		goto err;
+	}
+
+	adaptived_release(&ctx);
+	return AUTOMAKE_PASSED;
+
+err:
+	adaptived_release(&ctx);
+	return AUTOMAKE_HARD_ERROR;
+}
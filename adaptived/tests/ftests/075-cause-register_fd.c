@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2025, Oracle and/or its affiliates.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+/**
+ * Test to verify that a cause can register a file descriptor and that its rule
+ * is run as soon as the file descriptor is ready
+ *
+ */
+
+#include <sys/eventfd.h>
+#include <sys/epoll.h>
+#include <json-c/json.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <syslog.h>
+#include <errno.h>
+#include <time.h>
+
+#include <adaptived.h>
+
+#include "ftests.h"
+
+#define EXPECTED_RET -123
+
+static int event_fd = -1;
+
+int fd_cause_init(struct adaptived_cause * const cse, struct json_object *args_obj, int interval)
+{
+	event_fd = eventfd(0, EFD_NONBLOCK);
+	if (event_fd < 0)
+		return -errno;
+
+	return adaptived_cause_register_fd(cse, event_fd, EPOLLIN);
+}
+
+int fd_cause_main(struct adaptived_cause * const cse, int time_since_last_run)
+{
+	uint64_t value;
+
+	if (read(event_fd, &value, sizeof(value)) == sizeof(value)) {
+		/* the main loop should have recorded that the fd woke this rule */
+		if (adaptived_cause_fd_pending(cse, event_fd) != 1)
+			return -EINVAL;
+
+		return 1;
+	}
+
+	return 0;
+}
+
+void fd_cause_exit(struct adaptived_cause * const cse)
+{
+	close(event_fd);
+}
+
+const struct adaptived_cause_functions fd_cause_fns = {
+	fd_cause_init,
+	fd_cause_main,
+	fd_cause_exit,
+};
+
+static void *adaptived_wrapper(void *arg)
+{
+	struct adaptived_ctx *ctx = arg;
+	uintptr_t ret;
+
+	ret = adaptived_loop(ctx, true);
+
+	return (void *)ret;
+}
+
+int main(int argc, char *argv[])
+{
+	struct adaptived_rule_stats stats;
+	char config_path[FILENAME_MAX];
+	struct timespec start, end;
+	pthread_t adaptived_thread;
+	struct adaptived_ctx *ctx;
+	uint64_t value = 1;
+	double time_diff;
+	void *tret;
+	int ret;
+
+	snprintf(config_path, FILENAME_MAX - 1, "%s/075-cause-register_fd.json", argv[1]);
+	config_path[FILENAME_MAX - 1] = '\0';
+
+	ctx = adaptived_init(config_path);
+	if (!ctx)
+		return AUTOMAKE_HARD_ERROR;
+
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_INTERVAL, 10000);
+	if (ret)
+		goto err;
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_LOG_LEVEL, LOG_DEBUG);
+	if (ret)
+		goto err;
+
+	ret = adaptived_register_cause(ctx, "fd_cause", &fd_cause_fns);
+	if (ret)
+		goto err;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	ret = pthread_create(&adaptived_thread, NULL, &adaptived_wrapper, ctx);
+	if (ret)
+		goto err;
+
+	/* let the rule run once and go to sleep.  it's not due again for 10 seconds */
+	usleep(500000);
+
+	if (write(event_fd, &value, sizeof(value)) != sizeof(value))
+		goto err;
+
+	pthread_join(adaptived_thread, &tret);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	if (tret != (void *)EXPECTED_RET) {
+		adaptived_err("Expected the adaptived_loop() to return %d, but it returned: %ld\n",
+			      EXPECTED_RET, (long)tret);
+		goto err;
+	}
+
+	time_diff = time_elapsed(&start, &end);
+	if (time_diff > 1.0) {
+		adaptived_err("Expected the rule to be woken in 0.5 seconds, but it took %f\n",
+			      time_diff);
+		goto err;
+	}
+
+	ret = adaptived_get_rule_stats(ctx, "Wake on fd", &stats);
+	if (ret)
+		goto err;
+	if (stats.loops_run_cnt != 2 || stats.trigger_cnt != 1)
+		goto err;
+
+	adaptived_release(&ctx);
+	return AUTOMAKE_PASSED;
+
+err:
+	adaptived_release(&ctx);
+	return AUTOMAKE_HARD_ERROR;
+}
@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) 2025, Oracle and/or its affiliates.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+/**
+ * Test to verify that causes are short-circuited once a cause in the rule does
+ * not trigger, and that adaptive ordering runs cheap, selective causes first
+ *
+ */
+
+#include <json-c/json.h>
+#include <syslog.h>
+#include <errno.h>
+#include <time.h>
+
+#include <adaptived.h>
+
+#include "ftests.h"
+
+#define MAX_LOOPS 20
+#define MAX_IDS 8
+
+static int run_cnt[MAX_IDS];
+
+struct test_cause_opts {
+	int id;
+	int ret; /* value returned by the main routine */
+	int busy; /* microseconds to spend in the main routine */
+};
+
+static int test_cause_init(struct adaptived_cause * const cse, struct json_object *args_obj,
+			   int interval, bool stateful)
+{
+	struct test_cause_opts *opts;
+	int ret = 0;
+
+	opts = malloc(sizeof(struct test_cause_opts));
+	if (!opts) {
+		ret = -ENOMEM;
+		goto error;
+	}
+
+	ret = adaptived_parse_int(args_obj, "id", &opts->id);
+	if (ret)
+		goto error;
+	if (opts->id < 0 || opts->id >= MAX_IDS) {
+		ret = -EINVAL;
+		goto error;
+	}
+
+	ret = adaptived_parse_int(args_obj, "return", &opts->ret);
+	if (ret)
+		goto error;
+
+	ret = adaptived_parse_int(args_obj, "busy", &opts->busy);
+	if (ret == -ENOENT)
+		opts->busy = 0;
+	else if (ret)
+		goto error;
+
+	ret = adaptived_cause_set_data(cse, (void *)opts);
+	if (ret)
+		goto error;
+
+	/* registered causes default to being run every sample */
+	if (!stateful)
+		adaptived_cause_set_flags(cse, 0);
+
+	return 0;
+
+error:
+	if (opts)
+		free(opts);
+
+	return ret;
+}
+
+int stateless_cause_init(struct adaptived_cause * const cse, struct json_object *args_obj,
+			 int interval)
+{
+	return test_cause_init(cse, args_obj, interval, false);
+}
+
+int stateful_cause_init(struct adaptived_cause * const cse, struct json_object *args_obj,
+			int interval)
+{
+	return test_cause_init(cse, args_obj, interval, true);
+}
+
+int test_cause_main(struct adaptived_cause * const cse, int time_since_last_run)
+{
+	struct test_cause_opts *opts;
+	struct timespec busy;
+
+	opts = (struct test_cause_opts *)adaptived_cause_get_data(cse);
+
+	run_cnt[opts->id]++;
+
+	if (opts->busy) {
+		busy.tv_sec = 0;
+		busy.tv_nsec = opts->busy * 1000LL;
+		nanosleep(&busy, NULL);
+	}
+
+	return opts->ret;
+}
+
+void test_cause_exit(struct adaptived_cause * const cse)
+{
+	free(adaptived_cause_get_data(cse));
+}
+
+const struct adaptived_cause_functions stateless_cause_fns = {
+	stateless_cause_init,
+	test_cause_main,
+	test_cause_exit,
+};
+
+const struct adaptived_cause_functions stateful_cause_fns = {
+	stateful_cause_init,
+	test_cause_main,
+	test_cause_exit,
+};
+
+int main(int argc, char *argv[])
+{
+	struct adaptived_rule_stats stats;
+	char config_path[FILENAME_MAX];
+	struct adaptived_ctx *ctx;
+	int ret;
+
+	snprintf(config_path, FILENAME_MAX - 1, "%s/076-rule-short_circuit.json", argv[1]);
+	config_path[FILENAME_MAX - 1] = '\0';
+
+	ctx = adaptived_init(config_path);
+	if (!ctx)
+		return AUTOMAKE_HARD_ERROR;
+
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_MAX_LOOPS, MAX_LOOPS);
+	if (ret)
+		goto err;
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_SKIP_SLEEP, 1);
+	if (ret)
+		goto err;
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_LOG_LEVEL, LOG_DEBUG);
+	if (ret)
+		goto err;
+
+	ret = adaptived_register_cause(ctx, "stateless", &stateless_cause_fns);
+	if (ret)
+		goto err;
+	ret = adaptived_register_cause(ctx, "stateful", &stateful_cause_fns);
+	if (ret)
+		goto err;
+
+	ret = adaptived_loop(ctx, true);
+	if (ret != -ETIME)
+		goto err;
+
+	/*
+	 * Rule "short circuit": cause 0 never triggers, so the stateless cause 1
+	 * is never run.  The stateful cause 2 is run every time
+	 */
+	if (run_cnt[0] != MAX_LOOPS || run_cnt[1] != 0 || run_cnt[2] != MAX_LOOPS) {
+		adaptived_err("Expected %d, 0, and %d runs, but got %d, %d, and %d\n",
+			      MAX_LOOPS, MAX_LOOPS, run_cnt[0], run_cnt[1], run_cnt[2]);
+		goto err;
+	}
+
+	ret = adaptived_get_rule_stats(ctx, "short circuit", &stats);
+	if (ret)
+		goto err;
+	if (stats.cause_skip_cnt != MAX_LOOPS || stats.trigger_cnt != 0)
+		goto err;
+
+	/*
+	 * Rule "adaptive": cause 3 is expensive and always triggers.  cause 4 is
+	 * cheap and never triggers.  After the first run, cause 4 should be run
+	 * first and cause 3 should be skipped
+	 */
+	if (run_cnt[4] != MAX_LOOPS || run_cnt[3] > 2) {
+		adaptived_err("Expected %d and <= 2 runs, but got %d and %d\n",
+			      MAX_LOOPS, run_cnt[4], run_cnt[3]);
+		goto err;
+	}
+
+	adaptived_release(&ctx);
+	return AUTOMAKE_PASSED;
+
+err:
+	adaptived_release(&ctx);
+	return AUTOMAKE_HARD_ERROR;
+}
@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2025, Oracle and/or its affiliates.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+/**
+ * Test to verify that the rule stats and the attributes can be read while a
+ * rule is running without waiting for the rule to finish
+ *
+ */
+
+#include <json-c/json.h>
+#include <pthread.h>
+#include <syslog.h>
+#include <errno.h>
+#include <time.h>
+
+#include <adaptived.h>
+
+#include "ftests.h"
+
+#define MAX_LOOPS 2
+#define BUSY_MS 500
+
+static int running;
+
+int busy_cause_init(struct adaptived_cause * const cse, struct json_object *args_obj, int interval)
+{
+	return 0;
+}
+
+int busy_cause_main(struct adaptived_cause * const cse, int time_since_last_run)
+{
+	struct timespec busy;
+
+	__atomic_store_n(&running, 1, __ATOMIC_RELEASE);
+
+	busy.tv_sec = BUSY_MS / 1000;
+	busy.tv_nsec = (BUSY_MS % 1000) * 1000000LL;
+	nanosleep(&busy, NULL);
+
+	__atomic_store_n(&running, 0, __ATOMIC_RELEASE);
+
+	return 0;
+}
+
+void busy_cause_exit(struct adaptived_cause * const cse)
+{
+}
+
+const struct adaptived_cause_functions busy_cause_fns = {
+	busy_cause_init,
+	busy_cause_main,
+	busy_cause_exit,
+};
+
+static void *adaptived_wrapper(void *arg)
+{
+	struct adaptived_ctx *ctx = arg;
+	uintptr_t ret;
+
+	ret = adaptived_loop(ctx, true);
+
+	return (void *)ret;
+}
+
+int main(int argc, char *argv[])
+{
+	struct timespec sleep, start, end;
+	struct adaptived_rule_stats stats;
+	char config_path[FILENAME_MAX];
+	pthread_t adaptived_thread;
+	struct adaptived_ctx *ctx;
+	bool thread_started = false;
+	uint32_t value;
+	double time_diff;
+	void *tret;
+	int ret;
+
+	snprintf(config_path, FILENAME_MAX - 1, "%s/077-rule-nonblocking_stats.json", argv[1]);
+	config_path[FILENAME_MAX - 1] = '\0';
+
+	ctx = adaptived_init(config_path);
+	if (!ctx)
+		return AUTOMAKE_HARD_ERROR;
+
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_MAX_LOOPS, MAX_LOOPS);
+	if (ret)
+		goto err;
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_INTERVAL, 100);
+	if (ret)
+		goto err;
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_LOG_LEVEL, LOG_DEBUG);
+	if (ret)
+		goto err;
+
+	ret = adaptived_register_cause(ctx, "busy_cause", &busy_cause_fns);
+	if (ret)
+		goto err;
+
+	ret = pthread_create(&adaptived_thread, NULL, &adaptived_wrapper, ctx);
+	if (ret)
+		goto err;
+	thread_started = true;
+
+	/* wait for the rule to start running */
+	sleep.tv_sec = 0;
+	sleep.tv_nsec = 1000000LL;
+	while (!__atomic_load_n(&running, __ATOMIC_ACQUIRE))
+		nanosleep(&sleep, NULL);
+
+	/*
+	 * The rule is now busy for BUSY_MS.  None of these calls should have to
+	 * wait for it to finish
+	 */
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	ret = adaptived_get_rule_stats(ctx, "nonblocking", &stats);
+	if (ret)
+		goto err;
+	ret = adaptived_get_attr(ctx, ADAPTIVED_ATTR_RULE_CNT, &value);
+	if (ret)
+		goto err;
+	if (value != 1) {
+		adaptived_err("Expected 1 rule, but got %u\n", value);
+		goto err;
+	}
+	ret = adaptived_get_attr(ctx, ADAPTIVED_ATTR_INTERVAL, &value);
+	if (ret)
+		goto err;
+	if (value != 100) {
+		adaptived_err("Expected an interval of 100, but got %u\n", value);
+		goto err;
+	}
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_LOG_LEVEL, LOG_DEBUG);
+	if (ret)
+		goto err;
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	if (!__atomic_load_n(&running, __ATOMIC_ACQUIRE)) {
+		adaptived_err("The rule finished before the stats and attributes were read\n");
+		goto err;
+	}
+
+	time_diff = time_elapsed(&start, &end);
+	if (time_diff > 0.05) {
+		adaptived_err("Reading the stats and attributes took %f seconds\n", time_diff);
+		goto err;
+	}
+
+	/* the stats are published when the rule starts running */
+	if (stats.loops_run_cnt != 1) {
+		adaptived_err("Expected 1 loop, but %d loops ran\n", stats.loops_run_cnt);
+		goto err;
+	}
+
+	pthread_join(adaptived_thread, &tret);
+	thread_started = false;
+
+	if (tret != (void *)-ETIME) {
+		adaptived_err("Expected the adaptived_loop() to return -ETIME, but it returned: %d\n",
+			   tret);
+		goto err;
+	}
+
+	ret = adaptived_get_rule_stats(ctx, "nonblocking", &stats);
+	if (ret)
+		goto err;
+	if (stats.loops_run_cnt != MAX_LOOPS) {
+		adaptived_err("Expected %d loops, but %d loops ran\n", MAX_LOOPS,
+			      stats.loops_run_cnt);
+		goto err;
+	}
+
+	adaptived_release(&ctx);
+	return AUTOMAKE_PASSED;
+
+err:
+	if (thread_started)
+		pthread_join(adaptived_thread, NULL);
+	adaptived_release(&ctx);
+	return AUTOMAKE_HARD_ERROR;
+}
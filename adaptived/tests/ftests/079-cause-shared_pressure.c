@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2024, Oracle and/or its affiliates.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+/**
+ * Test that identical causes in different rules share a single instance that is
+ * evaluated once per pass through the main loop
+ *
+ * The pressure file is rewritten before each rule runs.  The first two rules use
+ * the same pressure cause (with its arguments in a different order), so the second
+ * rule must reuse the result of the first rule and not see the new pressure.  The
+ * third rule uses a different threshold and must read the file itself.
+ */
+
+#include <unistd.h>
+#include <string.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include <adaptived.h>
+
+#include "ftests.h"
+
+#define EXPECTED_RET -79
+
+static const char *pressure_file = "079-cause-shared_pressure.pressure";
+static int ctr = 0;
+
+typedef int (*adaptived_injection_function)(struct adaptived_ctx * const ctx);
+extern int adaptived_register_injection_function(struct adaptived_ctx * const ctx,
+					      adaptived_injection_function fn);
+
+/* the pressure before each of the three rules runs */
+static const float some_avg10[] = {10.0, 90.0, 90.0};
+
+static int inject(struct adaptived_ctx * const ctx)
+{
+	int fd, ret = 0;
+	char buf[1024];
+	ssize_t w;
+
+	if (ctr >= ARRAY_SIZE(some_avg10))
+		return -E2BIG;
+
+	fd = open(pressure_file, O_TRUNC | O_WRONLY | O_CREAT, S_IWUSR | S_IRUSR);
+	if (fd <= 0)
+		return -EINVAL;
+
+	memset(buf, 0, sizeof(buf));
+
+	w = sprintf(buf, "some avg10=%.2f avg60=0.00 avg300=0.00 total=0\n"
+		    "full avg10=0.00 avg60=0.00 avg300=0.00 total=0", some_avg10[ctr]);
+	if (w <= 0 || w >= 1024) {
+		ret = -errno;
+		goto err;
+	}
+
+	w = write(fd, buf, strlen(buf));
+	if (w <= 0)
+		ret = -errno;
+
+err:
+	close(fd);
+	ctr++;
+
+	return ret;
+}
+
+int main(int argc, char *argv[])
+{
+	struct adaptived_rule_stats stats;
+	char config_path[FILENAME_MAX];
+	struct adaptived_ctx *ctx;
+	int ret;
+
+	snprintf(config_path, FILENAME_MAX - 1, "%s/079-cause-shared_pressure.json", argv[1]);
+	config_path[FILENAME_MAX - 1] = '\0';
+
+	ctx = adaptived_init(config_path);
+	if (!ctx)
+		goto err;
+
+	ret = adaptived_register_injection_function(ctx, inject);
+	if (ret)
+		goto err;
+
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_MAX_LOOPS, 1);
+	if (ret)
+		goto err;
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_INTERVAL, 1000);
+	if (ret)
+		goto err;
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_SKIP_SLEEP, 1);
+	if (ret)
+		goto err;
+
+	ret = adaptived_loop(ctx, true);
+	if (ret != EXPECTED_RET)
+		goto err;
+
+	ret = adaptived_get_rule_stats(ctx, "second", &stats);
+	if (ret)
+		goto err;
+	if (stats.loops_run_cnt != 1 || stats.trigger_cnt != 0)
+		goto err;
+
+	adaptived_release(&ctx);
+	(void)remove(pressure_file);
+	return AUTOMAKE_PASSED;
+
+err:
+	if (ctx)
+		adaptived_release(&ctx);
+
+	(void)remove(pressure_file);
+	return AUTOMAKE_HARD_ERROR;
+}
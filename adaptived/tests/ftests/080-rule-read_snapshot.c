@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2024, Oracle and/or its affiliates.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+/**
+ * Test that the files read during a pass through the main loop are a consistent
+ * snapshot
+ *
+ * Both rules read the same meminfo file and cgroup setting.  After the first
+ * rule has read them, its effect rewrites the meminfo file directly and writes
+ * the cgroup setting via adaptived_cgroup_set_ll().  The second rule must see the
+ * meminfo file as it was at the start of the pass, but it must see the new value
+ * of the cgroup setting because it was written through the cgroup helpers.
+ */
+
+#include <adaptived-utils.h>
+#include <adaptived.h>
+
+#include "ftests.h"
+
+#define EXPECTED_RET -78
+
+static const char * const meminfo_file = "080-rule-read_snapshot.meminfo";
+static const char * const setting_file = "080-rule-read_snapshot.setting";
+
+static int rewrite_init(struct adaptived_effect * const eff, struct json_object *args_obj,
+			const struct adaptived_cause * const cse)
+{
+	return 0;
+}
+
+static int rewrite_main(struct adaptived_effect * const eff)
+{
+	write_file(meminfo_file, "MemTotal:  4000 kB\nMemFree:    100 kB\n");
+
+	return adaptived_cgroup_set_ll(setting_file, 200, 0);
+}
+
+static void rewrite_exit(struct adaptived_effect * const eff)
+{
+}
+
+static const struct adaptived_effect_functions rewrite_fns = {
+	rewrite_init,
+	rewrite_main,
+	rewrite_exit,
+};
+
+int main(int argc, char *argv[])
+{
+	struct adaptived_ctx *ctx = NULL;
+	char config_path[FILENAME_MAX];
+	int ret;
+
+	snprintf(config_path, FILENAME_MAX - 1, "%s/080-rule-read_snapshot.json", argv[1]);
+	config_path[FILENAME_MAX - 1] = '\0';
+
+	write_file(meminfo_file, "MemTotal:  4000 kB\nMemFree:   2000 kB\n");
+	write_file(setting_file, "100\n");
+
+	ctx = adaptived_init(config_path);
+	if (!ctx)
+		goto err;
+
+	ret = adaptived_register_effect(ctx, "rewrite", &rewrite_fns);
+	if (ret)
+		goto err;
+
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_MAX_LOOPS, 1);
+	if (ret)
+		goto err;
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_INTERVAL, 1000);
+	if (ret)
+		goto err;
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_SKIP_SLEEP, 1);
+	if (ret)
+		goto err;
+
+	ret = adaptived_loop(ctx, true);
+	if (ret != EXPECTED_RET)
+		goto err;
+
+	adaptived_release(&ctx);
+	(void)remove(meminfo_file);
+	(void)remove(setting_file);
+	return AUTOMAKE_PASSED;
+
+err:
+	if (ctx)
+		adaptived_release(&ctx);
+
+	(void)remove(meminfo_file);
+	(void)remove(setting_file);
+	return AUTOMAKE_HARD_ERROR;
+}
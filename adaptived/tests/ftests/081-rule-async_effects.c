@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2024, Oracle and/or its affiliates.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+/**
+ * Test that a rule's effects can run asynchronously
+ *
+ * The effects take much longer than the rule's interval.  They must not delay
+ * the main loop, the rule must not be run again until they have completed,
+ * and the error returned by the last effect must be reported in the rule's
+ * stats rather than stopping the main loop.
+ */
+
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+
+#include <adaptived.h>
+
+#include "ftests.h"
+
+#define EXPECTED_RET -ETIME
+#define EFFECT_SLEEP_MS 300
+
+static int slow_init(struct adaptived_effect * const eff, struct json_object *args_obj,
+		     const struct adaptived_cause * const cse)
+{
+	return 0;
+}
+
+static int slow_main(struct adaptived_effect * const eff)
+{
+	usleep(EFFECT_SLEEP_MS * 1000);
+
+	return 0;
+}
+
+static void slow_exit(struct adaptived_effect * const eff)
+{
+}
+
+static const struct adaptived_effect_functions slow_fns = {
+	slow_init,
+	slow_main,
+	slow_exit,
+};
+
+static long long now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (long long)ts.tv_sec * 1000LL + ts.tv_nsec / 1000000LL;
+}
+
+int main(int argc, char *argv[])
+{
+	struct adaptived_rule_stats stats;
+	struct adaptived_ctx *ctx = NULL;
+	char config_path[FILENAME_MAX];
+	long long start, loop_ms;
+	int ret;
+
+	snprintf(config_path, FILENAME_MAX - 1, "%s/081-rule-async_effects.json", argv[1]);
+	config_path[FILENAME_MAX - 1] = '\0';
+
+	ctx = adaptived_init(config_path);
+	if (!ctx)
+		goto err;
+
+	ret = adaptived_register_effect(ctx, "slow", &slow_fns);
+	if (ret)
+		goto err;
+
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_MAX_LOOPS, 6);
+	if (ret)
+		goto err;
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_INTERVAL, 50);
+	if (ret)
+		goto err;
+
+	start = now_ms();
+	ret = adaptived_loop(ctx, true);
+	loop_ms = now_ms() - start;
+	if (ret != EXPECTED_RET)
+		goto err;
+
+	/*
+	 * Six passes at a 50ms interval.  Running the effects inline would take
+	 * at least six times EFFECT_SLEEP_MS
+	 */
+	if (loop_ms >= 3 * EFFECT_SLEEP_MS)
+		goto err;
+
+	ret = adaptived_get_rule_stats(ctx, "async", &stats);
+	if (ret)
+		goto err;
+
+	/* adaptived_loop() waits for the asynchronous effects before returning */
+	if (stats.effect_dispatch_cnt < 1 || stats.effect_dispatch_cnt != stats.trigger_cnt)
+		goto err;
+	if (stats.effect_done_cnt != stats.effect_dispatch_cnt)
+		goto err;
+	if (stats.effect_fail_cnt != stats.effect_done_cnt || stats.effect_last_ret != -77)
+		goto err;
+	if (stats.effect_last_latency < EFFECT_SLEEP_MS ||
+	    stats.effect_max_latency < stats.effect_last_latency)
+		goto err;
+	if (stats.effect_busy_cnt < 1)
+		goto err;
+
+	adaptived_release(&ctx);
+	return AUTOMAKE_PASSED;
+
+err:
+	if (ctx)
+		adaptived_release(&ctx);
+
+	return AUTOMAKE_HARD_ERROR;
+}
@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2024, Oracle and/or its affiliates.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+/**
+ * Test the top cause's cpus and cpuset arguments
+ *
+ * Only cpus 2 and 3 become busy.  The machine-wide average stays low, so only the
+ * rule that watches cpus 2-3 should trigger
+ */
+
+#include <stdio.h>
+#include <errno.h>
+
+#include <adaptived.h>
+
+#include "ftests.h"
+
+#define EXPECTED_RET -82
+
+static const char * const stat_file = "082-cause-top_cpus.stat";
+static const char * const cpuset_file = "082-cause-top_cpus.cpuset";
+
+static int ctr;
+
+/*
+ * On every loop, cpus 2 and 3 each spend another 100 ticks in user, while cpus 0
+ * and 1 are idle
+ */
+static void write_sample(void)
+{
+	char buf[1024];
+
+	snprintf(buf, sizeof(buf),
+		 "cpu  %d 0 400 %d 0 0 0 0 0 0\n"
+		 "cpu0 100 0 100 %d 0 0 0 0 0 0\n"
+		 "cpu1 100 0 100 %d 0 0 0 0 0 0\n"
+		 "cpu2 %d 0 100 10000 0 0 0 0 0 0\n"
+		 "cpu3 %d 0 100 10000 0 0 0 0 0 0\n"
+		 "intr 0\n",
+		 400 + ctr * 200, 40000 + ctr * 600, 10000 + ctr * 100,
+		 10000 + ctr * 100, 100 + ctr * 100, 100 + ctr * 100);
+
+	write_file(stat_file, buf);
+}
+
+typedef int (*adaptived_injection_function)(struct adaptived_ctx * const ctx);
+extern int adaptived_register_injection_function(struct adaptived_ctx * const ctx,
+					      adaptived_injection_function fn);
+
+static int inject(struct adaptived_ctx * const ctx)
+{
+	write_sample();
+	ctr++;
+
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	char config_path[FILENAME_MAX];
+	struct adaptived_ctx *ctx;
+	int ret;
+
+	snprintf(config_path, FILENAME_MAX - 1, "%s/082-cause-top_cpus.json", argv[1]);
+	config_path[FILENAME_MAX - 1] = '\0';
+
+	write_sample();
+	write_file(cpuset_file, "0-1\n");
+
+	ctx = adaptived_init(config_path);
+	if (!ctx)
+		goto err;
+
+	ret = adaptived_register_injection_function(ctx, inject);
+	if (ret)
+		goto err;
+
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_MAX_LOOPS, 6);
+	if (ret)
+		goto err;
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_INTERVAL, 100);
+	if (ret)
+		goto err;
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_SKIP_SLEEP, 1);
+	if (ret)
+		goto err;
+
+	ret = adaptived_loop(ctx, true);
+	if (ret != EXPECTED_RET) {
+		adaptived_err("Expected %d, got %d\n", EXPECTED_RET, ret);
+		goto err;
+	}
+
+	adaptived_release(&ctx);
+	(void)remove(stat_file);
+	(void)remove(cpuset_file);
+
+	return AUTOMAKE_PASSED;
+
+err:
+	if (ctx)
+		adaptived_release(&ctx);
+	(void)remove(stat_file);
+	(void)remove(cpuset_file);
+
+	return AUTOMAKE_HARD_ERROR;
+}
@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2024, Oracle and/or its affiliates.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+/**
+ * Test the stall_window setting of the pressure and pressure_rate causes
+ *
+ * The PSI totals grow steadily, such that 30% of the time is spent in "some"
+ * stalls and 3% of the time in "full" stalls.  Only the rule that watches for
+ * more than 25% "some" stall time over a 2 second window should trigger
+ */
+
+#include <stdio.h>
+#include <errno.h>
+
+#include <adaptived.h>
+
+#include "ftests.h"
+
+#define EXPECTED_RET -83
+
+static const char * const pressure_file = "083-cause-pressure_stall_window.pressure";
+
+/*
+ * The injection function runs before every rule, and there are three rules, so
+ * each rule sees three of these steps per 1 second interval
+ */
+static const long long some_step = 100000;
+static const long long full_step = 10000;
+
+static int ctr;
+
+static void write_sample(void)
+{
+	char buf[1024];
+
+	snprintf(buf, sizeof(buf),
+		 "some avg10=0.00 avg60=0.00 avg300=0.00 total=%lld\n"
+		 "full avg10=0.00 avg60=0.00 avg300=0.00 total=%lld\n",
+		 ctr * some_step, ctr * full_step);
+
+	write_file(pressure_file, buf);
+}
+
+typedef int (*adaptived_injection_function)(struct adaptived_ctx * const ctx);
+extern int adaptived_register_injection_function(struct adaptived_ctx * const ctx,
+					      adaptived_injection_function fn);
+
+static int inject(struct adaptived_ctx * const ctx)
+{
+	ctr++;
+	write_sample();
+
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	char config_path[FILENAME_MAX];
+	struct adaptived_ctx *ctx;
+	int ret;
+
+	snprintf(config_path, FILENAME_MAX - 1, "%s/083-cause-pressure_stall_window.json", argv[1]);
+	config_path[FILENAME_MAX - 1] = '\0';
+
+	write_sample();
+
+	ctx = adaptived_init(config_path);
+	if (!ctx)
+		goto err;
+
+	ret = adaptived_register_injection_function(ctx, inject);
+	if (ret)
+		goto err;
+
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_MAX_LOOPS, 5);
+	if (ret)
+		goto err;
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_INTERVAL, 1000);
+	if (ret)
+		goto err;
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_SKIP_SLEEP, 1);
+	if (ret)
+		goto err;
+
+	ret = adaptived_loop(ctx, true);
+	if (ret != EXPECTED_RET) {
+		adaptived_err("Expected %d, got %d\n", EXPECTED_RET, ret);
+		goto err;
+	}
+
+	adaptived_release(&ctx);
+	(void)remove(pressure_file);
+
+	return AUTOMAKE_PASSED;
+
+err:
+	if (ctx)
+		adaptived_release(&ctx);
+	(void)remove(pressure_file);
+
+	return AUTOMAKE_HARD_ERROR;
+}
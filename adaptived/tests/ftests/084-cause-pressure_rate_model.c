@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2024, Oracle and/or its affiliates.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+/**
+ * Test the model setting of the pressure_rate cause
+ *
+ * The pressure is steady and then bursts once.  The least-squares line overshoots
+ * the burst and predicts that the threshold will be exceeded, while the ewma model
+ * damps the burst and does not
+ */
+
+#include <stdio.h>
+#include <errno.h>
+
+#include <adaptived.h>
+
+#include "ftests.h"
+
+#define EXPECTED_RET -84
+#define RULE_CNT 2
+
+static const char * const pressure_file = "084-cause-pressure_rate_model.pressure";
+
+static const float full_avg10[] = {20.0, 20.0, 20.0, 20.0, 20.0, 20.0, 60.0};
+
+static int ctr;
+
+typedef int (*adaptived_injection_function)(struct adaptived_ctx * const ctx);
+extern int adaptived_register_injection_function(struct adaptived_ctx * const ctx,
+					      adaptived_injection_function fn);
+
+static int inject(struct adaptived_ctx * const ctx)
+{
+	char buf[1024];
+	int idx;
+
+	/* the injection function runs before every rule.  give each rule the same sample */
+	idx = ctr / RULE_CNT;
+	if (idx >= ARRAY_SIZE(full_avg10))
+		return -E2BIG;
+
+	snprintf(buf, sizeof(buf),
+		 "some avg10=0.00 avg60=0.00 avg300=0.00 total=0\n"
+		 "full avg10=%.2f avg60=0.00 avg300=0.00 total=0\n", full_avg10[idx]);
+	write_file(pressure_file, buf);
+
+	ctr++;
+
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	char config_path[FILENAME_MAX];
+	struct adaptived_ctx *ctx;
+	int ret;
+
+	snprintf(config_path, FILENAME_MAX - 1, "%s/084-cause-pressure_rate_model.json", argv[1]);
+	config_path[FILENAME_MAX - 1] = '\0';
+
+	ctx = adaptived_init(config_path);
+	if (!ctx)
+		goto err;
+
+	ret = adaptived_register_injection_function(ctx, inject);
+	if (ret)
+		goto err;
+
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_MAX_LOOPS, ARRAY_SIZE(full_avg10));
+	if (ret)
+		goto err;
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_INTERVAL, 3000);
+	if (ret)
+		goto err;
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_SKIP_SLEEP, 1);
+	if (ret)
+		goto err;
+
+	ret = adaptived_loop(ctx, true);
+	if (ret != EXPECTED_RET) {
+		adaptived_err("Expected %d, got %d\n", EXPECTED_RET, ret);
+		goto err;
+	}
+
+	adaptived_release(&ctx);
+	(void)remove(pressure_file);
+
+	return AUTOMAKE_PASSED;
+
+err:
+	if (ctx)
+		adaptived_release(&ctx);
+	(void)remove(pressure_file);
+
+	return AUTOMAKE_HARD_ERROR;
+}
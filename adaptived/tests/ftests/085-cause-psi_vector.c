@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2024, Oracle and/or its affiliates.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+/**
+ * Test the psi_vector cause and the PSI vector that it shares with its effects
+ *
+ * The cgroup has 30% "some" memory pressure, 12% "full" memory pressure, and only
+ * 5% "some" io pressure.  Only the rule that uses the max predicate triggers
+ */
+
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <errno.h>
+
+#include <adaptived-utils.h>
+#include <adaptived.h>
+
+#include "ftests.h"
+
+#define EXPECTED_RET -85
+
+static const char * const cgroup_dir = "085-cause-psi_vector.cgroup";
+
+static const char * const cpu_pressure =
+	"some avg10=1.00 avg60=1.00 avg300=1.00 total=100\n"
+	"full avg10=0.00 avg60=0.00 avg300=0.00 total=0\n";
+static const char * const memory_pressure =
+	"some avg10=30.00 avg60=20.00 avg300=10.00 total=3000\n"
+	"full avg10=12.00 avg60=8.00 avg300=4.00 total=1200\n";
+static const char * const io_pressure =
+	"some avg10=5.00 avg60=5.00 avg300=5.00 total=500\n"
+	"full avg10=1.00 avg60=1.00 avg300=1.00 total=100\n";
+
+struct check_vector_opts {
+	const struct adaptived_cause *cse;
+};
+
+static int check_vector_init(struct adaptived_effect * const eff, struct json_object *args_obj,
+			     const struct adaptived_cause * const cse)
+{
+	struct check_vector_opts *opts;
+
+	opts = malloc(sizeof(struct check_vector_opts));
+	if (!opts)
+		return -ENOMEM;
+
+	opts->cse = cse;
+
+	return adaptived_effect_set_data(eff, opts);
+}
+
+static int check_vector_main(struct adaptived_effect * const eff)
+{
+	struct check_vector_opts *opts = adaptived_effect_get_data(eff);
+	enum adaptived_sdata_type type;
+	struct adaptived_psi_vector *vec;
+	uint32_t flags;
+	void *data;
+	int ret;
+
+	if (adaptived_get_shared_data_cnt(opts->cse) != 1)
+		return -EINVAL;
+
+	ret = adaptived_get_shared_data(opts->cse, 0, &type, &data, &flags);
+	if (ret)
+		return ret;
+	if (type != ADAPTIVED_SDATA_PSI_VECTOR)
+		return -EINVAL;
+
+	vec = data;
+
+	/* the whole vector is shared, not just the resources used by the rule */
+	if (vec->res[ADAPTIVED_PSI_CPU].some.avg10 != 1.0f ||
+	    vec->res[ADAPTIVED_PSI_MEMORY].some.avg10 != 30.0f ||
+	    vec->res[ADAPTIVED_PSI_MEMORY].full.total != 1200 ||
+	    vec->res[ADAPTIVED_PSI_IO].some.avg60 != 5.0f)
+		return -EINVAL;
+
+	/* max(2 * 30.0, 1 * 5.0) */
+	if (vec->value != 60.0f)
+		return -EINVAL;
+
+	return EXPECTED_RET;
+}
+
+static void check_vector_exit(struct adaptived_effect * const eff)
+{
+	free(adaptived_effect_get_data(eff));
+}
+
+static const struct adaptived_effect_functions check_vector_fns = {
+	check_vector_init,
+	check_vector_main,
+	check_vector_exit,
+};
+
+static void cleanup(void)
+{
+	char path[FILENAME_MAX];
+
+	snprintf(path, sizeof(path), "%s/cpu.pressure", cgroup_dir);
+	(void)remove(path);
+	snprintf(path, sizeof(path), "%s/memory.pressure", cgroup_dir);
+	(void)remove(path);
+	snprintf(path, sizeof(path), "%s/io.pressure", cgroup_dir);
+	(void)remove(path);
+	(void)rmdir(cgroup_dir);
+}
+
+int main(int argc, char *argv[])
+{
+	char config_path[FILENAME_MAX];
+	char path[FILENAME_MAX];
+	struct adaptived_ctx *ctx = NULL;
+	int ret;
+
+	snprintf(config_path, FILENAME_MAX - 1, "%s/085-cause-psi_vector.json", argv[1]);
+	config_path[FILENAME_MAX - 1] = '\0';
+
+	if (mkdir(cgroup_dir, 0755) && errno != EEXIST)
+		goto err;
+
+	snprintf(path, sizeof(path), "%s/cpu.pressure", cgroup_dir);
+	write_file(path, cpu_pressure);
+	snprintf(path, sizeof(path), "%s/memory.pressure", cgroup_dir);
+	write_file(path, memory_pressure);
+	snprintf(path, sizeof(path), "%s/io.pressure", cgroup_dir);
+	write_file(path, io_pressure);
+
+	ctx = adaptived_init(config_path);
+	if (!ctx)
+		goto err;
+
+	ret = adaptived_register_effect(ctx, "check_vector", &check_vector_fns);
+	if (ret)
+		goto err;
+
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_MAX_LOOPS, 3);
+	if (ret)
+		goto err;
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_INTERVAL, 1000);
+	if (ret)
+		goto err;
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_SKIP_SLEEP, 1);
+	if (ret)
+		goto err;
+
+	ret = adaptived_loop(ctx, true);
+	if (ret != EXPECTED_RET) {
+		adaptived_err("Expected %d, got %d\n", EXPECTED_RET, ret);
+		goto err;
+	}
+
+	adaptived_release(&ctx);
+	cleanup();
+
+	return AUTOMAKE_PASSED;
+
+err:
+	if (ctx)
+		adaptived_release(&ctx);
+	cleanup();
+
+	return AUTOMAKE_HARD_ERROR;
+}
@@ -0,0 +1,235 @@
+/*
+ * Copyright (c) 2024, Oracle and/or its affiliates.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+/**
+ * Test to exercise the cgroup setting by psi effect when cgroups are created
+ * and removed while adaptived is running.  The effect's view of the cgroup tree
+ * must follow the changes.
+ *
+ * Note that this test creates a fake cgroup hierarchy directly in the
+ * tests/ftests directory and operates on it.
+ *
+ */
+
+#include <sys/stat.h>
+#include <unistd.h>
+#include <syslog.h>
+#include <string.h>
+#include <errno.h>
+
+#include <adaptived.h>
+
+#include "ftests.h"
+
+#define EXPECTED_RET -ETIME
+#define LOOP_CNT 3
+
+typedef int (*adaptived_injection_function)(struct adaptived_ctx * const ctx);
+extern int adaptived_register_injection_function(struct adaptived_ctx * const ctx,
+					      adaptived_injection_function fn);
+
+static int ctr = 0;
+static int child2_ret = -ENOENT;
+
+static const char * const cgroup_dirs[] = {
+	"./test087cgroup",
+	"./test087cgroup/child1",
+};
+static const int cgroup_dirs_cnt = ARRAY_SIZE(cgroup_dirs);
+
+/* child2 is created before the second loop and removed before the third */
+static const char * const child2_dir = "./test087cgroup/child2";
+static const char * const child2_psi_file = "./test087cgroup/child2/cpu.pressure";
+static const char * const child2_cgroup_file = "./test087cgroup/child2/cpu.weight";
+
+static const char * const psi_files[] = {
+	"./test087cgroup/cpu.pressure",
+	"./test087cgroup/child1/cpu.pressure",
+};
+static const int psi_files_cnt = ARRAY_SIZE(psi_files);
+
+static const float some_avg60[LOOP_CNT][ARRAY_SIZE(psi_files) + 1] = {
+	/*   ./, child1, child2 */
+	{   1.0,    5.0,    0.0 }, /* child1 gets set */
+	{   1.0,    5.0,    9.0 }, /* child2 gets set */
+	{   3.0,    2.0,    0.0 }, /* ./ gets set */
+};
+
+static const char * const cgroup_files[] = {
+	"./test087cgroup/cpu.weight",
+	"./test087cgroup/child1/cpu.weight",
+};
+static const int cgroup_files_cnt = ARRAY_SIZE(cgroup_files);
+
+static const int expected_cgroup_files_contents[] = {
+	75,
+	75,
+};
+static_assert(ARRAY_SIZE(expected_cgroup_files_contents) == ARRAY_SIZE(cgroup_files),
+	      "expected cgroup file contents array must be same length as cgroup files array");
+
+static void write_psi_file(const char * const file, float avg60)
+{
+	char val[1024];
+
+	memset(val, '\0', sizeof(val));
+	sprintf(val, "some avg10=0.00 avg60=%.2f avg300=0.00 total=1234\n"
+		"full avg10=0.00 avg60=0.00 avg300=0.00 total=5678", avg60);
+
+	write_file(file, val);
+}
+
+static void write_psi_files(int loop_cnt)
+{
+	int i;
+
+	for (i = 0; i < psi_files_cnt; i++)
+		write_psi_file(psi_files[i], some_avg60[loop_cnt][i]);
+}
+
+static void write_cgroup_files(void)
+{
+	int i;
+
+	for (i = 0; i < cgroup_files_cnt; i++)
+		write_file(cgroup_files[i], "100");
+}
+
+static int validate_files(void)
+{
+	int ret, i;
+
+	for (i = 0; i < cgroup_files_cnt; i++) {
+		ret = verify_int_file(cgroup_files[i], expected_cgroup_files_contents[i]);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+static void delete_child2(void)
+{
+	const char * const files[] = { child2_psi_file, child2_cgroup_file };
+	const char * const dirs[] = { child2_dir };
+
+	delete_files(files, ARRAY_SIZE(files));
+	delete_dirs(dirs, ARRAY_SIZE(dirs));
+}
+
+static int inject(struct adaptived_ctx * const ctx)
+{
+	int ret;
+
+	if (ctr >= LOOP_CNT)
+		return -E2BIG;
+
+	switch (ctr) {
+	case 1:
+		ret = mkdir(child2_dir, S_IRWXU | S_IRWXG | S_IRWXO);
+		if (ret)
+			return -errno;
+
+		write_file(child2_cgroup_file, "100");
+		write_psi_file(child2_psi_file, some_avg60[ctr][psi_files_cnt]);
+		break;
+	case 2:
+		child2_ret = verify_int_file(child2_cgroup_file, 75);
+		delete_child2();
+		break;
+	default:
+		break;
+	}
+
+	write_psi_files(ctr);
+	ctr++;
+
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	char config_path[FILENAME_MAX];
+	struct adaptived_ctx *ctx = NULL;
+	int ret;
+
+	snprintf(config_path, FILENAME_MAX - 1, "%s/087-effect-cgroup_setting_by_psi_new_cgroup.json",
+		 argv[1]);
+	config_path[FILENAME_MAX - 1] = '\0';
+
+	ctx = adaptived_init(config_path);
+	if (!ctx)
+		return AUTOMAKE_HARD_ERROR;
+
+	ret = create_dirs(cgroup_dirs, cgroup_dirs_cnt);
+	if (ret)
+		goto err;
+
+	write_cgroup_files();
+
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_MAX_LOOPS, LOOP_CNT);
+	if (ret)
+		goto err;
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_INTERVAL, 10000);
+	if (ret)
+		goto err;
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_SKIP_SLEEP, 1);
+	if (ret)
+		goto err;
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_LOG_LEVEL, LOG_INFO);
+	if (ret)
+		goto err;
+	ret = adaptived_register_injection_function(ctx, inject);
+	if (ret)
+		goto err;
+
+	ret = adaptived_loop(ctx, true);
+	if (ret != EXPECTED_RET) {
+		adaptived_err("Test 087 returned: %d, expected: %d\n", ret, EXPECTED_RET);
+		goto err;
+	}
+
+	if (child2_ret) {
+		adaptived_err("Test 087: child2 wasn't set: %d\n", child2_ret);
+		goto err;
+	}
+
+	ret = validate_files();
+	if (ret)
+		goto err;
+
+	delete_files(cgroup_files, cgroup_files_cnt);
+	delete_files(psi_files, psi_files_cnt);
+	delete_dirs(cgroup_dirs, cgroup_dirs_cnt);
+	adaptived_release(&ctx);
+
+	return AUTOMAKE_PASSED;
+
+err:
+	delete_child2();
+	delete_files(cgroup_files, cgroup_files_cnt);
+	delete_files(psi_files, psi_files_cnt);
+	delete_dirs(cgroup_dirs, cgroup_dirs_cnt);
+	adaptived_release(&ctx);
+
+	return AUTOMAKE_HARD_ERROR;
+}
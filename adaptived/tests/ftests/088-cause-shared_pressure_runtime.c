@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2024, Oracle and/or its affiliates.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+/**
+ * Test that a shared cause with a duration is evaluated once per interval when the
+ * rules that share it run on different schedules
+ *
+ * The second rule is loaded while the main loop is running, so its deadlines are
+ * not aligned with the first rule's.  The pressure is always above the threshold,
+ * and the duration is reached on every third evaluation of the shared instance.
+ * Both rules must see every trigger, i.e. each must trigger on roughly every third
+ * run.  If the shared instance were evaluated by each rule separately, the duration
+ * would accumulate twice as fast and the triggers would be split between the rules
+ */
+
+#include <pthread.h>
+#include <unistd.h>
+#include <string.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include <adaptived.h>
+
+#include "ftests.h"
+
+#define EXPECTED_RET -ETIME
+
+#define INTERVAL 200
+#define DURATION 500
+#define MIN_RUNS 8
+
+static const char * const pressure_file = "088-cause-shared_pressure_runtime.pressure";
+static const char * const rule_name = "second";
+
+static void *adaptived_wrapper(void *arg)
+{
+	struct adaptived_ctx *ctx = arg;
+	uintptr_t ret;
+
+	ret = adaptived_loop(ctx, true);
+
+	return (void *)ret;
+}
+
+static int write_pressure(void)
+{
+	const char * const buf = "some avg10=90.00 avg60=0.00 avg300=0.00 total=0\n"
+				 "full avg10=0.00 avg60=0.00 avg300=0.00 total=0";
+	int fd, ret = 0;
+	ssize_t w;
+
+	fd = open(pressure_file, O_TRUNC | O_WRONLY | O_CREAT, S_IWUSR | S_IRUSR);
+	if (fd <= 0)
+		return -EINVAL;
+
+	w = write(fd, buf, strlen(buf));
+	if (w <= 0)
+		ret = -errno;
+
+	close(fd);
+
+	return ret;
+}
+
+/*
+ * The shared instance triggers on every third evaluation.  Allow for the run that
+ * was in progress when the rule was loaded or the loop ended
+ */
+static bool triggered_every_third_run(long long runs, long long triggers)
+{
+	return runs >= MIN_RUNS && triggers * 3 + 3 >= runs && triggers * 3 <= runs + 3;
+}
+
+int main(int argc, char *argv[])
+{
+	struct adaptived_rule_stats stats1_start, stats1, stats2;
+	struct adaptived_cause *cse = NULL;
+	struct adaptived_effect *eff = NULL;
+	struct adaptived_rule *rule = NULL;
+	char config_path[FILENAME_MAX];
+	struct adaptived_ctx *ctx = NULL;
+	pthread_t adaptived_thread;
+	void *tret;
+	int ret;
+
+	snprintf(config_path, FILENAME_MAX - 1, "%s/088-cause-shared_pressure_runtime.json",
+		 argv[1]);
+	config_path[FILENAME_MAX - 1] = '\0';
+
+	ret = write_pressure();
+	if (ret)
+		goto err;
+
+	/* the same cause as the first rule in the json file */
+	cse = adaptived_build_cause("pressure");
+	if (!cse)
+		goto err;
+	ret = adaptived_cause_add_string_arg(cse, "pressure_file", pressure_file);
+	if (ret)
+		goto err;
+	ret = adaptived_cause_add_int_arg(cse, "threshold", 50);
+	if (ret)
+		goto err;
+	ret = adaptived_cause_add_int_arg(cse, "duration", DURATION);
+	if (ret)
+		goto err;
+	ret = adaptived_cause_add_string_arg(cse, "operator", "greaterthan");
+	if (ret)
+		goto err;
+	ret = adaptived_cause_add_string_arg(cse, "measurement", "some-avg10");
+	if (ret)
+		goto err;
+
+	eff = adaptived_build_effect("print");
+	if (!eff)
+		goto err;
+	ret = adaptived_effect_add_string_arg(eff, "message", "second triggered\n");
+	if (ret)
+		goto err;
+	ret = adaptived_effect_add_string_arg(eff, "file", "stdout");
+	if (ret)
+		goto err;
+
+	rule = adaptived_build_rule(rule_name);
+	if (!rule)
+		goto err;
+	ret = adaptived_rule_add_cause(rule, cse);
+	if (ret)
+		goto err;
+	ret = adaptived_rule_add_effect(rule, eff);
+	if (ret)
+		goto err;
+
+	ctx = adaptived_init(config_path);
+	if (!ctx)
+		goto err;
+
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_INTERVAL, INTERVAL);
+	if (ret)
+		goto err;
+	/* roughly one second before the second rule is loaded and three seconds after */
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_MAX_LOOPS, 35);
+	if (ret)
+		goto err;
+
+	ret = pthread_create(&adaptived_thread, NULL, &adaptived_wrapper, ctx);
+	if (ret)
+		goto err;
+
+	/* load the second rule partway through the first rule's interval */
+	usleep(1100 * 1000);
+
+	ret = adaptived_get_rule_stats(ctx, "first", &stats1_start);
+	if (ret)
+		goto err;
+	ret = adaptived_load_rule(ctx, rule);
+	if (ret)
+		goto err;
+
+	pthread_join(adaptived_thread, &tret);
+
+	if (tret != (void *)EXPECTED_RET)
+		goto err;
+
+	ret = adaptived_get_rule_stats(ctx, "first", &stats1);
+	if (ret)
+		goto err;
+	ret = adaptived_get_rule_stats(ctx, rule_name, &stats2);
+	if (ret)
+		goto err;
+
+	if (!triggered_every_third_run(stats1.loops_run_cnt - stats1_start.loops_run_cnt,
+				       stats1.trigger_cnt - stats1_start.trigger_cnt))
+		goto err;
+	if (!triggered_every_third_run(stats2.loops_run_cnt, stats2.trigger_cnt))
+		goto err;
+
+	adaptived_release_cause(&cse);
+	adaptived_release_effect(&eff);
+	adaptived_release_rule(&rule);
+
+	adaptived_release(&ctx);
+	(void)remove(pressure_file);
+
+	return AUTOMAKE_PASSED;
+
+err:
+	adaptived_release_cause(&cse);
+	adaptived_release_effect(&eff);
+	adaptived_release_rule(&rule);
+
+	if (ctx)
+		adaptived_release(&ctx);
+	(void)remove(pressure_file);
+
+	return AUTOMAKE_HARD_ERROR;
+}
@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2024, Oracle and/or its affiliates.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+/**
+ * Test that a slabinfo cause whose slab cache is missing doesn't stop adaptived
+ *
+ * Slab caches come and go, and slab merging hides some of them.  A missing slab
+ * cache is compared as 0, so the "greaterthan" rule never triggers, the
+ * "lessthan" rule triggers on every pass, and the main loop runs until it
+ * reaches its maximum number of loops.
+ */
+
+#include <unistd.h>
+#include <string.h>
+#include <syslog.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include <adaptived.h>
+
+#include "ftests.h"
+
+#define EXPECTED_RET -ETIME
+#define MAX_LOOPS 4
+
+static const char * const slabinfo_file = "089-cause-slabinfo_missing.setting";
+
+#define SLABINFO_LINE0	"# name            <active_objs> <num_objs> <objsize> <objperslab> <pagesperslab> : tunables <limit> <batchcount> <sharedfactor> : slabdata <active_slabs> <num_slabs> <sharedavail>\n"
+#define SLABINFO_LINE1	"kmalloc-32        172487 226688     32  128    1 : tunables    0    0    0 : slabdata   1771   1771      0\n"
+
+static int write_slabinfo(void)
+{
+	int fd, ret = 0;
+	ssize_t w;
+
+	fd = open(slabinfo_file, O_TRUNC | O_WRONLY | O_CREAT, S_IWUSR | S_IRUSR);
+	if (fd <= 0)
+		return -EINVAL;
+
+	w = write(fd, SLABINFO_LINE0 SLABINFO_LINE1, strlen(SLABINFO_LINE0 SLABINFO_LINE1));
+	if (w <= 0)
+		ret = -errno;
+
+	close(fd);
+
+	return ret;
+}
+
+int main(int argc, char *argv[])
+{
+	struct adaptived_rule_stats stats;
+	char config_path[FILENAME_MAX];
+	struct adaptived_ctx *ctx = NULL;
+	int ret;
+
+	snprintf(config_path, FILENAME_MAX - 1, "%s/089-cause-slabinfo_missing.json", argv[1]);
+	config_path[FILENAME_MAX - 1] = '\0';
+
+	ret = write_slabinfo();
+	if (ret)
+		goto err;
+
+	ctx = adaptived_init(config_path);
+	if (!ctx)
+		goto err;
+
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_MAX_LOOPS, MAX_LOOPS);
+	if (ret)
+		goto err;
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_INTERVAL, 4000);
+	if (ret)
+		goto err;
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_SKIP_SLEEP, 1);
+	if (ret)
+		goto err;
+	ret = adaptived_set_attr(ctx, ADAPTIVED_ATTR_LOG_LEVEL, LOG_DEBUG);
+	if (ret)
+		goto err;
+
+	ret = adaptived_loop(ctx, true);
+	if (ret != EXPECTED_RET)
+		goto err;
+
+	ret = adaptived_get_rule_stats(ctx, "missing cache > threshold", &stats);
+	if (ret)
+		goto err;
+	if (stats.loops_run_cnt != MAX_LOOPS || stats.trigger_cnt != 0)
+		goto err;
+
+	ret = adaptived_get_rule_stats(ctx, "missing cache < threshold", &stats);
+	if (ret)
+		goto err;
+	if (stats.loops_run_cnt != MAX_LOOPS || stats.trigger_cnt != MAX_LOOPS)
+		goto err;
+
+	adaptived_release(&ctx);
+	(void)remove(slabinfo_file);
+	return AUTOMAKE_PASSED;
+
+err:
+	if (ctx)
+		adaptived_release(&ctx);
+
+	(void)remove(slabinfo_file);
+	return AUTOMAKE_HARD_ERROR;
+}
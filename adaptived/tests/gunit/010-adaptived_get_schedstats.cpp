@@ -142,3 +142,95 @@ TEST_F(GetSchedstatsTest, GetSnapshot)
 	ASSERT_EQ(ss.schedstat_cpus[3].schedstat_domains[1].ttwu_remote, 15U);
 	ASSERT_EQ(ss.schedstat_cpus[3].schedstat_domains[1].ttwu_move_affine, 16U);
 }
+
+TEST_F(GetSchedstatsTest, GetCpus)
+{
+	struct adaptived_schedstat_cpus *ss = NULL;
+	int ret;
+
+	ret = adaptived_get_schedstat_cpus(schedstats_file, &ss);
+	ASSERT_EQ(ret, 0);
+	ASSERT_NE(ss, nullptr);
+
+	ASSERT_EQ(ss->nr_cpus, 4);
+	ASSERT_EQ(ss->timestamp, 5979263307LU);
+	ASSERT_EQ(ss->cpu[3], 3);
+	ASSERT_EQ(ss->run_time[0], 43076095314418LLU);
+	ASSERT_EQ(ss->run_delay[1], 136791545255LLU);
+	ASSERT_EQ(ss->nr_timeslices[2], 527416276LLU);
+	ASSERT_EQ(ss->run_delay[3], 172082515008LLU);
+
+	/* the snapshot is reused when it's big enough */
+	CreateFile(schedstats_file,
+		   "version 15\n"
+		   "timestamp 100\n"
+		   "cpu0 0 0 0 0 7 6 5 4 3\n"
+		   "cpu8 0 0 0 0 1 2 3 4 5\n");
+	ret = adaptived_get_schedstat_cpus(schedstats_file, &ss);
+	ASSERT_EQ(ret, 0);
+	ASSERT_EQ(ss->nr_cpus, 2);
+	ASSERT_EQ(ss->max_cpus, 4);
+	ASSERT_EQ(ss->cpu[1], 8);
+	ASSERT_EQ(ss->ttwu[0], 7LLU);
+	ASSERT_EQ(ss->ttwu_local[1], 2LLU);
+
+	adaptived_schedstat_cpus_free(&ss);
+	ASSERT_EQ(ss, nullptr);
+
+	ret = adaptived_get_schedstat_cpus("invalid_filename", &ss);
+	ASSERT_LT(ret, 0);
+}
+
+TEST_F(GetSchedstatsTest, Diff)
+{
+	struct adaptived_schedstat_cpus *prev = NULL, *cur = NULL;
+	double run_delay_rate[4], ttwu_rate[4];
+	int ret;
+
+	CreateFile(schedstats_file,
+		   "cpu0 0 0 0 0 100 0 0 1000 0\n"
+		   "cpu1 0 0 0 0 200 0 0 2000 0\n"
+		   "cpu2 0 0 0 0 300 0 0 3000 0\n");
+	ret = adaptived_get_schedstat_cpus(schedstats_file, &prev);
+	ASSERT_EQ(ret, 0);
+
+	CreateFile(schedstats_file,
+		   "cpu0 0 0 0 0 150 0 0 3000 0\n"
+		   "cpu1 0 0 0 0 200 0 0 2500 0\n"
+		   "cpu2 0 0 0 0 400 0 0 3000 0\n");
+	ret = adaptived_get_schedstat_cpus(schedstats_file, &cur);
+	ASSERT_EQ(ret, 0);
+
+	/* pretend that the snapshots were taken two seconds apart */
+	cur->read_ns = prev->read_ns + 2000000000LL;
+
+	ret = adaptived_schedstat_diff(prev, cur, run_delay_rate, ttwu_rate, 4);
+	ASSERT_EQ(ret, 0);
+	ASSERT_DOUBLE_EQ(run_delay_rate[0], 1000.0);
+	ASSERT_DOUBLE_EQ(run_delay_rate[1], 250.0);
+	ASSERT_DOUBLE_EQ(run_delay_rate[2], 0.0);
+	ASSERT_DOUBLE_EQ(ttwu_rate[0], 25.0);
+	ASSERT_DOUBLE_EQ(ttwu_rate[1], 0.0);
+	ASSERT_DOUBLE_EQ(ttwu_rate[2], 50.0);
+
+	/* cpu1 went offline and cpu3 came online */
+	CreateFile(schedstats_file,
+		   "cpu0 0 0 0 0 200 0 0 5000 0\n"
+		   "cpu2 0 0 0 0 500 0 0 3000 0\n"
+		   "cpu3 0 0 0 0 900 0 0 9000 0\n");
+	ret = adaptived_get_schedstat_cpus(schedstats_file, &prev);
+	ASSERT_EQ(ret, 0);
+	prev->read_ns = cur->read_ns + 1000000000LL;
+
+	ret = adaptived_schedstat_diff(cur, prev, run_delay_rate, NULL, 4);
+	ASSERT_EQ(ret, 0);
+	ASSERT_DOUBLE_EQ(run_delay_rate[0], 2000.0);
+	ASSERT_DOUBLE_EQ(run_delay_rate[1], 0.0);
+	ASSERT_DOUBLE_EQ(run_delay_rate[2], 0.0);
+
+	ret = adaptived_schedstat_diff(cur, prev, run_delay_rate, NULL, 2);
+	ASSERT_EQ(ret, -EINVAL);
+
+	adaptived_schedstat_cpus_free(&prev);
+	adaptived_schedstat_cpus_free(&cur);
+}
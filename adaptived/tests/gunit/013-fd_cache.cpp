@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2025, Oracle and/or its affiliates.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+/**
+ * adaptived googletest for the procfs/cgroupfs file descriptor cache
+ */
+
+#include <dirent.h>
+
+#include <adaptived-utils.h>
+#include <adaptived.h>
+
+#include "gtest/gtest.h"
+
+class FdCacheTest : public ::testing::Test {
+};
+
+static int CountOpenFds(void)
+{
+	struct dirent *de;
+	int cnt = 0;
+	DIR *dir;
+
+	dir = opendir("/proc/self/fd");
+	if (!dir)
+		return -1;
+
+	while ((de = readdir(dir)) != NULL) {
+		if (de->d_name[0] != '.')
+			cnt++;
+	}
+
+	closedir(dir);
+
+	return cnt;
+}
+
+static void CreateFile(const char * const filename, const char * const contents)
+{
+	FILE *f;
+
+	f = fopen(filename, "w");
+	ASSERT_NE(f, nullptr);
+
+	fprintf(f, "%s", contents);
+	fclose(f);
+}
+
+TEST_F(FdCacheTest, ProcfsFileStaysOpen)
+{
+	const char * const filename = "/proc/sys/kernel/pid_max";
+	long long first, value;
+	int fds, ret, i;
+
+	ret = adaptived_cgroup_get_ll(filename, &first);
+	if (ret == -ENOENT || ret == -EACCES)
+		GTEST_SKIP();
+	ASSERT_EQ(ret, 0);
+
+	fds = CountOpenFds();
+	ASSERT_GT(fds, 0);
+
+	for (i = 0; i < 100; i++) {
+		ret = adaptived_cgroup_get_ll(filename, &value);
+		ASSERT_EQ(ret, 0);
+		ASSERT_EQ(value, first);
+	}
+
+	/* the cached descriptor is reused rather than a new one being opened */
+	ASSERT_EQ(CountOpenFds(), fds);
+}
+
+TEST_F(FdCacheTest, RegularFileIsReopened)
+{
+	char filename[] = "./FdCacheRegularFileIsReopened";
+	long long value;
+	int fds, ret;
+
+	remove(filename);
+	CreateFile(filename, "1234");
+
+	fds = CountOpenFds();
+
+	ret = adaptived_cgroup_get_ll(filename, &value);
+	ASSERT_EQ(ret, 0);
+	ASSERT_EQ(value, 1234);
+
+	/* regular files are not kept open */
+	ASSERT_EQ(CountOpenFds(), fds);
+
+	/* a new file with the same name must be read, not the old one */
+	remove(filename);
+	CreateFile(filename, "5678");
+
+	ret = adaptived_cgroup_get_ll(filename, &value);
+	ASSERT_EQ(ret, 0);
+	ASSERT_EQ(value, 5678);
+
+	remove(filename);
+
+	ret = adaptived_cgroup_get_ll(filename, &value);
+	ASSERT_EQ(ret, -ENOENT);
+}
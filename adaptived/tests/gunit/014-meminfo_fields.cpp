@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2025, Oracle and/or its affiliates.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+/**
+ * adaptived googletest for adaptived_get_meminfo_fields()
+ */
+
+#include <string>
+
+#include <adaptived-utils.h>
+#include <adaptived.h>
+
+#include "gtest/gtest.h"
+
+static const char * const meminfo_keys[] = {
+	"MemTotal", "MemFree", "MemAvailable", "Buffers", "Cached", "SwapCached",
+	"Active", "Inactive", "Active(anon)", "Inactive(anon)", "Active(file)",
+	"Inactive(file)", "Unevictable", "Mlocked", "HighTotal", "HighFree",
+	"LowTotal", "LowFree", "MmapCopy", "SwapTotal", "SwapFree", "Zswap",
+	"Zswapped", "Dirty", "Writeback", "AnonPages", "Mapped", "Shmem",
+	"KReclaimable", "Slab", "SReclaimable", "SUnreclaim", "KernelStack",
+	"ShadowCallStack", "PageTables", "SecPageTables", "NFS_Unstable", "Bounce",
+	"WritebackTmp", "CommitLimit", "Committed_AS", "VmallocTotal", "VmallocUsed",
+	"VmallocChunk", "Percpu", "HardwareCorrupted", "AnonHugePages",
+	"ShmemHugePages", "ShmemPmdMapped", "FileHugePages", "FilePmdMapped",
+	"CmaTotal", "CmaFree", "Unaccepted", "Balloon", "HugePages_Total",
+	"HugePages_Free", "HugePages_Rsvd", "HugePages_Surp", "Hugepagesize",
+	"Hugetlb", "DirectMap4k", "DirectMap2M", "DirectMap4M", "DirectMap1G",
+	/* not a key that adaptived knows about */
+	"FutureKey",
+};
+static const int key_cnt = sizeof(meminfo_keys) / sizeof(meminfo_keys[0]);
+
+class MeminfoFieldsTest : public ::testing::Test {
+};
+
+static void CreateFile(const char * const filename, const char * const contents)
+{
+	FILE *f;
+
+	f = fopen(filename, "w");
+	ASSERT_NE(f, nullptr);
+
+	fprintf(f, "%s", contents);
+	fclose(f);
+}
+
+TEST_F(MeminfoFieldsTest, AllFields)
+{
+	const char * const filename = "test014.meminfo";
+	struct adaptived_meminfo_request reqs[key_cnt];
+	std::string contents;
+	int ret, i;
+
+	/* Write the keys in reverse order so that the lookup can't rely on the order */
+	for (i = key_cnt - 1; i >= 0; i--) {
+		contents += meminfo_keys[i];
+		contents += ":    ";
+		contents += std::to_string(1000 + i);
+		if (i % 2)
+			contents += " kB";
+		contents += "\n";
+	}
+	CreateFile(filename, contents.c_str());
+
+	for (i = 0; i < key_cnt; i++) {
+		reqs[i].field = meminfo_keys[i];
+		reqs[i].value = -1;
+		reqs[i].ret = 1;
+	}
+
+	ret = adaptived_get_meminfo_fields(filename, reqs, key_cnt);
+	ASSERT_EQ(ret, 0);
+
+	for (i = 0; i < key_cnt; i++) {
+		ASSERT_EQ(reqs[i].ret, 0) << meminfo_keys[i];
+		if (i % 2)
+			ASSERT_EQ(reqs[i].value, (1000 + i) * 1024LL) << meminfo_keys[i];
+		else
+			ASSERT_EQ(reqs[i].value, 1000 + i) << meminfo_keys[i];
+	}
+
+	remove(filename);
+}
+
+TEST_F(MeminfoFieldsTest, ExactMatch)
+{
+	const char * const filename = "test014.exact";
+	struct adaptived_meminfo_request reqs[] = {
+		{ "Cached", 0, 0 },
+		{ "SwapCached", 0, 0 },
+		{ "Active", 0, 0 },
+		{ "Cache", 0, 0 },
+		{ "FutureKey", 0, 0 },
+	};
+	long long value;
+	int ret;
+
+	CreateFile(filename,
+		   "SwapCached:   11 kB\n"
+		   "Active(anon): 22 kB\n"
+		   "FutureKeyLonger: 33 kB\n"
+		   "Cached:       44 kB\n"
+		   "Active:       55 kB\n"
+		   "FutureKey:    66 kB\n");
+
+	ret = adaptived_get_meminfo_fields(filename, reqs, sizeof(reqs) / sizeof(reqs[0]));
+	ASSERT_EQ(ret, -ENOENT);
+
+	ASSERT_EQ(reqs[0].ret, 0);
+	ASSERT_EQ(reqs[0].value, 44 * 1024);
+	ASSERT_EQ(reqs[1].ret, 0);
+	ASSERT_EQ(reqs[1].value, 11 * 1024);
+	ASSERT_EQ(reqs[2].ret, 0);
+	ASSERT_EQ(reqs[2].value, 55 * 1024);
+	ASSERT_EQ(reqs[3].ret, -ENOENT);
+	ASSERT_EQ(reqs[4].ret, 0);
+	ASSERT_EQ(reqs[4].value, 66 * 1024);
+
+	ret = adaptived_get_meminfo_field(filename, "Cached", &value);
+	ASSERT_EQ(ret, 0);
+	ASSERT_EQ(value, 44 * 1024);
+
+	ret = adaptived_get_meminfo_field(filename, "FutureKey", &value);
+	ASSERT_EQ(ret, 0);
+	ASSERT_EQ(value, 66 * 1024);
+
+	remove(filename);
+}
+
+TEST_F(MeminfoFieldsTest, InvalidValue)
+{
+	const char * const filename = "test014.invalid";
+	struct adaptived_meminfo_request reqs[] = {
+		{ "MemTotal", 0, 0 },
+		{ "MemFree", 0, 0 },
+	};
+	int ret;
+
+	CreateFile(filename,
+		   "MemTotal:     1234 kB\n"
+		   "MemFree:      abcd kB\n");
+
+	ret = adaptived_get_meminfo_fields(filename, reqs, sizeof(reqs) / sizeof(reqs[0]));
+	ASSERT_EQ(ret, -EINVAL);
+	ASSERT_EQ(reqs[0].ret, 0);
+	ASSERT_EQ(reqs[0].value, 1234 * 1024);
+	ASSERT_EQ(reqs[1].ret, -EINVAL);
+
+	remove(filename);
+}
@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2025, Oracle and/or its affiliates.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+/**
+ * adaptived googletest for adaptived_cgroup_get_memorystat()
+ */
+
+#include <string>
+
+#include <adaptived-utils.h>
+#include <adaptived.h>
+
+#include "gtest/gtest.h"
+
+class MemorystatTest : public ::testing::Test {
+};
+
+static void CreateFile(const char * const filename, const char * const contents)
+{
+	FILE *f;
+
+	f = fopen(filename, "w");
+	ASSERT_NE(f, nullptr);
+
+	fprintf(f, "%s", contents);
+	fclose(f);
+}
+
+TEST_F(MemorystatTest, KnownAndExtraFields)
+{
+	const char * const filename = "test015.memory.stat";
+	struct adaptived_memorystat_snapshot snap;
+	long long value;
+	int ret;
+
+	/* slab is intentionally out of the kernel's order */
+	CreateFile(filename,
+		   "slab 99\n"
+		   "anon 1000\n"
+		   "file 2000\n"
+		   "hugetlb 3000\n"
+		   "workingset_refault_anon 4000\n"
+		   "workingset_refault_file 5000\n"
+		   "pgmajfault 6000\n"
+		   "bogus abc\n");
+
+	ret = adaptived_cgroup_get_memorystat(filename, &snap);
+	ASSERT_EQ(ret, 0);
+
+	ASSERT_TRUE(snap.present[ADAPTIVED_MEMORYSTAT_ANON]);
+	ASSERT_EQ(snap.values[ADAPTIVED_MEMORYSTAT_ANON], 1000);
+	ASSERT_EQ(snap.values[ADAPTIVED_MEMORYSTAT_FILE], 2000);
+	ASSERT_EQ(snap.values[ADAPTIVED_MEMORYSTAT_WORKINGSET_REFAULT_ANON], 4000);
+	ASSERT_EQ(snap.values[ADAPTIVED_MEMORYSTAT_WORKINGSET_REFAULT_FILE], 5000);
+	ASSERT_EQ(snap.values[ADAPTIVED_MEMORYSTAT_PGMAJFAULT], 6000);
+	ASSERT_EQ(snap.values[ADAPTIVED_MEMORYSTAT_SLAB], 99);
+	ASSERT_FALSE(snap.present[ADAPTIVED_MEMORYSTAT_SHMEM]);
+
+	ASSERT_EQ(snap.extra_cnt, 1);
+	ASSERT_STREQ(snap.extra[0].key, "hugetlb");
+	ASSERT_FALSE(snap.extra_truncated);
+
+	ret = adaptived_memorystat_get_field(&snap, "hugetlb", &value);
+	ASSERT_EQ(ret, 0);
+	ASSERT_EQ(value, 3000);
+
+	ret = adaptived_memorystat_get_field(&snap, "shmem", &value);
+	ASSERT_EQ(ret, -ENOENT);
+	ret = adaptived_memorystat_get_field(&snap, "bogus", &value);
+	ASSERT_EQ(ret, -ENOENT);
+
+	ret = adaptived_cgroup_get_memorystat_field(filename, "file", &value);
+	ASSERT_EQ(ret, 0);
+	ASSERT_EQ(value, 2000);
+
+	ASSERT_EQ(adaptived_memorystat_field_idx("pgmajfault"), ADAPTIVED_MEMORYSTAT_PGMAJFAULT);
+	ASSERT_EQ(adaptived_memorystat_field_idx("pgmaj"), -ENOENT);
+	ASSERT_EQ(adaptived_memorystat_field_idx("hugetlb"), -ENOENT);
+
+	remove(filename);
+}
+
+TEST_F(MemorystatTest, TooManyExtraFields)
+{
+	const char * const filename = "test015.truncated.stat";
+	std::string contents = "anon 1\n";
+	long long value;
+	int ret, i;
+
+	for (i = 0; i < ADAPTIVED_MEMORYSTAT_EXTRA_MAX + 8; i++)
+		contents += "extra" + std::to_string(i) + " " + std::to_string(i * 10) + "\n";
+	CreateFile(filename, contents.c_str());
+
+	/* fields that didn't fit in the snapshot are still found */
+	ret = adaptived_cgroup_get_memorystat_field(filename, "extra3", &value);
+	ASSERT_EQ(ret, 0);
+	ASSERT_EQ(value, 30);
+	ret = adaptived_cgroup_get_memorystat_field(filename,
+		("extra" + std::to_string(ADAPTIVED_MEMORYSTAT_EXTRA_MAX + 4)).c_str(), &value);
+	ASSERT_EQ(ret, 0);
+	ASSERT_EQ(value, (ADAPTIVED_MEMORYSTAT_EXTRA_MAX + 4) * 10);
+	ret = adaptived_cgroup_get_memorystat_field(filename, "extra", &value);
+	ASSERT_EQ(ret, -ENOENT);
+
+	remove(filename);
+}
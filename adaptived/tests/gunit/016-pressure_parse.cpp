@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2025, Oracle and/or its affiliates.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+/**
+ * adaptived googletest for the PSI parser.  adaptived_get_pressure() is compared
+ * against the original fopen()/getline()/strstr() parser
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <adaptived-utils.h>
+#include <adaptived.h>
+
+#include "gtest/gtest.h"
+#include "legacy_pressure.h"
+
+static const char * const PRESSURE_FILE = "016-pressure_parse.pressure";
+
+class PressureParseTest : public ::testing::Test {
+};
+
+static void CreateFile(const char * const filename, const char * const contents)
+{
+	FILE *f;
+
+	f = fopen(filename, "w");
+	ASSERT_NE(f, nullptr);
+
+	fprintf(f, "%s", contents);
+	fclose(f);
+}
+
+static void ExpectSame(const struct adaptived_pressure_snapshot * const a,
+		       const struct adaptived_pressure_snapshot * const b)
+{
+	EXPECT_FLOAT_EQ(a->some.avg10, b->some.avg10);
+	EXPECT_FLOAT_EQ(a->some.avg60, b->some.avg60);
+	EXPECT_FLOAT_EQ(a->some.avg300, b->some.avg300);
+	EXPECT_EQ(a->some.total, b->some.total);
+	EXPECT_FLOAT_EQ(a->full.avg10, b->full.avg10);
+	EXPECT_FLOAT_EQ(a->full.avg60, b->full.avg60);
+	EXPECT_FLOAT_EQ(a->full.avg300, b->full.avg300);
+	EXPECT_EQ(a->full.total, b->full.total);
+}
+
+TEST_F(PressureParseTest, MatchesLegacyParser)
+{
+	struct adaptived_pressure_snapshot ps, legacy;
+	int ret;
+
+	CreateFile(PRESSURE_FILE,
+		   "some avg10=1.23 avg60=45.60 avg300=99.99 total=123456789\n"
+		   "full avg10=0.07 avg60=100.00 avg300=0.00 total=9876543210\n");
+
+	ret = adaptived_get_pressure(PRESSURE_FILE, &ps);
+	ASSERT_EQ(ret, 0);
+	ret = legacy_get_pressure(PRESSURE_FILE, &legacy);
+	ASSERT_EQ(ret, 0);
+
+	ExpectSame(&ps, &legacy);
+	ASSERT_EQ(ps.full.total, 9876543210LL);
+
+	remove(PRESSURE_FILE);
+}
+
+TEST_F(PressureParseTest, SomeOnly)
+{
+	struct adaptived_pressure_snapshot ps;
+	int ret;
+
+	CreateFile(PRESSURE_FILE, "some avg10=2.50 avg60=1.00 avg300=0.50 total=42\n");
+
+	ret = adaptived_get_pressure(PRESSURE_FILE, &ps);
+	ASSERT_EQ(ret, 0);
+	ASSERT_FLOAT_EQ(ps.some.avg10, 2.5);
+	ASSERT_EQ(ps.some.total, 42);
+	ASSERT_EQ(ps.full.total, 0);
+
+	remove(PRESSURE_FILE);
+}
+
+TEST_F(PressureParseTest, MalformedFiles)
+{
+	const char * const malformed[] = {
+		"",
+		"some\n",
+		"some avg10=1.00 avg60=1.00 total=5\n",
+		"some avg10=1.00 avg60=1.00 avg300=1.00 total=\n",
+		"some avg10=abc avg60=1.00 avg300=1.00 total=5\n",
+		"some avg10 avg60 avg300 total\n",
+		"full avg10=1.00 avg60=1.00 avg300=1.00 total=5\n",
+	};
+	struct adaptived_pressure_snapshot ps;
+	size_t i;
+	int ret;
+
+	for (i = 0; i < sizeof(malformed) / sizeof(malformed[0]); i++) {
+		CreateFile(PRESSURE_FILE, malformed[i]);
+
+		ret = adaptived_get_pressure(PRESSURE_FILE, &ps);
+		ASSERT_EQ(ret, -EINVAL) << malformed[i];
+	}
+
+	/* unknown keys are ignored */
+	CreateFile(PRESSURE_FILE, "some avg10=1.00 avg30=7.00 avg60=2.00 avg300=3.00 total=4\n");
+	ret = adaptived_get_pressure(PRESSURE_FILE, &ps);
+	ASSERT_EQ(ret, 0);
+	ASSERT_FLOAT_EQ(ps.some.avg60, 2.0);
+	ASSERT_EQ(ps.some.total, 4);
+
+	remove(PRESSURE_FILE);
+}
+
+TEST_F(PressureParseTest, ProcPressure)
+{
+	struct adaptived_pressure_snapshot ps, legacy;
+	bool has_some = false, has_full = false;
+	char line[256];
+	FILE *f;
+	int ret;
+
+	f = fopen("/proc/pressure/cpu", "r");
+	if (!f)
+		GTEST_SKIP();
+
+	while (fgets(line, sizeof(line), f)) {
+		if (strncmp(line, "some ", 5) == 0)
+			has_some = true;
+		if (strncmp(line, "full ", 5) == 0)
+			has_full = true;
+	}
+	fclose(f);
+
+	ret = legacy_get_pressure("/proc/pressure/cpu", &legacy);
+	ASSERT_EQ(ret, 0);
+	ret = adaptived_get_pressure("/proc/pressure/cpu", &ps);
+	ASSERT_EQ(ret, 0);
+
+	/* the averages may change between the reads, but the totals never decrease */
+	ASSERT_TRUE(has_some);
+	EXPECT_GE(ps.some.total, legacy.some.total);
+	EXPECT_GE(ps.some.avg10, 0.0);
+	EXPECT_LE(ps.some.avg10, 100.0);
+
+	if (has_full) {
+		EXPECT_GE(ps.full.total, legacy.full.total);
+	} else {
+		/* older kernels don't report full cpu pressure */
+		EXPECT_EQ(ps.full.total, 0);
+		EXPECT_FLOAT_EQ(ps.full.avg10, 0.0);
+	}
+}
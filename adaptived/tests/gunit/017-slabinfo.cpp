@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2025, Oracle and/or its affiliates.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+/**
+ * adaptived googletest for the slabinfo snapshot
+ */
+
+#include <adaptived-utils.h>
+#include <adaptived.h>
+
+#include "gtest/gtest.h"
+
+static const char * const SLABINFO_FILE = "017-slabinfo.slabinfo";
+
+static const char * const SLABINFO_HDR =
+	"slabinfo - version: 2.1\n"
+	"# name            <active_objs> <num_objs> <objsize> <objperslab> <pagesperslab> "
+	": tunables <limit> <batchcount> <sharedfactor> : slabdata <active_slabs> "
+	"<num_slabs> <sharedavail>\n";
+
+class SlabinfoTest : public ::testing::Test {
+};
+
+static void CreateFile(const char * const filename, const char * const hdr,
+		       const char * const contents)
+{
+	FILE *f;
+
+	f = fopen(filename, "w");
+	ASSERT_NE(f, nullptr);
+
+	fprintf(f, "%s%s", hdr, contents);
+	fclose(f);
+}
+
+TEST_F(SlabinfoTest, GetValue)
+{
+	struct adaptived_slabinfo_snapshot *snap = NULL;
+	long long value;
+	int ret;
+
+	CreateFile(SLABINFO_FILE, SLABINFO_HDR,
+		   "kmalloc-32        1000   1024     32  128    1 : tunables    0    0    0 : slabdata      8      8      0\n"
+		   "dentry            2000   2100    192   21    1 : tunables    0    0    0 : slabdata    100    100      0\n"
+		   "inode_cache        300    310    600   13    2 : tunables    1    2    3 : slabdata     24     25      4\n");
+
+	ret = adaptived_get_slabinfo(SLABINFO_FILE, &snap);
+	ASSERT_EQ(ret, 0);
+	ASSERT_NE(snap, nullptr);
+
+	ret = adaptived_slabinfo_get_value(snap, "dentry", ADAPTIVED_SLABINFO_ACTIVE_OBJS, &value);
+	ASSERT_EQ(ret, 0);
+	ASSERT_EQ(value, 2000);
+	ret = adaptived_slabinfo_get_value(snap, "inode_cache", ADAPTIVED_SLABINFO_SHAREDAVAIL,
+					   &value);
+	ASSERT_EQ(ret, 0);
+	ASSERT_EQ(value, 4);
+	ret = adaptived_slabinfo_get_value(snap, "inode_cache", ADAPTIVED_SLABINFO_BATCHCOUNT,
+					   &value);
+	ASSERT_EQ(ret, 0);
+	ASSERT_EQ(value, 2);
+	ret = adaptived_slabinfo_get_value(snap, "kmalloc-64", ADAPTIVED_SLABINFO_NUM_OBJS,
+					   &value);
+	ASSERT_EQ(ret, -ENOENT);
+
+	adaptived_slabinfo_put(&snap);
+	ASSERT_EQ(snap, nullptr);
+
+	ret = adaptived_get_slabinfo_field(SLABINFO_FILE, "kmalloc-32", "<num_objs>", &value);
+	ASSERT_EQ(ret, 0);
+	ASSERT_EQ(value, 1024);
+	ret = adaptived_get_slabinfo_field(SLABINFO_FILE, "kmalloc-64", "<num_objs>", &value);
+	ASSERT_EQ(ret, 0);
+	ASSERT_EQ(value, 0);
+	ret = adaptived_get_slabinfo_field(SLABINFO_FILE, "kmalloc-32", "<bogus>", &value);
+	ASSERT_EQ(ret, -EINVAL);
+
+	ASSERT_EQ(adaptived_slabinfo_column_idx("<num_slabs>"), ADAPTIVED_SLABINFO_NUM_SLABS);
+	ASSERT_EQ(adaptived_slabinfo_column_idx("<num_slab>"), -EINVAL);
+
+	remove(SLABINFO_FILE);
+}
+
+TEST_F(SlabinfoTest, TopGrowth)
+{
+	struct adaptived_slabinfo_snapshot *prev = NULL, *cur = NULL;
+	struct adaptived_slabinfo_growth top[2];
+	int ret;
+
+	CreateFile(SLABINFO_FILE, SLABINFO_HDR,
+		   "kmalloc-32  1000 1024 32 128 1 : tunables 0 0 0 : slabdata 8 8 0\n"
+		   "dentry      2000 2100 192 21 1 : tunables 0 0 0 : slabdata 100 100 0\n"
+		   "inode_cache  300  310 600 13 2 : tunables 0 0 0 : slabdata 24 25 0\n");
+	ret = adaptived_get_slabinfo(SLABINFO_FILE, &prev);
+	ASSERT_EQ(ret, 0);
+
+	CreateFile(SLABINFO_FILE, SLABINFO_HDR,
+		   "kmalloc-32   900 1024 32 128 1 : tunables 0 0 0 : slabdata 8 8 0\n"
+		   "dentry      9000 9100 192 21 1 : tunables 0 0 0 : slabdata 400 400 0\n"
+		   "inode_cache  800  810 600 13 2 : tunables 0 0 0 : slabdata 64 65 0\n"
+		   "new_cache    100  100  64 64 1 : tunables 0 0 0 : slabdata 2 2 0\n");
+	ret = adaptived_get_slabinfo(SLABINFO_FILE, &cur);
+	ASSERT_EQ(ret, 0);
+
+	ret = adaptived_slabinfo_top_growth(cur, prev, ADAPTIVED_SLABINFO_ACTIVE_OBJS, top, 2);
+	ASSERT_EQ(ret, 2);
+	ASSERT_STREQ(top[0].name, "dentry");
+	ASSERT_EQ(top[0].value, 9000);
+	ASSERT_EQ(top[0].delta, 7000);
+	ASSERT_STREQ(top[1].name, "inode_cache");
+	ASSERT_EQ(top[1].delta, 500);
+
+	/* only three caches grew */
+	struct adaptived_slabinfo_growth all[8];
+	ret = adaptived_slabinfo_top_growth(cur, prev, ADAPTIVED_SLABINFO_ACTIVE_OBJS, all, 8);
+	ASSERT_EQ(ret, 3);
+	ASSERT_STREQ(all[2].name, "new_cache");
+	ASSERT_EQ(all[2].delta, 100);
+
+	adaptived_slabinfo_put(&prev);
+	adaptived_slabinfo_put(&cur);
+
+	remove(SLABINFO_FILE);
+}
+
+TEST_F(SlabinfoTest, Malformed)
+{
+	struct adaptived_slabinfo_snapshot *snap = NULL;
+	int ret;
+
+	CreateFile(SLABINFO_FILE, SLABINFO_HDR,
+		   "dentry 2000 2100 192 21 1 : tunables 0 0 0 : slabdata 100 100\n");
+	ret = adaptived_get_slabinfo(SLABINFO_FILE, &snap);
+	ASSERT_EQ(ret, -EINVAL);
+	ASSERT_EQ(snap, nullptr);
+
+	remove(SLABINFO_FILE);
+}
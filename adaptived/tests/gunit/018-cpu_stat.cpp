@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2025, Oracle and/or its affiliates.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+/**
+ * adaptived googletest for the per-cpu /proc/stat snapshot and cpumasks
+ */
+
+#include <adaptived-utils.h>
+#include <adaptived.h>
+
+#include "gtest/gtest.h"
+
+static const char * const STAT_FILE = "018-cpu_stat.stat";
+
+class CpuStatTest : public ::testing::Test {
+};
+
+static void CreateFile(const char * const filename, const char * const contents)
+{
+	FILE *f;
+
+	f = fopen(filename, "w");
+	ASSERT_NE(f, nullptr);
+
+	fprintf(f, "%s", contents);
+	fclose(f);
+}
+
+TEST_F(CpuStatTest, CpumaskParse)
+{
+	struct adaptived_cpumask mask;
+	int ret;
+
+	ret = adaptived_cpumask_parse("0-3,8,10-11\n", &mask);
+	ASSERT_EQ(ret, 0);
+	ASSERT_TRUE(adaptived_cpumask_test(&mask, 0));
+	ASSERT_TRUE(adaptived_cpumask_test(&mask, 3));
+	ASSERT_FALSE(adaptived_cpumask_test(&mask, 4));
+	ASSERT_TRUE(adaptived_cpumask_test(&mask, 8));
+	ASSERT_FALSE(adaptived_cpumask_test(&mask, 9));
+	ASSERT_TRUE(adaptived_cpumask_test(&mask, 11));
+	ASSERT_FALSE(adaptived_cpumask_test(&mask, 12));
+
+	ret = adaptived_cpumask_parse("64-65", &mask);
+	ASSERT_EQ(ret, 0);
+	ASSERT_FALSE(adaptived_cpumask_test(&mask, 63));
+	ASSERT_TRUE(adaptived_cpumask_test(&mask, 64));
+	ASSERT_TRUE(adaptived_cpumask_test(&mask, 65));
+
+	ret = adaptived_cpumask_parse("", &mask);
+	ASSERT_EQ(ret, 0);
+	ASSERT_FALSE(adaptived_cpumask_test(&mask, 0));
+
+	ASSERT_EQ(adaptived_cpumask_parse("3-1", &mask), -EINVAL);
+	ASSERT_EQ(adaptived_cpumask_parse("1,a", &mask), -EINVAL);
+	ASSERT_EQ(adaptived_cpumask_parse("0-100000", &mask), -EINVAL);
+}
+
+TEST_F(CpuStatTest, Delta)
+{
+	struct adaptived_cpu_stat *prev = NULL, *cur = NULL;
+	long long ticks[ADAPTIVED_CPU_STAT_CNT];
+	struct adaptived_cpumask mask;
+	int ret;
+
+	CreateFile(STAT_FILE,
+		   "cpu  100 0 100 1000 0 0 0 0 0 0\n"
+		   "cpu0 25 0 25 250 0 0 0 0 0 0\n"
+		   "cpu1 25 0 25 250 0 0 0 0 0 0\n"
+		   "cpu2 25 0 25 250 0 0 0 0 0 0\n"
+		   "cpu3 25 0 25 250 0 0 0 0 0 0\n"
+		   "intr 1 2 3\n");
+	ret = adaptived_get_cpu_stat(STAT_FILE, &prev);
+	ASSERT_EQ(ret, 0);
+
+	CreateFile(STAT_FILE,
+		   "cpu  300 0 100 1200 0 0 0 0 0 0\n"
+		   "cpu0 25 0 25 350 0 0 0 0 0 0\n"
+		   "cpu1 25 0 25 350 0 0 0 0 0 0\n"
+		   "cpu2 125 0 25 250 0 0 0 0 0 0\n"
+		   "cpu3 125 0 25 250 1 2 3 4 0 0\n"
+		   "intr 1 2 3\n");
+	ret = adaptived_get_cpu_stat(STAT_FILE, &cur);
+	ASSERT_EQ(ret, 0);
+
+	/* the aggregate line */
+	ret = adaptived_cpu_stat_delta(prev, cur, NULL, ticks);
+	ASSERT_EQ(ret, 0);
+	ASSERT_EQ(ticks[ADAPTIVED_CPU_STAT_USER], 200);
+	ASSERT_EQ(ticks[ADAPTIVED_CPU_STAT_IDLE], 200);
+
+	ret = adaptived_cpumask_parse("2-3", &mask);
+	ASSERT_EQ(ret, 0);
+	ret = adaptived_cpu_stat_delta(prev, cur, &mask, ticks);
+	ASSERT_EQ(ret, 0);
+	ASSERT_EQ(ticks[ADAPTIVED_CPU_STAT_USER], 200);
+	ASSERT_EQ(ticks[ADAPTIVED_CPU_STAT_IDLE], 0);
+	ASSERT_EQ(ticks[ADAPTIVED_CPU_STAT_IOWAIT], 1);
+	ASSERT_EQ(ticks[ADAPTIVED_CPU_STAT_STEAL], 4);
+
+	/* relative to boot */
+	ret = adaptived_cpu_stat_delta(NULL, cur, &mask, ticks);
+	ASSERT_EQ(ret, 0);
+	ASSERT_EQ(ticks[ADAPTIVED_CPU_STAT_USER], 250);
+	ASSERT_EQ(ticks[ADAPTIVED_CPU_STAT_SYSTEM], 50);
+
+	adaptived_cpu_stat_put(&prev);
+
+	/* cpu1 went offline and cpu4 came online */
+	CreateFile(STAT_FILE,
+		   "cpu  400 0 100 1300 0 0 0 0 0 0\n"
+		   "cpu0 30 0 25 350 0 0 0 0 0 0\n"
+		   "cpu2 225 0 25 250 0 0 0 0 0 0\n"
+		   "cpu3 125 0 25 250 1 2 3 4 0 0\n"
+		   "cpu4 500 0 0 0 0 0 0 0 0 0\n");
+	ret = adaptived_get_cpu_stat(STAT_FILE, &prev);
+	ASSERT_EQ(ret, 0);
+
+	ret = adaptived_cpumask_parse("0-4", &mask);
+	ASSERT_EQ(ret, 0);
+	ret = adaptived_cpu_stat_delta(cur, prev, &mask, ticks);
+	ASSERT_EQ(ret, 0);
+	ASSERT_EQ(ticks[ADAPTIVED_CPU_STAT_USER], 105);
+
+	adaptived_cpu_stat_put(&prev);
+	adaptived_cpu_stat_put(&cur);
+	ASSERT_EQ(cur, nullptr);
+
+	remove(STAT_FILE);
+}
+
+TEST_F(CpuStatTest, Malformed)
+{
+	struct adaptived_cpu_stat *cs = NULL;
+	int ret;
+
+	CreateFile(STAT_FILE, "cpu  1 2 3 4\ncpu1 1 2 3 4\ncpu0 1 2 3 4\n");
+	ret = adaptived_get_cpu_stat(STAT_FILE, &cs);
+	ASSERT_EQ(ret, -EINVAL);
+	ASSERT_EQ(cs, nullptr);
+
+	CreateFile(STAT_FILE, "cpu  1 2\n");
+	ret = adaptived_get_cpu_stat(STAT_FILE, &cs);
+	ASSERT_EQ(ret, -EINVAL);
+
+	remove(STAT_FILE);
+}
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2025, Oracle and/or its affiliates.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+/**
+ * adaptived googletest for adaptived_pressure_trigger_open() and
+ * adaptived_pressure_trigger_check()
+ */
+
+#include <unistd.h>
+#include <stdio.h>
+#include <errno.h>
+
+#include <adaptived-utils.h>
+#include <adaptived.h>
+
+#include "gtest/gtest.h"
+
+static const char * const PRESSURE_FILE = "019-pressure_trigger.pressure";
+
+class PressureTriggerTest : public ::testing::Test {
+};
+
+TEST_F(PressureTriggerTest, InvalidSettings)
+{
+	int fd = -1;
+
+	ASSERT_EQ(adaptived_pressure_trigger_open(NULL, false, 100000, 1000000, &fd), -EINVAL);
+	ASSERT_EQ(adaptived_pressure_trigger_open("/proc/pressure/cpu", false, 100000, 1000000,
+						  NULL), -EINVAL);
+
+	/* the window must be between 500ms and 10s */
+	ASSERT_EQ(adaptived_pressure_trigger_open("/proc/pressure/cpu", false, 100000, 499999,
+						  &fd), -EINVAL);
+	ASSERT_EQ(adaptived_pressure_trigger_open("/proc/pressure/cpu", false, 100000, 10000001,
+						  &fd), -EINVAL);
+
+	/* the stall time must fit within the window */
+	ASSERT_EQ(adaptived_pressure_trigger_open("/proc/pressure/cpu", true, 0, 1000000, &fd),
+		  -EINVAL);
+	ASSERT_EQ(adaptived_pressure_trigger_open("/proc/pressure/cpu", true, 1000001, 1000000,
+						  &fd), -EINVAL);
+
+	ASSERT_EQ(fd, -1);
+	ASSERT_EQ(adaptived_pressure_trigger_check(-1), -EINVAL);
+}
+
+TEST_F(PressureTriggerTest, NotAPsiFile)
+{
+	FILE *f;
+	int fd = -1;
+
+	f = fopen(PRESSURE_FILE, "w");
+	ASSERT_NE(f, nullptr);
+	fprintf(f, "some avg10=0.00 avg60=0.00 avg300=0.00 total=0\n");
+	fclose(f);
+
+	/* a regular file would accept the trigger but never raise POLLPRI */
+	ASSERT_EQ(adaptived_pressure_trigger_open(PRESSURE_FILE, false, 100000, 1000000, &fd),
+		  -EOPNOTSUPP);
+	ASSERT_EQ(fd, -1);
+
+	ASSERT_EQ(adaptived_pressure_trigger_open("019-does-not-exist.pressure", false, 100000,
+						  1000000, &fd), -ENOENT);
+
+	remove(PRESSURE_FILE);
+}
+
+TEST_F(PressureTriggerTest, CheckWithoutEvent)
+{
+	int pipe_fds[2];
+
+	/* a file descriptor that never raises POLLPRI */
+	ASSERT_EQ(pipe(pipe_fds), 0);
+	ASSERT_EQ(adaptived_pressure_trigger_check(pipe_fds[0]), 0);
+
+	close(pipe_fds[0]);
+	close(pipe_fds[1]);
+}
+
+TEST_F(PressureTriggerTest, SystemTrigger)
+{
+	int fd = -1;
+	int ret;
+
+	ret = adaptived_pressure_trigger_open("/proc/pressure/cpu", false, 500000, 1000000, &fd);
+	if (ret)
+		GTEST_SKIP() << "PSI triggers are not supported on this system: " << ret;
+
+	ret = adaptived_pressure_trigger_check(fd);
+	ASSERT_GE(ret, 0);
+	ASSERT_LE(ret, 1);
+
+	close(fd);
+}
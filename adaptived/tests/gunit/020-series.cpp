@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2025, Oracle and/or its affiliates.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+/**
+ * adaptived googletest for struct adaptived_series
+ */
+
+#include <errno.h>
+#include <math.h>
+
+#include <adaptived-utils.h>
+#include <adaptived.h>
+
+#include "gtest/gtest.h"
+#include "defines.h"
+
+class SeriesTest : public ::testing::Test {
+};
+
+/* least squares over the raw samples, for comparison */
+static double BruteForce(const long long * const x, const double * const y, int cnt,
+			 long long at)
+{
+	double xmean = 0.0, ymean = 0.0, numer = 0.0, denom = 0.0, slope;
+	int i;
+
+	for (i = 0; i < cnt; i++) {
+		xmean += (double)x[i];
+		ymean += y[i];
+	}
+	xmean /= cnt;
+	ymean /= cnt;
+
+	for (i = 0; i < cnt; i++) {
+		numer += ((double)x[i] - xmean) * (y[i] - ymean);
+		denom += ((double)x[i] - xmean) * ((double)x[i] - xmean);
+	}
+
+	slope = numer / denom;
+
+	return ymean + slope * ((double)at - xmean);
+}
+
+TEST_F(SeriesTest, InvalidParameters)
+{
+	struct adaptived_series *series;
+	double value;
+
+	ASSERT_EQ(adaptived_series_alloc(0), nullptr);
+	ASSERT_EQ(adaptived_series_append(NULL, 0, 1.0), -EINVAL);
+	ASSERT_EQ(adaptived_series_count(NULL), -EINVAL);
+
+	series = adaptived_series_alloc(4);
+	ASSERT_NE(series, nullptr);
+
+	/* a regression needs at least two distinct times */
+	ASSERT_EQ(adaptived_series_linear_regression(series, 0, &value), -EINVAL);
+	ASSERT_EQ(adaptived_series_append(series, 100, 1.0), 0);
+	ASSERT_EQ(adaptived_series_linear_regression(series, 0, &value), -EINVAL);
+	ASSERT_EQ(adaptived_series_append(series, 100, 2.0), 0);
+	ASSERT_EQ(adaptived_series_linear_regression(series, 0, &value), -EINVAL);
+
+	/* time cannot go backwards */
+	ASSERT_EQ(adaptived_series_append(series, 99, 1.0), -EINVAL);
+
+	adaptived_series_free(&series);
+	ASSERT_EQ(series, nullptr);
+}
+
+TEST_F(SeriesTest, MatchesFarray)
+{
+	float y[] = {94.6, 88.4, 92.5, 90.1, 84.3, 75.7, 75.9, 80.2, 65.8, 60.9, 62.3,
+		     58.9, 58.5, 63.5, 55.4, 59.4, 56.3, 52.1, 51.1, 48.6, 47.9, 51.8,
+		     50.3, 45.6, 43.2, 43.1, 46.2, 40.7, 38.9, 37.5, 35.9, 40.2, 38.7};
+	struct adaptived_series *series;
+	int y_len, i, interval = 2;
+	float farray_y;
+	double value;
+
+	y_len = ARRAY_SIZE(y);
+
+	series = adaptived_series_alloc(y_len);
+	ASSERT_NE(series, nullptr);
+
+	for (i = 0; i < y_len; i++)
+		ASSERT_EQ(adaptived_series_append(series, (i + 1) * interval, y[i]), 0);
+	ASSERT_EQ(adaptived_series_count(series), y_len);
+
+	ASSERT_EQ(adaptived_farray_linear_regression(y, y_len, interval, 7, &farray_y), 0);
+	ASSERT_EQ(adaptived_series_linear_regression(series, y_len * interval + 7, &value), 0);
+	EXPECT_NEAR(value, farray_y, 0.01);
+
+	adaptived_series_free(&series);
+}
+
+TEST_F(SeriesTest, IrregularTimestamps)
+{
+	long long times[] = {0, 3, 4, 10, 11, 25, 26, 40};
+	struct adaptived_series *series;
+	double value;
+	int i;
+
+	series = adaptived_series_alloc(ARRAY_SIZE(times));
+	ASSERT_NE(series, nullptr);
+
+	/* y = 0.5 * x + 3 */
+	for (i = 0; i < (int)ARRAY_SIZE(times); i++)
+		ASSERT_EQ(adaptived_series_append(series, times[i], 0.5 * times[i] + 3.0), 0);
+
+	ASSERT_EQ(adaptived_series_linear_regression(series, 100, &value), 0);
+	EXPECT_NEAR(value, 53.0, 1e-9);
+
+	adaptived_series_reset(series);
+	ASSERT_EQ(adaptived_series_count(series), 0);
+
+	adaptived_series_free(&series);
+}
+
+TEST_F(SeriesTest, SlidingWindow)
+{
+	const int size = 16, loops = 1000000;
+	struct adaptived_series *series;
+	long long x[16];
+	double y[16];
+	long long now;
+	double value;
+	int i, idx;
+
+	series = adaptived_series_alloc(size);
+	ASSERT_NE(series, nullptr);
+
+	/*
+	 * Run for a long time with large timestamps and irregular spacing.  The
+	 * running sums must still match a regression over the samples in the window
+	 */
+	now = 1700000000000LL;
+	for (i = 0; i < loops; i++) {
+		now += 1000 + (i * 7919LL) % 500;
+		idx = i % size;
+		x[idx] = now;
+		y[idx] = 50.0 + 40.0 * sin(i / 100.0) + (i % 13) * 0.1;
+
+		ASSERT_EQ(adaptived_series_append(series, x[idx], y[idx]), 0);
+
+		if (i >= size && i % 9973 == 0) {
+			ASSERT_EQ(adaptived_series_linear_regression(series, now + 10000, &value), 0);
+			EXPECT_NEAR(value, BruteForce(x, y, size, now + 10000), 1e-6);
+		}
+	}
+
+	ASSERT_EQ(adaptived_series_count(series), size);
+
+	adaptived_series_free(&series);
+}
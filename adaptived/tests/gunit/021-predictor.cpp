@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2025, Oracle and/or its affiliates.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+/**
+ * adaptived googletest for struct adaptived_predictor
+ */
+
+#include <errno.h>
+
+#include <adaptived-utils.h>
+#include <adaptived.h>
+
+#include "gtest/gtest.h"
+
+class PredictorTest : public ::testing::Test {
+};
+
+TEST_F(PredictorTest, ModelNames)
+{
+	ASSERT_EQ(adaptived_predictor_model_idx("ols"), ADAPTIVED_PREDICTOR_OLS);
+	ASSERT_EQ(adaptived_predictor_model_idx("ewma"), ADAPTIVED_PREDICTOR_EWMA);
+	ASSERT_EQ(adaptived_predictor_model_idx("holt"), ADAPTIVED_PREDICTOR_HOLT);
+	ASSERT_EQ(adaptived_predictor_model_idx("p95"), ADAPTIVED_PREDICTOR_P95);
+	ASSERT_EQ(adaptived_predictor_model_idx("p99"), -EINVAL);
+	ASSERT_EQ(adaptived_predictor_model_idx(NULL), -EINVAL);
+
+	ASSERT_EQ(adaptived_predictor_alloc(ADAPTIVED_PREDICTOR_CNT, 10), nullptr);
+	ASSERT_EQ(adaptived_predictor_alloc(ADAPTIVED_PREDICTOR_EWMA, 0), nullptr);
+}
+
+TEST_F(PredictorTest, Count)
+{
+	struct adaptived_predictor *pred;
+	double value;
+	int i;
+
+	pred = adaptived_predictor_alloc(ADAPTIVED_PREDICTOR_EWMA, 4);
+	ASSERT_NE(pred, nullptr);
+
+	ASSERT_EQ(adaptived_predictor_forecast(pred, 0, &value), -EINVAL);
+
+	for (i = 0; i < 10; i++) {
+		ASSERT_EQ(adaptived_predictor_update(pred, i * 1000, 1.0), 0);
+		ASSERT_EQ(adaptived_predictor_count(pred), i < 4 ? i + 1 : 4);
+	}
+
+	/* time cannot go backwards */
+	ASSERT_EQ(adaptived_predictor_update(pred, 0, 1.0), -EINVAL);
+
+	adaptived_predictor_free(&pred);
+	ASSERT_EQ(pred, nullptr);
+}
+
+TEST_F(PredictorTest, LinearRamp)
+{
+	struct adaptived_predictor *ols, *holt, *ewma;
+	double value;
+	int i;
+
+	ols = adaptived_predictor_alloc(ADAPTIVED_PREDICTOR_OLS, 10);
+	holt = adaptived_predictor_alloc(ADAPTIVED_PREDICTOR_HOLT, 10);
+	ewma = adaptived_predictor_alloc(ADAPTIVED_PREDICTOR_EWMA, 10);
+	ASSERT_NE(ols, nullptr);
+	ASSERT_NE(holt, nullptr);
+	ASSERT_NE(ewma, nullptr);
+
+	/* y = 0.01 * t, sampled every second */
+	for (i = 0; i < 200; i++) {
+		ASSERT_EQ(adaptived_predictor_update(ols, i * 1000LL, i * 10.0), 0);
+		ASSERT_EQ(adaptived_predictor_update(holt, i * 1000LL, i * 10.0), 0);
+		ASSERT_EQ(adaptived_predictor_update(ewma, i * 1000LL, i * 10.0), 0);
+	}
+
+	/* the trend models extrapolate the ramp 10 seconds past the last sample */
+	ASSERT_EQ(adaptived_predictor_forecast(ols, 209000, &value), 0);
+	EXPECT_NEAR(value, 2090.0, 1e-6);
+	ASSERT_EQ(adaptived_predictor_forecast(holt, 209000, &value), 0);
+	EXPECT_NEAR(value, 2090.0, 1.0);
+
+	/* the ewma is flat and lags the ramp */
+	ASSERT_EQ(adaptived_predictor_forecast(ewma, 209000, &value), 0);
+	EXPECT_LT(value, 1990.0);
+
+	adaptived_predictor_free(&ols);
+	adaptived_predictor_free(&holt);
+	adaptived_predictor_free(&ewma);
+}
+
+TEST_F(PredictorTest, Burst)
+{
+	struct adaptived_predictor *ols, *ewma;
+	double ols_value, ewma_value;
+	int i;
+
+	ols = adaptived_predictor_alloc(ADAPTIVED_PREDICTOR_OLS, 5);
+	ewma = adaptived_predictor_alloc(ADAPTIVED_PREDICTOR_EWMA, 5);
+	ASSERT_NE(ols, nullptr);
+	ASSERT_NE(ewma, nullptr);
+
+	/* steady pressure followed by a single burst */
+	for (i = 0; i < 10; i++) {
+		ASSERT_EQ(adaptived_predictor_update(ols, i * 3000LL, i == 9 ? 60.0 : 20.0), 0);
+		ASSERT_EQ(adaptived_predictor_update(ewma, i * 3000LL, i == 9 ? 60.0 : 20.0), 0);
+	}
+
+	/* the least-squares line overshoots the burst.  the ewma damps it */
+	ASSERT_EQ(adaptived_predictor_forecast(ols, 27000 + 10000, &ols_value), 0);
+	ASSERT_EQ(adaptived_predictor_forecast(ewma, 27000 + 10000, &ewma_value), 0);
+	EXPECT_GT(ols_value, 60.0);
+	EXPECT_NEAR(ewma_value, 20.0 + 40.0 / 3.0, 1e-6);
+
+	adaptived_predictor_free(&ols);
+	adaptived_predictor_free(&ewma);
+}
+
+TEST_F(PredictorTest, Quantile)
+{
+	struct adaptived_predictor *pred;
+	unsigned int seed = 1;
+	double value;
+	int i;
+
+	pred = adaptived_predictor_alloc(ADAPTIVED_PREDICTOR_P95, 30);
+	ASSERT_NE(pred, nullptr);
+
+	/* uniformly distributed between 0 and 100 */
+	for (i = 0; i < 100000; i++) {
+		seed = seed * 1103515245 + 12345;
+		ASSERT_EQ(adaptived_predictor_update(pred, i * 1000LL,
+						     (double)((seed >> 16) % 10001) / 100.0), 0);
+	}
+
+	ASSERT_EQ(adaptived_predictor_forecast(pred, 100000000LL, &value), 0);
+	EXPECT_NEAR(value, 95.0, 5.0);
+
+	adaptived_predictor_free(&pred);
+}
@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2025, Oracle and/or its affiliates.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+/**
+ * adaptived googletest for the cgroup-wide PSI scan
+ */
+
+#include <sys/stat.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <ftw.h>
+
+#include <adaptived-utils.h>
+#include <adaptived.h>
+
+#include "gtest/gtest.h"
+#include "defines.h"
+
+static const char * const dirs[] = {
+	"test022",
+	"test022/child1",
+	"test022/child1/grandchild11",
+	"test022/child2",
+};
+
+/* some-avg10 and full-avg60 of each cgroup in dirs[] */
+static const float some_avg10[] = { 4.0, 12.5, 12.5, 0.5 };
+static const float full_avg60[] = { 1.0, 3.0, 2.0, 9.0 };
+static_assert(ARRAY_SIZE(some_avg10) == ARRAY_SIZE(dirs), "some_avg10[] must match dirs[]");
+static_assert(ARRAY_SIZE(full_avg60) == ARRAY_SIZE(dirs), "full_avg60[] must match dirs[]");
+
+class PsiScanTest : public ::testing::Test {
+	protected:
+
+	void SetUp() override {
+		char path[FILENAME_MAX];
+		int ret, i;
+		FILE *f;
+
+		for (i = 0; i < (int)ARRAY_SIZE(dirs); i++) {
+			ret = mkdir(dirs[i], S_IRWXU | S_IRWXG | S_IRWXO);
+			ASSERT_EQ(ret, 0);
+
+			snprintf(path, sizeof(path), "%s/memory.pressure", dirs[i]);
+			f = fopen(path, "w");
+			ASSERT_NE(f, nullptr);
+			fprintf(f, "some avg10=%.2f avg60=0.00 avg300=0.00 total=1000\n"
+				"full avg10=0.00 avg60=%.2f avg300=0.00 total=500\n",
+				some_avg10[i], full_avg60[i]);
+			fclose(f);
+		}
+	}
+
+	static int unlink_cb(const char *fpath, const struct stat *sb, int typeflag,
+			     struct FTW *ftwbuf) {
+		return remove(fpath);
+	}
+
+	void TearDown() override {
+		int ret;
+
+		ret = nftw(dirs[0], unlink_cb, 64, FTW_DEPTH | FTW_PHYS);
+		ASSERT_EQ(ret, 0);
+	}
+};
+
+TEST_F(PsiScanTest, InvalidSettings)
+{
+	struct adaptived_psi_scan *scan = NULL;
+	struct adaptived_psi_scan_entry top[2];
+
+	ASSERT_EQ(adaptived_get_psi_scan(NULL, ADAPTIVED_PSI_MEMORY, -1, &scan), -EINVAL);
+	ASSERT_EQ(adaptived_get_psi_scan("test022", ADAPTIVED_PSI_RESOURCE_CNT, -1, &scan),
+		  -EINVAL);
+	ASSERT_EQ(adaptived_get_psi_scan("test022", ADAPTIVED_PSI_MEMORY, -1, NULL), -EINVAL);
+	ASSERT_EQ(adaptived_get_psi_scan("test022-does-not-exist", ADAPTIVED_PSI_MEMORY, -1,
+					 &scan), -ENOENT);
+
+	/* the cgroups don't have a cpu.pressure file */
+	ASSERT_EQ(adaptived_get_psi_scan("test022", ADAPTIVED_PSI_CPU, -1, &scan), -EINVAL);
+	ASSERT_EQ(scan, nullptr);
+
+	ASSERT_EQ(adaptived_get_psi_scan("test022", ADAPTIVED_PSI_MEMORY, -1, &scan), 0);
+	ASSERT_EQ(adaptived_psi_scan_top(scan, PRESSURE_SOME_TOTAL, false,
+					 ADAPTIVED_PSI_SCAN_TIE_FIRST_WALKED, top, 2), -EINVAL);
+	ASSERT_EQ(adaptived_psi_scan_top(scan, PRESSURE_SOME_AVG10, false,
+					 ADAPTIVED_PSI_SCAN_TIE_FIRST_WALKED, top, 0), -EINVAL);
+	ASSERT_EQ(adaptived_psi_scan_top(scan, PRESSURE_SOME_AVG10, false,
+					 ADAPTIVED_PSI_SCAN_TIE_CNT, top, 2), -EINVAL);
+	ASSERT_EQ(adaptived_psi_scan_above(scan, PRESSURE_FULL_TOTAL, 1.0, top, 2), -EINVAL);
+	ASSERT_EQ(adaptived_psi_scan_count(NULL), -EINVAL);
+
+	adaptived_psi_scan_put(&scan);
+	ASSERT_EQ(scan, nullptr);
+}
+
+TEST_F(PsiScanTest, Top)
+{
+	struct adaptived_psi_scan *scan = NULL;
+	struct adaptived_psi_scan_entry top[ARRAY_SIZE(dirs) + 1];
+	struct adaptived_psi_scan_entry max;
+	int ret;
+
+	ret = adaptived_get_psi_scan("test022", ADAPTIVED_PSI_MEMORY, -1, &scan);
+	ASSERT_EQ(ret, 0);
+	ASSERT_EQ(adaptived_psi_scan_count(scan), (int)ARRAY_SIZE(dirs));
+
+	/* the grandchild ties with its parent, which is walked first */
+	ret = adaptived_psi_scan_max(scan, PRESSURE_SOME_AVG10, &max);
+	ASSERT_EQ(ret, 0);
+	ASSERT_STREQ(max.cgroup, "test022/child1");
+	ASSERT_FLOAT_EQ(max.value, 12.5);
+
+	ret = adaptived_psi_scan_top(scan, PRESSURE_SOME_AVG10, false,
+				     ADAPTIVED_PSI_SCAN_TIE_FIRST_WALKED, top, 3);
+	ASSERT_EQ(ret, 3);
+	ASSERT_STREQ(top[0].cgroup, "test022/child1");
+	ASSERT_STREQ(top[1].cgroup, "test022/child1/grandchild11");
+	ASSERT_STREQ(top[2].cgroup, "test022");
+	ASSERT_FLOAT_EQ(top[2].value, 4.0);
+
+	ret = adaptived_psi_scan_top(scan, PRESSURE_SOME_AVG10, false,
+				     ADAPTIVED_PSI_SCAN_TIE_LAST_WALKED, top, 3);
+	ASSERT_EQ(ret, 3);
+	ASSERT_STREQ(top[0].cgroup, "test022/child1/grandchild11");
+	ASSERT_STREQ(top[1].cgroup, "test022/child1");
+	ASSERT_STREQ(top[2].cgroup, "test022");
+
+	/* a full list only lets a tied cgroup in if the last walked cgroup wins */
+	ret = adaptived_psi_scan_top(scan, PRESSURE_SOME_AVG10, false,
+				     ADAPTIVED_PSI_SCAN_TIE_FIRST_WALKED, top, 1);
+	ASSERT_EQ(ret, 1);
+	ASSERT_STREQ(top[0].cgroup, "test022/child1");
+	ret = adaptived_psi_scan_top(scan, PRESSURE_SOME_AVG10, false,
+				     ADAPTIVED_PSI_SCAN_TIE_LAST_WALKED, top, 1);
+	ASSERT_EQ(ret, 1);
+	ASSERT_STREQ(top[0].cgroup, "test022/child1/grandchild11");
+
+	ret = adaptived_psi_scan_top(scan, PRESSURE_FULL_AVG60, true,
+				     ADAPTIVED_PSI_SCAN_TIE_FIRST_WALKED, top, ARRAY_SIZE(top));
+	ASSERT_EQ(ret, (int)ARRAY_SIZE(dirs));
+	ASSERT_STREQ(top[0].cgroup, "test022");
+	ASSERT_STREQ(top[1].cgroup, "test022/child1/grandchild11");
+	ASSERT_STREQ(top[2].cgroup, "test022/child1");
+	ASSERT_STREQ(top[3].cgroup, "test022/child2");
+	ASSERT_FLOAT_EQ(top[3].value, 9.0);
+
+	adaptived_psi_scan_put(&scan);
+}
+
+TEST_F(PsiScanTest, Above)
+{
+	struct adaptived_psi_scan *scan = NULL;
+	struct adaptived_psi_scan_entry above[1];
+	int ret;
+
+	ret = adaptived_get_psi_scan("test022", ADAPTIVED_PSI_MEMORY, -1, &scan);
+	ASSERT_EQ(ret, 0);
+
+	ret = adaptived_psi_scan_above(scan, PRESSURE_FULL_AVG60, 5.0, above, ARRAY_SIZE(above));
+	ASSERT_EQ(ret, 1);
+	ASSERT_STREQ(above[0].cgroup, "test022/child2");
+	ASSERT_FLOAT_EQ(above[0].value, 9.0);
+
+	/* only count the cgroups */
+	ret = adaptived_psi_scan_above(scan, PRESSURE_FULL_AVG60, 1.5, NULL, 0);
+	ASSERT_EQ(ret, 3);
+	ret = adaptived_psi_scan_above(scan, PRESSURE_SOME_AVG10, 12.5, NULL, 0);
+	ASSERT_EQ(ret, 0);
+
+	adaptived_psi_scan_put(&scan);
+}
+
+TEST_F(PsiScanTest, MaxDepth)
+{
+	struct adaptived_psi_scan *scan = NULL;
+	struct adaptived_psi_scan_entry max;
+	int ret;
+
+	/* the root and its children only */
+	ret = adaptived_get_psi_scan("test022", ADAPTIVED_PSI_MEMORY, 0, &scan);
+	ASSERT_EQ(ret, 0);
+	ASSERT_EQ(adaptived_psi_scan_count(scan), 3);
+
+	ret = adaptived_psi_scan_max(scan, PRESSURE_SOME_AVG10, &max);
+	ASSERT_EQ(ret, 0);
+	ASSERT_STREQ(max.cgroup, "test022/child1");
+
+	adaptived_psi_scan_put(&scan);
+}
@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2025, Oracle and/or its affiliates.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+/**
+ * adaptived googletest for the persistent cgroup tree index
+ */
+
+#include <sys/stat.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <errno.h>
+#include <ftw.h>
+
+#include <adaptived-utils.h>
+#include <adaptived.h>
+
+#include "gtest/gtest.h"
+#include "defines.h"
+
+static const char * const dirs[] = {
+	"test023",
+	"test023/child1",
+	"test023/child1/grandchild11",
+	"test023/child2",
+};
+
+class CgroupTreeTest : public ::testing::Test {
+	protected:
+
+	void SetUp() override {
+		int ret, i;
+
+		for (i = 0; i < (int)ARRAY_SIZE(dirs); i++) {
+			ret = mkdir(dirs[i], S_IRWXU | S_IRWXG | S_IRWXO);
+			ASSERT_EQ(ret, 0);
+		}
+	}
+
+	static int unlink_cb(const char *fpath, const struct stat *sb, int typeflag,
+			     struct FTW *ftwbuf) {
+		return remove(fpath);
+	}
+
+	int rmrf(const char * const path) {
+		return nftw(path, unlink_cb, 64, FTW_DEPTH | FTW_PHYS);
+	}
+
+	void TearDown() override {
+		rmrf(dirs[0]);
+	}
+};
+
+static int count_nodes(const char * const root, int max_depth)
+{
+	struct adaptived_cgroup_tree_node *node = NULL;
+	struct adaptived_cgroup_tree *tree = NULL;
+	int ret, cnt = 0;
+
+	ret = adaptived_get_cgroup_tree(root, &tree);
+	if (ret)
+		return ret;
+
+	while ((node = adaptived_cgroup_tree_next(tree, node, max_depth)))
+		cnt++;
+
+	adaptived_cgroup_tree_put(&tree);
+
+	return cnt;
+}
+
+TEST_F(CgroupTreeTest, InvalidSettings)
+{
+	struct adaptived_cgroup_tree *tree = NULL;
+
+	ASSERT_EQ(adaptived_get_cgroup_tree(NULL, &tree), -EINVAL);
+	ASSERT_EQ(adaptived_get_cgroup_tree("test023", NULL), -EINVAL);
+	ASSERT_EQ(adaptived_get_cgroup_tree("test023-does-not-exist", &tree), -ENOENT);
+	ASSERT_EQ(tree, nullptr);
+
+	ASSERT_EQ(adaptived_cgroup_tree_next(NULL, NULL, -1), nullptr);
+	ASSERT_EQ(adaptived_cgroup_tree_node_path(NULL), nullptr);
+	ASSERT_EQ(adaptived_cgroup_tree_node_dirfd(NULL), -EINVAL);
+}
+
+TEST_F(CgroupTreeTest, Walk)
+{
+	struct adaptived_cgroup_tree_node *node;
+	struct adaptived_cgroup_tree *tree = NULL;
+	int ret;
+
+	ASSERT_EQ(count_nodes("test023", -1), 4);
+	ASSERT_EQ(count_nodes("test023/*", -1), 4);
+	ASSERT_EQ(count_nodes("test023", 0), 3);
+
+	ret = adaptived_get_cgroup_tree("test023*", &tree);
+	ASSERT_EQ(ret, 0);
+
+	node = adaptived_cgroup_tree_next(tree, NULL, -1);
+	ASSERT_STREQ(adaptived_cgroup_tree_node_path(node), "test023");
+	ASSERT_STREQ(adaptived_cgroup_tree_node_name(node), "test023");
+	ASSERT_EQ(adaptived_cgroup_tree_node_depth(node), 0);
+
+	do {
+		node = adaptived_cgroup_tree_next(tree, node, -1);
+		ASSERT_NE(node, nullptr);
+	} while (strcmp(adaptived_cgroup_tree_node_name(node), "grandchild11") != 0);
+
+	ASSERT_STREQ(adaptived_cgroup_tree_node_path(node), "test023/child1/grandchild11");
+	ASSERT_EQ(adaptived_cgroup_tree_node_depth(node), 2);
+
+	adaptived_cgroup_tree_put(&tree);
+	ASSERT_EQ(tree, nullptr);
+}
+
+TEST_F(CgroupTreeTest, Updates)
+{
+	ASSERT_EQ(count_nodes("test023", -1), 4);
+
+	/* the new directories are picked up from the inotify events */
+	ASSERT_EQ(mkdir("test023/child3", S_IRWXU), 0);
+	ASSERT_EQ(mkdir("test023/child3/grandchild31", S_IRWXU), 0);
+	ASSERT_EQ(mkdir("test023/child2/grandchild21", S_IRWXU), 0);
+	ASSERT_EQ(count_nodes("test023", -1), 7);
+
+	/* files are not part of the tree */
+	ASSERT_EQ(close(open("test023/child2/memory.high", O_CREAT | O_WRONLY, S_IRWXU)), 0);
+	ASSERT_EQ(count_nodes("test023", -1), 7);
+
+	ASSERT_EQ(rmrf("test023/child1"), 0);
+	ASSERT_EQ(count_nodes("test023", -1), 5);
+
+	ASSERT_EQ(rename("test023/child3", "test023/child4"), 0);
+	ASSERT_EQ(count_nodes("test023", -1), 5);
+	ASSERT_EQ(count_nodes("test023", 0), 3);
+
+	/* the tree is rebuilt when its root is recreated */
+	ASSERT_EQ(rmrf("test023"), 0);
+	ASSERT_EQ(count_nodes("test023", -1), -ENOENT);
+	ASSERT_EQ(mkdir("test023", S_IRWXU), 0);
+	ASSERT_EQ(count_nodes("test023", -1), 1);
+}
+
+TEST_F(CgroupTreeTest, Dirfd)
+{
+	struct adaptived_cgroup_tree_node *node;
+	struct adaptived_cgroup_tree *tree = NULL;
+	int dirfd, fd, ret;
+
+	ASSERT_EQ(close(open("test023/child2/memory.high", O_CREAT | O_WRONLY, S_IRWXU)), 0);
+
+	ret = adaptived_get_cgroup_tree("test023", &tree);
+	ASSERT_EQ(ret, 0);
+
+	node = NULL;
+	do {
+		node = adaptived_cgroup_tree_next(tree, node, -1);
+		ASSERT_NE(node, nullptr);
+	} while (strcmp(adaptived_cgroup_tree_node_name(node), "child2") != 0);
+
+	dirfd = adaptived_cgroup_tree_node_dirfd(node);
+	ASSERT_GE(dirfd, 0);
+	ASSERT_EQ(adaptived_cgroup_tree_node_dirfd(node), dirfd);
+
+	fd = openat(dirfd, "memory.high", O_RDONLY);
+	ASSERT_GE(fd, 0);
+	close(fd);
+
+	adaptived_cgroup_tree_put(&tree);
+}
@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) 2025, Oracle and/or its affiliates.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+/**
+ * adaptived googletest for the dirfd-relative directory walker
+ */
+
+#include <sys/stat.h>
+#include <dirent.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <errno.h>
+#include <ftw.h>
+
+#include <adaptived-utils.h>
+#include <adaptived.h>
+
+#include "gtest/gtest.h"
+#include "defines.h"
+
+static const char * const dirs[] = {
+	"test024",
+	"test024/child1",
+	"test024/child1/grandchild11",
+	"test024/child2",
+};
+
+static const char * const files[] = {
+	"test024/file0",
+	"test024/child1/file1",
+	"test024/child1/grandchild11/file11",
+};
+
+class DirWalkTest : public ::testing::Test {
+	protected:
+
+	void SetUp() override {
+		int ret, i, fd;
+
+		for (i = 0; i < (int)ARRAY_SIZE(dirs); i++) {
+			ret = mkdir(dirs[i], S_IRWXU | S_IRWXG | S_IRWXO);
+			ASSERT_EQ(ret, 0);
+		}
+
+		for (i = 0; i < (int)ARRAY_SIZE(files); i++) {
+			fd = open(files[i], O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+			ASSERT_GE(fd, 0);
+			ASSERT_EQ(write(fd, "1234\n", 5), 5);
+			close(fd);
+		}
+	}
+
+	static int unlink_cb(const char *fpath, const struct stat *sb, int typeflag,
+			     struct FTW *ftwbuf) {
+		return remove(fpath);
+	}
+
+	int rmrf(const char * const path) {
+		return nftw(path, unlink_cb, 64, FTW_DEPTH | FTW_PHYS);
+	}
+
+	void TearDown() override {
+		rmrf(dirs[0]);
+	}
+};
+
+static int count_entries(const char * const path, int flags, int max_depth)
+{
+	struct adaptived_dir_walk_entry entry;
+	struct adaptived_dir_walk *walk = NULL;
+	int ret, cnt = 0;
+
+	ret = adaptived_dir_walk_start(path, flags, max_depth, &walk);
+	if (ret)
+		return ret;
+
+	while ((ret = adaptived_dir_walk_next(walk, &entry)) > 0)
+		cnt++;
+
+	adaptived_dir_walk_end(&walk);
+
+	if (ret < 0)
+		return ret;
+
+	return cnt;
+}
+
+TEST_F(DirWalkTest, InvalidSettings)
+{
+	struct adaptived_dir_walk_entry entry;
+	struct adaptived_dir_walk *walk = NULL;
+
+	ASSERT_EQ(adaptived_dir_walk_start(NULL, 0, -1, &walk), -EINVAL);
+	ASSERT_EQ(adaptived_dir_walk_start("test024", 0, -1, NULL), -EINVAL);
+	ASSERT_EQ(adaptived_dir_walk_start("test024-does-not-exist", 0, -1, &walk), -ENOENT);
+	ASSERT_EQ(adaptived_dir_walk_start("test024/file0", 0, -1, &walk), -ENOTDIR);
+	ASSERT_EQ(walk, nullptr);
+
+	ASSERT_EQ(adaptived_dir_walk_next(NULL, &entry), -EINVAL);
+
+	/* these are no-ops */
+	adaptived_dir_walk_end(NULL);
+	adaptived_dir_walk_end(&walk);
+}
+
+TEST_F(DirWalkTest, Counts)
+{
+	const int dirs_files = ADAPTIVED_PATH_WALK_LIST_DIRS | ADAPTIVED_PATH_WALK_LIST_FILES;
+
+	ASSERT_EQ(count_entries("test024", 0, -1), 4);
+	ASSERT_EQ(count_entries("test024/", 0, -1), 4);
+	ASSERT_EQ(count_entries("test024*", 0, -1), 4);
+	ASSERT_EQ(count_entries("test024/*", 0, -1), 3);
+	ASSERT_EQ(count_entries("test024", 0, 0), 3);
+	ASSERT_EQ(count_entries("test024", 0, 1), 4);
+
+	ASSERT_EQ(count_entries("test024", ADAPTIVED_PATH_WALK_LIST_FILES, -1), 3);
+	ASSERT_EQ(count_entries("test024", ADAPTIVED_PATH_WALK_LIST_FILES, 0), 1);
+	ASSERT_EQ(count_entries("test024", dirs_files, -1), 7);
+
+	/* each directory has a "." and ".." */
+	ASSERT_EQ(count_entries("test024", dirs_files | ADAPTIVED_PATH_WALK_LIST_DOT_DIRS, -1),
+		  15);
+}
+
+TEST_F(DirWalkTest, MatchesPathWalk)
+{
+	struct adaptived_path_walk_handle *handle = NULL;
+	const int max_depths[] = { -1, 0, 1 };
+	struct adaptived_dir_walk_entry entry;
+	struct adaptived_dir_walk *walk = NULL;
+	char *path;
+	int ret, i;
+
+	for (i = 0; i < (int)ARRAY_SIZE(max_depths); i++) {
+		ret = adaptived_path_walk_start("test024", &handle, 0, max_depths[i]);
+		ASSERT_EQ(ret, 0);
+		ret = adaptived_dir_walk_start("test024", 0, max_depths[i], &walk);
+		ASSERT_EQ(ret, 0);
+
+		/* both walks read the same directories in the same order */
+		do {
+			ret = adaptived_path_walk_next(&handle, &path);
+			ASSERT_EQ(ret, 0);
+
+			ret = adaptived_dir_walk_next(walk, &entry);
+			if (!path) {
+				ASSERT_EQ(ret, 0);
+				break;
+			}
+			ASSERT_EQ(ret, 1);
+
+			ASSERT_EQ(strcmp(&path[strlen(path) - strlen(entry.name)], entry.name), 0);
+			free(path);
+		} while (true);
+
+		adaptived_path_walk_end(&handle);
+		adaptived_dir_walk_end(&walk);
+		ASSERT_EQ(walk, nullptr);
+	}
+}
+
+TEST_F(DirWalkTest, Entries)
+{
+	struct adaptived_dir_walk_entry entry;
+	struct adaptived_dir_walk *walk = NULL;
+	char buf[16] = { '\0' };
+	bool found = false;
+	int ret, fd;
+
+	ret = adaptived_dir_walk_start("test024", ADAPTIVED_PATH_WALK_LIST_DIRS |
+				       ADAPTIVED_PATH_WALK_LIST_FILES, -1, &walk);
+	ASSERT_EQ(ret, 0);
+
+	ret = adaptived_dir_walk_next(walk, &entry);
+	ASSERT_EQ(ret, 1);
+	ASSERT_EQ(entry.dirfd, AT_FDCWD);
+	ASSERT_STREQ(entry.name, "test024");
+	ASSERT_GE(entry.fd, 0);
+	ASSERT_EQ(entry.depth, 0);
+	ASSERT_EQ(entry.type, DT_DIR);
+
+	while ((ret = adaptived_dir_walk_next(walk, &entry)) > 0) {
+		if (strcmp(entry.name, "grandchild11") == 0) {
+			ASSERT_EQ(entry.type, DT_DIR);
+			ASSERT_EQ(entry.depth, 2);
+
+			/* the directory's contents can be opened relative to its fd */
+			fd = openat(entry.fd, "file11", O_RDONLY);
+			ASSERT_GE(fd, 0);
+			ASSERT_EQ(read(fd, buf, sizeof(buf) - 1), 5);
+			close(fd);
+			ASSERT_STREQ(buf, "1234\n");
+		} else if (strcmp(entry.name, "file1") == 0) {
+			ASSERT_EQ(entry.type, DT_REG);
+			ASSERT_EQ(entry.depth, 2);
+			ASSERT_EQ(entry.fd, -1);
+
+			fd = openat(entry.dirfd, entry.name, O_RDONLY);
+			ASSERT_GE(fd, 0);
+			close(fd);
+			found = true;
+		}
+	}
+
+	ASSERT_EQ(ret, 0);
+	ASSERT_TRUE(found);
+
+	adaptived_dir_walk_end(&walk);
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2025, Oracle and/or its affiliates.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+/**
+ * The original fopen()/getline()/strstr() PSI parser, shared by the PSI parser
+ * googletest and benchmark
+ */
+
+#ifndef __ADAPTIVED_TESTS_LEGACY_PRESSURE_H
+#define __ADAPTIVED_TESTS_LEGACY_PRESSURE_H
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+
+#include <adaptived-utils.h>
+
+/*
+ * The parser that adaptived_get_pressure() used previously.  The gunit test
+ * checks that the new parser produces the same results, and the benchmark
+ * compares their per-call cost
+ */
+static inline void legacy_get_avgs(const char * const line, struct adaptived_pressure_avgs * const pa)
+{
+	const char *subp;
+
+	subp = strstr(line, "avg10");
+	subp = strstr(subp, "=");
+	pa->avg10 = strtof(&subp[1], NULL);
+
+	subp = strstr(subp, "avg60");
+	subp = strstr(subp, "=");
+	pa->avg60 = strtof(&subp[1], NULL);
+
+	subp = strstr(subp, "avg300");
+	subp = strstr(subp, "=");
+	pa->avg300 = strtof(&subp[1], NULL);
+
+	subp = strstr(subp, "total");
+	subp = strstr(subp, "=");
+	pa->total = strtoll(&subp[1], 0, 0);
+}
+
+static inline int legacy_get_pressure(const char * const pressure_file,
+			       struct adaptived_pressure_snapshot * const ps)
+{
+	char *line = NULL;
+	size_t len = 0;
+	FILE *fp;
+
+	fp = fopen(pressure_file, "r");
+	if (!fp)
+		return -errno;
+
+	memset(ps, 0, sizeof(*ps));
+
+	while (getline(&line, &len, fp) != -1) {
+		if (strncmp(line, "some", 4) == 0)
+			legacy_get_avgs(line, &ps->some);
+		if (strncmp(line, "full", 4) == 0)
+			legacy_get_avgs(line, &ps->full);
+	}
+
+	fclose(fp);
+	free(line);
+
+	return 0;
+}
+
+#endif /* __ADAPTIVED_TESTS_LEGACY_PRESSURE_H */
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2025, Oracle and/or its affiliates.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+ */
+/**
+ * Microbenchmark that compares the per-call cost of adaptived_get_pressure() against
+ * the original fopen()/getline()/strstr() parser
+ *
+ * It is built by "make check", but it isn't run as part of the test suite.  Run it
+ * by hand, optionally with the PSI files to read, e.g.
+ *	./pressure_parse_bench /proc/pressure/cpu /proc/pressure/memory
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <adaptived-utils.h>
+#include <adaptived.h>
+
+#include "legacy_pressure.h"
+
+static const char * const PRESSURE_FILE = "pressure_parse_bench.pressure";
+static const int BENCH_LOOPS = 20000;
+
+static long long NowNs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int Benchmark(const char * const pressure_file)
+{
+	struct adaptived_pressure_snapshot ps;
+	long long start, legacy_ns, new_ns;
+	int i, ret;
+
+	start = NowNs();
+	for (i = 0; i < BENCH_LOOPS; i++) {
+		ret = legacy_get_pressure(pressure_file, &ps);
+		if (ret)
+			return ret;
+	}
+	legacy_ns = NowNs() - start;
+
+	start = NowNs();
+	for (i = 0; i < BENCH_LOOPS; i++) {
+		ret = adaptived_get_pressure(pressure_file, &ps);
+		if (ret)
+			return ret;
+	}
+	new_ns = NowNs() - start;
+
+	printf("%s: legacy %lld ns/call, adaptived_get_pressure() %lld ns/call\n",
+	       pressure_file, legacy_ns / BENCH_LOOPS, new_ns / BENCH_LOOPS);
+
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	int ret, i;
+	FILE *f;
+
+	if (argc > 1) {
+		for (i = 1; i < argc; i++) {
+			ret = Benchmark(argv[i]);
+			if (ret) {
+				fprintf(stderr, "Failed to read %s: %d\n", argv[i], ret);
+				return EXIT_FAILURE;
+			}
+		}
+
+		return EXIT_SUCCESS;
+	}
+
+	f = fopen(PRESSURE_FILE, "w");
+	if (!f)
+		return EXIT_FAILURE;
+
+	fprintf(f, "some avg10=1.23 avg60=45.60 avg300=99.99 total=123456789\n"
+		   "full avg10=0.07 avg60=100.00 avg300=0.00 total=9876543210\n");
+	fclose(f);
+
+	ret = Benchmark(PRESSURE_FILE);
+	remove(PRESSURE_FILE);
+	if (ret)
+		return EXIT_FAILURE;
+
+	/* PSI may not be enabled */
+	(void)Benchmark("/proc/pressure/cpu");
+
+	return EXIT_SUCCESS;
+}